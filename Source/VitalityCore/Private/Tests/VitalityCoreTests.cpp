@@ -0,0 +1,133 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "VitalityCombatMath.h"
+#include "VitalityEffectLifetime.h"
+#include "VitalityPoolMath.h"
+#include "VitalityStatMath.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVitalityPoolMathTest, "VitalityCore.PoolMath",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVitalityPoolMathTest::RunTest(const FString& Parameters)
+{
+	// Percent is clamped, and a pool with no maximum is not in use
+	TestEqual(TEXT("Half pool"), FVitalityPoolMath::GetPercent(50.f, 100.f), 0.5f);
+	TestEqual(TEXT("Overfull pool clamps to one"), FVitalityPoolMath::GetPercent(150.f, 100.f), 1.f);
+	TestEqual(TEXT("Negative pool clamps to zero"), FVitalityPoolMath::GetPercent(-10.f, 100.f), 0.f);
+	TestEqual(TEXT("Zero maximum"), FVitalityPoolMath::GetPercent(50.f, 0.f), 0.f);
+	TestEqual(TEXT("Negative maximum"), FVitalityPoolMath::GetPercent(50.f, -1.f), 0.f);
+
+	// Damage ignores its sign, and lethal damage stops at zero
+	float Current = 100.f;
+	TestEqual(TEXT("Damage"), FVitalityPoolMath::ApplyDamage(Current, 30.f), 70.f);
+	TestEqual(TEXT("Negative damage still removes"), FVitalityPoolMath::ApplyDamage(Current, -20.f), 50.f);
+	TestEqual(TEXT("Lethal damage stops at zero"), FVitalityPoolMath::ApplyDamage(Current, 500.f), 0.f);
+	TestEqual(TEXT("Damage is written back"), Current, 0.f);
+
+	// Adding is clamped to [0, Maximum], and a zero maximum holds nothing
+	Current = 90.f;
+	TestEqual(TEXT("Add clamps to maximum"), FVitalityPoolMath::Add(Current, 100.f, 50.f), 100.f);
+	TestEqual(TEXT("Negative add clamps to zero"), FVitalityPoolMath::Add(Current, 100.f, -500.f), 0.f);
+	TestEqual(TEXT("Add to zero maximum"), FVitalityPoolMath::Add(Current, 0.f, 10.f), 0.f);
+
+	// Lowering the maximum clamps the current value
+	float Maximum = 100.f;
+	Current = 80.f;
+	TestFalse(TEXT("Lowered maximum is full"), FVitalityPoolMath::SetMaximum(Current, Maximum, 50.f));
+	TestEqual(TEXT("Current clamped to new maximum"), Current, 50.f);
+	FVitalityPoolMath::SetMaximum(Current, Maximum, -10.f);
+	TestEqual(TEXT("Negative maximum is zero"), Maximum, 0.f);
+	TestEqual(TEXT("Current clamped to zero maximum"), Current, 0.f);
+	TestTrue(TEXT("Raised maximum has room"), FVitalityPoolMath::SetMaximum(Current, Maximum, 100.f));
+
+	// Regen and drain stop at the bounds and report when they are done
+	Current = 95.f;
+	TestTrue(TEXT("Regen fills the pool"), FVitalityPoolMath::Regenerate(Current, 100.f, 10.f));
+	TestEqual(TEXT("Regen stops at maximum"), Current, 100.f);
+	Current = 5.f;
+	TestTrue(TEXT("Drain empties the pool"), FVitalityPoolMath::Drain(Current, 10.f));
+	TestEqual(TEXT("Drain stops at zero"), Current, 0.f);
+
+	// Health at zero never regenerates, and hunger gates health below the threshold
+	Current = 0.f;
+	TestFalse(TEXT("Dead health does not regenerate"), FVitalityPoolMath::RegenerateHealth(Current, 100.f, 10.f, 1.f));
+	TestEqual(TEXT("Dead health stays at zero"), Current, 0.f);
+	Current = 50.f;
+	FVitalityPoolMath::RegenerateHealth(Current, 100.f, 10.f, 0.1f);
+	TestEqual(TEXT("Starving health does not regenerate"), Current, 50.f);
+	FVitalityPoolMath::RegenerateHealth(Current, 100.f, 10.f, FVitalityPoolMath::HungerRegenThreshold);
+	TestEqual(TEXT("Fed health regenerates"), Current, 60.f);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVitalityCombatMathTest, "VitalityCore.CombatMath",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVitalityCombatMathTest::RunTest(const FString& Parameters)
+{
+	TestTrue(TEXT("Relaxed increases to alert"),
+		FVitalityCombatMath::GetIncreased(EVitalityCombatLevel::Relaxed) == EVitalityCombatLevel::Alert);
+	TestTrue(TEXT("Engaged cannot increase"),
+		FVitalityCombatMath::GetIncreased(EVitalityCombatLevel::Engaged) == EVitalityCombatLevel::Engaged);
+	TestTrue(TEXT("Engaged decreases to alert"),
+		FVitalityCombatMath::GetDecreased(EVitalityCombatLevel::Engaged) == EVitalityCombatLevel::Alert);
+	TestTrue(TEXT("Relaxed cannot decrease"),
+		FVitalityCombatMath::GetDecreased(EVitalityCombatLevel::Relaxed) == EVitalityCombatLevel::Relaxed);
+
+	TestEqual(TEXT("Newly alert decays quickly"), FVitalityCombatMath::GetDecayTime(
+		EVitalityCombatLevel::Relaxed, EVitalityCombatLevel::Alert), FVitalityCombatMath::AlertTimeout);
+	TestEqual(TEXT("Sustained alert decays slowly"), FVitalityCombatMath::GetDecayTime(
+		EVitalityCombatLevel::Alert, EVitalityCombatLevel::Alert), FVitalityCombatMath::EngagedTimeout);
+	TestEqual(TEXT("Relaxed does not decay"), FVitalityCombatMath::GetDecayTime(
+		EVitalityCombatLevel::Alert, EVitalityCombatLevel::Relaxed), 0.f);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVitalityEffectLifetimeTest, "VitalityCore.EffectLifetime",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVitalityEffectLifetimeTest::RunTest(const FString& Parameters)
+{
+	// A non-persistent effect runs out on its last tick
+	int32 TicksRemaining = 2;
+	TestFalse(TEXT("First tick keeps the effect"), FVitalityEffectLifetime::Tick(TicksRemaining, false));
+	TestEqual(TEXT("First tick counts down"), TicksRemaining, 1);
+	TestTrue(TEXT("Last tick expires the effect"), FVitalityEffectLifetime::Tick(TicksRemaining, false));
+
+	// A persistent effect never runs out or counts down
+	TicksRemaining = 1;
+	TestFalse(TEXT("Persistent effect does not expire"), FVitalityEffectLifetime::Tick(TicksRemaining, true));
+	TestEqual(TEXT("Persistent effect does not count down"), TicksRemaining, 1);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVitalityStatMathTest, "VitalityCore.StatMath",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVitalityStatMathTest::RunTest(const FString& Parameters)
+{
+	const float Base[]		= { 10.f, 20.f, 30.f };
+	const float Gear[]		= { 1.f, 2.f };
+	const float Effects[]	= { 5.f, 5.f, 5.f };
+	const TConstArrayView<float> Layers[] = { Base, Gear, Effects };
+
+	TestEqual(TEXT("Total across layers"), FVitalityStatMath::GetTotal(Layers, 0), 16.f);
+	TestEqual(TEXT("Short layers count as zero"), FVitalityStatMath::GetTotal(Layers, 2), 35.f);
+	TestEqual(TEXT("Index past every layer"), FVitalityStatMath::GetTotal(Layers, 5), 0.f);
+	TestEqual(TEXT("Missing value"), FVitalityStatMath::GetLayerValue(Gear, 2), 0.f);
+
+	// Accumulating copies the layer and adds it to the total, up to the shortest view
+	float OutLayer[]	= { 0.f, 0.f, 0.f };
+	float OutTotal[]	= { 100.f, 100.f, 100.f };
+	FVitalityStatMath::AccumulateLayer(Gear, OutLayer, OutTotal);
+	TestEqual(TEXT("Layer copied"), OutLayer[1], 2.f);
+	TestEqual(TEXT("Layer added to total"), OutTotal[1], 102.f);
+	TestEqual(TEXT("Total past the layer untouched"), OutTotal[2], 100.f);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,41 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "VitalityCombatMath.h"
+
+
+EVitalityCombatLevel FVitalityCombatMath::GetIncreased(EVitalityCombatLevel State)
+{
+	switch (State)
+	{
+	case EVitalityCombatLevel::Recovery:	return EVitalityCombatLevel::Relaxed;
+	case EVitalityCombatLevel::Relaxed:		return EVitalityCombatLevel::Alert;
+	case EVitalityCombatLevel::Injured:		return EVitalityCombatLevel::Alert;
+	case EVitalityCombatLevel::Alert:		return EVitalityCombatLevel::Engaged;
+	default: // Already engaged (highest), or not applicable
+		return State;
+	}
+}
+
+EVitalityCombatLevel FVitalityCombatMath::GetDecreased(EVitalityCombatLevel State)
+{
+	switch (State)
+	{
+	case EVitalityCombatLevel::Engaged:	return EVitalityCombatLevel::Alert;
+	case EVitalityCombatLevel::Alert:	return EVitalityCombatLevel::Relaxed;
+	case EVitalityCombatLevel::Injured:	return EVitalityCombatLevel::Relaxed;
+	default:
+		return State;
+	}
+}
+
+float FVitalityCombatMath::GetDecayTime(EVitalityCombatLevel OldState, EVitalityCombatLevel NewState)
+{
+	switch (NewState)
+	{
+	// Newly alert decays quickly, while sustained alertness waits as long as engagement
+	case EVitalityCombatLevel::Alert:	return OldState != EVitalityCombatLevel::Alert ? AlertTimeout : EngagedTimeout;
+	case EVitalityCombatLevel::Engaged:	return EngagedTimeout;
+	default:
+		return 0.f;
+	}
+}
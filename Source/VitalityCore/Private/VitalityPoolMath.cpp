@@ -0,0 +1,57 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "VitalityPoolMath.h"
+
+
+float FVitalityPoolMath::ApplyDamage(float& Current, float Damage)
+{
+	Current = FMath::Max(Current - FMath::Abs(Damage), 0.f);
+	return Current;
+}
+
+float FVitalityPoolMath::Add(float& Current, float Maximum, float Amount)
+{
+	Current = FMath::Clamp(Current + Amount, 0.f, FMath::Max(Maximum, 0.f));
+	return Current;
+}
+
+bool FVitalityPoolMath::SetMaximum(float& Current, float& Maximum, float NewMaximum)
+{
+	Maximum = FMath::Max(NewMaximum, 0.f);
+	if (Current > Maximum)
+		Current = Maximum;
+	return Current < Maximum;
+}
+
+bool FVitalityPoolMath::Regenerate(float& Current, float Maximum, float Rate)
+{
+	if (Current < Maximum)
+		Current = FMath::Min(Current + Rate, Maximum);
+	else
+		Current = Maximum;
+	return Current >= Maximum;
+}
+
+bool FVitalityPoolMath::RegenerateHealth(float& Current, float Maximum, float Rate, float HungerPercent)
+{
+	if (Current <= 0.f)
+		return false;
+	if (Current >= Maximum)
+	{
+		Current = Maximum;
+		return true;
+	}
+
+	const bool bWellFed		= HungerPercent >= HungerRegenThreshold;
+	const bool bBelowHunger	= (Current / Maximum) * HungerHealthFactor < HungerPercent;
+	if (bWellFed || bBelowHunger)
+		Current = FMath::Min(Current + Rate, Maximum);
+	return Current >= Maximum;
+}
+
+bool FVitalityPoolMath::Drain(float& Current, float Rate)
+{
+	if (Current > 0.f)
+		Current = FMath::Max(Current - Rate, 0.f);
+	return Current <= 0.f;
+}
@@ -0,0 +1,22 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "VitalityStatMath.h"
+
+
+float FVitalityStatMath::GetTotal(TConstArrayView<TConstArrayView<float>> Layers, int32 Index)
+{
+	float Total = 0.f;
+	for (const TConstArrayView<float>& Layer : Layers)
+		Total += GetLayerValue(Layer, Index);
+	return Total;
+}
+
+void FVitalityStatMath::AccumulateLayer(TConstArrayView<float> Layer, TArrayView<float> OutLayer, TArrayView<float> OutTotal)
+{
+	const int32 NumValues = FMath::Min3(Layer.Num(), OutLayer.Num(), OutTotal.Num());
+	for (int32 i = 0; i < NumValues; i++)
+	{
+		OutLayer[i]	 = Layer[i];
+		OutTotal[i]	+= Layer[i];
+	}
+}
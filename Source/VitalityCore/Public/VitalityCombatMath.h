@@ -0,0 +1,39 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+// Mirrors ECombatState, which cannot be used here since it is reflected
+enum class EVitalityCombatLevel : uint8
+{
+	Relaxed = 0,
+	Alert,
+	Engaged,
+	Recovery,
+	Injured,
+	Max
+};
+
+
+// The combat state transitions. Timers and delegates stay with the welfare component.
+struct VITALITYCORE_API FVitalityCombatMath
+{
+	// Seconds before a combat state decays to the next lower one
+	static constexpr float AlertTimeout		= 3.f;
+	static constexpr float EngagedTimeout	= 10.f;
+
+	// Returns the next higher state, or the same state if it cannot increase
+	static EVitalityCombatLevel GetIncreased(EVitalityCombatLevel State);
+	// Returns the next lower state, or the same state if it cannot decrease
+	static EVitalityCombatLevel GetDecreased(EVitalityCombatLevel State);
+
+	/**
+	 * @brief The seconds until a newly set state should decrease. Hostile action restarts the countdown.
+	 * @param OldState The state before it was set
+	 * @param NewState The state that was set
+	 * @return The countdown, or zero if the new state does not decay
+	 */
+	static float GetDecayTime(EVitalityCombatLevel OldState, EVitalityCombatLevel NewState);
+};
@@ -0,0 +1,24 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+// How long effects last. The effect rows themselves stay with the effects component.
+struct VITALITYCORE_API FVitalityEffectLifetime
+{
+	/**
+	 * @brief Counts down one tick of an effect. Persistent effects never run out.
+	 * @param TicksRemaining The effect's remaining ticks, decremented unless persistent
+	 * @param bIsPersistent True if the effect lasts until removed
+	 * @return True if the effect has run out and should be removed
+	 */
+	static bool Tick(int32& TicksRemaining, bool bIsPersistent)
+	{
+		if (bIsPersistent)
+			return false;
+		TicksRemaining--;
+		return TicksRemaining < 1;
+	}
+};
@@ -0,0 +1,62 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/**
+ * The rules of a vitality pool, like health, stamina or calories. A pool is a current and
+ * maximum value; a pool with no maximum is not in use. Every function works on the caller's
+ * own values, so components keep their replicated members and only delegate the math here.
+ */
+struct VITALITYCORE_API FVitalityPoolMath
+{
+	// Below this hunger percent, health only regenerates while under HungerHealthFactor x hunger
+	static constexpr float HungerRegenThreshold	= 0.4f;
+	static constexpr float HungerHealthFactor	= 0.4f;
+
+	// Returns the pool as a percent in [0, 1], or zero if the pool is not in use
+	static float GetPercent(float Current, float Maximum)
+	{
+		return Maximum > 0.f ? FMath::Clamp(Current / Maximum, 0.f, 1.f) : 0.f;
+	}
+
+	/**
+	 * @brief Removes the damage from the pool, stopping at zero. The sign of the damage is ignored.
+	 * @return The new current value
+	 */
+	static float ApplyDamage(float& Current, float Damage);
+
+	/**
+	 * @brief Adds the amount to the pool, clamped to [0, Maximum]. Negative amounts remove.
+	 * @return The new current value
+	 */
+	static float Add(float& Current, float Maximum, float Amount);
+
+	/**
+	 * @brief Sets the maximum, treating negative values as zero, and clamps the current value.
+	 * @return True if the pool now has room to regenerate
+	 */
+	static bool SetMaximum(float& Current, float& Maximum, float NewMaximum);
+
+	/**
+	 * @brief Regenerates one tick, clamped to the maximum.
+	 * @return True once the pool is full, meaning its regen can stop
+	 */
+	static bool Regenerate(float& Current, float Maximum, float Rate);
+
+	/**
+	 * @brief Regenerates one tick of health, gated by hunger. Above the hunger threshold health
+	 *        regenerates fully; below it, health only regenerates while its percent stays under
+	 *        HungerHealthFactor times the hunger percent. Health at zero does not regenerate.
+	 * @return True once health is full, meaning its regen can stop
+	 */
+	static bool RegenerateHealth(float& Current, float Maximum, float Rate, float HungerPercent);
+
+	/**
+	 * @brief Drains one tick, stopping at zero.
+	 * @return True once the pool is empty, meaning its drain can stop
+	 */
+	static bool Drain(float& Current, float Rate);
+};
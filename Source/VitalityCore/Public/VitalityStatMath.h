@@ -0,0 +1,27 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+// Stat layer totals. A layer is an array of values indexed by stat or damage type.
+struct VITALITYCORE_API FVitalityStatMath
+{
+	// Returns the value at the index, or zero if the layer does not have it
+	static float GetLayerValue(TConstArrayView<float> Layer, int32 Index)
+	{
+		return Layer.IsValidIndex(Index) ? Layer[Index] : 0.f;
+	}
+
+	// Returns the sum of the value at the index across every layer that has it
+	static float GetTotal(TConstArrayView<TConstArrayView<float>> Layers, int32 Index);
+
+	/**
+	 * @brief Copies a layer and adds it to a running total, up to the shortest of the three.
+	 * @param Layer The layer to read
+	 * @param OutLayer Receives a copy of the layer
+	 * @param OutTotal The total the layer is added to
+	 */
+	static void AccumulateLayer(TConstArrayView<float> Layer, TArrayView<float> OutLayer, TArrayView<float> OutTotal);
+};
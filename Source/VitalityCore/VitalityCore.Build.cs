@@ -0,0 +1,20 @@
+// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+using UnrealBuildTool;
+
+// The vitality rules as plain C++. Depends on Core only, so it can be tested and
+// benchmarked without an engine, a world or any UObject.
+public class VitalityCore : ModuleRules
+{
+	public VitalityCore(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Core"
+			}
+			);
+	}
+}
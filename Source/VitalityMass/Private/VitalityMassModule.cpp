@@ -0,0 +1,5 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "Modules/ModuleManager.h"
+
+IMPLEMENT_MODULE(FDefaultModuleImpl, VitalityMass);
@@ -0,0 +1,394 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "VitalityMassProcessors.h"
+
+#include "MassActorSubsystem.h"
+#include "MassCommonTypes.h"
+#include "MassEntityManager.h"
+#include "MassExecutionContext.h"
+#include "VitalityEffectLifetime.h"
+#include "VitalityPoolMath.h"
+#include "VitalityWelfareComponent.h"
+#include "lib/VitalityStats.h"
+
+
+namespace
+{
+	constexpr int32 AuthorityExecutionFlags =
+		static_cast<int32>(EProcessorExecutionFlags::Server | EProcessorExecutionFlags::Standalone);
+
+	// Runs the ticks that came due this frame, the same as the welfare component's timers would
+	void StepPools(FVitalityPoolsFragment& Pools, float DeltaTime)
+	{
+		for (int32 i = 0; i < FVitalityPoolsFragment::NumPools; i++)
+		{
+			if (Pools.Maximum[i] <= 0.f || FMath::IsNearlyZero(Pools.Rate[i]))
+				continue;
+
+			Pools.Elapsed[i] += DeltaTime;
+			const int32 NumTicks = FMath::FloorToInt32(Pools.Elapsed[i] / Pools.TickRate[i]);
+			if (NumTicks < 1)
+				continue;
+			Pools.Elapsed[i] -= NumTicks * Pools.TickRate[i];
+
+			float& Current		= Pools.Current[i];
+			const float Maximum	= Pools.Maximum[i];
+			const float Rate	= Pools.Rate[i];
+			bool bIsSettled		= false;
+			for (int32 Tick = 0; Tick < NumTicks && !bIsSettled; Tick++)
+			{
+				switch (static_cast<EVitalityCategory>(i))
+				{
+				case EVitalityCategory::HEALTH:
+					bIsSettled = FVitalityPoolMath::RegenerateHealth(Current, Maximum, Rate,
+						Pools.GetPercent(EVitalityCategory::HUNGER));
+					break;
+				case EVitalityCategory::STAMINA:
+					bIsSettled = FVitalityPoolMath::Regenerate(Current, Maximum, Rate);
+					break;
+				case EVitalityCategory::HUNGER:
+				case EVitalityCategory::THIRST:
+					bIsSettled = FVitalityPoolMath::Drain(Current, Rate);
+					break;
+				default: // Magic does not regenerate passively
+					bIsSettled = true;
+					break;
+				}
+			}
+		}
+	}
+}
+
+
+/****************************************
+ * DAMAGE
+****************************************/
+
+UVitalityMassDamageProcessor::UVitalityMassDamageProcessor()
+	: EntityQuery_(*this)
+{
+	ExecutionFlags = AuthorityExecutionFlags;
+	ExecutionOrder.ExecuteAfter.Add(UVitalityMassActorBridgeProcessor::StaticClass()->GetFName());
+}
+
+bool UVitalityMassDamageProcessor::QueueDamage(FMassEntityManager& EntityManager, FMassEntityHandle Entity,
+	float DamageTaken, AActor* DamageInstigator)
+{
+	check(IsInGameThread());
+	if (!EntityManager.IsEntityValid(Entity))
+		return false;
+
+	// While an actor represents the entity, its welfare component owns health
+	if (const FVitalityActorBridgeFragment* Bridge = EntityManager.GetFragmentDataPtr<FVitalityActorBridgeFragment>(Entity))
+	{
+		if (const AActor* BoundActor = Bridge->BoundActor.Get())
+		{
+			if (UVitalityWelfareComponent* WelfareComponent = BoundActor->FindComponentByClass<UVitalityWelfareComponent>())
+			{
+				WelfareComponent->DamageHealth(DamageInstigator, DamageTaken);
+				return true;
+			}
+		}
+	}
+
+	FVitalityDamageFragment* Damage = EntityManager.GetFragmentDataPtr<FVitalityDamageFragment>(Entity);
+	if (Damage == nullptr)
+		return false;
+	Damage->PendingDamage += FMath::Abs(DamageTaken);
+	return true;
+}
+
+void UVitalityMassDamageProcessor::ConfigureQueries()
+{
+	EntityQuery_.AddRequirement<FVitalityPoolsFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery_.AddRequirement<FVitalityDamageFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery_.AddTagRequirement<FVitalityDeadTag>(EMassFragmentPresence::None);
+	EntityQuery_.AddTagRequirement<FVitalityActorBoundTag>(EMassFragmentPresence::None);
+}
+
+void UVitalityMassDamageProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityMassDamage);
+	EntityQuery_.ForEachEntityChunk(EntityManager, Context, [](FMassExecutionContext& Context)
+	{
+		const TArrayView<FVitalityPoolsFragment> PoolsList = Context.GetMutableFragmentView<FVitalityPoolsFragment>();
+		const TArrayView<FVitalityDamageFragment> DamageList = Context.GetMutableFragmentView<FVitalityDamageFragment>();
+		constexpr int32 Health = static_cast<int32>(EVitalityCategory::HEALTH);
+
+		int32 NumDamaged = 0;
+		for (int32 i = 0; i < Context.GetNumEntities(); i++)
+		{
+			float& PendingDamage = DamageList[i].PendingDamage;
+			if (FMath::IsNearlyZero(PendingDamage))
+				continue;
+
+			FVitalityPoolsFragment& Pools = PoolsList[i];
+			FVitalityPoolMath::ApplyDamage(Pools.Current[Health], PendingDamage);
+			PendingDamage = 0.f;
+			NumDamaged++;
+
+			if (Pools.Current[Health] <= 0.f)
+			{
+				Pools.bIsDead = true;
+				Context.Defer().AddTag<FVitalityDeadTag>(Context.GetEntity(i));
+			}
+		}
+		INC_DWORD_STAT_BY(STAT_VitalityDamageEvents, NumDamaged);
+	});
+}
+
+
+/****************************************
+ * POOLS
+****************************************/
+
+UVitalityMassPoolsProcessor::UVitalityMassPoolsProcessor()
+	: EntityQuery_(*this)
+{
+	ExecutionFlags = AuthorityExecutionFlags;
+	ExecutionOrder.ExecuteAfter.Add(UVitalityMassDamageProcessor::StaticClass()->GetFName());
+}
+
+void UVitalityMassPoolsProcessor::ConfigureQueries()
+{
+	EntityQuery_.AddRequirement<FVitalityPoolsFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery_.AddTagRequirement<FVitalityDeadTag>(EMassFragmentPresence::None);
+	EntityQuery_.AddTagRequirement<FVitalityActorBoundTag>(EMassFragmentPresence::None);
+}
+
+void UVitalityMassPoolsProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityMassPools);
+	EntityQuery_.ForEachEntityChunk(EntityManager, Context, [](FMassExecutionContext& Context)
+	{
+		const float DeltaTime = Context.GetDeltaTimeSeconds();
+		for (FVitalityPoolsFragment& Pools : Context.GetMutableFragmentView<FVitalityPoolsFragment>())
+			StepPools(Pools, DeltaTime);
+	});
+}
+
+
+/****************************************
+ * EFFECTS
+****************************************/
+
+UVitalityMassEffectsProcessor::UVitalityMassEffectsProcessor()
+	: EntityQuery_(*this)
+{
+	ExecutionFlags = AuthorityExecutionFlags;
+	ExecutionOrder.ExecuteAfter.Add(UVitalityMassPoolsProcessor::StaticClass()->GetFName());
+}
+
+void UVitalityMassEffectsProcessor::ConfigureQueries()
+{
+	EntityQuery_.AddRequirement<FVitalityEffectsFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery_.AddTagRequirement<FVitalityActorBoundTag>(EMassFragmentPresence::None);
+}
+
+void UVitalityMassEffectsProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityMassEffects);
+	EntityQuery_.ForEachEntityChunk(EntityManager, Context, [](FMassExecutionContext& Context)
+	{
+		const float DeltaTime = Context.GetDeltaTimeSeconds();
+		int32 NumExpired = 0;
+		for (FVitalityEffectsFragment& Effects : Context.GetMutableFragmentView<FVitalityEffectsFragment>())
+		{
+			if (Effects.NumEffects < 1)
+			{
+				Effects.Elapsed = 0.f;
+				continue;
+			}
+
+			Effects.Elapsed += DeltaTime;
+			while (Effects.Elapsed >= FVitalityEffectsFragment::TickRate)
+			{
+				Effects.Elapsed -= FVitalityEffectsFragment::TickRate;
+				// Backwards, so removing by swapping with the last effect skips nothing
+				for (int32 i = Effects.NumEffects - 1; i >= 0; i--)
+				{
+					FVitalityMassEffect& Effect = Effects.Effects[i];
+					if (FVitalityEffectLifetime::Tick(Effect.RemainingTicks, Effect.bIsPersistent))
+					{
+						Effects.Effects[i] = Effects.Effects[--Effects.NumEffects];
+						NumExpired++;
+					}
+				}
+			}
+		}
+		INC_DWORD_STAT_BY(STAT_VitalityEffectsExpired, NumExpired);
+	});
+}
+
+
+/****************************************
+ * ACTOR BRIDGE
+****************************************/
+
+UVitalityMassActorBridgeProcessor::UVitalityMassActorBridgeProcessor()
+	: EntityQuery_(*this)
+{
+	ExecutionFlags = AuthorityExecutionFlags;
+	// The save system and the components it drives are game thread only
+	bRequiresGameThreadExecution = true;
+	// Actors are spawned and released by the representation processors
+	ExecutionOrder.ExecuteAfter.Add(UE::Mass::ProcessorGroupNames::Representation);
+}
+
+void UVitalityMassActorBridgeProcessor::WriteRecord(const FVitalityPoolsFragment& Pools,
+	const FVitalityEffectsFragment& Effects, const FVitalityStatsFragment& Stats, FVitalitySaveRecord& OutRecord)
+{
+	OutRecord.Sections = EVitalitySaveSections::WELFARE | EVitalitySaveSections::EFFECTS
+		| EVitalitySaveSections::STATS_NATURAL;
+
+	for (int32 i = 0; i < FVitalitySaveRecord::NumPools; i++)
+	{
+		OutRecord.PoolCurrent[i]	= Pools.Current[i];
+		OutRecord.PoolMax[i]		= Pools.Maximum[i];
+	}
+	OutRecord.bIsDead		= Pools.bIsDead;
+	OutRecord.CombatState	= Pools.CombatState;
+
+	OutRecord.Effects.Reset(Effects.NumEffects);
+	for (int32 i = 0; i < Effects.NumEffects; i++)
+	{
+		const FVitalityMassEffect& Effect = Effects.Effects[i];
+		FVitalitySaveRecord::FEffect& SavedEffect = OutRecord.Effects.AddDefaulted_GetRef();
+		SavedEffect.EffectName		= Effect.EffectName;
+		SavedEffect.BenefitEffect	= Effect.BenefitEffect;
+		SavedEffect.DetrimentEffect	= Effect.DetrimentEffect;
+		SavedEffect.RemainingTicks	= Effect.RemainingTicks;
+		SavedEffect.UniqueId		= Effect.UniqueId;
+		SavedEffect.bIsPersistent	= Effect.bIsPersistent;
+	}
+
+	constexpr int32 Natural = static_cast<int32>(EVitalityStatLayer::NATURAL);
+	OutRecord.CoreStats[Natural].Reset();
+	OutRecord.CoreStats[Natural].Append(Stats.CoreStats, FVitalityStatSnapshot::NumCoreStats);
+	OutRecord.DamageBonuses[Natural].Reset();
+	OutRecord.DamageBonuses[Natural].Append(Stats.DamageBonuses, FVitalityStatSnapshot::NumDamageTypes);
+	OutRecord.DamageResists[Natural].Reset();
+	OutRecord.DamageResists[Natural].Append(Stats.DamageResists, FVitalityStatSnapshot::NumDamageTypes);
+}
+
+void UVitalityMassActorBridgeProcessor::ReadRecord(const FVitalitySaveRecord& Record,
+	FVitalityPoolsFragment& Pools, FVitalityEffectsFragment& Effects, FVitalityStatsFragment& Stats)
+{
+	if (Record.HasSection(EVitalitySaveSections::WELFARE))
+	{
+		for (int32 i = 0; i < FVitalitySaveRecord::NumPools; i++)
+		{
+			Pools.Current[i]	= Record.PoolCurrent[i];
+			Pools.Maximum[i]	= Record.PoolMax[i];
+		}
+		Pools.bIsDead		= Record.bIsDead;
+		Pools.CombatState	= Record.CombatState;
+	}
+
+	if (Record.HasSection(EVitalitySaveSections::EFFECTS))
+	{
+		// Effects past what the fragment holds are dropped, the persistent ones last
+		Effects.NumEffects = 0;
+		for (const bool bPersistentPass : { true, false })
+		{
+			for (const FVitalitySaveRecord::FEffect& SavedEffect : Record.Effects)
+			{
+				if (SavedEffect.bIsPersistent != bPersistentPass)
+					continue;
+				FVitalityMassEffect Effect;
+				Effect.EffectName		= SavedEffect.EffectName;
+				Effect.BenefitEffect	= SavedEffect.BenefitEffect;
+				Effect.DetrimentEffect	= SavedEffect.DetrimentEffect;
+				Effect.RemainingTicks	= SavedEffect.RemainingTicks;
+				Effect.UniqueId			= SavedEffect.UniqueId;
+				Effect.bIsPersistent	= SavedEffect.bIsPersistent;
+				Effects.AddEffect(Effect);
+			}
+		}
+	}
+
+	constexpr int32 Natural = static_cast<int32>(EVitalityStatLayer::NATURAL);
+	if (Record.HasSection(EVitalitySaveSections::STATS_NATURAL))
+	{
+		for (int32 i = 0; i < FVitalityStatSnapshot::NumCoreStats; i++)
+			Stats.CoreStats[i] = Record.CoreStats[Natural].IsValidIndex(i) ? Record.CoreStats[Natural][i] : 0.f;
+		for (int32 i = 0; i < FVitalityStatSnapshot::NumDamageTypes; i++)
+		{
+			Stats.DamageBonuses[i] = Record.DamageBonuses[Natural].IsValidIndex(i) ? Record.DamageBonuses[Natural][i] : 0.f;
+			Stats.DamageResists[i] = Record.DamageResists[Natural].IsValidIndex(i) ? Record.DamageResists[Natural][i] : 0.f;
+		}
+	}
+}
+
+void UVitalityMassActorBridgeProcessor::ConfigureQueries()
+{
+	EntityQuery_.AddRequirement<FMassActorFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery_.AddRequirement<FVitalityActorBridgeFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery_.AddRequirement<FVitalityPoolsFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery_.AddRequirement<FVitalityEffectsFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery_.AddRequirement<FVitalityStatsFragment>(EMassFragmentAccess::ReadWrite);
+}
+
+void UVitalityMassActorBridgeProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityMassBridge);
+	EntityQuery_.ForEachEntityChunk(EntityManager, Context, [this](FMassExecutionContext& Context)
+	{
+		const TArrayView<FMassActorFragment> ActorList = Context.GetMutableFragmentView<FMassActorFragment>();
+		const TArrayView<FVitalityActorBridgeFragment> BridgeList = Context.GetMutableFragmentView<FVitalityActorBridgeFragment>();
+		const TArrayView<FVitalityPoolsFragment> PoolsList = Context.GetMutableFragmentView<FVitalityPoolsFragment>();
+		const TArrayView<FVitalityEffectsFragment> EffectsList = Context.GetMutableFragmentView<FVitalityEffectsFragment>();
+		const TArrayView<FVitalityStatsFragment> StatsList = Context.GetMutableFragmentView<FVitalityStatsFragment>();
+
+		for (int32 i = 0; i < Context.GetNumEntities(); i++)
+		{
+			AActor* Actor = ActorList[i].GetMutable();
+			FVitalityActorBridgeFragment& Bridge = BridgeList[i];
+			// The bound actor may already be destroyed by the time the entity lets it go
+			const bool bWasBound	= !Bridge.BoundActor.IsExplicitlyNull();
+			AActor* BoundActor		= Bridge.BoundActor.Get();
+			FVitalityPoolsFragment& Pools = PoolsList[i];
+
+			if (BoundActor != nullptr)
+			{
+				// Natural stats rarely change, so they are only copied back when dirty or on release
+				EVitalitySaveSections Sections = EVitalitySaveSections::WELFARE | EVitalitySaveSections::EFFECTS;
+				if (Actor != BoundActor || EnumHasAnyFlags(UVitalitySaveSystem::GetActorDirtySections(BoundActor),
+					EVitalitySaveSections::STATS_NATURAL))
+				{
+					Sections |= EVitalitySaveSections::STATS_NATURAL;
+				}
+
+				const bool bWasDead = Pools.bIsDead;
+				Record_.Sections = EVitalitySaveSections::NONE;
+				if (UVitalitySaveSystem::CaptureActor(BoundActor, Record_, Sections))
+					ReadRecord(Record_, Pools, EffectsList[i], StatsList[i]);
+
+				if (Pools.bIsDead != bWasDead)
+				{
+					if (Pools.bIsDead)
+						Context.Defer().AddTag<FVitalityDeadTag>(Context.GetEntity(i));
+					else
+						Context.Defer().RemoveTag<FVitalityDeadTag>(Context.GetEntity(i));
+				}
+			}
+
+			if (Actor != nullptr && Actor == BoundActor)
+				continue;
+
+			if (Actor != nullptr)
+			{
+				WriteRecord(Pools, EffectsList[i], StatsList[i], Record_);
+				UVitalitySaveSystem::ApplyToActor(Actor, Record_);
+				if (!bWasBound)
+					Context.Defer().AddTag<FVitalityActorBoundTag>(Context.GetEntity(i));
+				Bridge.BoundActor = Actor;
+			}
+			else if (bWasBound)
+			{
+				Context.Defer().RemoveTag<FVitalityActorBoundTag>(Context.GetEntity(i));
+				Bridge.BoundActor.Reset();
+			}
+		}
+	});
+}
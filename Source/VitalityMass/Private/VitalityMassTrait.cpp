@@ -0,0 +1,60 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "VitalityMassTrait.h"
+
+#include "MassEntityTemplateRegistry.h"
+#include "VitalityMassFragments.h"
+
+
+namespace
+{
+	void InitPool(FVitalityPoolsFragment& Pools, EVitalityCategory VitalityCategory, bool bUsePool,
+		float Current, float Maximum, float Rate = 0.f, float TickRate = 1.f)
+	{
+		if (!bUsePool)
+			return;
+		const int32 i = static_cast<int32>(VitalityCategory);
+		Pools.Maximum[i]	= FMath::Max(Maximum, 0.f);
+		Pools.Current[i]	= FMath::Clamp(Current, 0.f, Pools.Maximum[i]);
+		Pools.Rate[i]		= Rate;
+		// The same fallback the timers use
+		Pools.TickRate[i]	= TickRate <= 0.f ? 1.f : TickRate;
+	}
+
+	template <int32 NumValues, typename EnumType>
+	void InitLayer(float (&Layer)[NumValues], const TMap<EnumType, float>& Values)
+	{
+		for (const TPair<EnumType, float>& Value : Values)
+		{
+			const int32 i = static_cast<int32>(Value.Key);
+			if (i < NumValues)
+				Layer[i] = Value.Value;
+		}
+	}
+}
+
+
+void UVitalityMassTrait::BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const
+{
+	// The values set here are the starting values of every entity spawned from the template
+	FVitalityPoolsFragment& Pools = BuildContext.AddFragment_GetRef<FVitalityPoolsFragment>();
+	InitPool(Pools, EVitalityCategory::HEALTH, UseHealthSubsystem,
+		StartingHealthCurrent, StartingHealthMaximum, PassiveHealthRegen, HealthTimerTickRate);
+	InitPool(Pools, EVitalityCategory::STAMINA, UseStaminaSubsystem,
+		StartingStaminaCurrent, StartingStaminaMaximum, PassiveStaminaRegen, StaminaTimerTickRate);
+	InitPool(Pools, EVitalityCategory::MAGIC, UseMagicSubsystem,
+		StartingMagicCurrent, StartingMagicMaximum);
+	InitPool(Pools, EVitalityCategory::HUNGER, UseSurvivalSubsystem,
+		StartingHungerCurrent, StartingHungerMaximum, PassiveHungerDrain, CaloriesTimerTickRate);
+	InitPool(Pools, EVitalityCategory::THIRST, UseSurvivalSubsystem,
+		StartingHydrationCurrent, StartingHydrationMaximum, PassiveHydrationDrain, HydrationTimerTickRate);
+
+	FVitalityStatsFragment& Stats = BuildContext.AddFragment_GetRef<FVitalityStatsFragment>();
+	InitLayer(Stats.CoreStats, NaturalCoreStats);
+	InitLayer(Stats.DamageBonuses, NaturalDamageBonuses);
+	InitLayer(Stats.DamageResists, NaturalResistances);
+
+	BuildContext.AddFragment<FVitalityEffectsFragment>();
+	BuildContext.AddFragment<FVitalityDamageFragment>();
+	BuildContext.AddFragment<FVitalityActorBridgeFragment>();
+}
@@ -0,0 +1,152 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "lib/VitalityEnums.h"
+#include "lib/VitalitySnapshot.h"
+
+#include "VitalityMassFragments.generated.h"
+
+
+/**
+ * The welfare pools of an entity, laid out like the welfare component's but as flat
+ * arrays indexed by EVitalityCategory, so the pools processor walks a chunk linearly.
+ * A pool with no maximum is not in use.
+ */
+USTRUCT()
+struct VITALITYMASS_API FVitalityPoolsFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	static constexpr int32 NumPools = static_cast<int32>(EVitalityCategory::MAX);
+
+	float Current[NumPools]		= {};
+	float Maximum[NumPools]		= {};
+	// Regen per tick for health and stamina, drain per tick for hunger and thirst. Magic does not regenerate passively.
+	float Rate[NumPools]		= {};
+	// Seconds between ticks, the same as the welfare component's timers
+	float TickRate[NumPools]	= { 1.f, 1.f, 1.f, 1.f, 1.f };
+	// Time towards the next tick
+	float Elapsed[NumPools]		= {};
+
+	bool bIsDead = false;
+	ECombatState CombatState = ECombatState::RELAXED;
+
+	float GetPercent(EVitalityCategory VitalityCategory) const
+	{
+		const int32 i = static_cast<int32>(VitalityCategory);
+		return i < NumPools ? FVitalityWelfareSnapshot::GetPercent(Current[i], Maximum[i]) : 0.f;
+	}
+};
+
+
+// One active effect of an entity. Mirrors FVitalitySaveRecord::FEffect.
+USTRUCT()
+struct VITALITYMASS_API FVitalityMassEffect
+{
+	GENERATED_BODY()
+
+	FName EffectName;
+	EEffectsBeneficial	BenefitEffect	= EEffectsBeneficial::MAX;
+	EEffectsDetrimental	DetrimentEffect	= EEffectsDetrimental::MAX;
+	int32 RemainingTicks	= 0;
+	int32 UniqueId			= 0;
+	bool bIsPersistent		= false;
+};
+
+
+/**
+ * The active effects of an entity. Held inline rather than in an array so the fragment
+ * stays trivially copyable and every effect sits in the chunk next to its entity.
+ * Crowd entities rarely carry more than a few effects; AddEffect fails once it is full.
+ */
+USTRUCT()
+struct VITALITYMASS_API FVitalityEffectsFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	static constexpr int32 MaxEffects = 8;
+	// Seconds between effect ticks, the same as the effects component
+	static constexpr float TickRate = 0.5f;
+
+	FVitalityMassEffect Effects[MaxEffects];
+	int32 NumEffects	= 0;
+	// Time towards the next tick
+	float Elapsed		= 0.f;
+
+	// Returns false if the entity already has MaxEffects effects
+	bool AddEffect(const FVitalityMassEffect& Effect)
+	{
+		if (NumEffects >= MaxEffects)
+			return false;
+		Effects[NumEffects++] = Effect;
+		return true;
+	}
+
+	// Removes the effect with the unique ID. Returns false if there was none.
+	bool RemoveEffect(int32 UniqueId)
+	{
+		for (int32 i = 0; i < NumEffects; i++)
+		{
+			if (Effects[i].UniqueId == UniqueId)
+			{
+				Effects[i] = Effects[--NumEffects];
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+
+/**
+ * The natural stat layer of an entity. Gear, magical and other layers belong to
+ * represented actors; they are not kept while the entity has no actor.
+ */
+USTRUCT()
+struct VITALITYMASS_API FVitalityStatsFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	float CoreStats[FVitalityStatSnapshot::NumCoreStats]			= {};
+	float DamageBonuses[FVitalityStatSnapshot::NumDamageTypes]	= {};
+	float DamageResists[FVitalityStatSnapshot::NumDamageTypes]	= {};
+};
+
+
+// Damage waiting for the damage processor. Queue it with UVitalityMassDamageProcessor::QueueDamage().
+USTRUCT()
+struct VITALITYMASS_API FVitalityDamageFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	float PendingDamage = 0.f;
+};
+
+
+// The actor the entity's vitality was handed to, if any
+USTRUCT()
+struct VITALITYMASS_API FVitalityActorBridgeFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	TWeakObjectPtr<AActor> BoundActor;
+};
+
+
+// The entity's health reached zero. Dead entities no longer regenerate or take damage.
+USTRUCT()
+struct VITALITYMASS_API FVitalityDeadTag : public FMassTag
+{
+	GENERATED_BODY()
+};
+
+
+// The entity is represented by an actor whose vitality components own its vitality
+USTRUCT()
+struct VITALITYMASS_API FVitalityActorBoundTag : public FMassTag
+{
+	GENERATED_BODY()
+};
@@ -0,0 +1,123 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityQuery.h"
+#include "MassProcessor.h"
+#include "VitalityMassFragments.h"
+#include "lib/SaveStats.h"
+
+#include "VitalityMassProcessors.generated.h"
+
+
+/**
+ * The processors run in this order on the server and in standalone games: the bridge hands
+ * vitality to and from represented actors, then damage is applied, then pools regenerate
+ * and drain, then effects count down. Entities bound to an actor are skipped by everything
+ * but the bridge, since the actor's vitality components own their vitality meanwhile.
+ */
+
+// Applies queued damage to health, and tags the entities it kills
+UCLASS()
+class VITALITYMASS_API UVitalityMassDamageProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+public:
+
+	UVitalityMassDamageProcessor();
+
+	/**
+	 * @brief Damages an entity, or the actor representing it. Game thread only.
+	 * @param EntityManager The manager the entity belongs to
+	 * @param Entity The entity to damage
+	 * @param DamageTaken The damage to deal. The sign is ignored, like DamageHealth().
+	 * @param DamageInstigator Passed on to DamageHealth() when an actor represents the entity
+	 * @return True if the entity has vitality
+	 */
+	static bool QueueDamage(FMassEntityManager& EntityManager, FMassEntityHandle Entity,
+		float DamageTaken, AActor* DamageInstigator = nullptr);
+
+protected:
+
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+
+	FMassEntityQuery EntityQuery_;
+};
+
+
+// Regenerates health and stamina, and drains hunger and thirst, at each pool's tick rate
+UCLASS()
+class VITALITYMASS_API UVitalityMassPoolsProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+public:
+
+	UVitalityMassPoolsProcessor();
+
+protected:
+
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+
+	FMassEntityQuery EntityQuery_;
+};
+
+
+// Counts down effects and removes the ones that run out
+UCLASS()
+class VITALITYMASS_API UVitalityMassEffectsProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+public:
+
+	UVitalityMassEffectsProcessor();
+
+protected:
+
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+
+	FMassEntityQuery EntityQuery_;
+};
+
+
+/**
+ * Hands vitality across the entity/actor LOD transition. When an actor starts representing
+ * an entity, the entity's fragments are applied to the actor's vitality components through
+ * a save record. While bound, the components are captured back every frame, so the entity
+ * carries on from where the actor left off once the actor is released.
+ */
+UCLASS()
+class VITALITYMASS_API UVitalityMassActorBridgeProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+public:
+
+	UVitalityMassActorBridgeProcessor();
+
+	// Copies the fragments into the record, as the welfare, effects and natural stat sections
+	static void WriteRecord(const FVitalityPoolsFragment& Pools, const FVitalityEffectsFragment& Effects,
+		const FVitalityStatsFragment& Stats, FVitalitySaveRecord& OutRecord);
+	// Copies the sections the record holds into the fragments
+	static void ReadRecord(const FVitalitySaveRecord& Record, FVitalityPoolsFragment& Pools,
+		FVitalityEffectsFragment& Effects, FVitalityStatsFragment& Stats);
+
+protected:
+
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+private:
+
+	FMassEntityQuery EntityQuery_;
+	// Reused so capturing every frame does not reallocate the stat layers
+	FVitalitySaveRecord Record_;
+};
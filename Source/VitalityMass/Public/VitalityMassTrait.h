@@ -0,0 +1,81 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTraitBase.h"
+#include "lib/VitalityEnums.h"
+
+#include "VitalityMassTrait.generated.h"
+
+
+/**
+ * Gives the entities of a Mass entity config vitality without any component. The settings
+ * mirror the welfare component's, so an entity and its represented actor start out alike.
+ * Add it alongside a representation trait to hand vitality to actors at high LOD.
+ */
+UCLASS(meta = (DisplayName = "Vitality"))
+class VITALITYMASS_API UVitalityMassTrait : public UMassEntityTraitBase
+{
+	GENERATED_BODY()
+public:
+
+	virtual void BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const override;
+
+	UPROPERTY(EditAnywhere, Category = "Health Settings")
+	bool UseHealthSubsystem = true;
+	UPROPERTY(EditAnywhere, Category = "Health Settings")
+	float StartingHealthCurrent = 100.f;
+	UPROPERTY(EditAnywhere, Category = "Health Settings")
+	float StartingHealthMaximum = 100.f;
+	UPROPERTY(EditAnywhere, Category = "Health Settings")
+	float PassiveHealthRegen = 0.25;
+	UPROPERTY(EditAnywhere, Category = "Health Settings")
+	float HealthTimerTickRate = 0.5;
+
+	UPROPERTY(EditAnywhere, Category = "Stamina Settings")
+	bool UseStaminaSubsystem = true;
+	UPROPERTY(EditAnywhere, Category = "Stamina Settings")
+	float StartingStaminaCurrent = 100.f;
+	UPROPERTY(EditAnywhere, Category = "Stamina Settings")
+	float StartingStaminaMaximum = 100.f;
+	UPROPERTY(EditAnywhere, Category = "Stamina Settings")
+	float PassiveStaminaRegen = 0.082;
+	UPROPERTY(EditAnywhere, Category = "Stamina Settings")
+	float StaminaTimerTickRate = 0.5;
+
+	UPROPERTY(EditAnywhere, Category = "Magic Settings")
+	bool UseMagicSubsystem = true;
+	UPROPERTY(EditAnywhere, Category = "Magic Settings")
+	float StartingMagicCurrent = 100.f;
+	UPROPERTY(EditAnywhere, Category = "Magic Settings")
+	float StartingMagicMaximum = 100.f;
+
+	UPROPERTY(EditAnywhere, Category = "Survival Settings")
+	bool UseSurvivalSubsystem = false;
+	UPROPERTY(EditAnywhere, Category = "Survival Settings")
+	float StartingHydrationCurrent = 1000.f;
+	UPROPERTY(EditAnywhere, Category = "Survival Settings")
+	float StartingHungerCurrent = 1000.f;
+	UPROPERTY(EditAnywhere, Category = "Survival Settings")
+	float StartingHydrationMaximum = 10000.f;
+	UPROPERTY(EditAnywhere, Category = "Survival Settings")
+	float StartingHungerMaximum = 1000.f;
+	UPROPERTY(EditAnywhere, Category = "Survival Settings")
+	float PassiveHydrationDrain = 0.082;
+	UPROPERTY(EditAnywhere, Category = "Survival Settings")
+	float PassiveHungerDrain = 0.037;
+	UPROPERTY(EditAnywhere, Category = "Survival Settings")
+	float HydrationTimerTickRate = 0.5;
+	UPROPERTY(EditAnywhere, Category = "Survival Settings")
+	float CaloriesTimerTickRate = 0.5;
+
+	// The natural layer of the entity's stats. Stats not listed start at zero.
+	UPROPERTY(EditAnywhere, Category = "Stat Settings")
+	TMap<EVitalityStat, float> NaturalCoreStats;
+	UPROPERTY(EditAnywhere, Category = "Stat Settings")
+	TMap<EDamageType, float> NaturalDamageBonuses;
+	UPROPERTY(EditAnywhere, Category = "Stat Settings")
+	TMap<EDamageType, float> NaturalResistances;
+
+};
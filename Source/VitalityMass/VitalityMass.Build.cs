@@ -0,0 +1,36 @@
+// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+using UnrealBuildTool;
+
+// Vitality for Mass entities. Crowds keep their pools, effects and stats in fragments,
+// and hand them to the vitality components when an entity is represented by an actor.
+// Not loaded by default: games that use it enable MassGameplay and add this module to
+// their own module's dependencies, which loads it along with theirs.
+public class VitalityMass : ModuleRules
+{
+	public VitalityMass(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Core",
+				"CoreUObject",
+				"Engine",
+				"MassEntity",
+				"MassSpawner",
+				"VitalityMatters"
+			}
+			);
+
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"MassCommon",
+				"MassActors",
+				"VitalityCore"
+			}
+			);
+	}
+}
@@ -0,0 +1,52 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "lib/SaveStats.h"
+#include "VitalityStatComponent.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FVitalitySaveGearJournalTest, "VitalityMatters.Save.GearEditIsJournaled",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FVitalitySaveGearJournalTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	AActor* Actor = World->SpawnActor<AActor>();
+	UVitalityStatComponent* Stats = NewObject<UVitalityStatComponent>(Actor);
+	Stats->RegisterComponent();
+
+	// Start from a clean slate, as if the actor had just been saved
+	UVitalitySaveSystem::SetActorDirtySections(Actor, EVitalitySaveSections::ALL, false);
+	Stats->SetGearCoreStat(EVitalityStat::STRENGTH, 5.f);
+
+	const EVitalitySaveSections DirtySections = UVitalitySaveSystem::GetActorDirtySections(Actor);
+	TestTrue(TEXT("A gear edit marks the gear section dirty"),
+		EnumHasAnyFlags(DirtySections, EVitalitySaveSections::STATS_GEAR));
+	TestFalse(TEXT("A gear edit leaves the natural section clean"),
+		EnumHasAnyFlags(DirtySections, EVitalitySaveSections::STATS_NATURAL));
+
+	// The journal captures only the dirty sections
+	FVitalitySaveRecord Record;
+	UVitalitySaveSystem::CaptureActor(Actor, Record, DirtySections);
+	constexpr int32 Gear	= static_cast<int32>(EVitalityStatLayer::GEAR);
+	constexpr int32 Strength	= static_cast<int32>(EVitalityStat::STRENGTH);
+	TestTrue(TEXT("The journal record holds the gear section"), Record.HasSection(EVitalitySaveSections::STATS_GEAR));
+	if (TestTrue(TEXT("The journal record holds the gear stats"), Record.CoreStats[Gear].IsValidIndex(Strength)))
+		TestEqual(TEXT("The journal record holds the edited value"), Record.CoreStats[Gear][Strength], 5.f);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,235 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "VitalityDamageNumbers.h"
+
+#include "Engine/GameViewportClient.h"
+#include "Engine/World.h"
+#include "Fonts/FontMeasure.h"
+#include "Framework/Application/SlateApplication.h"
+#include "GameFramework/PlayerController.h"
+#include "Rendering/DrawElements.h"
+#include "Styling/CoreStyle.h"
+#include "Widgets/SLeafWidget.h"
+
+
+// The single layer every damage number is drawn on. Holds no state of its own.
+class SVitalityDamageNumbers : public SLeafWidget
+{
+public:
+
+	SLATE_BEGIN_ARGS(SVitalityDamageNumbers) {}
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs, UVitalityDamageNumbers* InDamageNumbers)
+	{
+		DamageNumbers = InDamageNumbers;
+		SetVisibility(EVisibility::HitTestInvisible);
+	}
+
+	virtual FVector2D ComputeDesiredSize(float) const override { return FVector2D::ZeroVector; }
+
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry,
+		const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements,
+		int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override
+	{
+		if (const UVitalityDamageNumbers* Owner = DamageNumbers.Get())
+			Owner->PaintDamageNumbers(AllottedGeometry, OutDrawElements, LayerId);
+		return LayerId;
+	}
+
+private:
+
+	TWeakObjectPtr<UVitalityDamageNumbers> DamageNumbers;
+};
+
+
+UVitalityDamageNumbers* UVitalityDamageNumbers::Get(const UObject* WorldContextObject)
+{
+	if (!IsValid(WorldContextObject))
+		return nullptr;
+	const UWorld* World = WorldContextObject->GetWorld();
+	return IsValid(World) ? World->GetSubsystem<UVitalityDamageNumbers>() : nullptr;
+}
+
+/**
+ * @brief Shows a damage number above the target. A hit within MergeWindow of the target's
+ *        previous hit is added to that number instead, so rapid hits read as one total.
+ * @param Target The actor that was hit
+ * @param DamageValue The damage taken. Negative values are shown as healing.
+ */
+void UVitalityDamageNumbers::AddDamageNumber(AActor* Target, float DamageValue)
+{
+	if (!IsValid(Target) || FMath::IsNearlyZero(DamageValue) || MaxVisible < 1)
+		return;
+
+	for (int32 i = 0; i < NumActive_; i++)
+	{
+		FEntry& Entry = Entries_[i];
+		if (Entry.Target.Get() == Target && Entry.SinceLastHit <= MergeWindow
+			&& FMath::Sign(Entry.Value) == FMath::Sign(DamageValue))
+		{
+			SetEntryValue(Entry, Entry.Value + DamageValue);
+			Entry.SinceLastHit = 0.f;
+			return;
+		}
+	}
+
+	if (Entries_.Num() != MaxVisible)
+	{
+		Entries_.SetNum(MaxVisible);
+		NumActive_ = FMath::Min(NumActive_, MaxVisible);
+	}
+
+	int32 EntryIndex = NumActive_;
+	if (NumActive_ < MaxVisible)
+	{
+		NumActive_++;
+	}
+	else
+	{
+		// Full, so reuse the number that has been waiting the longest
+		EntryIndex = 0;
+		for (int32 i = 1; i < NumActive_; i++)
+		{
+			if (Entries_[i].SinceLastHit > Entries_[EntryIndex].SinceLastHit)
+				EntryIndex = i;
+		}
+	}
+
+	FEntry& Entry		= Entries_[EntryIndex];
+	Entry.Target		= Target;
+	Entry.Anchor		= Target->GetActorLocation();
+	Entry.Age			= 0.f;
+	Entry.SinceLastHit	= 0.f;
+	Entry.bOnScreen		= false;
+	SetEntryValue(Entry, DamageValue);
+	EnsureWidget();
+}
+
+void UVitalityDamageNumbers::ClearDamageNumbers()
+{
+	for (int32 i = 0; i < NumActive_; i++)
+		Entries_[i].Target.Reset();
+	NumActive_ = 0;
+}
+
+bool UVitalityDamageNumbers::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UVitalityDamageNumbers::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	Entries_.SetNum(FMath::Max(MaxVisible, 0));
+}
+
+void UVitalityDamageNumbers::Deinitialize()
+{
+	if (Widget_.IsValid())
+	{
+		if (UGameViewportClient* GameViewport = GetWorld()->GetGameViewport())
+			GameViewport->RemoveViewportWidgetContent(Widget_.ToSharedRef());
+		Widget_.Reset();
+	}
+	ClearDamageNumbers();
+	Entries_.Empty();
+	Super::Deinitialize();
+}
+
+/**
+ * @brief Ages every showing number, drops the expired ones, and projects the rest to the
+ *        screen for the next paint. Costs nothing while no number is showing.
+ */
+void UVitalityDamageNumbers::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	if (NumActive_ < 1)
+		return;
+
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	const float SafeLifetime = FMath::Max(Lifetime, KINDA_SMALL_NUMBER);
+
+	for (int32 i = NumActive_ - 1; i >= 0; i--)
+	{
+		FEntry& Entry = Entries_[i];
+		Entry.Age			+= DeltaTime;
+		Entry.SinceLastHit	+= DeltaTime;
+		if (Entry.SinceLastHit >= SafeLifetime)
+		{
+			// Keep the showing entries packed at the front of the pool
+			Entry.Target.Reset();
+			if (i != NumActive_ - 1)
+				Swap(Entry, Entries_[NumActive_ - 1]);
+			NumActive_--;
+			continue;
+		}
+
+		if (const AActor* Target = Entry.Target.Get())
+			Entry.Anchor = Target->GetActorLocation();
+
+		const float Rise		= RiseHeight * FMath::Min(Entry.Age / SafeLifetime, 1.f);
+		const FVector Location	= Entry.Anchor + WorldOffset + FVector(0.f, 0.f, Rise);
+		// Fades out over the last third of its life
+		Entry.Opacity	= FMath::Clamp((SafeLifetime - Entry.SinceLastHit) / (SafeLifetime / 3.f), 0.f, 1.f);
+		Entry.bOnScreen	= PlayerController != nullptr
+			&& PlayerController->ProjectWorldLocationToScreen(Location, Entry.ScreenPosition, false);
+	}
+}
+
+TStatId UVitalityDamageNumbers::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVitalityDamageNumbers, STATGROUP_Tickables);
+}
+
+bool UVitalityDamageNumbers::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UVitalityDamageNumbers::SetEntryValue(FEntry& Entry, float NewValue) const
+{
+	Entry.Value = NewValue;
+	Entry.Text	= FString::FromInt(FMath::RoundToInt(FMath::Abs(NewValue)));
+	if (FSlateApplication::IsInitialized())
+	{
+		const FSlateFontInfo Font = FCoreStyle::GetDefaultFontStyle("Bold", FontSize);
+		Entry.TextSize = FSlateApplication::Get().GetRenderer()->GetFontMeasureService()->Measure(Entry.Text, Font);
+	}
+}
+
+void UVitalityDamageNumbers::EnsureWidget()
+{
+	if (Widget_.IsValid())
+		return;
+	UGameViewportClient* GameViewport = GetWorld()->GetGameViewport();
+	if (GameViewport == nullptr)
+		return;
+	SAssignNew(Widget_, SVitalityDamageNumbers, this);
+	GameViewport->AddViewportWidgetContent(Widget_.ToSharedRef(), 10);
+}
+
+void UVitalityDamageNumbers::PaintDamageNumbers(const FGeometry& AllottedGeometry,
+	FSlateWindowElementList& OutDrawElements, int32 LayerId) const
+{
+	if (NumActive_ < 1)
+		return;
+
+	const FSlateFontInfo Font = FCoreStyle::GetDefaultFontStyle("Bold", FontSize);
+	// Projected positions are in viewport pixels, while the layer paints in DPI scaled units
+	const float InverseScale = 1.f / FMath::Max(AllottedGeometry.Scale, KINDA_SMALL_NUMBER);
+
+	for (int32 i = 0; i < NumActive_; i++)
+	{
+		const FEntry& Entry = Entries_[i];
+		if (!Entry.bOnScreen)
+			continue;
+
+		FLinearColor TextColor = Entry.Value < 0.f ? HealColor : DamageColor;
+		TextColor.A *= Entry.Opacity;
+		const FVector2D Position = Entry.ScreenPosition * InverseScale - Entry.TextSize * 0.5f;
+		FSlateDrawElement::MakeText(OutDrawElements, LayerId,
+			AllottedGeometry.ToPaintGeometry(Entry.TextSize, FSlateLayoutTransform(Position)),
+			Entry.Text, Font, ESlateDrawEffect::None, TextColor);
+	}
+}
@@ -3,8 +3,11 @@
 
 #include "VitalityEffectsComponent.h"
 
+#include "lib/SaveStats.h"
 #include "lib/VitalityGlobals.h"
+#include "lib/VitalityStats.h"
 #include "Net/UnrealNetwork.h"
+#include "VitalityEffectLifetime.h"
 
 
 UVitalityEffectsComponent::UVitalityEffectsComponent()
@@ -25,6 +28,77 @@ void UVitalityEffectsComponent::Server_InitializeEffects_Implementation(const TA
 		FRWScopeLock ReadLock(EffectsLock_, SLT_Write);
 		CurrentEffects_.Empty();
 		CurrentEffects_ = SavedEffects;
+		MarkEffectsDirty();
+	}
+}
+
+void UVitalityEffectsComponent::CaptureSaveData(FVitalitySaveRecord& OutRecord,
+	EVitalitySaveSections Sections) const
+{
+	if (!EnumHasAnyFlags(Sections, EVitalitySaveSections::EFFECTS))
+		return;
+	
+	OutRecord.Sections |= EVitalitySaveSections::EFFECTS;
+	FRWScopeLock ReadLock(EffectsLock_, SLT_ReadOnly);
+	OutRecord.Effects.Reset(CurrentEffects_.Num());
+	for (const FStVitalityEffects& CurrentEffect : CurrentEffects_)
+	{
+		FVitalitySaveRecord::FEffect& SavedEffect = OutRecord.Effects.AddDefaulted_GetRef();
+		SavedEffect.EffectName		= CurrentEffect.EffectName;
+		SavedEffect.BenefitEffect	= CurrentEffect.benefitEffect;
+		SavedEffect.DetrimentEffect	= CurrentEffect.detrimentEffect;
+		SavedEffect.RemainingTicks	= CurrentEffect.effectTicks;
+		SavedEffect.UniqueId		= CurrentEffect.uniqueId;
+		SavedEffect.bIsPersistent	= CurrentEffect.bIsPersistent;
+	}
+}
+
+/**
+ * @brief Rebuilds the saved effects from the vitality data table, restoring their
+ *        remaining ticks and unique IDs, and replaces the active effects in one step.
+ * @param Record The saved record. Does nothing if it has no effects section.
+ */
+void UVitalityEffectsComponent::ApplySaveData(const FVitalitySaveRecord& Record)
+{
+	if (!Record.HasSection(EVitalitySaveSections::EFFECTS) || !GetOwner()->HasAuthority())
+		return;
+
+	TArray<FStVitalityEffects> RestoredEffects;
+	RestoredEffects.Reserve(Record.Effects.Num());
+	for (const FVitalitySaveRecord::FEffect& SavedEffect : Record.Effects)
+	{
+		// The table row holds everything that was not saved, such as icons and spawn classes
+		FStVitalityEffects RestoredEffect;
+		if (!SavedEffect.EffectName.IsNone())
+			RestoredEffect = UVitalityEffect::GetVitalityEffect(SavedEffect.EffectName);
+		else if (SavedEffect.BenefitEffect != EEffectsBeneficial::MAX)
+			RestoredEffect = UVitalityEffect::GetVitalityEffectByBenefit(SavedEffect.BenefitEffect);
+		else
+			RestoredEffect = UVitalityEffect::GetVitalityEffectByDetriment(SavedEffect.DetrimentEffect);
+		
+		RestoredEffect.EffectName		= SavedEffect.EffectName;
+		RestoredEffect.benefitEffect	= SavedEffect.BenefitEffect;
+		RestoredEffect.detrimentEffect	= SavedEffect.DetrimentEffect;
+		RestoredEffect.effectTicks		= SavedEffect.RemainingTicks;
+		RestoredEffect.uniqueId			= SavedEffect.UniqueId;
+		RestoredEffect.bIsPersistent	= SavedEffect.bIsPersistent;
+		RestoredEffects.Add(RestoredEffect);
+	}
+
+	{
+		FRWScopeLock WriteLock(EffectsLock_, SLT_Write);
+		CurrentEffects_ = MoveTemp(RestoredEffects);
+		bHasInitialized = true;
+	}
+	MarkEffectsDirty();
+	SetSaveSectionsDirty(EVitalitySaveSections::EFFECTS, false);
+
+	for (const FStVitalityEffects& CurrentEffect : CurrentEffects_)
+	{
+		if (CurrentEffect.benefitEffect != EEffectsBeneficial::MAX)
+			OnEffectBeneficialApplied.Broadcast(CurrentEffect.uniqueId, CurrentEffect.EffectName);
+		else
+			OnEffectDetrimentalApplied.Broadcast(CurrentEffect.uniqueId, CurrentEffect.EffectName);
 	}
 }
 
@@ -87,6 +161,9 @@ bool UVitalityEffectsComponent::ApplyEffectBeneficial(EEffectsBeneficial EffectB
 			for (int i = 0; i < StackCount; i++)
 				CurrentEffects_.Add(vitalityData);
 		}
+		MarkEffectsDirty();
+		INC_DWORD_STAT_BY(STAT_VitalityEffectsApplied, StackCount);
+		VITALITY_TRACE_EVENT(EffectApplied, GetOwner(), vitalityData.uniqueId, vitalityData.EffectName, StackCount);
 	}
 	return false;
 }
@@ -115,6 +192,8 @@ bool UVitalityEffectsComponent::ApplyEffectDetrimental(EEffectsDetrimental Effec
 	{
 		for (int i = 0; i < StackCount; i++)
 			AddQueue_.Add(vitalityData);
+		INC_DWORD_STAT_BY(STAT_VitalityEffectsApplied, StackCount);
+		VITALITY_TRACE_EVENT(EffectApplied, GetOwner(), vitalityData.uniqueId, vitalityData.EffectName, StackCount);
 	}
 	
 	return false;
@@ -202,7 +281,11 @@ bool UVitalityEffectsComponent::RemoveEffectAtIndex(int IndexNumber)
 	const int UniqueId		= CurrentEffects_[IndexNumber].uniqueId;
 	const FName EffectName	= CurrentEffects_[IndexNumber].EffectName;
 	CurrentEffects_.RemoveAt(IndexNumber);
+	MarkEffectsDirty();
+	INC_DWORD_STAT(STAT_VitalityEffectsExpired);
+	VITALITY_TRACE_EVENT(EffectExpired, GetOwner(), UniqueId, EffectName);
 	OnEffectDetrimentalExpired.Broadcast(UniqueId, EffectName);
+	INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
 	return true;
 }
 
@@ -410,41 +493,180 @@ bool UVitalityEffectsComponent::IsEffectDetrimentalActive(EEffectsDetrimental Ef
 	return false;
 }
 
+/**
+ * @brief Collects the active beneficial and detrimental enums as bit sets
+ * @param OutBenefitBits Bit n is set if EEffectsBeneficial(n) is active
+ * @param OutDetrimentBits Bit n is set if EEffectsDetrimental(n) is active
+ */
+void UVitalityEffectsComponent::GetActiveEffectBits(uint32& OutBenefitBits, uint32& OutDetrimentBits) const
+{
+	OutBenefitBits = 0;
+	OutDetrimentBits = 0;
+	FRWScopeLock ReadLock(EffectsLock_, SLT_ReadOnly);
+	for (const FStVitalityEffects& CurrentEffect : CurrentEffects_)
+	{
+		if (CurrentEffect.benefitEffect != EEffectsBeneficial::MAX)
+			OutBenefitBits |= 1u << static_cast<uint32>(CurrentEffect.benefitEffect);
+		if (CurrentEffect.detrimentEffect != EEffectsDetrimental::MAX)
+			OutDetrimentBits |= 1u << static_cast<uint32>(CurrentEffect.detrimentEffect);
+	}
+}
+
+/**
+ * @brief Copies the active effects into the back buffer and flips it, so worker
+ *        threads can read them without locking. Game thread only.
+ */
+void UVitalityEffectsComponent::PublishSnapshot()
+{
+	check(IsInGameThread());
+	FVitalityEffectsSnapshot& Snapshot = Snapshot_.BeginWrite();
+	Snapshot = FVitalityEffectsSnapshot();
+
+	FVitalityVisibleEffects VisibleEffects;
+	EffectsLock_.ReadLock();
+	Snapshot.NumEffects = CurrentEffects_.Num();
+	for (int i = 0; i < CurrentEffects_.Num(); i++)
+	{
+		const FStVitalityEffects& CurrentEffect = CurrentEffects_[i];
+		if (CurrentEffect.benefitEffect != EEffectsBeneficial::MAX)
+		{
+			const uint32 EffectIndex = static_cast<uint32>(CurrentEffect.benefitEffect);
+			Snapshot.BenefitBits |= 1u << EffectIndex;
+			Snapshot.BenefitCounts[EffectIndex] = FMath::Min(Snapshot.BenefitCounts[EffectIndex] + 1, 255);
+		}
+		if (CurrentEffect.detrimentEffect != EEffectsDetrimental::MAX)
+		{
+			const uint32 EffectIndex = static_cast<uint32>(CurrentEffect.detrimentEffect);
+			Snapshot.DetrimentBits |= 1u << EffectIndex;
+			Snapshot.DetrimentCounts[EffectIndex] = FMath::Min(Snapshot.DetrimentCounts[EffectIndex] + 1, 255);
+		}
+		if (i < FVitalityEffectsSnapshot::MaxListedEffects)
+		{
+			FVitalityEffectsSnapshot::FEffect& ListedEffect = Snapshot.Effects[i];
+			ListedEffect.UniqueId			= CurrentEffect.uniqueId;
+			ListedEffect.EffectTicks		= CurrentEffect.effectTicks;
+			ListedEffect.BenefitEffect		= CurrentEffect.benefitEffect;
+			ListedEffect.DetrimentEffect	= CurrentEffect.detrimentEffect;
+			ListedEffect.bIsPersistent		= CurrentEffect.bIsPersistent;
+		}
+		if (CurrentEffect.benefitEffect == EEffectsBeneficial::MAX
+			&& CurrentEffect.detrimentEffect == EEffectsDetrimental::MAX)
+		{
+			const int32 TableIndex = VisibleTableEffects.Find(CurrentEffect.EffectName);
+			if (TableIndex != INDEX_NONE && TableIndex < FVitalityVisibleEffects::MaxTableEffects)
+				VisibleEffects.TableBits |= static_cast<uint16>(1u << TableIndex);
+		}
+	}
+	VisibleEffects.BenefitBits		= static_cast<uint8>(Snapshot.BenefitBits);
+	VisibleEffects.DetrimentBits	= static_cast<uint16>(Snapshot.DetrimentBits);
+	Snapshot_.Publish();
+	EffectsLock_.ReadUnlock();
+
+	// Broadcast without the lock, so listeners can apply or remove effects
+	if (GetOwner()->HasAuthority() && VisibleEffects != VisibleEffects_)
+	{
+		VisibleEffects_ = VisibleEffects;
+		OnVisibleEffectsChanged.Broadcast();
+		INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
+	}
+}
+
+bool UVitalityEffectsComponent::IsTableEffectVisible(FName EffectName) const
+{
+	return VisibleEffects_.HasTableEffect(VisibleTableEffects.Find(EffectName));
+}
+
+void UVitalityEffectsComponent::GetMemoryUsage(FVitalityMemoryUsage& OutUsage) const
+{
+	FRWScopeLock ReadLock(EffectsLock_, SLT_ReadOnly);
+	OutUsage.Effects	+= CurrentEffects_.GetAllocatedSize();
+	OutUsage.Queues		+= AddQueue_.GetAllocatedSize() + RemoveQueue_.GetAllocatedSize();
+}
+
+void UVitalityEffectsComponent::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	FVitalityMemoryUsage MemoryUsage;
+	GetMemoryUsage(MemoryUsage);
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(MemoryUsage.GetTotal());
+}
+
+#if !UE_BUILD_SHIPPING
+void UVitalityEffectsComponent::SetActiveEffectsForTesting(const TArray<FStVitalityEffects>& Effects)
+{
+	FRWScopeLock WriteLock(EffectsLock_, SLT_Write);
+	CurrentEffects_ = Effects;
+}
+#endif
+
 void UVitalityEffectsComponent::BeginPlay()
 {
 	Super::BeginPlay();
+	UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this);
+	if (VitalitySubsystem != nullptr)
+		VitalityHandle_ = VitalitySubsystem->RegisterComponent(this);
+	
+	// In parallel update mode the subsystem counts the effects down instead
+	if (GetOwner()->HasAuthority() && (VitalitySubsystem == nullptr || !VitalitySubsystem->IsParallelUpdate()))
+	{
+		InitializeTimer(EffectsTimer_,
+			FTimerDelegate::CreateUObject(this, &UVitalityEffectsComponent::TickEffects), EffectsTickRate);
+	}
+}
+
+void UVitalityEffectsComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	CancelTimer(EffectsTimer_);
+	if (UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this))
+		VitalitySubsystem->UnregisterComponent(this);
+	VitalityHandle_ = FVitalityHandle();
+	Super::EndPlay(EndPlayReason);
+}
+
+void UVitalityEffectsComponent::MarkEffectsDirty()
+{
+	DirtySaveSections_ |= EVitalitySaveSections::EFFECTS;
+	if (UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this))
+		VitalitySubsystem->MarkDirty(VitalityHandle_);
+}
+
+void UVitalityEffectsComponent::SetSaveSectionsDirty(EVitalitySaveSections Sections, bool bIsDirty)
+{
+	Sections &= EVitalitySaveSections::EFFECTS;
+	if (bIsDirty)
+		DirtySaveSections_ |= Sections;
+	else
+		DirtySaveSections_ &= ~Sections;
 }
 
 void UVitalityEffectsComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 	DOREPLIFETIME_CONDITION(UVitalityEffectsComponent, CurrentEffects_, COND_OwnerOnly);
+	DOREPLIFETIME(UVitalityEffectsComponent, VisibleEffects_);
 }
 
-// Runs the tick timer, evaluating each active effect per tick
+// Runs the tick timer, counting each active effect down once per tick
 void UVitalityEffectsComponent::TickEffects()
 {
-	// Perform any logic effects need done per tick
-	if (CurrentEffects_.Num() > 0)
-	{
-		FRWScopeLock WriteLock(EffectsLock_, SLT_ReadOnly);
-		for (int i = 0; i < CurrentEffects_.Num(); i++)
-		{
-			if (CurrentEffects_.IsValidIndex(i))
-			{
-				const FStVitalityEffects vitalityData = CurrentEffects_[i];
-				if (!vitalityData.bIsPersistent)
-				{
-					CurrentEffects_[i].effectTicks--;
-					if (CurrentEffects_[i].effectTicks < 1)
-					{
-						RemoveEffectAtIndex(i);
-					}
-				}
-			}
-		}
-	}
-	
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityTickEffects);
+	INC_DWORD_STAT(STAT_VitalityTimersFired);
+	// The same steps the parallel update takes, run back to back on the game thread
+	CountDownEffects(EffectsTickRate);
+	ApplyExpiredEffects();
+}
+
+bool UVitalityEffectsComponent::HasEffectsToTick() const
+{
+	if (AddQueue_.Num() > 0 || RemoveQueue_.Num() > 0)
+		return true;
+	// Persistent effects never count down, so a list of only those has nothing to do
+	return CurrentEffects_.ContainsByPredicate(
+		[](const FStVitalityEffects& CurrentEffect) { return !CurrentEffect.bIsPersistent; });
+}
+
+void UVitalityEffectsComponent::FlushEffectQueues()
+{
 	// Remove any effects that are pending removal
 	if (RemoveQueue_.Num() > 0)
 	{
@@ -458,6 +680,7 @@ void UVitalityEffectsComponent::TickEffects()
 				if (CurrentEffects_[j].uniqueId == RemoveQueue_[i])
 				{
 					CurrentEffects_.RemoveAt(j);
+					MarkEffectsDirty();
 					break;
 				}
 			}
@@ -474,9 +697,79 @@ void UVitalityEffectsComponent::TickEffects()
 			CurrentEffects_.Add( AddQueue_[i] );
 			AddQueue_.RemoveAt(i);
 		}
+		MarkEffectsDirty();
 	}
 }
 
+/**
+ * @brief Counts down every non-persistent effect once for each interval that passed. Called by
+ *        the vitality subsystem from a worker thread, or by TickEffects(), so expired effects
+ *        are only gathered here.
+ * @param DeltaSeconds The time since the last update
+ */
+void UVitalityEffectsComponent::CountDownEffects(float DeltaSeconds)
+{
+	EffectsElapsed_ += DeltaSeconds;
+	if (EffectsElapsed_ < EffectsTickRate)
+		return;
+	
+	FRWScopeLock WriteLock(EffectsLock_, SLT_Write);
+	while (EffectsElapsed_ >= EffectsTickRate)
+	{
+		EffectsElapsed_ -= EffectsTickRate;
+		for (FStVitalityEffects& CurrentEffect : CurrentEffects_)
+		{
+			if (CurrentEffect.bIsPersistent)
+				continue;
+			// The remaining ticks are replicated, snapshotted and saved
+			bTicksCounted_ = true;
+			if (FVitalityEffectLifetime::Tick(CurrentEffect.effectTicks, false))
+				ExpiredEffects_.AddUnique(CurrentEffect.uniqueId);
+		}
+	}
+}
+
+/**
+ * @brief Removes the effects gathered by CountDownEffects() and flushes the queues.
+ *        Delegates are broadcast after the lock is released.
+ */
+void UVitalityEffectsComponent::ApplyExpiredEffects()
+{
+	check(IsInGameThread());
+	if (bTicksCounted_)
+	{
+		bTicksCounted_ = false;
+		MarkEffectsDirty();
+	}
+	if (ExpiredEffects_.Num() > 0)
+	{
+		TArray<TPair<int, FName>, TInlineAllocator<8>> RemovedEffects;
+		{
+			FRWScopeLock WriteLock(EffectsLock_, SLT_Write);
+			for (const int UniqueId : ExpiredEffects_)
+			{
+				const int32 EffectIndex = CurrentEffects_.IndexOfByPredicate(
+					[UniqueId](const FStVitalityEffects& CurrentEffect) { return CurrentEffect.uniqueId == UniqueId; });
+				// Removed some other way since it was gathered
+				if (EffectIndex == INDEX_NONE)
+					continue;
+				RemovedEffects.Emplace(UniqueId, CurrentEffects_[EffectIndex].EffectName);
+				CurrentEffects_.RemoveAt(EffectIndex);
+			}
+		}
+		ExpiredEffects_.Reset();
+		
+		for (const TPair<int, FName>& RemovedEffect : RemovedEffects)
+		{
+			INC_DWORD_STAT(STAT_VitalityEffectsExpired);
+			VITALITY_TRACE_EVENT(EffectExpired, GetOwner(), RemovedEffect.Key, RemovedEffect.Value);
+			OnEffectDetrimentalExpired.Broadcast(RemovedEffect.Key, RemovedEffect.Value);
+			INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
+		}
+	}
+	FlushEffectQueues();
+}
+
 /**
  * @brief Helper Function used to set the various timers in this class
  * @param TimerHandle The timer handle to be modified
@@ -486,8 +779,8 @@ void UVitalityEffectsComponent::TickEffects()
 void UVitalityEffectsComponent::InitializeTimer(FTimerHandle& TimerHandle,
 		FTimerDelegate TimerDelegate, float TickRate) const
 {
-	if (GetWorld()->GetTimerManager().TimerExists(TimerHandle))
-		TimerHandle.Invalidate();
+	// Cleared rather than invalidated, or the old timer keeps firing alongside the new one
+	GetWorld()->GetTimerManager().ClearTimer(TimerHandle);
 
 	const float managerTickRate = TickRate <= 0.f ? 1.f : TickRate;
 	GetWorld()->GetTimerManager().SetTimer(TimerHandle,	TimerDelegate,
@@ -500,11 +793,8 @@ void UVitalityEffectsComponent::InitializeTimer(FTimerHandle& TimerHandle,
  */
 void UVitalityEffectsComponent::CancelTimer(FTimerHandle& TimerHandle) const
 {
-	if (GetWorld()->GetTimerManager().TimerExists(TimerHandle))
-	{
-		if (TimerHandle.IsValid())
-			TimerHandle.Invalidate();
-	}
+	// Invalidates the handle as well
+	GetWorld()->GetTimerManager().ClearTimer(TimerHandle);
 }
 
 /**
@@ -513,10 +803,10 @@ void UVitalityEffectsComponent::CancelTimer(FTimerHandle& TimerHandle) const
  */
 int UVitalityEffectsComponent::GenerateUniqueId()
 {
-	bool idExists = false;
 	FRWScopeLock ReadLock(EffectsLock_, SLT_ReadOnly);
-	while (idExists)
+	for (int attempt = 0; attempt < 100; attempt++)
 	{
+		bool idExists = false;
 		const int randomNumber = FMath::RandRange(1,INT_MAX);
 		for (const FStVitalityEffects& vEffect : CurrentEffects_)
 		{
@@ -532,6 +822,13 @@ int UVitalityEffectsComponent::GenerateUniqueId()
 	return 0;
 }
 
+void UVitalityEffectsComponent::OnRep_VisibleEffectsChanged()
+{
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityOnRepEffects);
+	OnVisibleEffectsChanged.Broadcast();
+	INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
+}
+
 /**
  * @brief Ruins on the owning client, triggering the proper delegates
  * @param OldArray The effects that were active before the update occurred
@@ -539,6 +836,9 @@ int UVitalityEffectsComponent::GenerateUniqueId()
 void UVitalityEffectsComponent::OnRep_CurrentEffectsChanged_Implementation(
 	const TArray<FStVitalityEffects>& OldArray)
 {
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityOnRepEffects);
+	MarkEffectsDirty();
+	
 	// Arrays that track effects by Unique ID (KEY) and EffectName (VALUE)
 	TMap<int, FName> AddedBenefitEffects;
 	TMap<int, FName> AddedDetrimentEffects;
@@ -584,6 +884,8 @@ void UVitalityEffectsComponent::OnRep_CurrentEffectsChanged_Implementation(
 	}
 
 	// Trigger Delegates	
+	INC_DWORD_STAT_BY(STAT_VitalityDelegatesBroadcast, AddedBenefitEffects.Num() + AddedDetrimentEffects.Num()
+		+ RemovedBenefitEffects.Num() + RemovedDetrimentEffects.Num());
 	for (const TPair<int, FName>& RemovedEffect : AddedBenefitEffects)
 		OnEffectBeneficialApplied.Broadcast(RemovedEffect.Key, RemovedEffect.Value);
 	
@@ -0,0 +1,213 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "VitalityHealthBars.h"
+
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Rendering/DrawElements.h"
+#include "Styling/CoreStyle.h"
+#include "VitalitySubsystem.h"
+#include "VitalityWelfareComponent.h"
+#include "Widgets/SLeafWidget.h"
+
+
+// The single layer every health bar is drawn on. Holds no state of its own.
+class SVitalityHealthBars : public SLeafWidget
+{
+public:
+
+	SLATE_BEGIN_ARGS(SVitalityHealthBars) {}
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs, UVitalityHealthBars* InHealthBars)
+	{
+		HealthBars = InHealthBars;
+		SetVisibility(EVisibility::HitTestInvisible);
+	}
+
+	virtual FVector2D ComputeDesiredSize(float) const override { return FVector2D::ZeroVector; }
+
+	virtual int32 OnPaint(const FPaintArgs& Args, const FGeometry& AllottedGeometry,
+		const FSlateRect& MyCullingRect, FSlateWindowElementList& OutDrawElements,
+		int32 LayerId, const FWidgetStyle& InWidgetStyle, bool bParentEnabled) const override
+	{
+		if (const UVitalityHealthBars* Owner = HealthBars.Get())
+			return Owner->PaintHealthBars(AllottedGeometry, OutDrawElements, LayerId);
+		return LayerId;
+	}
+
+private:
+
+	TWeakObjectPtr<UVitalityHealthBars> HealthBars;
+};
+
+
+UVitalityHealthBars* UVitalityHealthBars::Get(const UObject* WorldContextObject)
+{
+	if (!IsValid(WorldContextObject))
+		return nullptr;
+	const UWorld* World = WorldContextObject->GetWorld();
+	return IsValid(World) ? World->GetSubsystem<UVitalityHealthBars>() : nullptr;
+}
+
+void UVitalityHealthBars::SetHealthBarsEnabled(bool bEnabled)
+{
+	bEnabled_ = bEnabled;
+	if (!bEnabled_)
+		Bars_.Reset();
+}
+
+bool UVitalityHealthBars::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UVitalityHealthBars::Deinitialize()
+{
+	if (Widget_.IsValid())
+	{
+		if (UGameViewportClient* GameViewport = GetWorld()->GetGameViewport())
+			GameViewport->RemoveViewportWidgetContent(Widget_.ToSharedRef());
+		Widget_.Reset();
+	}
+	Bars_.Empty();
+	Super::Deinitialize();
+}
+
+/**
+ * @brief Gathers a bar for every welfare component that wants one, reading its published
+ *        snapshot. Actors beyond MaxDistance, off screen, or not rendered recently are
+ *        skipped before they are projected; the closest MaxBars are kept.
+ */
+void UVitalityHealthBars::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	Bars_.Reset();
+	if (!bEnabled_)
+		return;
+
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	const UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this);
+	if (PlayerController == nullptr || PlayerController->PlayerCameraManager == nullptr || VitalitySubsystem == nullptr)
+		return;
+
+	const FVector CameraLocation	= PlayerController->PlayerCameraManager->GetCameraLocation();
+	const AActor* ViewingPawn		= PlayerController->GetPawn();
+	const float MaxDistanceSquared	= FMath::Square(MaxDistance);
+	const float DetailDistanceSquared = FMath::Square(DetailDistance);
+
+	VitalitySubsystem->ForEachWelfare([&](const FVitalityHandle& Handle, UVitalityWelfareComponent& Welfare)
+	{
+		const AActor* Actor = Welfare.GetOwner();
+		if (!Welfare.ShowHealthBar || Actor == nullptr || Actor == ViewingPawn)
+			return;
+
+		const FVitalityWelfareSnapshot& Snapshot = Welfare.GetPublishedSnapshot();
+		const float HealthPercent = Snapshot.GetHealthPercent();
+		if (Snapshot.bIsDead || Snapshot.HealthMax <= 0.f || (bHideWhenFull && HealthPercent >= 1.f))
+			return;
+
+		const FVector BarLocation = Actor->GetActorLocation() + WorldOffset;
+		const float DistanceSquared = FVector::DistSquared(CameraLocation, BarLocation);
+		if (DistanceSquared > MaxDistanceSquared)
+			return;
+		if (RecentlyRenderedTime > 0.f && !Actor->WasRecentlyRendered(RecentlyRenderedTime))
+			return;
+
+		FVector2D ScreenPosition;
+		if (!PlayerController->ProjectWorldLocationToScreen(BarLocation, ScreenPosition, false))
+			return;
+
+		FBar& Bar			= Bars_.AddDefaulted_GetRef();
+		Bar.ScreenPosition	= ScreenPosition;
+		Bar.DistanceSquared	= DistanceSquared;
+		Bar.Scale			= FMath::Lerp(1.f, MinScale, FMath::Sqrt(DistanceSquared) / FMath::Max(MaxDistance, 1.f));
+		Bar.HealthPercent	= HealthPercent;
+		Bar.StaminaPercent	= Snapshot.GetStaminaPercent();
+		Bar.MagicPercent	= Snapshot.GetMagicPercent();
+		Bar.bShowDetail		= DistanceSquared <= DetailDistanceSquared;
+	});
+
+	if (Bars_.Num() > MaxBars)
+	{
+		Bars_.Sort([](const FBar& A, const FBar& B) { return A.DistanceSquared < B.DistanceSquared; });
+		Bars_.SetNum(FMath::Max(MaxBars, 0), false);
+	}
+	// Painted back to front, so closer bars cover further ones
+	Bars_.Sort([](const FBar& A, const FBar& B) { return A.DistanceSquared > B.DistanceSquared; });
+
+	if (Bars_.Num() > 0)
+		EnsureWidget();
+}
+
+TStatId UVitalityHealthBars::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVitalityHealthBars, STATGROUP_Tickables);
+}
+
+bool UVitalityHealthBars::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UVitalityHealthBars::EnsureWidget()
+{
+	if (Widget_.IsValid())
+		return;
+	UGameViewportClient* GameViewport = GetWorld()->GetGameViewport();
+	if (GameViewport == nullptr)
+		return;
+	SAssignNew(Widget_, SVitalityHealthBars, this);
+	// Below the damage numbers
+	GameViewport->AddViewportWidgetContent(Widget_.ToSharedRef(), 9);
+}
+
+int32 UVitalityHealthBars::PaintHealthBars(const FGeometry& AllottedGeometry,
+	FSlateWindowElementList& OutDrawElements, int32 LayerId) const
+{
+	if (Bars_.Num() < 1)
+		return LayerId;
+
+	const FSlateBrush* Brush = FCoreStyle::Get().GetBrush("GenericWhiteBox");
+	// Projected positions are in viewport pixels, while the layer paints in DPI scaled units
+	const float InverseScale = 1.f / FMath::Max(AllottedGeometry.Scale, KINDA_SMALL_NUMBER);
+
+	// Slate sorts by layer before submission order, so each bar gets its own pair of layers.
+	// Otherwise a far bar's fill would paint over a nearer bar's background.
+	int32 BarLayer = LayerId;
+	auto DrawBar = [&](const FVector2D& Position, const FVector2D& Size, float Percent, const FLinearColor& Color)
+	{
+		FSlateDrawElement::MakeBox(OutDrawElements, BarLayer,
+			AllottedGeometry.ToPaintGeometry(Size, FSlateLayoutTransform(Position)),
+			Brush, ESlateDrawEffect::None, BackgroundColor);
+		if (Percent > 0.f)
+		{
+			FSlateDrawElement::MakeBox(OutDrawElements, BarLayer + 1,
+				AllottedGeometry.ToPaintGeometry(FVector2D(Size.X * Percent, Size.Y), FSlateLayoutTransform(Position)),
+				Brush, ESlateDrawEffect::None, Color);
+		}
+	};
+
+	for (int32 i = 0; i < Bars_.Num(); i++)
+	{
+		const FBar& Bar = Bars_[i];
+		BarLayer = LayerId + 2 * i;
+		const FVector2D HealthSize = BarSize * Bar.Scale;
+		FVector2D Position = Bar.ScreenPosition * InverseScale - FVector2D(HealthSize.X * 0.5f, HealthSize.Y);
+		DrawBar(Position, HealthSize, Bar.HealthPercent, HealthColor);
+
+		if (Bar.bShowDetail)
+		{
+			// Stamina and magic are half height, directly under health
+			const FVector2D DetailSize(HealthSize.X, HealthSize.Y * 0.5f);
+			Position.Y += HealthSize.Y;
+			DrawBar(Position, DetailSize, Bar.StaminaPercent, StaminaColor);
+			Position.Y += DetailSize.Y;
+			DrawBar(Position, DetailSize, Bar.MagicPercent, MagicColor);
+		}
+	}
+	// The fill layer of the nearest bar
+	return BarLayer + 1;
+}
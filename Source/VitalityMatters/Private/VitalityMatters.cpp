@@ -2,17 +2,29 @@
 
 #include "VitalityMatters.h"
 
+#include "lib/NutritionRegistry.h"
+#include "lib/VitalityDataBlob.h"
+
 #define LOCTEXT_NAMESPACE "FVitalityMattersModule"
 
 void FVitalityMattersModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+
+	// Dedicated servers read the cooked data blob instead of loading the data tables and their assets
+	if (IsRunningDedicatedServer())
+		FVitalityDataBlob::Get().Open(FVitalityDataBlob::GetDefaultPath());
+	
+	// Streams the nutrition table in the background, so consuming an item never waits on it
+	FNutritionRegistry::Get().StartPreload();
 }
 
 void FVitalityMattersModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FNutritionRegistry::Get().Shutdown();
+	FVitalityDataBlob::Get().Close();
 }
 
 #undef LOCTEXT_NAMESPACE
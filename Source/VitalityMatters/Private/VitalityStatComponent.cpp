@@ -3,10 +3,13 @@
 
 #include "VitalityStatComponent.h"
 
+#include "VitalityWelfareComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "lib/SaveStats.h"
+#include "lib/VitalityStats.h"
 #include "Logging/StructuredLog.h"
 #include "Net/UnrealNetwork.h"
+#include "VitalityStatMath.h"
 
 
 UVitalityStatComponent::UVitalityStatComponent()
@@ -14,11 +17,18 @@ UVitalityStatComponent::UVitalityStatComponent()
 	SetIsReplicatedByDefault(true);
 }
 
-bool UVitalityStatComponent::LoadStatsFromSave(
+/**
+ * @brief Saves the owner's stats, welfare and effects to the given slot
+ * @param ResponseString Describes the result of the request
+ * @param SaveSlotName The slot to save to
+ * @param isAsync If true, encoding and writing happens on a worker thread and
+ *                OnInventorySaved is broadcast once finished
+ * @return True if the save was written (or the async request was sent)
+ */
+bool UVitalityStatComponent::SaveStatsToSlot(
 		FString& ResponseString, FString SaveSlotName, bool isAsync)
 {
-	/*
-	ResponseString = "Failed to Save (Inventory Has Not Initialized)";
+	ResponseString = "Failed to Save (Stats Have Not Initialized)";
 	if (bSavesOnServerOnly)
 	{
 		if (GetNetMode() == NM_Client)
@@ -30,7 +40,47 @@ bool UVitalityStatComponent::LoadStatsFromSave(
 	
 	if (bStatsSystemReady)
 	{
-		if (!UGameplayStatics::DoesSaveGameExist(SaveSlotName, 0))
+		StatsSaveName_ = SaveSlotName;
+		if (isAsync)
+		{
+			const bool bSent = UVitalitySaveSystem::SaveActorAsync(GetOwner(), StatsSaveName_, StatsSaveUserIndex_,
+				FOnVitalitySaveComplete::CreateUObject(this, &UVitalityStatComponent::SaveDataDelegate));
+			ResponseString = bSent ? "Sent Async Save Request" : "Nothing to Save";
+			return bSent;
+		}
+
+		if (UVitalitySaveSystem::SaveActor(GetOwner(), StatsSaveName_, StatsSaveUserIndex_))
+		{
+			ResponseString = "Successful Synchronous Save";
+			OnInventorySaved.Broadcast(true);
+			return true;
+		}
+		ResponseString = "Failed to Write Save Slot";
+	}
+	return false;
+}
+
+/**
+ * @brief Loads the owner's stats, welfare and effects from the given slot
+ * @param ResponseString Describes the result of the request
+ * @param SaveSlotName The slot to load from
+ * @param isAsync If true, reading and decoding happens on a worker thread, the result
+ *                is applied on the game thread in one step and OnStatsLoaded is broadcast
+ * @return True if the save was applied (or the async request was sent)
+ */
+bool UVitalityStatComponent::LoadStatsFromSave(
+		FString& ResponseString, FString SaveSlotName, bool isAsync)
+{
+	ResponseString = "Failed to Load (Stats Have Not Initialized)";
+	if (!GetOwner()->HasAuthority())
+	{
+		ResponseString = "Loading Only Allowed on Authority";
+		return false;
+	}
+	
+	if (bStatsSystemReady)
+	{
+		if (!UVitalitySaveSystem::DoesVitalitySaveExist(SaveSlotName, StatsSaveUserIndex_))
 		{
 			ResponseString = "No SaveSlotName Exists";
 			return false;
@@ -39,32 +89,108 @@ bool UVitalityStatComponent::LoadStatsFromSave(
 
 		if (isAsync)
 		{
-			FAsyncLoadGameFromSlotDelegate LoadDelegate;
-			LoadDelegate.BindUObject(this, &UVitalityStatComponent::LoadDataDelegate);
-			UGameplayStatics::AsyncLoadGameFromSlot(StatsSaveName_, StatsSaveUserIndex_, LoadDelegate);
-			ResponseString = "Sent Async Save Request";
+			UVitalitySaveSystem::LoadActorAsync(GetOwner(), StatsSaveName_, StatsSaveUserIndex_,
+				FOnVitalityLoadComplete::CreateUObject(this, &UVitalityStatComponent::LoadDataDelegate));
+			ResponseString = "Sent Async Load Request";
 			return true;
 		}
 
-		const USaveGame* SaveData = UGameplayStatics::LoadGameFromSlot(
-											StatsSaveName_, StatsSaveUserIndex_);
-		
-		if (IsValid(SaveData))
+		if (UVitalitySaveSystem::LoadActor(GetOwner(), StatsSaveName_, StatsSaveUserIndex_))
 		{
-			const USaveVitalityStat* SavedStats = Cast<USaveVitalityStat>( SaveData );
-			if (IsValid(SavedStats))
-			{
-				SavedStats(InventorySave->InventorySlots_,
-								 InventorySave->EquipmentSlots_);
-				ResponseString = "Successful Synchronous Load";
-				return true;	
-			}
+			ResponseString = "Successful Synchronous Load";
+			OnStatsLoaded.Broadcast(true);
+			return true;
 		}
+		ResponseString = "Save Slot Could Not Be Read";
 	}
-	*/
 	return false;
 }
 
+void UVitalityStatComponent::SaveDataDelegate(bool bSuccess)
+{
+	OnInventorySaved.Broadcast(bSuccess);
+}
+
+void UVitalityStatComponent::LoadDataDelegate(bool bSuccess)
+{
+	OnStatsLoaded.Broadcast(bSuccess);
+}
+
+void UVitalityStatComponent::CaptureSaveData(FVitalitySaveRecord& OutRecord,
+	EVitalitySaveSections Sections) const
+{
+	for (int32 Layer = 0; Layer < FVitalitySaveRecord::NumLayers; Layer++)
+	{
+		const EVitalitySaveSections LayerSection =
+			FVitalitySaveRecord::GetLayerSection(static_cast<EVitalityStatLayer>(Layer));
+		if (!EnumHasAnyFlags(Sections, LayerSection))
+			continue;
+
+		OutRecord.Sections |= LayerSection;
+		const FStVitalityStats* StatsMap = GetStatsLayer(static_cast<EVitalityStatLayer>(Layer));
+		OutRecord.CoreStats[Layer]		= StatsMap->CoreStats;
+		OutRecord.DamageBonuses[Layer]	= StatsMap->DamageBonuses;
+		OutRecord.DamageResists[Layer]	= StatsMap->DamageResists;
+	}
+}
+
+/**
+ * @brief Replaces the saved stat layers, firing the stat delegates for every
+ *        value that changed and recomputing derived stats once.
+ * @param Record The saved record. Layers it does not hold are left untouched.
+ */
+void UVitalityStatComponent::ApplySaveData(const FVitalitySaveRecord& Record)
+{
+	if (!Record.HasSection(EVitalitySaveSections::STATS) || !GetOwner()->HasAuthority())
+		return;
+
+	FStVitalityStats* Layers[FVitalitySaveRecord::NumLayers] = {
+		&BaseStats_, &GearStats_, &ModifiedStats_, &OtherStats_ };
+	
+	for (int32 Layer = 0; Layer < FVitalitySaveRecord::NumLayers; Layer++)
+	{
+		if (!Record.HasSection(FVitalitySaveRecord::GetLayerSection(static_cast<EVitalityStatLayer>(Layer))))
+			continue;
+		
+		const FStVitalityStats OldStats = *Layers[Layer];
+		FStVitalityStats& StatsMap = *Layers[Layer];
+
+		// Saves from an older build may have fewer entries; those keep their current value
+		const int NumCoreStats = FMath::Min(StatsMap.CoreStats.Num(), Record.CoreStats[Layer].Num());
+		for (int i = 0; i < NumCoreStats; i++)
+			StatsMap.CoreStats[i] = Record.CoreStats[Layer][i];
+		
+		const int NumBonuses = FMath::Min(StatsMap.DamageBonuses.Num(), Record.DamageBonuses[Layer].Num());
+		for (int i = 0; i < NumBonuses; i++)
+			StatsMap.DamageBonuses[i] = Record.DamageBonuses[Layer][i];
+		
+		const int NumResists = FMath::Min(StatsMap.DamageResists.Num(), Record.DamageResists[Layer].Num());
+		for (int i = 0; i < NumResists; i++)
+			StatsMap.DamageResists[i] = Record.DamageResists[Layer][i];
+
+		StatsEventTrigger(&OldStats, &StatsMap);
+	}
+
+	// The layers were written directly, so every derived stat may be stale
+	if (DerivedStats_.IsCompiled())
+	{
+		DerivedStats_.MarkAllDirty();
+		EvaluateDerivedStats();
+	}
+
+	// The layers now match the save, so there is nothing new to journal
+	SetSaveSectionsDirty(Record.Sections, false);
+}
+
+void UVitalityStatComponent::SetSaveSectionsDirty(EVitalitySaveSections Sections, bool bIsDirty)
+{
+	Sections &= EVitalitySaveSections::STATS;
+	if (bIsDirty)
+		DirtySaveSections_ |= Sections;
+	else
+		DirtySaveSections_ &= ~Sections;
+}
+
 void UVitalityStatComponent::Reinitialize()
 {
 	UE_LOGFMT(LogTemp, Display, "{cName}({Sv}): Reinitialize()", *GetName(), GetOwner()->HasAuthority()?"S":"C");
@@ -82,6 +208,17 @@ void UVitalityStatComponent::Reinitialize()
 		OnDamageBonusUpdated.Broadcast(UVitalitySystem::GetDamageTypeFromInt(i));
 		OnDamageResistUpdated.Broadcast(UVitalitySystem::GetDamageTypeFromInt(i));
 	}
+
+	if (UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this))
+		VitalitySubsystem->MarkDirty(VitalityHandle_);
+	SetSaveSectionsDirty(EVitalitySaveSections::STATS_NATURAL, true);
+
+	// The base layer was written directly, so every derived stat may be stale
+	if (DerivedStats_.IsCompiled())
+	{
+		DerivedStats_.MarkAllDirty();
+		EvaluateDerivedStats();
+	}
 }
 
 /**
@@ -263,10 +400,10 @@ float UVitalityStatComponent::GetOtherDamageBonusValue(EDamageType DamageEnum)
  */
 float UVitalityStatComponent::GetTotalResistance(EDamageType DamageEnum)
 {
-	return (
-		  GetNaturalResistanceValue(DamageEnum) + GetMagicalResistanceValue(DamageEnum)
-		+ GetGearResistanceValue(DamageEnum) + GetOtherResistanceValue(DamageEnum)
-	);
+	return FVitalityStatMath::GetTotal({
+		BaseStats_.DamageResists, GearStats_.DamageResists,
+		ModifiedStats_.DamageResists, OtherStats_.DamageResists
+	}, static_cast<int32>(DamageEnum));
 }
 
 /**
@@ -276,10 +413,10 @@ float UVitalityStatComponent::GetTotalResistance(EDamageType DamageEnum)
  */
 float UVitalityStatComponent::GetTotalDamageBonus(EDamageType DamageEnum)
 {
-	return (
-		  GetNaturalDamageBonusValue(DamageEnum) + GetMagicalDamageBonusValue(DamageEnum)
-		+ GetGearDamageBonusValue(DamageEnum) + GetOtherDamageBonusValue(DamageEnum)
-	);
+	return FVitalityStatMath::GetTotal({
+		BaseStats_.DamageBonuses, GearStats_.DamageBonuses,
+		ModifiedStats_.DamageBonuses, OtherStats_.DamageBonuses
+	}, static_cast<int32>(DamageEnum));
 }
 
 /**
@@ -329,10 +466,10 @@ bool UVitalityStatComponent::SetOtherCoreStat(EVitalityStat StatEnum, float NewV
  */
 float UVitalityStatComponent::GetTotalCoreStat(EVitalityStat StatEnum)
 {
-	return (
-		GetCoreStatValue(BaseStats_, StatEnum) + GetCoreStatValue(GearStats_, StatEnum)
-	  + GetCoreStatValue(ModifiedStats_, StatEnum) + GetCoreStatValue(OtherStats_, StatEnum)
-	);
+	return FVitalityStatMath::GetTotal({
+		BaseStats_.CoreStats, GearStats_.CoreStats,
+		ModifiedStats_.CoreStats, OtherStats_.CoreStats
+	}, static_cast<int32>(StatEnum));
 }
 
 /**
@@ -462,12 +599,19 @@ void UVitalityStatComponent::BindListenerEvents()
 void UVitalityStatComponent::StatsEventTrigger(
 	const FStVitalityStats* OldStats, const FStVitalityStats* NewStats)
 {
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityStatsEventTrigger);
+	if (UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this))
+		VitalitySubsystem->MarkDirty(VitalityHandle_);
+	
 	for (int i = 0; i < static_cast<int>(EVitalityStat::MAX); i++)
 	{
 		if (NewStats->CoreStats.IsValidIndex(i) && OldStats->CoreStats.IsValidIndex(i))
 		{
-			if (NewStats->CoreStats[i] != NewStats->CoreStats[i])
-				OnCoreStatModified.Broadcast(static_cast<EVitalityStat>(i));	
+			if (NewStats->CoreStats[i] != OldStats->CoreStats[i])
+			{
+				OnCoreStatModified.Broadcast(static_cast<EVitalityStat>(i));
+				INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
+			}
 		}
 	}
 	for (int i = 0; i < static_cast<int>(EDamageType::MAX); i++)
@@ -475,12 +619,18 @@ void UVitalityStatComponent::StatsEventTrigger(
 		if (NewStats->DamageBonuses.IsValidIndex(i) && OldStats->DamageBonuses.IsValidIndex(i))
 		{
 			if (NewStats->DamageBonuses[i] != OldStats->DamageBonuses[i])
-				OnDamageBonusUpdated.Broadcast(static_cast<EDamageType>(i));	
+			{
+				OnDamageBonusUpdated.Broadcast(static_cast<EDamageType>(i));
+				INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
+			}
 		}
 		if (NewStats->DamageResists.IsValidIndex(i) && OldStats->DamageResists.IsValidIndex(i))
 		{
 			if (NewStats->DamageResists[i] != OldStats->DamageResists[i])
-				OnDamageResistUpdated.Broadcast(static_cast<EDamageType>(i));	
+			{
+				OnDamageResistUpdated.Broadcast(static_cast<EDamageType>(i));
+				INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
+			}
 		}
 	}
 }
@@ -510,12 +660,23 @@ void UVitalityStatComponent::BeginPlay()
 {
 	Super::BeginPlay();
 	BindListenerEvents();
+	if (UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this))
+		VitalityHandle_ = VitalitySubsystem->RegisterComponent(this);
 	if (GetNetMode() < NM_Client)
 	{
+		CompileDerivedStats();
 		Reinitialize();
 	}
 }
 
+void UVitalityStatComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this))
+		VitalitySubsystem->UnregisterComponent(this);
+	VitalityHandle_ = FVitalityHandle();
+	Super::EndPlay(EndPlayReason);
+}
+
 void UVitalityStatComponent::OnComponentCreated()
 {
 	Super::OnComponentCreated();
@@ -637,60 +798,276 @@ float UVitalityStatComponent::GetCoreStatValue(
 
 void UVitalityStatComponent::NaturalCoreStatUpdated(const EVitalityStat CoreStat)
 {
+	StatInputChanged(EDerivedStatSource::CORE_STAT, EVitalityStatLayer::NATURAL, static_cast<int32>(CoreStat));
 	OnCoreStatModified.Broadcast(CoreStat);
 }
 
 void UVitalityStatComponent::GearCoreStatUpdated(const EVitalityStat CoreStat)
 {
+	StatInputChanged(EDerivedStatSource::CORE_STAT, EVitalityStatLayer::GEAR, static_cast<int32>(CoreStat));
 	OnCoreStatModified.Broadcast(CoreStat);
 }
 
 void UVitalityStatComponent::MagicCoreStatUpdated(const EVitalityStat CoreStat)
 {
+	StatInputChanged(EDerivedStatSource::CORE_STAT, EVitalityStatLayer::MAGICAL, static_cast<int32>(CoreStat));
 	OnCoreStatModified.Broadcast(CoreStat);
 }
 
 void UVitalityStatComponent::OtherCoreStatUpdated(const EVitalityStat CoreStat)
 {
+	StatInputChanged(EDerivedStatSource::CORE_STAT, EVitalityStatLayer::OTHER, static_cast<int32>(CoreStat));
 	OnCoreStatModified.Broadcast(CoreStat);
 }
 
 void UVitalityStatComponent::NaturalDamageBonusUpdated(const EDamageType DamageEnum)
 {
+	StatInputChanged(EDerivedStatSource::DAMAGE_BONUS, EVitalityStatLayer::NATURAL, static_cast<int32>(DamageEnum));
 	OnDamageBonusUpdated.Broadcast(DamageEnum);
 }
 
 void UVitalityStatComponent::GearDamageBonusUpdated(const EDamageType DamageEnum)
 {
+	StatInputChanged(EDerivedStatSource::DAMAGE_BONUS, EVitalityStatLayer::GEAR, static_cast<int32>(DamageEnum));
 	OnDamageBonusUpdated.Broadcast(DamageEnum);
 }
 
 void UVitalityStatComponent::MagicDamageBonusUpdated(const EDamageType DamageEnum)
 {
+	StatInputChanged(EDerivedStatSource::DAMAGE_BONUS, EVitalityStatLayer::MAGICAL, static_cast<int32>(DamageEnum));
 	OnDamageBonusUpdated.Broadcast(DamageEnum);
 }
 
 void UVitalityStatComponent::OtherDamageBonusUpdated(const EDamageType DamageEnum)
 {
+	StatInputChanged(EDerivedStatSource::DAMAGE_BONUS, EVitalityStatLayer::OTHER, static_cast<int32>(DamageEnum));
 	OnDamageBonusUpdated.Broadcast(DamageEnum);
 }
 
 void UVitalityStatComponent::NaturalDamageResistUpdated(const EDamageType DamageEnum)
 {
+	StatInputChanged(EDerivedStatSource::DAMAGE_RESIST, EVitalityStatLayer::NATURAL, static_cast<int32>(DamageEnum));
 	OnDamageResistUpdated.Broadcast(DamageEnum);
 }
 
 void UVitalityStatComponent::GearDamageResistUpdated(const EDamageType DamageEnum)
 {
+	StatInputChanged(EDerivedStatSource::DAMAGE_RESIST, EVitalityStatLayer::GEAR, static_cast<int32>(DamageEnum));
 	OnDamageResistUpdated.Broadcast(DamageEnum);
 }
 
 void UVitalityStatComponent::MagicDamageResistUpdated(const EDamageType DamageEnum)
 {
+	StatInputChanged(EDerivedStatSource::DAMAGE_RESIST, EVitalityStatLayer::MAGICAL, static_cast<int32>(DamageEnum));
 	OnDamageResistUpdated.Broadcast(DamageEnum);
 }
 
 void UVitalityStatComponent::OtherDamageResistUpdated(const EDamageType DamageEnum)
 {
+	StatInputChanged(EDerivedStatSource::DAMAGE_RESIST, EVitalityStatLayer::OTHER, static_cast<int32>(DamageEnum));
 	OnDamageResistUpdated.Broadcast(DamageEnum);
 }
+
+/**
+ * @brief Copies all four layers and their totals into the back buffer and flips it,
+ *        so worker threads can read stats without locking. Game thread only.
+ */
+void UVitalityStatComponent::PublishSnapshot()
+{
+	check(IsInGameThread());
+	FVitalityStatSnapshot& Snapshot = Snapshot_.BeginWrite();
+	Snapshot = FVitalityStatSnapshot();
+
+	constexpr int32 TotalLayer = FVitalityStatSnapshot::NumLayers;
+	for (int32 Layer = 0; Layer < TotalLayer; Layer++)
+	{
+		const FStVitalityStats* StatsMap = GetStatsLayer(static_cast<EVitalityStatLayer>(Layer));
+		
+		FVitalityStatMath::AccumulateLayer(StatsMap->CoreStats,
+			Snapshot.CoreStats[Layer], Snapshot.CoreStats[TotalLayer]);
+		FVitalityStatMath::AccumulateLayer(StatsMap->DamageBonuses,
+			Snapshot.DamageBonuses[Layer], Snapshot.DamageBonuses[TotalLayer]);
+		FVitalityStatMath::AccumulateLayer(StatsMap->DamageResists,
+			Snapshot.DamageResists[Layer], Snapshot.DamageResists[TotalLayer]);
+	}
+	Snapshot_.Publish();
+}
+
+/**
+ * @brief Compiles DerivedStatFormulas and DerivedStatsTable into the derived stat graph.
+ *        Called automatically on BeginPlay. Call again after changing the formulas.
+ * @return True if the formulas compiled, false on a cycle or duplicate name
+ */
+bool UVitalityStatComponent::CompileDerivedStats()
+{
+	TArray<FStDerivedStatFormula> Formulas = DerivedStatFormulas;
+	if (IsValid(DerivedStatsTable))
+	{
+		DerivedStatsTable->ForeachRow<FStDerivedStatFormula>(TEXT("CompileDerivedStats"),
+			[&Formulas](const FName& RowName, const FStDerivedStatFormula& Row)
+			{
+				FStDerivedStatFormula& Formula = Formulas.Add_GetRef(Row);
+				if (Formula.StatName.IsNone())
+					Formula.StatName = RowName;
+			});
+	}
+	if (Formulas.Num() < 1)
+	{
+		DerivedStats_.Reset();
+		return true;
+	}
+	if (!DerivedStats_.Compile(Formulas))
+		return false;
+	EvaluateDerivedStats();
+	return true;
+}
+
+/**
+ * @brief Returns the value of the derived stat, recomputing it first if any input changed
+ * @param StatName The name of the derived stat
+ * @return The value of the derived stat, or zero if it does not exist
+ */
+float UVitalityStatComponent::GetDerivedStatValue(FName StatName)
+{
+	if (DerivedStats_.IsDirty())
+		EvaluateDerivedStats();
+	return DerivedStats_.GetValue(StatName);
+}
+
+void UVitalityStatComponent::GetMemoryUsage(FVitalityMemoryUsage& OutUsage) const
+{
+	OutUsage.Stats += BaseStats_.GetAllocatedSize() + GearStats_.GetAllocatedSize()
+		+ ModifiedStats_.GetAllocatedSize() + OtherStats_.GetAllocatedSize()
+		+ StartingStats.GetAllocatedSize();
+	OutUsage.Other += DerivedStatFormulas.GetAllocatedSize() + DerivedStats_.GetAllocatedSize();
+	for (const FStDerivedStatFormula& Formula : DerivedStatFormulas)
+		OutUsage.Other += Formula.Terms.GetAllocatedSize();
+}
+
+void UVitalityStatComponent::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	FVitalityMemoryUsage MemoryUsage;
+	GetMemoryUsage(MemoryUsage);
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(MemoryUsage.GetTotal());
+}
+
+void UVitalityStatComponent::StatInputChanged(
+	EDerivedStatSource Source, EVitalityStatLayer Layer, int32 Index)
+{
+	MarkDerivedInputDirty(Source, Layer, Index);
+	if (UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this))
+		VitalitySubsystem->MarkDirty(VitalityHandle_);
+	// The next journal record has to carry the layer that changed
+	if (Layer != EVitalityStatLayer::TOTAL)
+		SetSaveSectionsDirty(FVitalitySaveRecord::GetLayerSection(Layer), true);
+}
+
+void UVitalityStatComponent::MarkDerivedInputDirty(
+	EDerivedStatSource Source, EVitalityStatLayer Layer, int32 Index)
+{
+	if (!DerivedStats_.IsCompiled())
+		return;
+	DerivedStats_.MarkInputDirty(Source, Layer, Index);
+
+	// Many inputs usually change together (equipping gear, leveling up),
+	// so the graph is evaluated once on the next tick instead of per change.
+	if (DerivedStats_.IsDirty() && !bDerivedStatsScheduled_ && IsValid(GetWorld()))
+	{
+		bDerivedStatsScheduled_ = true;
+		GetWorld()->GetTimerManager().SetTimerForNextTick(
+			FTimerDelegate::CreateUObject(this, &UVitalityStatComponent::EvaluateDerivedStats));
+	}
+}
+
+/**
+ * @brief Recomputes all dirty derived stats, pushing changed values into the welfare component
+ */
+void UVitalityStatComponent::EvaluateDerivedStats()
+{
+	bDerivedStatsScheduled_ = false;
+	if (!DerivedStats_.IsDirty())
+		return;
+
+	TArray<FVitalityDerivedStatGraph::FChangedStat> ChangedStats;
+	DerivedStats_.Evaluate(
+		[this](EDerivedStatSource Source, EVitalityStatLayer Layer, int32 Index)
+		{
+			return ReadDerivedInput(Source, Layer, Index);
+		}, ChangedStats);
+
+	if (ChangedStats.Num() < 1 || GetNetMode() == NM_Client)
+		return;
+
+	UVitalityWelfareComponent* WelfareComponent = GetOwner()->FindComponentByClass<UVitalityWelfareComponent>();
+	if (!IsValid(WelfareComponent))
+		return;
+
+	for (const FVitalityDerivedStatGraph::FChangedStat& ChangedStat : ChangedStats)
+	{
+		switch (ChangedStat.Target)
+		{
+		case EDerivedStatTarget::HEALTH_MAX:
+			WelfareComponent->SetVitalityMaximum(EVitalityCategory::HEALTH, ChangedStat.NewValue); break;
+		case EDerivedStatTarget::STAMINA_MAX:
+			WelfareComponent->SetVitalityMaximum(EVitalityCategory::STAMINA, ChangedStat.NewValue); break;
+		case EDerivedStatTarget::MAGIC_MAX:
+			WelfareComponent->SetVitalityMaximum(EVitalityCategory::MAGIC, ChangedStat.NewValue); break;
+		case EDerivedStatTarget::HYDRATION_MAX:
+			WelfareComponent->SetVitalityMaximum(EVitalityCategory::THIRST, ChangedStat.NewValue); break;
+		case EDerivedStatTarget::CALORIES_MAX:
+			WelfareComponent->SetVitalityMaximum(EVitalityCategory::HUNGER, ChangedStat.NewValue); break;
+		case EDerivedStatTarget::HEALTH_REGEN:
+			WelfareComponent->SetVitalityRegenRate(EVitalityCategory::HEALTH, ChangedStat.NewValue); break;
+		case EDerivedStatTarget::STAMINA_REGEN:
+			WelfareComponent->SetVitalityRegenRate(EVitalityCategory::STAMINA, ChangedStat.NewValue); break;
+		case EDerivedStatTarget::MAGIC_REGEN:
+			WelfareComponent->SetVitalityRegenRate(EVitalityCategory::MAGIC, ChangedStat.NewValue); break;
+		default:
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Reads a core stat, damage bonus or damage resistance for the derived stat graph
+ * @param Source The kind of value to read
+ * @param Layer The stat layer to read from, or TOTAL for the sum of all layers
+ * @param Index The core stat or damage type, as an int
+ * @return The value of the input, or zero if it does not exist
+ */
+float UVitalityStatComponent::ReadDerivedInput(
+	EDerivedStatSource Source, EVitalityStatLayer Layer, int32 Index) const
+{
+	float InputValue = 0.f;
+	for (int i = 0; i < static_cast<int>(EVitalityStatLayer::TOTAL); i++)
+	{
+		const EVitalityStatLayer StatLayer = static_cast<EVitalityStatLayer>(i);
+		if (Layer != EVitalityStatLayer::TOTAL && Layer != StatLayer)
+			continue;
+		const FStVitalityStats* StatsMap = GetStatsLayer(StatLayer);
+		switch (Source)
+		{
+		case EDerivedStatSource::CORE_STAT:
+			InputValue += StatsMap->GetCoreStatValue(static_cast<EVitalityStat>(Index)); break;
+		case EDerivedStatSource::DAMAGE_BONUS:
+			InputValue += StatsMap->GetDamageBonusValue(static_cast<EDamageType>(Index)); break;
+		case EDerivedStatSource::DAMAGE_RESIST:
+			InputValue += StatsMap->GetDamageResistValue(static_cast<EDamageType>(Index)); break;
+		default:
+			break;
+		}
+	}
+	return InputValue;
+}
+
+const FStVitalityStats* UVitalityStatComponent::GetStatsLayer(EVitalityStatLayer Layer) const
+{
+	switch (Layer)
+	{
+	case EVitalityStatLayer::GEAR:		return &GearStats_;
+	case EVitalityStatLayer::MAGICAL:	return &ModifiedStats_;
+	case EVitalityStatLayer::OTHER:		return &OtherStats_;
+	default:							return &BaseStats_;
+	}
+}
@@ -0,0 +1,680 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "VitalitySubsystem.h"
+
+#include "VitalityEffectsComponent.h"
+#include "VitalityStatComponent.h"
+#include "VitalityWelfareComponent.h"
+#include "lib/SaveStats.h"
+#include "lib/VitalityGlobals.h"
+#include "lib/VitalityStats.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "Hash/CityHash.h"
+#include "Misc/Paths.h"
+#include "TimerManager.h"
+
+
+/**
+ * @brief Finds the handle of the given actor in this snapshot
+ * @param Actor The actor to look up. Never dereferenced.
+ * @return The handle, or an invalid handle if the actor was not registered
+ */
+FVitalityHandle FVitalityFrameSnapshot::FindHandle(const AActor* Actor) const
+{
+	if (Handles.IsValid())
+	{
+		if (const FVitalityHandle* Handle = Handles->Find(Actor))
+			return *Handle;
+	}
+	return FVitalityHandle();
+}
+
+/**
+ * @brief Copies the requested fields of every handle into contiguous result arrays
+ * @param QueryHandles The handles to read, one result row per handle
+ * @param Fields The groups of values to copy
+ * @param OutResult Receives the values. Rows for invalid handles are zeroed.
+ */
+void FVitalityFrameSnapshot::Query(TConstArrayView<FVitalityHandle> QueryHandles,
+	EVitalityQueryFields Fields, FStVitalityBatchResult& OutResult) const
+{
+	const int32 NumRows			= QueryHandles.Num();
+	const int32 NumCoreStats	= UVitalitySystem::GetNumberOfCoreStats();
+	const int32 NumDamageTypes	= UVitalitySystem::GetNumberOfDamageTypes();
+
+	OutResult.FrameNumber	= FrameNumber;
+	OutResult.NumRows		= NumRows;
+	OutResult.IsValid.SetNumUninitialized(NumRows);
+
+	const bool bPools	= EnumHasAnyFlags(Fields, EVitalityQueryFields::POOLS) && Pools.IsValid();
+	const bool bCombat	= EnumHasAnyFlags(Fields, EVitalityQueryFields::COMBAT) && Pools.IsValid();
+	const bool bCore	= EnumHasAnyFlags(Fields, EVitalityQueryFields::CORE_STATS) && Stats.IsValid();
+	const bool bBonus	= EnumHasAnyFlags(Fields, EVitalityQueryFields::DAMAGE_BONUSES) && Stats.IsValid();
+	const bool bResist	= EnumHasAnyFlags(Fields, EVitalityQueryFields::RESISTANCES) && Stats.IsValid();
+	const bool bEffects	= EnumHasAnyFlags(Fields, EVitalityQueryFields::EFFECTS) && Effects.IsValid();
+
+	if (bPools)
+	{
+		OutResult.HealthPercent.SetNumZeroed(NumRows);
+		OutResult.StaminaPercent.SetNumZeroed(NumRows);
+		OutResult.MagicPercent.SetNumZeroed(NumRows);
+		OutResult.HydrationPercent.SetNumZeroed(NumRows);
+		OutResult.CaloriesPercent.SetNumZeroed(NumRows);
+	}
+	if (bCombat)
+	{
+		OutResult.IsDead.SetNumZeroed(NumRows);
+		OutResult.CombatState.Init(ECombatState::MAX, NumRows);
+	}
+	if (bCore)		OutResult.CoreStats.SetNumZeroed(NumRows * NumCoreStats);
+	if (bBonus)		OutResult.DamageBonuses.SetNumZeroed(NumRows * NumDamageTypes);
+	if (bResist)	OutResult.Resistances.SetNumZeroed(NumRows * NumDamageTypes);
+	if (bEffects)
+	{
+		OutResult.BenefitBits.SetNumZeroed(NumRows);
+		OutResult.DetrimentBits.SetNumZeroed(NumRows);
+	}
+
+	for (int32 Row = 0; Row < NumRows; Row++)
+	{
+		const FVitalityHandle& Handle = QueryHandles[Row];
+		const bool bValidRow = IsValidHandle(Handle);
+		OutResult.IsValid[Row] = bValidRow;
+		if (!bValidRow)
+			continue;
+
+		const int32 Slot = Handle.Index;
+		if (bPools)
+		{
+			OutResult.HealthPercent[Row]	= Pools->HealthPercent[Slot];
+			OutResult.StaminaPercent[Row]	= Pools->StaminaPercent[Slot];
+			OutResult.MagicPercent[Row]		= Pools->MagicPercent[Slot];
+			OutResult.HydrationPercent[Row]	= Pools->HydrationPercent[Slot];
+			OutResult.CaloriesPercent[Row]	= Pools->CaloriesPercent[Slot];
+		}
+		if (bCombat)
+		{
+			OutResult.IsDead[Row]		= Pools->IsDead[Slot];
+			OutResult.CombatState[Row]	= Pools->CombatState[Slot];
+		}
+		if (bCore)
+		{
+			FMemory::Memcpy(&OutResult.CoreStats[Row * NumCoreStats],
+				&Stats->CoreStats[Slot * NumCoreStats], sizeof(float) * NumCoreStats);
+		}
+		if (bBonus)
+		{
+			FMemory::Memcpy(&OutResult.DamageBonuses[Row * NumDamageTypes],
+				&Stats->DamageBonuses[Slot * NumDamageTypes], sizeof(float) * NumDamageTypes);
+		}
+		if (bResist)
+		{
+			FMemory::Memcpy(&OutResult.Resistances[Row * NumDamageTypes],
+				&Stats->Resistances[Slot * NumDamageTypes], sizeof(float) * NumDamageTypes);
+		}
+		if (bEffects)
+		{
+			OutResult.BenefitBits[Row]		= static_cast<int32>(Effects->BenefitBits[Slot]);
+			OutResult.DetrimentBits[Row]	= static_cast<int32>(Effects->DetrimentBits[Slot]);
+		}
+	}
+}
+
+
+UVitalitySubsystem* UVitalitySubsystem::Get(const UObject* WorldContextObject)
+{
+	if (!IsValid(WorldContextObject))
+		return nullptr;
+	const UWorld* World = WorldContextObject->GetWorld();
+	return IsValid(World) ? World->GetSubsystem<UVitalitySubsystem>() : nullptr;
+}
+
+/**
+ * @brief Registers a welfare, stat or effects component under its owning actor
+ * @param VitalityComponent The component to register
+ * @return The handle of the owning actor, or an invalid handle on failure
+ */
+FVitalityHandle UVitalitySubsystem::RegisterComponent(UActorComponent* VitalityComponent)
+{
+	check(IsInGameThread());
+	if (!IsValid(VitalityComponent) || !IsValid(VitalityComponent->GetOwner()))
+		return FVitalityHandle();
+
+	AActor* OwningActor = VitalityComponent->GetOwner();
+	int32 SlotIndex = INDEX_NONE;
+	if (const int32* ExistingSlot = SlotByActor_.Find(OwningActor))
+	{
+		SlotIndex = *ExistingSlot;
+	}
+	else
+	{
+		SlotIndex = FreeSlots_.Num() > 0 ? FreeSlots_.Pop(false) : Slots_.AddDefaulted();
+		FSlot& NewSlot = Slots_[SlotIndex];
+		NewSlot.Actor	= OwningActor;
+		NewSlot.Serial	+= 1;
+		NewSlot.bInUse	= true;
+		SlotByActor_.Add(OwningActor, SlotIndex);
+		bRegistryChanged_ = true;
+
+		// Restored on the next tick, once every component of the actor has begun play
+		if (CheckpointFile_.IsOpen())
+			PendingRestore_.Add(FVitalityHandle(SlotIndex, NewSlot.Serial));
+	}
+
+	FSlot& Slot = Slots_[SlotIndex];
+	if (UVitalityWelfareComponent* Welfare = Cast<UVitalityWelfareComponent>(VitalityComponent))
+		Slot.Welfare = Welfare;
+	else if (UVitalityStatComponent* Stats = Cast<UVitalityStatComponent>(VitalityComponent))
+		Slot.Stats = Stats;
+	else if (UVitalityEffectsComponent* Effects = Cast<UVitalityEffectsComponent>(VitalityComponent))
+		Slot.Effects = Effects;
+
+	const FVitalityHandle Handle(SlotIndex, Slot.Serial);
+	MarkDirty(Handle);
+	return Handle;
+}
+
+/**
+ * @brief Removes the component from its actor's slot. The slot is freed once empty.
+ * @param VitalityComponent The component to unregister
+ */
+void UVitalitySubsystem::UnregisterComponent(UActorComponent* VitalityComponent)
+{
+	check(IsInGameThread());
+	if (VitalityComponent == nullptr)
+		return;
+
+	const int32* SlotIndex = SlotByActor_.Find(VitalityComponent->GetOwner());
+	if (SlotIndex == nullptr)
+		return;
+
+	FSlot& Slot = Slots_[*SlotIndex];
+	if (Slot.Welfare.Get() == VitalityComponent)		Slot.Welfare.Reset();
+	else if (Slot.Stats.Get() == VitalityComponent)		Slot.Stats.Reset();
+	else if (Slot.Effects.Get() == VitalityComponent)	Slot.Effects.Reset();
+
+	if (Slot.Welfare.IsExplicitlyNull() && Slot.Stats.IsExplicitlyNull() && Slot.Effects.IsExplicitlyNull())
+	{
+		Slot.Actor.Reset();
+		Slot.bInUse = false;
+		FreeSlots_.Add(*SlotIndex);
+		SlotByActor_.Remove(VitalityComponent->GetOwner());
+		bRegistryChanged_ = true;
+	}
+	else
+	{
+		MarkDirty(FVitalityHandle(*SlotIndex, Slot.Serial));
+	}
+}
+
+void UVitalitySubsystem::MarkDirty(const FVitalityHandle& Handle)
+{
+	if (!Slots_.IsValidIndex(Handle.Index) || Slots_[Handle.Index].Serial != Handle.Serial)
+		return;
+	if (DirtySlots_.Num() < Slots_.Num())
+		DirtySlots_.Add(false, Slots_.Num() - DirtySlots_.Num());
+	DirtySlots_[Handle.Index] = true;
+}
+
+void UVitalitySubsystem::SetDigesting(const FVitalityHandle& Handle, bool bIsDigesting)
+{
+	if (!Slots_.IsValidIndex(Handle.Index) || Slots_[Handle.Index].Serial != Handle.Serial)
+		return;
+	if (DigestingSlots_.Num() < Slots_.Num())
+		DigestingSlots_.Add(false, Slots_.Num() - DigestingSlots_.Num());
+	DigestingSlots_[Handle.Index] = bIsDigesting;
+}
+
+FVitalityHandle UVitalitySubsystem::GetHandle(const AActor* Actor) const
+{
+	if (const int32* SlotIndex = SlotByActor_.Find(Actor))
+		return FVitalityHandle(*SlotIndex, Slots_[*SlotIndex].Serial);
+	return FVitalityHandle();
+}
+
+void UVitalitySubsystem::ForEachWelfare(
+	TFunctionRef<void(const FVitalityHandle&, UVitalityWelfareComponent&)> Function) const
+{
+	check(IsInGameThread());
+	for (int32 SlotIndex = 0; SlotIndex < Slots_.Num(); SlotIndex++)
+	{
+		const FSlot& Slot = Slots_[SlotIndex];
+		if (!Slot.bInUse)
+			continue;
+		if (UVitalityWelfareComponent* Welfare = Slot.Welfare.Get())
+			Function(FVitalityHandle(SlotIndex, Slot.Serial), *Welfare);
+	}
+}
+
+FVitalityFrameSnapshotPtr UVitalitySubsystem::GetFrameSnapshot() const
+{
+	FRWScopeLock ReadLock(SnapshotLock_, SLT_ReadOnly);
+	return FrameSnapshot_;
+}
+
+void UVitalitySubsystem::QueryActors(TConstArrayView<const AActor*> Actors,
+	EVitalityQueryFields Fields, FStVitalityBatchResult& OutResult) const
+{
+	const FVitalityFrameSnapshotPtr Snapshot = GetFrameSnapshot();
+	if (!Snapshot.IsValid())
+	{
+		OutResult = FStVitalityBatchResult();
+		return;
+	}
+	TArray<FVitalityHandle, TInlineAllocator<64>> Handles;
+	Handles.Reserve(Actors.Num());
+	for (const AActor* Actor : Actors)
+		Handles.Add(Snapshot->FindHandle(Actor));
+	Snapshot->Query(Handles, Fields, OutResult);
+}
+
+void UVitalitySubsystem::QueryHandles(TConstArrayView<FVitalityHandle> Handles,
+	EVitalityQueryFields Fields, FStVitalityBatchResult& OutResult) const
+{
+	const FVitalityFrameSnapshotPtr Snapshot = GetFrameSnapshot();
+	if (!Snapshot.IsValid())
+	{
+		OutResult = FStVitalityBatchResult();
+		return;
+	}
+	Snapshot->Query(Handles, Fields, OutResult);
+}
+
+FStVitalityBatchResult UVitalitySubsystem::K2_QueryActors(const TArray<AActor*>& Actors, int32 Fields)
+{
+	FStVitalityBatchResult Result;
+	QueryActors(TConstArrayView<const AActor*>(Actors.GetData(), Actors.Num()),
+		static_cast<EVitalityQueryFields>(Fields), Result);
+	return Result;
+}
+
+void UVitalitySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	if (PendingRestore_.Num() > 0)
+		RestorePendingSlots();
+	if (bParallelUpdate)
+		TickParallel(DeltaTime);
+	TickDigestion();
+	PublishFrameSnapshot();
+}
+
+/**
+ * @brief Releases the digestion queue of every actor that has one. Each queue is already
+ *        summed into a net rate per pool, so this costs the same however much was eaten.
+ */
+void UVitalitySubsystem::TickDigestion()
+{
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityTickDigestion);
+	const double WorldTime = GetWorld()->GetTimeSeconds();
+	for (TConstSetBitIterator<> It(DigestingSlots_); It; ++It)
+	{
+		const int32 SlotIndex = It.GetIndex();
+		UVitalityWelfareComponent* Welfare = Slots_[SlotIndex].Welfare.Get();
+		if (Welfare == nullptr || !Welfare->TickDigestion(WorldTime))
+			DigestingSlots_[SlotIndex] = false;
+	}
+}
+
+/**
+ * @brief Steps the welfare pools and effect lifetimes of every authoritative actor in batches on
+ *        worker threads. Each component only touches its own members there, and the game thread
+ *        waits for the batches, so nothing else can touch them either. Removals, broadcasts and
+ *        stat counters are then applied one component at a time on the game thread.
+ * @param DeltaTime The game time since the last tick
+ */
+void UVitalitySubsystem::TickParallel(float DeltaTime)
+{
+	ParallelWelfare_.Reset();
+	ParallelEffects_.Reset();
+	{
+		VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityParallelUpdate);
+		for (const FSlot& Slot : Slots_)
+		{
+			// Clients only ever receive pool and effect state, so only authoritative actors are stepped
+			const AActor* Actor = Slot.Actor.Get();
+			if (!Slot.bInUse || Actor == nullptr || !Actor->HasAuthority())
+				continue;
+			UVitalityWelfareComponent* Welfare = Slot.Welfare.Get();
+			if (Welfare != nullptr && Welfare->HasParallelPools())
+				ParallelWelfare_.Add(Welfare);
+			UVitalityEffectsComponent* Effects = Slot.Effects.Get();
+			if (Effects != nullptr && Effects->HasEffectsToTick())
+				ParallelEffects_.Add(Effects);
+		}
+
+		// Welfare and effects components share one index range, so the batches stay even
+		const int32 BatchSize	= FMath::Max(ParallelBatchSize, 1);
+		const int32 NumWelfare	= ParallelWelfare_.Num();
+		const int32 NumItems	= NumWelfare + ParallelEffects_.Num();
+		ParallelFor(FMath::DivideAndRoundUp(NumItems, BatchSize),
+			[this, DeltaTime, BatchSize, NumWelfare, NumItems](int32 Batch)
+			{
+				const int32 LastItem = FMath::Min((Batch + 1) * BatchSize, NumItems);
+				for (int32 Item = Batch * BatchSize; Item < LastItem; Item++)
+				{
+					if (Item < NumWelfare)
+						ParallelWelfare_[Item]->IntegratePools(DeltaTime);
+					else
+						ParallelEffects_[Item - NumWelfare]->CountDownEffects(DeltaTime);
+				}
+			});
+	}
+
+	{
+		VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityParallelApply);
+		// A broadcast may end another actor's play, so each component is checked before it is applied
+		for (UVitalityWelfareComponent* Welfare : ParallelWelfare_)
+		{
+			if (IsValid(Welfare))
+				Welfare->ApplyIntegratedPools();
+		}
+		for (UVitalityEffectsComponent* Effects : ParallelEffects_)
+		{
+			if (IsValid(Effects))
+				Effects->ApplyExpiredEffects();
+		}
+	}
+	ParallelWelfare_.Reset();
+	ParallelEffects_.Reset();
+}
+
+TStatId UVitalitySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UVitalitySubsystem, STATGROUP_Vitality);
+}
+
+void UVitalitySubsystem::Deinitialize()
+{
+	if (CheckpointWrite_.IsValid())
+		CheckpointWrite_.Wait();
+	ReleaseCheckpoint();
+	
+	{
+		FRWScopeLock WriteLock(SnapshotLock_, SLT_Write);
+		FrameSnapshot_.Reset();
+	}
+	Slots_.Empty();
+	FreeSlots_.Empty();
+	SlotByActor_.Empty();
+	DirtySlots_.Empty();
+	DigestingSlots_.Empty();
+	Super::Deinitialize();
+}
+
+/**
+ * @brief Returns the actor's stable ID from StableIdResolver if bound, otherwise a hash of
+ *        the actor's path. Only level-placed actors keep their path across restarts, so
+ *        games should bind the resolver for players and spawned NPCs.
+ * @param Actor The actor to identify
+ * @return The stable ID, or zero if the actor has none
+ */
+uint64 UVitalitySubsystem::GetStableActorId(const AActor* Actor) const
+{
+	if (!IsValid(Actor))
+		return 0;
+	if (StableIdResolver.IsBound())
+		return StableIdResolver.Execute(Actor);
+
+	const FString ActorPath = Actor->GetPathName();
+	return CityHash64(reinterpret_cast<const char*>(*ActorPath), ActorPath.Len() * sizeof(TCHAR));
+}
+
+FString UVitalitySubsystem::GetDefaultCheckpointPath() const
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Vitality"),
+		GetWorld()->GetMapName() + TEXT(".vcheckpoint"));
+}
+
+/**
+ * @brief Copies every registered actor's published snapshots into flat checkpoint
+ *        entries on the game thread, then sorts and writes them on a worker thread
+ * @param FilePath The checkpoint to write. Empty uses the default path for this map.
+ * @return True if the write was started
+ */
+bool UVitalitySubsystem::WriteCheckpointAsync(const FString& FilePath)
+{
+	check(IsInGameThread());
+	if (CheckpointWrite_.IsValid() && !CheckpointWrite_.IsReady())
+		return false;
+
+	TArray<FVitalityCheckpointEntry> Entries;
+	Entries.Reserve(SlotByActor_.Num());
+	for (const FSlot& Slot : Slots_)
+	{
+		const uint64 StableId = Slot.bInUse ? GetStableActorId(Slot.Actor.Get()) : 0;
+		if (StableId == 0)
+			continue;
+
+		UVitalityWelfareComponent* Welfare	= Slot.Welfare.Get();
+		UVitalityStatComponent* Stats		= Slot.Stats.Get();
+		UVitalityEffectsComponent* Effects	= Slot.Effects.Get();
+		
+		// Stats and effects are only published once marked dirty
+		if (Stats != nullptr && Stats->GetSnapshotVersion() == 0)		Stats->PublishSnapshot();
+		if (Effects != nullptr && Effects->GetSnapshotVersion() == 0)	Effects->PublishSnapshot();
+		if (Welfare != nullptr)											Welfare->PublishSnapshot();
+
+		FVitalityCheckpointEntry& Entry = Entries.AddDefaulted_GetRef();
+		Entry.StableId = StableId;
+		Entry.SetFromSnapshots(
+			Welfare != nullptr ? &Welfare->GetPublishedSnapshot() : nullptr,
+			Stats != nullptr ? &Stats->GetPublishedSnapshot() : nullptr,
+			Effects != nullptr ? &Effects->GetPublishedSnapshot() : nullptr);
+	}
+
+	const FString CheckpointPath = FilePath.IsEmpty() ? GetDefaultCheckpointPath() : FilePath;
+	const int64 Timestamp = FDateTime::UtcNow().GetTicks();
+	CheckpointWrite_ = Async(EAsyncExecution::ThreadPool,
+		[CheckpointPath, Timestamp, Entries = MoveTemp(Entries)]() mutable
+	{
+		return FVitalityCheckpointFile::Write(CheckpointPath, Entries, Timestamp);
+	});
+	return true;
+}
+
+void UVitalitySubsystem::SetCheckpointInterval(float IntervalSeconds, const FString& FilePath)
+{
+	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
+	TimerManager.ClearTimer(CheckpointTimer_);
+	if (IntervalSeconds <= 0.f)
+		return;
+
+	CheckpointPath_ = FilePath;
+	TimerManager.SetTimer(CheckpointTimer_, FTimerDelegate::CreateWeakLambda(this, [this]()
+	{
+		WriteCheckpointAsync(CheckpointPath_);
+	}), IntervalSeconds, true);
+}
+
+/**
+ * @brief Maps the checkpoint, then restores every registered actor found in it.
+ *        The file stays mapped for actors that register later, until ReleaseCheckpoint().
+ * @param FilePath The checkpoint to map. Empty uses the default path for this map.
+ * @return The number of actors restored now
+ */
+int32 UVitalitySubsystem::RestoreFromCheckpoint(const FString& FilePath)
+{
+	check(IsInGameThread());
+	if (!CheckpointFile_.Open(FilePath.IsEmpty() ? GetDefaultCheckpointPath() : FilePath))
+		return 0;
+
+	int32 NumRestored = 0;
+	for (int32 SlotIndex = 0; SlotIndex < Slots_.Num(); SlotIndex++)
+	{
+		if (RestoreSlotFromCheckpoint(SlotIndex))
+			NumRestored++;
+	}
+	PendingRestore_.Reset();
+	return NumRestored;
+}
+
+void UVitalitySubsystem::ReleaseCheckpoint()
+{
+	CheckpointFile_.Close();
+	PendingRestore_.Empty();
+}
+
+bool UVitalitySubsystem::RestoreSlotFromCheckpoint(int32 SlotIndex)
+{
+	const FSlot& Slot = Slots_[SlotIndex];
+	if (!Slot.bInUse)
+		return false;
+
+	const FVitalityCheckpointEntry* Entry = CheckpointFile_.Find(GetStableActorId(Slot.Actor.Get()));
+	if (Entry == nullptr)
+		return false;
+
+	FVitalitySaveRecord Record;
+	Entry->ToSaveRecord(Record);
+	return UVitalitySaveSystem::ApplyToActor(Slot.Actor.Get(), Record);
+}
+
+void UVitalitySubsystem::RestorePendingSlots()
+{
+	for (const FVitalityHandle& Handle : PendingRestore_)
+	{
+		if (CheckpointFile_.IsOpen() && Slots_.IsValidIndex(Handle.Index) && Slots_[Handle.Index].Serial == Handle.Serial)
+			RestoreSlotFromCheckpoint(Handle.Index);
+	}
+	PendingRestore_.Reset();
+}
+
+bool UVitalitySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+/**
+ * @brief Runs at the end of the game thread update. Publishes the per-component
+ *        snapshots, then builds this frame's snapshot from them. Pools are refreshed
+ *        for every slot since they change constantly; stats and effects are published
+ *        only for dirty slots, and the previous blocks are shared when nothing changed.
+ */
+void UVitalitySubsystem::PublishFrameSnapshot()
+{
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityPublishSnapshot);
+	const FVitalityFrameSnapshotPtr Previous = GetFrameSnapshot();
+	const int32 NumSlots		= Slots_.Num();
+	const int32 NumCoreStats	= UVitalitySystem::GetNumberOfCoreStats();
+	const int32 NumDamageTypes	= UVitalitySystem::GetNumberOfDamageTypes();
+	const bool bResized			= !Previous.IsValid() || Previous->NumSlots != NumSlots;
+
+	if (DirtySlots_.Num() < NumSlots)
+		DirtySlots_.Add(false, NumSlots - DirtySlots_.Num());
+
+	TSharedRef<FVitalityFrameSnapshot, ESPMode::ThreadSafe> Snapshot =
+		MakeShared<FVitalityFrameSnapshot, ESPMode::ThreadSafe>();
+	Snapshot->FrameNumber	= GFrameCounter;
+	Snapshot->NumSlots		= NumSlots;
+	Snapshot->Serials.SetNumUninitialized(NumSlots);
+
+	TSharedRef<FVitalityFrameSnapshot::FPoolBlock, ESPMode::ThreadSafe> PoolBlock =
+		MakeShared<FVitalityFrameSnapshot::FPoolBlock, ESPMode::ThreadSafe>();
+	PoolBlock->HealthPercent.SetNumZeroed(NumSlots);
+	PoolBlock->StaminaPercent.SetNumZeroed(NumSlots);
+	PoolBlock->MagicPercent.SetNumZeroed(NumSlots);
+	PoolBlock->HydrationPercent.SetNumZeroed(NumSlots);
+	PoolBlock->CaloriesPercent.SetNumZeroed(NumSlots);
+	PoolBlock->IsDead.SetNumZeroed(NumSlots);
+	PoolBlock->CombatState.Init(ECombatState::MAX, NumSlots);
+
+	const bool bAnyDirty = DirtySlots_.Find(true) != INDEX_NONE;
+	TSharedPtr<FVitalityFrameSnapshot::FStatBlock, ESPMode::ThreadSafe> StatBlock;
+	TSharedPtr<FVitalityFrameSnapshot::FEffectBlock, ESPMode::ThreadSafe> EffectBlock;
+	if (bAnyDirty || bResized)
+	{
+		// Copy-on-write: start from the previous frame and patch the dirty rows
+		StatBlock = Previous.IsValid() && Previous->Stats.IsValid()
+			? MakeShared<FVitalityFrameSnapshot::FStatBlock, ESPMode::ThreadSafe>(*Previous->Stats)
+			: MakeShared<FVitalityFrameSnapshot::FStatBlock, ESPMode::ThreadSafe>();
+		EffectBlock = Previous.IsValid() && Previous->Effects.IsValid()
+			? MakeShared<FVitalityFrameSnapshot::FEffectBlock, ESPMode::ThreadSafe>(*Previous->Effects)
+			: MakeShared<FVitalityFrameSnapshot::FEffectBlock, ESPMode::ThreadSafe>();
+		StatBlock->CoreStats.SetNumZeroed(NumSlots * NumCoreStats);
+		StatBlock->DamageBonuses.SetNumZeroed(NumSlots * NumDamageTypes);
+		StatBlock->Resistances.SetNumZeroed(NumSlots * NumDamageTypes);
+		EffectBlock->BenefitBits.SetNumZeroed(NumSlots);
+		EffectBlock->DetrimentBits.SetNumZeroed(NumSlots);
+	}
+
+	for (int32 SlotIndex = 0; SlotIndex < NumSlots; SlotIndex++)
+	{
+		const FSlot& Slot = Slots_[SlotIndex];
+		// Unused slots get a serial no handle can match
+		Snapshot->Serials[SlotIndex] = Slot.bInUse ? Slot.Serial : -1;
+		if (!Slot.bInUse)
+			continue;
+
+		// Every component publishes its own lock-free snapshot first, then the
+		// frame snapshot is assembled from those so both views agree.
+		if (UVitalityWelfareComponent* Welfare = Slot.Welfare.Get())
+		{
+			Welfare->PublishSnapshot();
+			const FVitalityWelfareSnapshot& Pools = Welfare->GetPublishedSnapshot();
+			PoolBlock->HealthPercent[SlotIndex]		= Pools.GetHealthPercent();
+			PoolBlock->StaminaPercent[SlotIndex]	= Pools.GetStaminaPercent();
+			PoolBlock->MagicPercent[SlotIndex]		= Pools.GetMagicPercent();
+			PoolBlock->HydrationPercent[SlotIndex]	= Pools.GetHydrationPercent();
+			PoolBlock->CaloriesPercent[SlotIndex]	= Pools.GetHungerPercent();
+			PoolBlock->IsDead[SlotIndex]			= Pools.bIsDead;
+			PoolBlock->CombatState[SlotIndex]		= Pools.CombatState;
+		}
+
+		if (!StatBlock.IsValid() || !(DirtySlots_[SlotIndex] || bResized))
+			continue;
+
+		// The rows are copied from the previous frame, and the slot may have been reused or lost a
+		// component since, so they are cleared before patching
+		FMemory::Memzero(&StatBlock->CoreStats[SlotIndex * NumCoreStats], sizeof(float) * NumCoreStats);
+		FMemory::Memzero(&StatBlock->DamageBonuses[SlotIndex * NumDamageTypes], sizeof(float) * NumDamageTypes);
+		FMemory::Memzero(&StatBlock->Resistances[SlotIndex * NumDamageTypes], sizeof(float) * NumDamageTypes);
+		EffectBlock->BenefitBits[SlotIndex]		= 0;
+		EffectBlock->DetrimentBits[SlotIndex]	= 0;
+
+		if (UVitalityStatComponent* Stats = Slot.Stats.Get())
+		{
+			Stats->PublishSnapshot();
+			const FVitalityStatSnapshot& StatSnapshot = Stats->GetPublishedSnapshot();
+			constexpr int32 TotalLayer = FVitalityStatSnapshot::NumLayers;
+			FMemory::Memcpy(&StatBlock->CoreStats[SlotIndex * NumCoreStats],
+				StatSnapshot.CoreStats[TotalLayer], sizeof(float) * NumCoreStats);
+			FMemory::Memcpy(&StatBlock->DamageBonuses[SlotIndex * NumDamageTypes],
+				StatSnapshot.DamageBonuses[TotalLayer], sizeof(float) * NumDamageTypes);
+			FMemory::Memcpy(&StatBlock->Resistances[SlotIndex * NumDamageTypes],
+				StatSnapshot.DamageResists[TotalLayer], sizeof(float) * NumDamageTypes);
+		}
+		if (UVitalityEffectsComponent* Effects = Slot.Effects.Get())
+		{
+			Effects->PublishSnapshot();
+			const FVitalityEffectsSnapshot& EffectSnapshot = Effects->GetPublishedSnapshot();
+			EffectBlock->BenefitBits[SlotIndex]		= EffectSnapshot.BenefitBits;
+			EffectBlock->DetrimentBits[SlotIndex]	= EffectSnapshot.DetrimentBits;
+		}
+	}
+	DirtySlots_.Init(false, NumSlots);
+
+	Snapshot->Pools		= PoolBlock;
+	Snapshot->Stats		= StatBlock.IsValid() ? StatBlock : Previous->Stats;
+	Snapshot->Effects	= EffectBlock.IsValid() ? EffectBlock : Previous->Effects;
+
+	if (bRegistryChanged_ || !Previous.IsValid())
+	{
+		TSharedRef<TMap<const AActor*, FVitalityHandle>, ESPMode::ThreadSafe> Handles =
+			MakeShared<TMap<const AActor*, FVitalityHandle>, ESPMode::ThreadSafe>();
+		Handles->Reserve(SlotByActor_.Num());
+		for (const TPair<const AActor*, int32>& Entry : SlotByActor_)
+			Handles->Add(Entry.Key, FVitalityHandle(Entry.Value, Slots_[Entry.Value].Serial));
+		Snapshot->Handles = Handles;
+		bRegistryChanged_ = false;
+	}
+	else
+	{
+		Snapshot->Handles = Previous->Handles;
+	}
+
+	FRWScopeLock WriteLock(SnapshotLock_, SLT_Write);
+	FrameSnapshot_ = Snapshot;
+}
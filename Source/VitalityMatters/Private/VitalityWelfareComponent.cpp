@@ -4,8 +4,30 @@
 
 #include "AsyncTreeDifferences.h"
 #include "GameFramework/Character.h"
+#include "GameFramework/GameStateBase.h"
 #include "Kismet/GameplayStatics.h"
+#include "lib/NutritionRegistry.h"
+#include "lib/SaveStats.h"
+#include "lib/VitalityStats.h"
 #include "Net/UnrealNetwork.h"
+#include "VitalityDamageNumbers.h"
+#include "VitalityCombatMath.h"
+#include "VitalityEffectsComponent.h"
+#include "VitalityPoolMath.h"
+
+static_assert(static_cast<uint8>(ECombatState::MAX) == static_cast<uint8>(EVitalityCombatLevel::Max)
+	&& static_cast<uint8>(ECombatState::INJURED) == static_cast<uint8>(EVitalityCombatLevel::Injured),
+	"EVitalityCombatLevel must mirror ECombatState");
+
+static EVitalityCombatLevel ToCombatLevel(ECombatState CombatState)
+{
+	return static_cast<EVitalityCombatLevel>(CombatState);
+}
+
+static ECombatState ToCombatState(EVitalityCombatLevel CombatLevel)
+{
+	return static_cast<ECombatState>(CombatLevel);
+}
 
 void UVitalityWelfareComponent::SetupDefaultValues()
 {
@@ -44,6 +66,7 @@ void UVitalityWelfareComponent::SetupDefaultValues()
  */
 float UVitalityWelfareComponent::DamageHealth(AActor* DamageInstigator, float DamageTaken)
 {
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityDamageHealth);
 	if (!GetOwner()->HasAuthority())
 		return HealthCurrent_;
 	
@@ -68,7 +91,10 @@ float UVitalityWelfareComponent::DamageHealth(AActor* DamageInstigator, float Da
 			if (IsNewDamage)
 				DamageHistory_.Add(FStDamageData(DamageInstigator, NewDamageValue));
 
-			HealthCurrent_ -= NewDamageValue;
+			FVitalityPoolMath::ApplyDamage(HealthCurrent_, NewDamageValue);
+			INC_DWORD_STAT(STAT_VitalityDamageEvents);
+			VITALITY_TRACE_EVENT(DamageApplied, GetOwner(), DamageInstigator,
+				NewDamageValue, HealthCurrent_, HealthCurrent_ <= 0.f);
 			Multicast_DamageTaken(DamageInstigator, NewDamageValue);
 			
 			if (HealthCurrent_ <= 0.f)
@@ -77,6 +103,7 @@ float UVitalityWelfareComponent::DamageHealth(AActor* DamageInstigator, float Da
 				{
 					IsDead_ = true;
 					OnDeath.Broadcast(DamageInstigator);
+					INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
 					
 					UAnimMontage* UsingAnimation = nullptr;
 					const int NumAnimations = HitAnimations.Num();
@@ -111,12 +138,9 @@ float UVitalityWelfareComponent::DamageStamina(AActor* DamageInstigator, float D
 {
 	if (!GetOwner()->HasAuthority())
 		return StaminaCurrent_;
-	const float NewDamageValue = abs(DamageTaken);
 	if (StaminaMax_ > 0.f)
 	{
-		StaminaCurrent_ -= NewDamageValue;
-		if (StaminaCurrent_ < 0.f)
-			StaminaCurrent_ = 0.f;
+		FVitalityPoolMath::ApplyDamage(StaminaCurrent_, DamageTaken);
 		OnStaminaUpdated.Broadcast(StaminaCurrent_, StaminaMax_, GetStaminaPercent());
 	}
 	return StaminaCurrent_;
@@ -132,19 +156,304 @@ float UVitalityWelfareComponent::DamageMagic(AActor* DamageInstigator, float Dam
 {
 	if (!GetOwner()->HasAuthority())
 		return MagicCurrent_;
-	const float NewDamageValue = abs(DamageTaken);
 	if (MagicMax_ > 0.f)
 	{
-		MagicCurrent_ -= NewDamageValue;
-		if (MagicCurrent_ < 0.f)
-			MagicCurrent_ = 0.f;
+		FVitalityPoolMath::ApplyDamage(MagicCurrent_, DamageTaken);
 		OnMagicUpdated.Broadcast(MagicCurrent_, MagicMax_, GetMagicPercent());
 	}
 	return MagicCurrent_;
 }
 
+/**
+ * @brief Adds calories to the hunger pool, restarting the passive drain if it had stopped
+ * @param CaloriesAdded The calories to add. Negative values remove calories.
+ * @return The new value of the components calories
+ */
+float UVitalityWelfareComponent::AddCalories(float CaloriesAdded)
+{
+	if (!GetOwner()->HasAuthority())
+		return CaloriesCurrent_;
+	if (CaloriesMax_ > 0.f && CaloriesAdded != 0.f)
+	{
+		FVitalityPoolMath::Add(CaloriesCurrent_, CaloriesMax_, CaloriesAdded);
+		if (UseSurvivalSubsystem && CaloriesCurrent_ > 0.f
+			&& !GetWorld()->GetTimerManager().IsTimerActive(CaloriesTimer_))
+		{
+			StartTimerForCategory(EVitalityCategory::HUNGER);
+		}
+		OnCaloriesUpdated.Broadcast(CaloriesCurrent_, CaloriesMax_, GetHungerPercent());
+	}
+	return CaloriesCurrent_;
+}
+
+/**
+ * @brief Adds hydration to the thirst pool, restarting the passive drain if it had stopped
+ * @param HydrationAdded The hydration to add. Negative values remove hydration.
+ * @return The new value of the components hydration
+ */
+float UVitalityWelfareComponent::AddHydration(float HydrationAdded)
+{
+	if (!GetOwner()->HasAuthority())
+		return HydrationCurrent_;
+	if (HydrationMax_ > 0.f && HydrationAdded != 0.f)
+	{
+		FVitalityPoolMath::Add(HydrationCurrent_, HydrationMax_, HydrationAdded);
+		if (UseSurvivalSubsystem && HydrationCurrent_ > 0.f
+			&& !GetWorld()->GetTimerManager().IsTimerActive(HydrationTimer_))
+		{
+			StartTimerForCategory(EVitalityCategory::THIRST);
+		}
+		OnHydrationUpdated.Broadcast(HydrationCurrent_, HydrationMax_, GetHydrationPercent());
+	}
+	return HydrationCurrent_;
+}
+
+/**
+ * @brief Consumes a batch of food and drink in one step. Every row is resolved first, then
+ *        the nutrition is summed into a single calories and hydration change, and each
+ *        distinct effect is applied once with its summed stack count. Authority only, since
+ *        the items and their spawned actors must come from the game's own inventory code.
+ * @param ItemNames The nutrition table row names of the consumed items. Duplicates are allowed.
+ * @return The number of items consumed. Always zero on clients.
+ */
+int UVitalityWelfareComponent::ConsumeItems(const TArray<FName>& ItemNames)
+{
+	if (ItemNames.Num() < 1)
+		return 0;
+	if (!GetOwner()->HasAuthority())
+		return 0;
+	
+	FNutritionRegistry& NutritionRegistry = FNutritionRegistry::Get();
+	float CaloriesAdded = 0.f;
+	float HydrationAdded = 0.f;
+	int BenefitStacks[static_cast<int>(EEffectsBeneficial::MAX)] = {};
+	int DetrimentStacks[static_cast<int>(EEffectsDetrimental::MAX)] = {};
+	TArray<TSubclassOf<AActor>, TInlineAllocator<8>> SpawnClasses;
+	int ItemsConsumed = 0;
+	const double WorldTime = GetWorld()->GetTimeSeconds();
+	bool bDigestionChanged = false;
+	
+	for (const FName& ItemName : ItemNames)
+	{
+		const FStNutritionData* NutritionData = NutritionRegistry.Find(ItemName);
+		if (NutritionData == nullptr)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("ConsumeItems(): No nutrition data for '%s'"), *ItemName.ToString());
+			continue;
+		}
+		if (NutritionData->digestSeconds > 0.f)
+		{
+			// Digested nutrition joins the queue, and is released by the vitality subsystem
+			if (!bDigestionChanged)
+			{
+				BeginDigestionChange(WorldTime);
+				bDigestionChanged = true;
+			}
+			QueueDigestion(EVitalityCategory::HUNGER, NutritionData->calories,
+				NutritionData->calories / NutritionData->digestSeconds, 0.f, WorldTime);
+			QueueDigestion(EVitalityCategory::THIRST, NutritionData->hydration,
+				NutritionData->hydration / NutritionData->digestSeconds, 0.f, WorldTime);
+		}
+		else
+		{
+			CaloriesAdded	+= NutritionData->calories;
+			HydrationAdded	+= NutritionData->hydration;
+		}
+		if (NutritionData->addBenefit != EEffectsBeneficial::MAX)
+			BenefitStacks[static_cast<int>(NutritionData->addBenefit)] += FMath::Max(NutritionData->benefitCount, 1);
+		if (NutritionData->addDetriment != EEffectsDetrimental::MAX)
+			DetrimentStacks[static_cast<int>(NutritionData->addDetriment)] += FMath::Max(NutritionData->detrimentCount, 1);
+		if (NutritionData->optionalSpawnActor != nullptr)
+			SpawnClasses.Add(NutritionData->optionalSpawnActor);
+		ItemsConsumed++;
+	}
+	
+	// One change per pool, so clients receive a single welfare update for the whole batch
+	AddCalories(CaloriesAdded);
+	AddHydration(HydrationAdded);
+	if (bDigestionChanged)
+	{
+		RebuildDigestion(WorldTime);
+		if (DigestionQueue_.Num() > 0)
+		{
+			if (UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this))
+				VitalitySubsystem->SetDigesting(VitalityHandle_, true);
+		}
+	}
+	
+	if (UVitalityEffectsComponent* EffectsComponent = GetOwner()->FindComponentByClass<UVitalityEffectsComponent>())
+	{
+		for (int i = 0; i < static_cast<int>(EEffectsBeneficial::MAX); i++)
+		{
+			if (BenefitStacks[i] > 0)
+				EffectsComponent->ApplyEffectBeneficial(static_cast<EEffectsBeneficial>(i), BenefitStacks[i]);
+		}
+		for (int i = 0; i < static_cast<int>(EEffectsDetrimental::MAX); i++)
+		{
+			if (DetrimentStacks[i] > 0)
+				EffectsComponent->ApplyEffectDetrimental(static_cast<EEffectsDetrimental>(i), DetrimentStacks[i]);
+		}
+	}
+	
+	if (SpawnClasses.Num() > 0)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = GetOwner();
+		SpawnParams.Instigator = Cast<APawn>(GetOwner());
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+		const FTransform SpawnTransform = GetOwner()->GetActorTransform();
+		for (const TSubclassOf<AActor>& SpawnClass : SpawnClasses)
+			GetWorld()->SpawnActor<AActor>(SpawnClass, SpawnTransform, SpawnParams);
+	}
+	return ItemsConsumed;
+}
+
+/**
+ * @brief Queues nutrition to be released into a pool over time. Every entry in the queue is
+ *        summed into one net rate per pool, which the vitality subsystem releases each frame,
+ *        so the per-frame cost does not grow with the number of entries.
+ * @param VitalityCategory HUNGER or THIRST
+ * @param Amount The total to release. Negative values drain the pool instead.
+ * @param ReleaseRate The amount released per second
+ * @param ExpirySeconds Seconds until any unreleased amount is discarded. Zero never expires.
+ * @return True if the nutrition was queued, false if not authority or invalid
+ */
+bool UVitalityWelfareComponent::DigestNutrition(EVitalityCategory VitalityCategory,
+	float Amount, float ReleaseRate, float ExpirySeconds)
+{
+	if (!GetOwner()->HasAuthority())
+		return false;
+	
+	const double WorldTime = GetWorld()->GetTimeSeconds();
+	BeginDigestionChange(WorldTime);
+	const bool bQueued = QueueDigestion(VitalityCategory, Amount, ReleaseRate, ExpirySeconds, WorldTime);
+	RebuildDigestion(WorldTime);
+	
+	if (bQueued)
+	{
+		if (UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this))
+			VitalitySubsystem->SetDigesting(VitalityHandle_, true);
+	}
+	return bQueued;
+}
+
+float UVitalityWelfareComponent::GetDigestionRate(EVitalityCategory VitalityCategory) const
+{
+	switch(VitalityCategory)
+	{
+	case EVitalityCategory::HUNGER:		return CaloriesDigestionRate_;
+	case EVitalityCategory::THIRST:		return HydrationDigestionRate_;
+	default:							return 0.f;
+	}
+}
+
+/**
+ * @brief Releases the summed digestion rates up to the given time. Only does per-entry
+ *        work when an entry finishes or expires, since that is the only time the rates change.
+ * @param WorldTime The world time to release up to
+ * @return True if the queue still has entries
+ */
+bool UVitalityWelfareComponent::TickDigestion(double WorldTime)
+{
+	while (DigestionQueue_.Num() > 0 && NextDigestionEvent_ <= WorldTime)
+	{
+		ReleaseDigestion(NextDigestionEvent_ - DigestionTime_);
+		DigestionTime_ = NextDigestionEvent_;
+		RebuildDigestion(DigestionTime_);
+	}
+	if (DigestionQueue_.Num() > 0)
+	{
+		ReleaseDigestion(WorldTime - DigestionTime_);
+		DigestionTime_ = WorldTime;
+		return true;
+	}
+	return false;
+}
+
+void UVitalityWelfareComponent::BeginDigestionChange(double WorldTime)
+{
+	if (TickDigestion(WorldTime))
+	{
+		RebuildDigestion(WorldTime);
+	}
+	else
+	{
+		DigestionTime_			= WorldTime;
+		DigestionRebuildTime_	= WorldTime;
+	}
+}
+
+bool UVitalityWelfareComponent::QueueDigestion(EVitalityCategory VitalityCategory,
+	float Amount, float ReleaseRate, float ExpirySeconds, double WorldTime)
+{
+	if (VitalityCategory != EVitalityCategory::HUNGER && VitalityCategory != EVitalityCategory::THIRST)
+		return false;
+	if (FMath::IsNearlyZero(Amount) || FMath::IsNearlyZero(ReleaseRate))
+		return false;
+	
+	FVitalityDigestion& Digestion = DigestionQueue_.AddDefaulted_GetRef();
+	Digestion.Pool				= VitalityCategory;
+	Digestion.AmountRemaining	= Amount;
+	Digestion.ReleaseRate		= FMath::Abs(ReleaseRate) * FMath::Sign(Amount);
+	Digestion.ExpiryTime		= ExpirySeconds > 0.f ? WorldTime + ExpirySeconds : TNumericLimits<double>::Max();
+	Digestion.FinishTime		= FMath::Min(WorldTime + Amount / Digestion.ReleaseRate, Digestion.ExpiryTime);
+	return true;
+}
+
+void UVitalityWelfareComponent::RebuildDigestion(double WorldTime)
+{
+	const float ElapsedSeconds = WorldTime - DigestionRebuildTime_;
+	DigestionRebuildTime_	= WorldTime;
+	CaloriesDigestionRate_	= 0.f;
+	HydrationDigestionRate_	= 0.f;
+	bPoolsPending_			= true;
+	NextDigestionEvent_		= TNumericLimits<double>::Max();
+	
+	for (int i = DigestionQueue_.Num() - 1; i >= 0; i--)
+	{
+		FVitalityDigestion& Digestion = DigestionQueue_[i];
+		if (Digestion.FinishTime <= WorldTime)
+		{
+			DigestionQueue_.RemoveAtSwap(i, 1, false);
+			continue;
+		}
+		Digestion.AmountRemaining -= Digestion.ReleaseRate * ElapsedSeconds;
+		if (Digestion.Pool == EVitalityCategory::HUNGER)
+			CaloriesDigestionRate_ += Digestion.ReleaseRate;
+		else
+			HydrationDigestionRate_ += Digestion.ReleaseRate;
+		NextDigestionEvent_ = FMath::Min(NextDigestionEvent_, Digestion.FinishTime);
+	}
+}
+
+void UVitalityWelfareComponent::ReleaseDigestion(float DeltaSeconds)
+{
+	if (DeltaSeconds <= 0.f)
+		return;
+	
+	if (CaloriesDigestionRate_ != 0.f && CaloriesMax_ > 0.f)
+	{
+		const bool bWasEmpty = CaloriesCurrent_ <= 0.f;
+		CaloriesCurrent_ = FMath::Clamp(CaloriesCurrent_ + CaloriesDigestionRate_ * DeltaSeconds, 0.f, CaloriesMax_);
+		
+		// The passive drain stops at zero, so it has to be restarted once there is something to drain
+		if (bWasEmpty && CaloriesCurrent_ > 0.f && UseSurvivalSubsystem)
+			StartTimerForCategory(EVitalityCategory::HUNGER);
+	}
+	if (HydrationDigestionRate_ != 0.f && HydrationMax_ > 0.f)
+	{
+		const bool bWasEmpty = HydrationCurrent_ <= 0.f;
+		HydrationCurrent_ = FMath::Clamp(HydrationCurrent_ + HydrationDigestionRate_ * DeltaSeconds, 0.f, HydrationMax_);
+		if (bWasEmpty && HydrationCurrent_ > 0.f && UseSurvivalSubsystem)
+			StartTimerForCategory(EVitalityCategory::THIRST);
+	}
+}
+
 bool UVitalityWelfareComponent::StartTimerForCategory(EVitalityCategory VitalityCategory)
 {
+	if (StartParallelPool(VitalityCategory))
+		return true;
+	
 	FTimerHandle* TimerReference = &HealthTimer_;
 	FTimerDelegate TimerDelegate;
 	float TimerTickRate = 1.f;
@@ -179,6 +488,7 @@ bool UVitalityWelfareComponent::StartTimerForCategory(EVitalityCategory Vitality
 	if (TimerReference != nullptr)
 		InitializeTimer(*TimerReference, TimerDelegate, TimerTickRate);
 	
+	bPoolsPending_ = true;
 	return true;
 }
 
@@ -195,6 +505,8 @@ bool UVitalityWelfareComponent::CancelTimerForCategory(EVitalityCategory Vitalit
 		break;
 	}
 	CancelTimer(*TimerReference);
+	ParallelPools_ &= ~(1 << static_cast<uint8>(VitalityCategory));
+	bPoolsPending_ = true;
 	return true;
 }
 
@@ -211,12 +523,32 @@ bool UVitalityWelfareComponent::PauseTimerForCategory(EVitalityCategory Vitality
 		break;
 	}
 	if (PauseTimer)
+	{
 		GetWorld()->GetTimerManager().PauseTimer(*TimerReference);
+		PausedParallelPools_ |= 1 << static_cast<uint8>(VitalityCategory);
+	}
 	else
+	{
 		GetWorld()->GetTimerManager().UnPauseTimer(*TimerReference);
+		PausedParallelPools_ &= ~(1 << static_cast<uint8>(VitalityCategory));
+	}
+	// The pool's rate changed, though its value did not
+	bPoolsPending_ = true;
 	return true;
 }
 
+bool UVitalityWelfareComponent::IsInDamageHistory(const AActor* DamagingActor) const
+{
+	if (DamagingActor == nullptr)
+		return false;
+	for (const FStDamageData& DamageData : DamageHistory_)
+	{
+		if (DamageData.DamagingActor == DamagingActor)
+			return true;
+	}
+	return false;
+}
+
 float UVitalityWelfareComponent::GetVitalityStatData(
 	EVitalityCategory VitalityCategory, float& CurrentValue, float& MaxValue) const
 {
@@ -240,13 +572,27 @@ float UVitalityWelfareComponent::GetVitalityStatData(
 	return 0;
 }
 
+/**
+ * @return The actor's status, worked out from the death flag, the combat state and the health
+ */
+EVitalityStatus UVitalityWelfareComponent::GetVitalityStatus() const
+{
+	if (GetIsDead())
+		return EVitalityStatus::DEAD;
+	if (CombatState_ == ECombatState::INJURED)
+		return EVitalityStatus::DOWN;
+	if (HealthCurrent_ < HealthMax_)
+		return EVitalityStatus::INJURED;
+	return EVitalityStatus::ALIVE;
+}
+
 /**
  * @return Returns the current health, as a percentage from 0.0 to 1.0
  */
 float UVitalityWelfareComponent::GetHealthPercent() const
 {
 	if (!GetIsDead())
-		return FMath::Clamp(HealthCurrent_/HealthMax_, 0.f, 1.f);
+		return FVitalityPoolMath::GetPercent(HealthCurrent_, HealthMax_);
 	return 0.f;
 }
 
@@ -267,9 +613,7 @@ float UVitalityWelfareComponent::GetCurrentHealth(float& CurrentValue, float& Ma
  */
 float UVitalityWelfareComponent::GetStaminaPercent() const
 {
-	if (StaminaMax_ > 0.f)
-		return FMath::Clamp(StaminaCurrent_/StaminaMax_, 0.f, 1.f);
-	return 0.f;
+	return FVitalityPoolMath::GetPercent(StaminaCurrent_, StaminaMax_);
 }
 
 /**
@@ -288,9 +632,7 @@ float UVitalityWelfareComponent::GetCurrentStamina(float& CurrentValue, float& M
  */
 float UVitalityWelfareComponent::GetMagicPercent() const
 {
-	if (MagicMax_ > 0.f)
-		return FMath::Clamp(MagicCurrent_/MagicMax_, 0.f, 1.f);
-	return 0.f;
+	return FVitalityPoolMath::GetPercent(MagicCurrent_, MagicMax_);
 }
 
 /**
@@ -312,9 +654,7 @@ float UVitalityWelfareComponent::GetCurrentMagic(float& CurrentValue, float& Max
  */
 float UVitalityWelfareComponent::GetHydrationPercent() const
 {
-	if (HydrationMax_ > 0.f)
-		return FMath::Clamp(HydrationCurrent_/HydrationMax_, 0.f, 1.f);
-	return 0.f;
+	return FVitalityPoolMath::GetPercent(HydrationCurrent_, HydrationMax_);
 }
 
 /**
@@ -336,9 +676,7 @@ float UVitalityWelfareComponent::GetCurrentHydration(float& CurrentValue, float&
  */
 float UVitalityWelfareComponent::GetHungerPercent() const
 {
-	if (CaloriesMax_ > 0.f)
-		return FMath::Clamp(CaloriesCurrent_/CaloriesMax_, 0.f, 1.f);
-	return 0.f;
+	return FVitalityPoolMath::GetPercent(CaloriesCurrent_, CaloriesMax_);
 }
 
 /**
@@ -354,6 +692,156 @@ float UVitalityWelfareComponent::GetCurrentHunger(float& CurrentValue, float& Ma
 	return GetHungerPercent();
 }
 
+/**
+ * @brief Copies the pools into the back buffer and flips it, so worker threads can
+ *        read them without locking. Does nothing if no value changed. Game thread only.
+ */
+void UVitalityWelfareComponent::PublishSnapshot()
+{
+	check(IsInGameThread());
+	UpdateDisplayedPools();
+	
+	FVitalityWelfareSnapshot NewSnapshot;
+	FMemory::Memzero(NewSnapshot);
+	NewSnapshot.HealthCurrent		= HealthCurrent_;
+	NewSnapshot.HealthMax			= HealthMax_;
+	NewSnapshot.StaminaCurrent		= StaminaCurrent_;
+	NewSnapshot.StaminaMax			= StaminaMax_;
+	NewSnapshot.MagicCurrent		= MagicCurrent_;
+	NewSnapshot.MagicMax			= MagicMax_;
+	NewSnapshot.HydrationCurrent	= HydrationCurrent_;
+	NewSnapshot.HydrationMax		= HydrationMax_;
+	NewSnapshot.CaloriesCurrent		= CaloriesCurrent_;
+	NewSnapshot.CaloriesMax			= CaloriesMax_;
+	NewSnapshot.bIsDead				= IsDead_;
+	NewSnapshot.CombatState			= CombatState_;
+
+	if (Snapshot_.GetVersion() > 0
+		&& FMemory::Memcmp(&NewSnapshot, &Snapshot_.GetFront(), sizeof(FVitalityWelfareSnapshot)) == 0)
+	{
+		// Nothing changed, but a held back pool may be due now, or a rate may have changed
+		if (bPoolsPending_ && GetOwner()->HasAuthority())
+			bPoolsPending_ = UpdateReplicatedPools();
+		return;
+	}
+
+	Snapshot_.BeginWrite() = NewSnapshot;
+	Snapshot_.Publish();
+
+	// Every pool that changed this frame, and is due, replicates together as one block
+	if (GetOwner()->HasAuthority())
+	{
+		bPoolsPending_ = UpdateReplicatedPools();
+		WriteSummary(ReplicatedSummary_);
+	}
+	
+	// Any published change is also a change the next journal record has to carry
+	DirtySaveSections_ |= EVitalitySaveSections::WELFARE;
+}
+
+void UVitalityWelfareComponent::CaptureSaveData(FVitalitySaveRecord& OutRecord,
+	EVitalitySaveSections Sections) const
+{
+	if (!EnumHasAnyFlags(Sections, EVitalitySaveSections::WELFARE))
+		return;
+	
+	OutRecord.Sections |= EVitalitySaveSections::WELFARE;
+	for (int i = 0; i < FVitalitySaveRecord::NumPools; i++)
+	{
+		GetVitalityStatData(static_cast<EVitalityCategory>(i),
+			OutRecord.PoolCurrent[i], OutRecord.PoolMax[i]);
+	}
+	OutRecord.bIsDead		= IsDead_;
+	OutRecord.CombatState	= CombatState_;
+}
+
+/**
+ * @brief Restores every pool from the saved record in one pass, then restarts
+ *        the regen and drain timers that are needed and fires the update delegates.
+ * @param Record The saved record. Does nothing if it has no welfare section.
+ */
+void UVitalityWelfareComponent::ApplySaveData(const FVitalitySaveRecord& Record)
+{
+	if (!Record.HasSection(EVitalitySaveSections::WELFARE) || !GetOwner()->HasAuthority())
+		return;
+
+	IsDead_ = Record.bIsDead;
+	for (int i = 0; i < FVitalitySaveRecord::NumPools; i++)
+	{
+		const EVitalityCategory VitalityCategory = static_cast<EVitalityCategory>(i);
+		float* CurrentValuePtr	= &HealthCurrent_;
+		float* MaximumValuePtr	= &HealthMax_;
+		FTimerHandle* PoolTimer	= &HealthTimer_;
+		bool UsesSubsystem		= UseHealthSubsystem;
+		bool DrainsPassively	= false;
+		switch(VitalityCategory)
+		{
+		case EVitalityCategory::STAMINA:
+			CurrentValuePtr = &StaminaCurrent_;		MaximumValuePtr = &StaminaMax_;
+			PoolTimer = &StaminaTimer_;				UsesSubsystem = UseStaminaSubsystem;
+			break;
+		case EVitalityCategory::MAGIC:
+			CurrentValuePtr = &MagicCurrent_;		MaximumValuePtr = &MagicMax_;
+			PoolTimer = &MagicTimer_;				UsesSubsystem = UseMagicSubsystem;
+			break;
+		case EVitalityCategory::HUNGER:
+			CurrentValuePtr = &CaloriesCurrent_;	MaximumValuePtr = &CaloriesMax_;
+			PoolTimer = &CaloriesTimer_;			UsesSubsystem = UseSurvivalSubsystem;
+			DrainsPassively = true;
+			break;
+		case EVitalityCategory::THIRST:
+			CurrentValuePtr = &HydrationCurrent_;	MaximumValuePtr = &HydrationMax_;
+			PoolTimer = &HydrationTimer_;			UsesSubsystem = UseSurvivalSubsystem;
+			DrainsPassively = true;
+			break;
+		default:
+			break;
+		}
+
+		*MaximumValuePtr = FMath::Max(Record.PoolMax[i], 0.f);
+		*CurrentValuePtr = FMath::Clamp(Record.PoolCurrent[i], 0.f, *MaximumValuePtr);
+
+		// Regen only needs to run below the maximum, but hunger and thirst always drain
+		const bool bNeedsTimer = DrainsPassively || *CurrentValuePtr < *MaximumValuePtr;
+		if (UsesSubsystem && !IsDead_ && bNeedsTimer
+			&& !GetWorld()->GetTimerManager().IsTimerActive(*PoolTimer))
+		{
+			StartTimerForCategory(VitalityCategory);
+		}
+		BroadcastCategoryUpdated(VitalityCategory);
+	}
+	SetCombatState(Record.CombatState);
+
+	// Publish now so the restored pools are not seen as a change worth journaling
+	PublishSnapshot();
+	SetSaveSectionsDirty(EVitalitySaveSections::WELFARE, false);
+}
+
+void UVitalityWelfareComponent::GetMemoryUsage(FVitalityMemoryUsage& OutUsage) const
+{
+	OutUsage.History	+= DamageHistory_.GetAllocatedSize();
+	OutUsage.Queues		+= DigestionQueue_.GetAllocatedSize();
+	OutUsage.Other		+= DeathAnimations.GetAllocatedSize() + DeathSounds.GetAllocatedSize()
+		+ HitAnimations.GetAllocatedSize() + HitSounds.GetAllocatedSize();
+}
+
+void UVitalityWelfareComponent::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	FVitalityMemoryUsage MemoryUsage;
+	GetMemoryUsage(MemoryUsage);
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(MemoryUsage.GetTotal());
+}
+
+void UVitalityWelfareComponent::SetSaveSectionsDirty(EVitalitySaveSections Sections, bool bIsDirty)
+{
+	Sections &= EVitalitySaveSections::WELFARE;
+	if (bIsDirty)
+		DirtySaveSections_ |= Sections;
+	else
+		DirtySaveSections_ &= ~Sections;
+}
+
 // Determines the animation & sound to be played, then uses multicast to send it
 void UVitalityWelfareComponent::HitByWeapon()
 {
@@ -389,18 +877,10 @@ void UVitalityWelfareComponent::Multicast_HitByWeaponEffects_Implementation(UAni
  */
 void UVitalityWelfareComponent::IncreaseCombatState()
 {
-	if (GetCombatState() == ECombatState::ENGAGED)
-		return;
 	const ECombatState OldState = CombatState_;
-	switch (CombatState_)
-	{
-	case ECombatState::RECOVERY: CombatState_ = ECombatState::RELAXED; break;
-	case ECombatState::RELAXED:  CombatState_ = ECombatState::ALERT; break;
-	case ECombatState::INJURED:  CombatState_ = ECombatState::ALERT; break;
-	case ECombatState::ALERT:    CombatState_ = ECombatState::ENGAGED; break;
-	default: // Status is already Engaged or None (highest)
+	CombatState_ = ToCombatState(FVitalityCombatMath::GetIncreased(ToCombatLevel(OldState)));
+	if (CombatState_ == OldState)
 		return;
-	}
 	OnCombatStateChanged.Broadcast(OldState, CombatState_);
 }
 
@@ -409,17 +889,10 @@ void UVitalityWelfareComponent::IncreaseCombatState()
  */
 void UVitalityWelfareComponent::DecreaseCombatState()
 {
-	if (GetCombatState() == ECombatState::RELAXED)
-		return;
 	const ECombatState OldState = CombatState_;
-	switch (CombatState_)
-	{
-	case ECombatState::ENGAGED:  CombatState_ = ECombatState::ALERT; break;
-	case ECombatState::ALERT:    CombatState_ = ECombatState::RELAXED; break;
-	case ECombatState::INJURED:  CombatState_ = ECombatState::RELAXED; break;
-	default:
+	CombatState_ = ToCombatState(FVitalityCombatMath::GetDecreased(ToCombatLevel(OldState)));
+	if (CombatState_ == OldState)
 		return;
-	}
 	OnCombatStateChanged.Broadcast(OldState, CombatState_);
 }
 
@@ -547,6 +1020,7 @@ void UVitalityWelfareComponent::InitializeSubsystem(EVitalityCategory VitalityCa
 		
 		if (SubsystemTimer->IsValid())
 			SubsystemTimer->Invalidate();
+		ParallelPools_ &= ~(1 << static_cast<uint8>(VitalityCategory));
 		
 		if (*UseSubsystemPtr)
 		{
@@ -563,7 +1037,8 @@ void UVitalityWelfareComponent::InitializeSubsystem(EVitalityCategory VitalityCa
 			// If the value isn't max, start the regen timer
 			if (*ActualCurrentPtr < *ActualMaximumPtr)
 			{
-				InitializeTimer(*SubsystemTimer, InitDelegate);
+				if (!StartParallelPool(VitalityCategory))
+					InitializeTimer(*SubsystemTimer, InitDelegate);
 				if (VitalityCategory == EVitalityCategory::HEALTH)
 				{
 					if (HealthCurrent_ <= 0.f && !GetIsDead())
@@ -584,6 +1059,90 @@ void UVitalityWelfareComponent::InitializeSubsystem(EVitalityCategory VitalityCa
 	}
 }
 
+/**
+ * @brief Sets the maximum value of the category without re-running the initializer.
+ *        The current value is clamped, and the regen timer is started if needed.
+ * @param VitalityCategory The category to modify
+ * @param NewMaximum The new maximum value. Negative values are treated as zero.
+ * @return True if the maximum was set, false if not authority or invalid category
+ */
+bool UVitalityWelfareComponent::SetVitalityMaximum(EVitalityCategory VitalityCategory, float NewMaximum)
+{
+	if (!GetOwner()->HasAuthority())
+		return false;
+
+	float* CurrentValuePtr = nullptr;
+	float* MaximumValuePtr = nullptr;
+	FTimerHandle* RegenTimer = nullptr;
+	switch(VitalityCategory)
+	{
+	case EVitalityCategory::HEALTH:
+		CurrentValuePtr = &HealthCurrent_;		MaximumValuePtr = &HealthMax_;		RegenTimer = &HealthTimer_;		break;
+	case EVitalityCategory::STAMINA:
+		CurrentValuePtr = &StaminaCurrent_;		MaximumValuePtr = &StaminaMax_;		RegenTimer = &StaminaTimer_;	break;
+	case EVitalityCategory::MAGIC:
+		CurrentValuePtr = &MagicCurrent_;		MaximumValuePtr = &MagicMax_;		RegenTimer = &MagicTimer_;		break;
+	case EVitalityCategory::THIRST:
+		CurrentValuePtr = &HydrationCurrent_;	MaximumValuePtr = &HydrationMax_;	break;
+	case EVitalityCategory::HUNGER:
+		CurrentValuePtr = &CaloriesCurrent_;	MaximumValuePtr = &CaloriesMax_;	break;
+	default:
+		return false;
+	}
+
+	const bool bHasHeadroom = FVitalityPoolMath::SetMaximum(*CurrentValuePtr, *MaximumValuePtr, NewMaximum);
+	if (RegenTimer != nullptr && bHasHeadroom)
+	{
+		// The new headroom needs to be regenerated, unless the pool is already ticking
+		if (!GetWorld()->GetTimerManager().IsTimerActive(*RegenTimer) && !IsParallelPoolActive(VitalityCategory))
+			StartTimerForCategory(VitalityCategory);
+	}
+	BroadcastCategoryUpdated(VitalityCategory);
+	return true;
+}
+
+/**
+ * @brief Sets the passive regen rate (or drain rate, for hunger & thirst) of the category
+ * @param VitalityCategory The category to modify
+ * @param NewRate The amount restored (or drained) per timer tick
+ * @return True if the rate was set, false if not authority or invalid category
+ */
+bool UVitalityWelfareComponent::SetVitalityRegenRate(EVitalityCategory VitalityCategory, float NewRate)
+{
+	if (!GetOwner()->HasAuthority())
+		return false;
+	switch(VitalityCategory)
+	{
+	case EVitalityCategory::HEALTH:		HealthRegenAtRest_		= NewRate; break;
+	case EVitalityCategory::STAMINA:	StaminaRegenAtRest_		= NewRate; break;
+	case EVitalityCategory::MAGIC:		MagicRegenAtRest_		= NewRate; break;
+	case EVitalityCategory::THIRST:		HydrationDrainAtRest_	= NewRate; break;
+	case EVitalityCategory::HUNGER:		CaloriesDrainAtRest_	= NewRate; break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+void UVitalityWelfareComponent::BroadcastCategoryUpdated(EVitalityCategory VitalityCategory)
+{
+	INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
+	switch(VitalityCategory)
+	{
+	case EVitalityCategory::HEALTH:
+		OnHealthUpdated.Broadcast(HealthCurrent_, HealthMax_, GetHealthPercent());				break;
+	case EVitalityCategory::STAMINA:
+		OnStaminaUpdated.Broadcast(StaminaCurrent_, StaminaMax_, GetStaminaPercent());			break;
+	case EVitalityCategory::MAGIC:
+		OnMagicUpdated.Broadcast(MagicCurrent_, MagicMax_, GetMagicPercent());					break;
+	case EVitalityCategory::THIRST:
+		OnHydrationUpdated.Broadcast(HydrationCurrent_, HydrationMax_, GetHydrationPercent());	break;
+	case EVitalityCategory::HUNGER:
+		OnCaloriesUpdated.Broadcast(CaloriesCurrent_, CaloriesMax_, GetHungerPercent());		break;
+	default:
+		break;
+	}
+}
 
 void UVitalityWelfareComponent::Server_InitializeHealthSubsystem_Implementation(bool UseSubsystem, float NowValue,
 																				float MaxValue, float RegenRate)
@@ -614,7 +1173,7 @@ void UVitalityWelfareComponent::Server_InitializeSurvivalSubsystem_Implementatio
 		HydrationDrainAtRest_	= PassiveHydrationDrain		> 0.f	? PassiveHydrationDrain		: 0.082;
 		HydrationTimerTickRate_	= HydrationTimerTickRate	> 0.f	? HydrationTimerTickRate	: 0.5;
 
-		if (HydrationCurrent_ > 0.f)
+		if (HydrationCurrent_ > 0.f && !StartParallelPool(EVitalityCategory::THIRST))
 		{
 			FTimerDelegate InitDelegate;
 			InitDelegate.BindUObject(this, &UVitalityWelfareComponent::TickHydration);
@@ -626,7 +1185,7 @@ void UVitalityWelfareComponent::Server_InitializeSurvivalSubsystem_Implementatio
 		CaloriesDrainAtRest_	= PassiveHungerDrain	> 0.f	? PassiveHungerDrain	: 0.082;
 		HungerTimerTickRate_	= CaloriesTimerTickRate	> 0.f	? CaloriesTimerTickRate	: 0.5;
 
-		if (CaloriesCurrent_ > 0.f)
+		if (CaloriesCurrent_ > 0.f && !StartParallelPool(EVitalityCategory::HUNGER))
 		{
 			FTimerDelegate InitDelegate;
 			InitDelegate.BindUObject(this, &UVitalityWelfareComponent::TickCalories);
@@ -646,30 +1205,33 @@ void UVitalityWelfareComponent::Server_InitializeSurvivalSubsystem_Implementatio
 void UVitalityWelfareComponent::BeginPlay()
 {
 	Super::BeginPlay();
+	if (UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this))
+		VitalityHandle_ = VitalitySubsystem->RegisterComponent(this);
+
+	// Fill the replicated block before the owner first replicates
+	if (GetOwner()->HasAuthority())
+		PublishSnapshot();
+}
+
+void UVitalityWelfareComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this))
+		VitalitySubsystem->UnregisterComponent(this);
+	VitalityHandle_ = FVitalityHandle();
+	Super::EndPlay(EndPlayReason);
 }
 
 void UVitalityWelfareComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 	
-	DOREPLIFETIME(UVitalityWelfareComponent, DamageHistory_);
-	DOREPLIFETIME(UVitalityWelfareComponent, IsDead_);
-	DOREPLIFETIME(UVitalityWelfareComponent, CombatState_);
-	
-	DOREPLIFETIME(UVitalityWelfareComponent, HealthCurrent_);
-	DOREPLIFETIME(UVitalityWelfareComponent, HealthMax_);
-	
-	DOREPLIFETIME(UVitalityWelfareComponent, MagicCurrent_);
-	DOREPLIFETIME(UVitalityWelfareComponent, MagicMax_);
+	DOREPLIFETIME_CONDITION(UVitalityWelfareComponent, DamageHistory_,	COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(UVitalityWelfareComponent, IsDead_,			COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(UVitalityWelfareComponent, CombatState_,		COND_OwnerOnly);
 	
-	DOREPLIFETIME(UVitalityWelfareComponent, StaminaCurrent_);
-	DOREPLIFETIME(UVitalityWelfareComponent, StaminaMax_);
-	
-	DOREPLIFETIME(UVitalityWelfareComponent, CaloriesCurrent_);
-	DOREPLIFETIME(UVitalityWelfareComponent, CaloriesMax_);
-	
-	DOREPLIFETIME(UVitalityWelfareComponent, HydrationCurrent_);
-	DOREPLIFETIME(UVitalityWelfareComponent, HydrationMax_);
+	DOREPLIFETIME_CONDITION(UVitalityWelfareComponent, ReplicatedPools_,	COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(UVitalityWelfareComponent, ReplicatedTrend_,	COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(UVitalityWelfareComponent, ReplicatedSummary_,	COND_SkipOwner);
 }
 
 /**
@@ -681,8 +1243,8 @@ void UVitalityWelfareComponent::GetLifetimeReplicatedProps(TArray<FLifetimePrope
 void UVitalityWelfareComponent::InitializeTimer(FTimerHandle& TimerHandle,
 		FTimerDelegate TimerDelegate, float TickRate) const
 {
-	if (GetWorld()->GetTimerManager().TimerExists(TimerHandle))
-		TimerHandle.Invalidate();
+	// Cleared rather than invalidated, or the old timer keeps firing alongside the new one
+	GetWorld()->GetTimerManager().ClearTimer(TimerHandle);
 
 	const float managerTickRate = TickRate <= 0.f ? 1.f : TickRate;
 	GetWorld()->GetTimerManager().SetTimer(TimerHandle,	TimerDelegate,
@@ -695,126 +1257,154 @@ void UVitalityWelfareComponent::InitializeTimer(FTimerHandle& TimerHandle,
  */
 void UVitalityWelfareComponent::CancelTimer(FTimerHandle& TimerHandle) const
 {
-	if (GetWorld()->GetTimerManager().TimerExists(TimerHandle))
-	{
-		if (TimerHandle.IsValid())
-			TimerHandle.Invalidate();
-	}
+	// Invalidates the handle as well
+	GetWorld()->GetTimerManager().ClearTimer(TimerHandle);
 }
 
 void UVitalityWelfareComponent::TickStamina()
 {
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityTickWelfare);
+	INC_DWORD_STAT(STAT_VitalityTimersFired);
 	// If stamina is fully regenerated, kill the timer. It's not needed anymore.
-	if (StaminaCurrent_ >= StaminaMax_)
-	{
+	if (StepPool(EVitalityCategory::STAMINA))
 		CancelTimer(StaminaTimer_);
-		StaminaCurrent_ = StaminaMax_;
-	}
-	else
-		StaminaCurrent_ += StaminaRegenAtRest_;
 }
 
 void UVitalityWelfareComponent::TickHealth()
 {
-	if (HealthCurrent_ > 0.f)
-	{
-		if (HealthCurrent_ < HealthMax_)
-		{
-			// Current calories percent
-			const float HungerPercent = GetHungerPercent();
-
-			// If hunger is above 40%, allow full regeneration
-			if (HungerPercent >= 0.4)
-			{
-				HealthCurrent_ += HealthRegenAtRest_;	
-			}
-			// If it's below 40%, cap regen to hunger value
-			else
-			{
-				// Health can regen up to twice the percentage of calories
-				if ( ((HealthCurrent_/HealthMax_)*0.4) < HungerPercent )
-				{
-					HealthCurrent_ += HealthRegenAtRest_;
-				}
-			}
-		}
-		else if (HealthCurrent_ > HealthMax_)
-		{
-			CancelTimer(HealthTimer_);
-			HealthCurrent_ = HealthMax_;
-		}
-	}
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityTickWelfare);
+	INC_DWORD_STAT(STAT_VitalityTimersFired);
+	if (StepPool(EVitalityCategory::HEALTH))
+		CancelTimer(HealthTimer_);
 }
 
 void UVitalityWelfareComponent::TickMagic()
 {
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityTickWelfare);
+	INC_DWORD_STAT(STAT_VitalityTimersFired);
 }
 
 void UVitalityWelfareComponent::TickCalories()
 {
-	if (CaloriesCurrent_ > 0.f)
-	{
-		CaloriesCurrent_ -= CaloriesDrainAtRest_;
-		if (CaloriesCurrent_ <= 0.f)
-		{
-			CancelTimer(CaloriesTimer_);
-			CaloriesCurrent_ = 0.f;
-		}
-	}
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityTickWelfare);
+	INC_DWORD_STAT(STAT_VitalityTimersFired);
+	if (StepPool(EVitalityCategory::HUNGER))
+		CancelTimer(CaloriesTimer_);
 }
 
 void UVitalityWelfareComponent::TickHydration()
 {
-	if (HydrationCurrent_ > 0.f)
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityTickWelfare);
+	INC_DWORD_STAT(STAT_VitalityTimersFired);
+	if (StepPool(EVitalityCategory::THIRST))
+		CancelTimer(HydrationTimer_);
+}
+
+bool UVitalityWelfareComponent::StepPool(EVitalityCategory VitalityCategory)
+{
+	switch(VitalityCategory)
 	{
-		HydrationCurrent_ -= HydrationDrainAtRest_;
-		if (HydrationCurrent_ <= 0.f)
-		{
-			HydrationCurrent_ = 0.f;
-			CancelTimer(HydrationTimer_);
-		}
+	case EVitalityCategory::HEALTH:
+		// Below 40% hunger, health can only regen up to a share of the calories left
+		return FVitalityPoolMath::RegenerateHealth(HealthCurrent_, HealthMax_, HealthRegenAtRest_, GetHungerPercent());
+	case EVitalityCategory::STAMINA:
+		return FVitalityPoolMath::Regenerate(StaminaCurrent_, StaminaMax_, StaminaRegenAtRest_);
+	case EVitalityCategory::HUNGER:
+		return FVitalityPoolMath::Drain(CaloriesCurrent_, CaloriesDrainAtRest_);
+	case EVitalityCategory::THIRST:
+		return FVitalityPoolMath::Drain(HydrationCurrent_, HydrationDrainAtRest_);
+	default: // Magic does not regenerate passively
+		return false;
 	}
 }
 
-void UVitalityWelfareComponent::SetCombatState(ECombatState CombatState)
+float UVitalityWelfareComponent::GetPoolTickRate(EVitalityCategory VitalityCategory) const
 {
-	const ECombatState OldCombatState = GetCombatState();
-	float CombatTimer = 0.f;
-		
-	// Everytime hostile action is taken, reset the timer
-	if (CombatState == ECombatState::ENGAGED || CombatState == ECombatState::ALERT)
+	float TickRate = 1.f;
+	switch(VitalityCategory)
 	{
-		if (CombatTimer_.IsValid())
-			CombatTimer_.Invalidate();
-		CombatTimer = 10.f;
+	case EVitalityCategory::HEALTH:		TickRate = HealthTimerTickRate_;	break;
+	case EVitalityCategory::STAMINA:	TickRate = StaminaTimerTickRate_;	break;
+	case EVitalityCategory::MAGIC:		TickRate = MagicTimerTickRate_;		break;
+	case EVitalityCategory::THIRST:		TickRate = HydrationTimerTickRate_;	break;
+	case EVitalityCategory::HUNGER:		TickRate = HungerTimerTickRate_;	break;
+	default:
+		break;
 	}
-		
-	if (GetCombatState() != CombatState)
+	// The same fallback the timers use
+	return TickRate <= 0.f ? 1.f : TickRate;
+}
+
+bool UVitalityWelfareComponent::StartParallelPool(EVitalityCategory VitalityCategory)
+{
+	if (VitalityCategory == EVitalityCategory::MAX)
+		return false;
+	const UVitalitySubsystem* VitalitySubsystem = UVitalitySubsystem::Get(this);
+	if (VitalitySubsystem == nullptr || !VitalitySubsystem->IsParallelUpdate())
+		return false;
+	
+	// Restarting a pool restarts its interval, the same as resetting its timer
+	ParallelPools_ |= 1 << static_cast<uint8>(VitalityCategory);
+	ParallelElapsed_[static_cast<int32>(VitalityCategory)] = 0.f;
+	bPoolsPending_ = true;
+	return true;
+}
+
+bool UVitalityWelfareComponent::IsParallelPoolActive(EVitalityCategory VitalityCategory) const
+{
+	return (ParallelPools_ & (1 << static_cast<uint8>(VitalityCategory))) != 0;
+}
+
+/**
+ * @brief Steps every parallel pool once for each of its intervals that passed. Called by the
+ *        vitality subsystem from a worker thread, so nothing outside the component is touched.
+ * @param DeltaSeconds The time since the last update
+ */
+void UVitalityWelfareComponent::IntegratePools(float DeltaSeconds)
+{
+	for (int32 Pool = 0; Pool < static_cast<int32>(EVitalityCategory::MAX); Pool++)
 	{
-		CombatState_ = CombatState;
-		if (CombatState != ECombatState::ENGAGED)
-		{
-			// Player has either acquired or sustained alertness
-			if (CombatState == ECombatState::ALERT)
-			{
-				CombatTimer = 3.f;
-			}
-			// Player is now engaged in combat
-			else if (CombatState == ECombatState::ENGAGED)
-			{
-				CombatTimer = 10.f;
-			}
-		}
-		else
+		const uint8 PoolBit = 1 << Pool;
+		if ((ParallelPools_ & PoolBit) == 0 || (PausedParallelPools_ & PoolBit) != 0)
+			continue;
+		
+		const EVitalityCategory VitalityCategory = static_cast<EVitalityCategory>(Pool);
+		const float TickRate = GetPoolTickRate(VitalityCategory);
+		ParallelElapsed_[Pool] += DeltaSeconds;
+		while (ParallelElapsed_[Pool] >= TickRate)
 		{
-			// Player has left combat and is coming down from engagement
-			if (CombatState == ECombatState::ALERT)
+			ParallelElapsed_[Pool] -= TickRate;
+			ParallelSteps_++;
+			if (StepPool(VitalityCategory))
 			{
-				CombatTimer = 10.f;
+				ParallelPools_ &= ~PoolBit;
+				break;
 			}
 		}
+	}
+}
+
+/**
+ * @brief Applies the side effects of the last IntegratePools() on the game thread.
+ *        The pools replicate and are snapshotted by value, so only the counters are left.
+ */
+void UVitalityWelfareComponent::ApplyIntegratedPools()
+{
+	check(IsInGameThread());
+	INC_DWORD_STAT_BY(STAT_VitalityTimersFired, ParallelSteps_);
+	ParallelSteps_ = 0;
+}
+
+void UVitalityWelfareComponent::SetCombatState(ECombatState CombatState)
+{
+	const ECombatState OldCombatState = GetCombatState();
+	// Everytime hostile action is taken, the countdown restarts
+	const float CombatTimer = FVitalityCombatMath::GetDecayTime(ToCombatLevel(OldCombatState), ToCombatLevel(CombatState));
+
+	if (OldCombatState != CombatState)
+	{
+		CombatState_ = CombatState;
 		OnCombatStateChanged.Broadcast(OldCombatState, GetCombatState());
-			
 	}
 
 	if (CombatTimer > 0.f)
@@ -825,85 +1415,271 @@ void UVitalityWelfareComponent::SetCombatState(ECombatState CombatState)
 		GetWorld()->GetTimerManager().SetTimer(CombatTimer_, this,
 			&UVitalityWelfareComponent::DecreaseCombatState, CombatTimer, false);
 	}
-	
 }
 
-void UVitalityWelfareComponent::OnRep_IsDeadChanged_Implementation(bool WasDeadBefore)
+void UVitalityWelfareComponent::OnRep_IsDeadChanged(bool WasDeadBefore)
 {
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityOnRepWelfare);
 	if (!WasDeadBefore)
 	{
 		OnDeath.Broadcast(nullptr);
+		INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
 	}
 }
 
-void UVitalityWelfareComponent::OnRep_CombatStateChanged_Implementation(ECombatState OldCombatState)
+void UVitalityWelfareComponent::OnRep_CombatStateChanged(ECombatState OldCombatState)
 {
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityOnRepWelfare);
+	INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
 	OnCombatStateChanged.Broadcast(OldCombatState, CombatState_);
 }
 
-void UVitalityWelfareComponent::OnRep_HealthValueChanged_Implementation(float OldValue)
+void UVitalityWelfareComponent::OnRep_PoolsChanged(const FVitalityPoolBlock& OldPools)
+{
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityOnRepWelfare);
+	FVitalityPoolBlock DisplayedPools;
+	WritePoolBlock(DisplayedPools);
+	ReadPoolBlock(ReplicatedPools_);
+	
+	const double WorldTime = GetWorld()->GetTimeSeconds();
+	uint8 ChangedPools = 0;
+	for (int i = 0; i < FVitalityPoolBlock::NumPools; i++)
+	{
+		const float Current = ReplicatedPools_.Current[i];
+		const float Maximum = ReplicatedPools_.Maximum[i];
+		if (Current == OldPools.Current[i] && Maximum == OldPools.Maximum[i])
+			continue;
+		ChangedPools |= 1 << i;
+
+		// Ease toward updates the server spaced out. Empty, full and a new maximum show at once.
+		// Moving pools are extrapolated from the new sample instead.
+		const FVitalityReplicationPolicy& Policy = GetReplicationPolicy(static_cast<EVitalityCategory>(i));
+		const uint8 PoolBit = 1 << i;
+		if (Policy.bInterpolate && Policy.MinInterval > 0.f && Maximum == OldPools.Maximum[i]
+			&& Current > 0.f && Current < Maximum && (ExtrapolatingPools_ & PoolBit) == 0)
+		{
+			InterpFrom_[i]		= DisplayedPools.Current[i];
+			InterpStart_[i]		= WorldTime;
+			InterpolatingPools_	|= PoolBit;
+		}
+		else
+		{
+			InterpolatingPools_	&= ~PoolBit;
+		}
+	}
+	
+	// Listeners read the pools, so they must already show the displayed values rather than the targets
+	if ((InterpolatingPools_ | ExtrapolatingPools_) != 0)
+		AdvanceDisplayedPools(WorldTime);
+	for (int i = 0; i < FVitalityPoolBlock::NumPools; i++)
+	{
+		if ((ChangedPools & (1 << i)) != 0)
+			BroadcastCategoryUpdated(static_cast<EVitalityCategory>(i));
+	}
+}
+
+void UVitalityWelfareComponent::OnRep_PoolTrendChanged(const FVitalityPoolTrend& OldTrend)
 {
-	float CurrentValue = 0, MaximumValue = 0;
-	const float ValueAsPercent = GetCurrentHealth(CurrentValue, MaximumValue);
-	OnHealthUpdated.Broadcast(HealthCurrent_, HealthMax_, ValueAsPercent);
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityOnRepWelfare);
+	ExtrapolatingPools_ = 0;
+	for (int i = 0; i < FVitalityPoolBlock::NumPools; i++)
+	{
+		if (ReplicatedTrend_.Rate[i] != 0.f)
+			ExtrapolatingPools_ |= 1 << i;
+	}
+	// A pool that starts moving is extrapolated from its sample, not eased toward it
+	InterpolatingPools_ &= ~ExtrapolatingPools_;
+	AdvanceDisplayedPools(GetWorld()->GetTimeSeconds());
 }
-void UVitalityWelfareComponent::OnRep_HealthMaxChanged_Implementation(float OldValue)
+
+bool UVitalityWelfareComponent::UpdateReplicatedPools()
 {
-	float CurrentValue = 0, MaximumValue = 0;
-	const float ValueAsPercent = GetCurrentHealth(CurrentValue, MaximumValue);
-	OnHealthUpdated.Broadcast(HealthCurrent_, HealthMax_, ValueAsPercent);
+	const double WorldTime = GetWorld()->GetTimeSeconds();
+	FVitalityPoolBlock Pools;
+	WritePoolBlock(Pools);
+
+	bool bHeldBack = false;
+	for (int i = 0; i < FVitalityPoolBlock::NumPools; i++)
+	{
+		const EVitalityCategory VitalityCategory = static_cast<EVitalityCategory>(i);
+		const float Current		= Pools.Current[i];
+		const float Maximum		= Pools.Maximum[i];
+		const float Rate		= GetPoolRate(VitalityCategory);
+		const float SentMaximum	= ReplicatedPools_.Maximum[i];
+		const float SentRate	= ReplicatedTrend_.Rate[i];
+		// What the owner is showing right now. Measuring against it, rather than against the
+		// last value sent, means a pool moving at its replicated rate never needs sending.
+		const float Predicted	= ReplicatedTrend_.Extrapolate(ReplicatedPools_, i, WorldTime);
+		if (Current == Predicted && Maximum == SentMaximum && Rate == SentRate)
+			continue;
+
+		const FVitalityReplicationPolicy& Policy = GetReplicationPolicy(VitalityCategory);
+		const bool bForced = Maximum != SentMaximum || Rate != SentRate
+			|| (Current <= 0.f) != (Predicted <= 0.f)
+			|| (Current >= Maximum) != (Predicted >= SentMaximum);
+		const bool bPastDeadband = FMath::Abs(Current - Predicted) > Policy.Deadband * Maximum;
+		if (!bPastDeadband && !bForced)
+			continue;
+
+		if (bForced || WorldTime - PoolSentTime_[i] >= Policy.MinInterval)
+		{
+			ReplicatedPools_.Current[i]		= Current;
+			ReplicatedPools_.Maximum[i]		= Maximum;
+			ReplicatedTrend_.Rate[i]		= Rate;
+			ReplicatedTrend_.Timestamp[i]	= WorldTime;
+			PoolSentTime_[i] = WorldTime;
+			INC_DWORD_STAT(STAT_VitalityPoolsReplicated);
+		}
+		else
+		{
+			bHeldBack = true;
+			INC_DWORD_STAT(STAT_VitalityPoolsHeldBack);
+		}
+	}
+	return bHeldBack;
+}
+
+void UVitalityWelfareComponent::UpdateDisplayedPools()
+{
+	if ((InterpolatingPools_ | ExtrapolatingPools_) != 0)
+		AdvanceDisplayedPools(GetWorld()->GetTimeSeconds());
 }
 
-void UVitalityWelfareComponent::OnRep_MagicValueChanged_Implementation(float OldValue)
+void UVitalityWelfareComponent::AdvanceDisplayedPools(double WorldTime)
 {
-	float CurrentValue = 0, MaximumValue = 0;
-	const float ValueAsPercent = GetCurrentMagic(CurrentValue, MaximumValue);
-	OnMagicUpdated.Broadcast(MagicCurrent_, MagicMax_, ValueAsPercent);
+	const double ServerTime = GetServerWorldTime();
+	FVitalityPoolBlock DisplayedPools = ReplicatedPools_;
+	for (int i = 0; i < FVitalityPoolBlock::NumPools; i++)
+	{
+		const uint8 PoolBit = 1 << i;
+		if ((ExtrapolatingPools_ & PoolBit) != 0)
+		{
+			DisplayedPools.Current[i] = ReplicatedTrend_.Extrapolate(ReplicatedPools_, i, ServerTime);
+			continue;
+		}
+		if ((InterpolatingPools_ & PoolBit) == 0)
+			continue;
+		
+		const float Duration = GetReplicationPolicy(static_cast<EVitalityCategory>(i)).MinInterval;
+		const float Alpha = Duration > 0.f ? FMath::Clamp(static_cast<float>((WorldTime - InterpStart_[i]) / Duration), 0.f, 1.f) : 1.f;
+		DisplayedPools.Current[i] = FMath::Lerp(InterpFrom_[i], ReplicatedPools_.Current[i], Alpha);
+		if (Alpha >= 1.f)
+			InterpolatingPools_ &= ~PoolBit;
+	}
+	ReadPoolBlock(DisplayedPools);
 }
-void UVitalityWelfareComponent::OnRep_MagicMaxChanged_Implementation(float OldValue)
+
+float UVitalityWelfareComponent::GetPoolRate(EVitalityCategory VitalityCategory) const
 {
-	float CurrentValue = 0, MaximumValue = 0;
-	const float ValueAsPercent = GetCurrentMagic(CurrentValue, MaximumValue);
-	OnMagicUpdated.Broadcast(MagicCurrent_, MagicMax_, ValueAsPercent);
+	const FTimerHandle* PoolTimer = nullptr;
+	float StepAmount	= 0.f;
+	float Digestion		= 0.f;
+	switch(VitalityCategory)
+	{
+	case EVitalityCategory::STAMINA:
+		PoolTimer = &StaminaTimer_;		StepAmount = StaminaRegenAtRest_;
+		break;
+	case EVitalityCategory::HUNGER:
+		PoolTimer = &CaloriesTimer_;	StepAmount = -CaloriesDrainAtRest_;		Digestion = CaloriesDigestionRate_;
+		break;
+	case EVitalityCategory::THIRST:
+		PoolTimer = &HydrationTimer_;	StepAmount = -HydrationDrainAtRest_;	Digestion = HydrationDigestionRate_;
+		break;
+	default:
+		// Magic does not regenerate passively, and health regen is capped by hunger, so neither
+		// is extrapolated. Their changes replicate as they happen.
+		return 0.f;
+	}
+
+	const uint8 PoolBit = 1 << static_cast<uint8>(VitalityCategory);
+	const bool bIsStepping = (ParallelPools_ & PoolBit) != 0
+		? (PausedParallelPools_ & PoolBit) == 0
+		: GetWorld()->GetTimerManager().IsTimerActive(*PoolTimer);
+	return Digestion + (bIsStepping ? StepAmount / GetPoolTickRate(VitalityCategory) : 0.f);
 }
 
-void UVitalityWelfareComponent::OnRep_StaminaValueChanged_Implementation(float OldValue)
+double UVitalityWelfareComponent::GetServerWorldTime() const
 {
-	float CurrentValue = 0, MaximumValue = 0;
-	const float ValueAsPercent = GetCurrentStamina(CurrentValue, MaximumValue);
-	OnStaminaUpdated.Broadcast(StaminaCurrent_, StaminaMax_, ValueAsPercent);
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	return GameState != nullptr ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
 }
-void UVitalityWelfareComponent::OnRep_StaminaMaxChanged_Implementation(float OldValue)
+
+const FVitalityReplicationPolicy& UVitalityWelfareComponent::GetReplicationPolicy(EVitalityCategory VitalityCategory) const
 {
-	float CurrentValue = 0, MaximumValue = 0;
-	const float ValueAsPercent = GetCurrentStamina(CurrentValue, MaximumValue);
-	OnStaminaUpdated.Broadcast(StaminaCurrent_, StaminaMax_, ValueAsPercent);
+	switch(VitalityCategory)
+	{
+	case EVitalityCategory::STAMINA:	return StaminaReplication;
+	case EVitalityCategory::MAGIC:		return MagicReplication;
+	case EVitalityCategory::HUNGER:		return HungerReplication;
+	case EVitalityCategory::THIRST:		return ThirstReplication;
+	default:							return HealthReplication;
+	}
 }
 
-void UVitalityWelfareComponent::OnRep_CaloriesValueChanged_Implementation(float OldValue)
+void UVitalityWelfareComponent::OnRep_SummaryChanged(const FVitalityProxySummary& OldSummary)
 {
-	float CurrentValue = 0, MaximumValue = 0;
-	const float ValueAsPercent = GetCurrentHunger(CurrentValue, MaximumValue);
-	OnCaloriesUpdated.Broadcast(CaloriesCurrent_, CaloriesMax_, ValueAsPercent);
+	VITALITY_SCOPE_CYCLE_COUNTER(STAT_VitalityOnRepWelfare);
+	
+	// Proxies never receive the maximums, so each pool is kept on the scale the component started with
+	auto ApplyPercent = [this](EVitalityCategory Category, float& Current, float& Maximum, float Percent, bool bChanged)
+	{
+		if (Maximum <= 0.f)
+			Maximum = 1.f;
+		Current = Percent * Maximum;
+		if (bChanged)
+			BroadcastCategoryUpdated(Category);
+	};
+	ApplyPercent(EVitalityCategory::HEALTH, HealthCurrent_, HealthMax_, ReplicatedSummary_.GetHealthPercent(),
+		ReplicatedSummary_.HealthPercent != OldSummary.HealthPercent);
+	ApplyPercent(EVitalityCategory::STAMINA, StaminaCurrent_, StaminaMax_, ReplicatedSummary_.GetStaminaPercent(),
+		ReplicatedSummary_.StaminaPercent != OldSummary.StaminaPercent);
+	ApplyPercent(EVitalityCategory::MAGIC, MagicCurrent_, MagicMax_, ReplicatedSummary_.GetMagicPercent(),
+		ReplicatedSummary_.MagicPercent != OldSummary.MagicPercent);
+
+	const bool WasDeadBefore = IsDead_;
+	IsDead_ = ReplicatedSummary_.Status == EVitalityStatus::DEAD;
+	if (IsDead_ && !WasDeadBefore)
+	{
+		OnDeath.Broadcast(nullptr);
+		INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
+	}
+
+	if (ReplicatedSummary_.CombatState != CombatState_)
+	{
+		const ECombatState OldCombatState = CombatState_;
+		CombatState_ = ReplicatedSummary_.CombatState;
+		OnCombatStateChanged.Broadcast(OldCombatState, CombatState_);
+		INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
+	}
 }
-void UVitalityWelfareComponent::OnRep_CaloriesMaxChanged_Implementation(float OldValue)
+
+void UVitalityWelfareComponent::WritePoolBlock(FVitalityPoolBlock& OutPools) const
 {
-	float CurrentValue = 0, MaximumValue = 0;
-	const float ValueAsPercent = GetCurrentHunger(CurrentValue, MaximumValue);
-	OnCaloriesUpdated.Broadcast(CaloriesCurrent_, CaloriesMax_, ValueAsPercent);
+	for (int i = 0; i < FVitalityPoolBlock::NumPools; i++)
+		GetVitalityStatData(static_cast<EVitalityCategory>(i), OutPools.Current[i], OutPools.Maximum[i]);
 }
 
-void UVitalityWelfareComponent::OnRep_HydrationValueChanged_Implementation(float OldValue)
+void UVitalityWelfareComponent::ReadPoolBlock(const FVitalityPoolBlock& Pools)
 {
-	float CurrentValue = 0, MaximumValue = 0;
-	const float ValueAsPercent = GetCurrentHydration(CurrentValue, MaximumValue);
-	OnHydrationUpdated.Broadcast(HydrationCurrent_, HydrationMax_, ValueAsPercent);
+	constexpr int Health	= static_cast<int>(EVitalityCategory::HEALTH);
+	constexpr int Stamina	= static_cast<int>(EVitalityCategory::STAMINA);
+	constexpr int Magic		= static_cast<int>(EVitalityCategory::MAGIC);
+	constexpr int Hunger	= static_cast<int>(EVitalityCategory::HUNGER);
+	constexpr int Thirst	= static_cast<int>(EVitalityCategory::THIRST);
+	HealthCurrent_		= Pools.Current[Health];	HealthMax_		= Pools.Maximum[Health];
+	StaminaCurrent_		= Pools.Current[Stamina];	StaminaMax_		= Pools.Maximum[Stamina];
+	MagicCurrent_		= Pools.Current[Magic];		MagicMax_		= Pools.Maximum[Magic];
+	CaloriesCurrent_	= Pools.Current[Hunger];	CaloriesMax_	= Pools.Maximum[Hunger];
+	HydrationCurrent_	= Pools.Current[Thirst];	HydrationMax_	= Pools.Maximum[Thirst];
 }
-void UVitalityWelfareComponent::OnRep_HydrationMaxChanged_Implementation(float OldValue)
+
+void UVitalityWelfareComponent::WriteSummary(FVitalityProxySummary& OutSummary) const
 {
-	float CurrentValue = 0, MaximumValue = 0;
-	const float ValueAsPercent = GetCurrentHydration(CurrentValue, MaximumValue);
-	OnHydrationUpdated.Broadcast(HydrationCurrent_, HydrationMax_, ValueAsPercent);
+	OutSummary.SetHealthPercent(GetHealthPercent());
+	OutSummary.SetStaminaPercent(GetStaminaPercent());
+	OutSummary.SetMagicPercent(GetMagicPercent());
+	OutSummary.Status		= GetVitalityStatus();
+	OutSummary.CombatState	= CombatState_;
 }
 
 /**
@@ -915,6 +1691,12 @@ void UVitalityWelfareComponent::Multicast_DamageTaken_Implementation(
 		AActor* DamageInstigator, float DamageTaken)
 {
 	OnDamageTaken.Broadcast(DamageInstigator, DamageTaken);
+	INC_DWORD_STAT(STAT_VitalityDelegatesBroadcast);
+	if (ShowDamageNumbers)
+	{
+		if (UVitalityDamageNumbers* DamageNumbers = UVitalityDamageNumbers::Get(this))
+			DamageNumbers->AddDamageNumber(GetOwner(), DamageTaken);
+	}
 }
 
 /**
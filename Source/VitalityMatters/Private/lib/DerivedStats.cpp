@@ -0,0 +1,245 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "lib/DerivedStats.h"
+
+
+/**
+ * @brief Compiles the given formulas into a topologically sorted dependency graph
+ * @param Formulas The formulas to compile. Names must be unique.
+ * @return True on success. False if a name is duplicated or the formulas contain a cycle.
+ */
+bool FVitalityDerivedStatGraph::Compile(const TArray<FStDerivedStatFormula>& Formulas)
+{
+	Reset();
+
+	// Index the formulas by name so derived terms can be resolved
+	TMap<FName, int32> FormulaByName;
+	for (int i = 0; i < Formulas.Num(); i++)
+	{
+		const FName StatName = Formulas[i].StatName;
+		if (StatName.IsNone())
+		{
+			UE_LOG(LogTemp, Error, TEXT("DerivedStats: Formula at index %d has no StatName. Skipping."), i);
+			continue;
+		}
+		if (FormulaByName.Contains(StatName))
+		{
+			UE_LOG(LogTemp, Error, TEXT("DerivedStats: Duplicate derived stat '%s'."), *StatName.ToString());
+			return false;
+		}
+		FormulaByName.Add(StatName, i);
+	}
+
+	// Count the incoming derived edges of every formula (Kahn's algorithm)
+	TMap<int32, int32> InDegree;
+	TMap<int32, TArray<int32>> Readers;
+	for (const TPair<FName, int32>& Entry : FormulaByName)
+	{
+		InDegree.FindOrAdd(Entry.Value);
+		for (const FStDerivedStatTerm& Term : Formulas[Entry.Value].Terms)
+		{
+			if (Term.Source != EDerivedStatSource::DERIVED)
+				continue;
+			const int32* SourceFormula = FormulaByName.Find(Term.DerivedStat);
+			if (SourceFormula == nullptr)
+			{
+				UE_LOG(LogTemp, Error, TEXT("DerivedStats: '%s' reads unknown derived stat '%s'."),
+					*Entry.Key.ToString(), *Term.DerivedStat.ToString());
+				continue;
+			}
+			InDegree.FindOrAdd(Entry.Value) += 1;
+			Readers.FindOrAdd(*SourceFormula).Add(Entry.Value);
+		}
+	}
+
+	TArray<int32> Ready;
+	for (const TPair<int32, int32>& Entry : InDegree)
+	{
+		if (Entry.Value == 0)
+			Ready.Add(Entry.Key);
+	}
+
+	TArray<int32> Sorted;
+	while (Ready.Num() > 0)
+	{
+		const int32 FormulaIndex = Ready.Pop(false);
+		Sorted.Add(FormulaIndex);
+		if (const TArray<int32>* FormulaReaders = Readers.Find(FormulaIndex))
+		{
+			for (const int32 Reader : *FormulaReaders)
+			{
+				if (--InDegree[Reader] == 0)
+					Ready.Add(Reader);
+			}
+		}
+	}
+
+	if (Sorted.Num() != InDegree.Num())
+	{
+		UE_LOG(LogTemp, Error, TEXT("DerivedStats: Formulas contain a dependency cycle. Derived stats disabled."));
+		return false;
+	}
+
+	// Build the nodes in topological order
+	Nodes_.SetNum(Sorted.Num());
+	for (int i = 0; i < Sorted.Num(); i++)
+	{
+		Nodes_[i].Formula = Formulas[Sorted[i]];
+		NodeByName_.Add(Nodes_[i].Formula.StatName, i);
+	}
+
+	for (int i = 0; i < Nodes_.Num(); i++)
+	{
+		FNode& Node = Nodes_[i];
+		Node.TermNodes.Init(INDEX_NONE, Node.Formula.Terms.Num());
+		for (int t = 0; t < Node.Formula.Terms.Num(); t++)
+		{
+			const FStDerivedStatTerm& Term = Node.Formula.Terms[t];
+			if (Term.Source == EDerivedStatSource::DERIVED)
+			{
+				if (const int32* SourceNode = NodeByName_.Find(Term.DerivedStat))
+				{
+					Node.TermNodes[t] = *SourceNode;
+					Nodes_[*SourceNode].Dependents.AddUnique(i);
+				}
+				continue;
+			}
+
+			const int32 Index = Term.Source == EDerivedStatSource::CORE_STAT
+				? static_cast<int32>(Term.CoreStat) : static_cast<int32>(Term.DamageType);
+			InputDependents_.FindOrAdd(MakeInputKey(Term.Source, Term.Layer, Index)).AddUnique(i);
+		}
+	}
+
+	MarkAllDirty();
+	return true;
+}
+
+void FVitalityDerivedStatGraph::Reset()
+{
+	Nodes_.Empty();
+	NodeByName_.Empty();
+	InputDependents_.Empty();
+	NumDirty_ = 0;
+}
+
+SIZE_T FVitalityDerivedStatGraph::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = Nodes_.GetAllocatedSize() + NodeByName_.GetAllocatedSize()
+		+ InputDependents_.GetAllocatedSize();
+	for (const FNode& Node : Nodes_)
+	{
+		AllocatedSize += Node.Formula.Terms.GetAllocatedSize()
+			+ Node.TermNodes.GetAllocatedSize() + Node.Dependents.GetAllocatedSize();
+	}
+	for (const TPair<int32, TArray<int32>>& Readers : InputDependents_)
+		AllocatedSize += Readers.Value.GetAllocatedSize();
+	return AllocatedSize;
+}
+
+/**
+ * @brief Marks all formulas reading the given input as dirty
+ * @param Source The kind of input that changed
+ * @param Layer The stat layer that changed. Readers of the TOTAL layer are always marked.
+ * @param Index The core stat or damage type, as an int
+ */
+void FVitalityDerivedStatGraph::MarkInputDirty(EDerivedStatSource Source, EVitalityStatLayer Layer, int32 Index)
+{
+	if (const TArray<int32>* LayerReaders = InputDependents_.Find(MakeInputKey(Source, Layer, Index)))
+	{
+		for (const int32 NodeIndex : *LayerReaders)
+			MarkNodeDirty(NodeIndex);
+	}
+	if (Layer != EVitalityStatLayer::TOTAL)
+	{
+		if (const TArray<int32>* TotalReaders = InputDependents_.Find(
+				MakeInputKey(Source, EVitalityStatLayer::TOTAL, Index)))
+		{
+			for (const int32 NodeIndex : *TotalReaders)
+				MarkNodeDirty(NodeIndex);
+		}
+	}
+}
+
+void FVitalityDerivedStatGraph::MarkAllDirty()
+{
+	for (FNode& Node : Nodes_)
+		Node.bDirty = true;
+	NumDirty_ = Nodes_.Num();
+}
+
+void FVitalityDerivedStatGraph::MarkNodeDirty(int32 NodeIndex)
+{
+	if (!Nodes_[NodeIndex].bDirty)
+	{
+		Nodes_[NodeIndex].bDirty = true;
+		NumDirty_ += 1;
+	}
+}
+
+/**
+ * @brief Recomputes every dirty formula. Derived readers of a changed formula
+ *        are marked dirty and evaluated in the same pass.
+ * @param ReadInput Reads the current value of a core stat, bonus or resistance
+ * @param OutChanged Receives every derived stat whose value changed
+ */
+void FVitalityDerivedStatGraph::Evaluate(FInputReader ReadInput, TArray<FChangedStat>& OutChanged)
+{
+	if (NumDirty_ == 0)
+		return;
+
+	for (int i = 0; i < Nodes_.Num(); i++)
+	{
+		FNode& Node = Nodes_[i];
+		if (!Node.bDirty)
+			continue;
+
+		Node.bDirty = false;
+		NumDirty_ -= 1;
+
+		const FStDerivedStatFormula& Formula = Node.Formula;
+		float NewValue = Formula.BaseValue;
+		for (int t = 0; t < Formula.Terms.Num(); t++)
+		{
+			const FStDerivedStatTerm& Term = Formula.Terms[t];
+			float InputValue = 0.f;
+			switch (Term.Source)
+			{
+			case EDerivedStatSource::CORE_STAT:
+				InputValue = ReadInput(Term.Source, Term.Layer, static_cast<int32>(Term.CoreStat));
+				break;
+			case EDerivedStatSource::DAMAGE_BONUS:
+			case EDerivedStatSource::DAMAGE_RESIST:
+				InputValue = ReadInput(Term.Source, Term.Layer, static_cast<int32>(Term.DamageType));
+				break;
+			case EDerivedStatSource::DERIVED:
+				if (Node.TermNodes[t] != INDEX_NONE)
+					InputValue = Nodes_[Node.TermNodes[t]].Value;
+				break;
+			default:
+				break;
+			}
+			NewValue += InputValue * Term.Coefficient;
+		}
+
+		NewValue = FMath::Max(NewValue, Formula.MinValue);
+		if (Formula.MaxValue > 0.f)
+			NewValue = FMath::Min(NewValue, Formula.MaxValue);
+
+		if (!Node.bEvaluated || !FMath::IsNearlyEqual(NewValue, Node.Value))
+		{
+			Node.bEvaluated = true;
+			Node.Value = NewValue;
+			OutChanged.Add({Formula.StatName, Formula.Target, NewValue});
+			for (const int32 Dependent : Node.Dependents)
+				MarkNodeDirty(Dependent);
+		}
+	}
+}
+
+float FVitalityDerivedStatGraph::GetValue(FName StatName) const
+{
+	if (const int32* NodeIndex = NodeByName_.Find(StatName))
+		return Nodes_[*NodeIndex].Value;
+	return 0.f;
+}
@@ -0,0 +1,186 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "lib/NutritionRegistry.h"
+
+#include "Engine/AssetManager.h"
+#include "Engine/DataTable.h"
+#include "Engine/StreamableManager.h"
+#include "lib/VitalityDataBlob.h"
+#include "Misc/CoreDelegates.h"
+
+
+FNutritionRegistry& FNutritionRegistry::Get()
+{
+	static FNutritionRegistry Registry;
+	return Registry;
+}
+
+void FNutritionRegistry::StartPreload()
+{
+	// The asset manager only exists once the engine has initialized
+	if (UAssetManager::IsInitialized())
+	{
+		RequestTableLoad();
+		return;
+	}
+	if (!PostEngineInitHandle_.IsValid())
+	{
+		PostEngineInitHandle_ = FCoreDelegates::OnPostEngineInit.AddLambda([this]()
+		{
+			FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle_);
+			PostEngineInitHandle_.Reset();
+			RequestTableLoad();
+		});
+	}
+}
+
+void FNutritionRegistry::Shutdown()
+{
+	if (PostEngineInitHandle_.IsValid())
+	{
+		FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle_);
+		PostEngineInitHandle_.Reset();
+	}
+#if WITH_EDITOR
+	if (UDataTable* NutritionTable = NutritionTable_.Get())
+		NutritionTable->OnDataTableChanged().Remove(TableChangedHandle_);
+#endif
+	TableChangedHandle_.Reset();
+	
+	if (LoadHandle_.IsValid())
+	{
+		LoadHandle_->CancelHandle();
+		LoadHandle_.Reset();
+	}
+	NutritionTable_.Reset();
+	SpawnClasses_.Empty();
+	Rows_.Empty();
+	RowIndex_.Empty();
+	bIsReady_ = false;
+	bLoadFailed_ = false;
+}
+
+const FStNutritionData* FNutritionRegistry::Find(FName RowName)
+{
+	if (!bIsReady_ && !bLoadFailed_)
+		FlushPreload();
+
+	if (const int32* RowIndex = RowIndex_.Find(RowName))
+		return &Rows_[*RowIndex];
+	return nullptr;
+}
+
+void FNutritionRegistry::RequestTableLoad()
+{
+	if (LoadHandle_.IsValid())
+		return;
+	
+	// Dedicated servers with a cooked data blob never load the table
+	const FVitalityDataBlob& DataBlob = FVitalityDataBlob::Get();
+	if (DataBlob.IsOpen())
+	{
+		BuildIndexFromBlob(DataBlob);
+		return;
+	}
+	
+	LoadHandle_ = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		FSoftObjectPath(NutritionDataTable),
+		FStreamableDelegate::CreateRaw(this, &FNutritionRegistry::OnTableLoaded),
+		FStreamableManager::AsyncLoadHighPriority);
+}
+
+void FNutritionRegistry::OnTableLoaded()
+{
+	if (bIsReady_ || bLoadFailed_)
+		return;
+	UDataTable* NutritionTable = LoadHandle_.IsValid() ? Cast<UDataTable>(LoadHandle_->GetLoadedAsset()) : nullptr;
+	if (!IsValid(NutritionTable))
+	{
+		bLoadFailed_ = true;
+		UE_LOG(LogTemp, Error, TEXT("FNutritionRegistry: Unable to load DataTable '%s'. Nutrition lookups will fail."),
+			*NutritionDataTable);
+		return;
+	}
+
+	NutritionTable_ = NutritionTable;
+	BuildIndex(NutritionTable);
+
+#if WITH_EDITOR
+	// Edits and reimports change the rows in place, so the index has to follow
+	TableChangedHandle_ = NutritionTable->OnDataTableChanged().AddLambda([this]()
+	{
+		if (const UDataTable* ChangedTable = NutritionTable_.Get())
+			BuildIndex(ChangedTable);
+	});
+#endif
+}
+
+void FNutritionRegistry::FlushPreload()
+{
+	check(IsInGameThread());
+	if (!LoadHandle_.IsValid())
+	{
+		if (!UAssetManager::IsInitialized())
+			return;
+		RequestTableLoad();
+		if (bIsReady_)
+			return;
+	}
+	
+	if (!LoadHandle_.IsValid())
+		return;
+	UE_LOG(LogTemp, Warning, TEXT("FNutritionRegistry: Lookup before the nutrition table finished streaming"));
+	LoadHandle_->WaitUntilComplete();
+	
+	// The completion delegate may not have run yet if the wait finished the load itself
+	OnTableLoaded();
+}
+
+void FNutritionRegistry::BuildIndex(const UDataTable* NutritionTable)
+{
+	Rows_.Reset();
+	RowIndex_.Reset();
+
+	const TMap<FName, uint8*>& RowMap = NutritionTable->GetRowMap();
+	Rows_.Reserve(RowMap.Num());
+	RowIndex_.Reserve(RowMap.Num());
+	for (const TPair<FName, uint8*>& Row : RowMap)
+	{
+		RowIndex_.Add(Row.Key, Rows_.Num());
+		Rows_.Add(*reinterpret_cast<const FStNutritionData*>(Row.Value));
+	}
+	bIsReady_ = true;
+}
+
+void FNutritionRegistry::BuildIndexFromBlob(const FVitalityDataBlob& DataBlob)
+{
+	const TConstArrayView<FVitalityBlobNutrition> BlobRows = DataBlob.GetNutrition();
+	Rows_.Reset(BlobRows.Num());
+	RowIndex_.Reset();
+	RowIndex_.Reserve(BlobRows.Num());
+	SpawnClasses_.Reset();
+	
+	for (const FVitalityBlobNutrition& BlobRow : BlobRows)
+	{
+		RowIndex_.Add(FName(UTF8_TO_TCHAR(DataBlob.GetString(BlobRow.NameOffset))), Rows_.Num());
+		FStNutritionData& Row = Rows_.AddDefaulted_GetRef();
+		Row.properName		= FName(UTF8_TO_TCHAR(DataBlob.GetString(BlobRow.ProperNameOffset)));
+		Row.calories		= BlobRow.Calories;
+		Row.hydration		= BlobRow.Hydration;
+		Row.digestSeconds	= BlobRow.DigestSeconds;
+		Row.addBenefit		= BlobRow.AddBenefit;
+		Row.benefitCount	= BlobRow.BenefitCount;
+		Row.addDetriment	= BlobRow.AddDetriment;
+		Row.detrimentCount	= BlobRow.DetrimentCount;
+		if (BlobRow.SpawnClassOffset != 0)
+		{
+			const FSoftClassPath SpawnClassPath(UTF8_TO_TCHAR(DataBlob.GetString(BlobRow.SpawnClassOffset)));
+			if (UClass* SpawnClass = SpawnClassPath.TryLoadClass<AActor>())
+			{
+				Row.optionalSpawnActor = SpawnClass;
+				SpawnClasses_.Emplace(SpawnClass);
+			}
+		}
+	}
+	bIsReady_ = true;
+}
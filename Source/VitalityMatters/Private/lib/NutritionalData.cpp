@@ -1,6 +1,8 @@
 ﻿
 #include "lib/NutritionalData.h"
 
+#include "lib/NutritionRegistry.h"
+
 UDataTable* UNutritionSystem::GetNutritionDataTable()
 {
 	const FSoftObjectPath itemTable = FSoftObjectPath(NutritionDataTable);
@@ -9,22 +11,30 @@ UDataTable* UNutritionSystem::GetNutritionDataTable()
 	return Cast<UDataTable>(itemTable.TryLoad());
 }
 
+/**
+ * @brief Looks up the nutrition data of a consumable. Served from the preloaded
+ *        nutrition registry, so it never touches the asset system after startup.
+ * @param rowName The data table row name of the consumable
+ * @return The nutrition data, or an empty row if it does not exist
+ */
 FStNutritionData UNutritionSystem::GetNutritionData(FName rowName)
 {
-	const UDataTable* nutritionData = GetNutritionDataTable();
-	if (IsValid(nutritionData))
+	const FStNutritionData* nutritionData = FNutritionRegistry::Get().Find(rowName);
+	if (nutritionData != nullptr)
 	{
-		const FString errorCaught;
-		FStNutritionData* vitalityPointer = nutritionData->FindRow<FStNutritionData>(rowName, errorCaught);
-		if (vitalityPointer != nullptr)
-		{
-			return *vitalityPointer;
-		}
-		UE_LOG(LogTemp, Error, TEXT("GetNutritionData(): %s"), *errorCaught);
+		return *nutritionData;
 	}
-	else
+	UE_LOG(LogTemp, Error, TEXT("GetNutritionData(): No nutrition data for '%s'"), *rowName.ToString());
+	return FStNutritionData();
+}
+
+bool UNutritionSystem::FindNutritionData(FName rowName, FStNutritionData& nutritionData)
+{
+	const FStNutritionData* foundData = FNutritionRegistry::Get().Find(rowName);
+	if (foundData == nullptr)
 	{
-		UE_LOG(LogTemp, Error, TEXT("GetNutritionData: Unable to find DataTable '%s'"), *NutritionDataTable);
+		return false;
 	}
-	return FStNutritionData();
-}
\ No newline at end of file
+	nutritionData = *foundData;
+	return true;
+}
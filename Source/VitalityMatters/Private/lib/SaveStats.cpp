@@ -1 +1,547 @@
 ﻿#include "lib/SaveStats.h"
+
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+#include "PlatformFeatures.h"
+#include "SaveGameSystem.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "VitalityEffectsComponent.h"
+#include "VitalityStatComponent.h"
+#include "VitalityWelfareComponent.h"
+
+namespace
+{
+	// Section bits used by VERSION_INITIAL records
+	enum ELegacySaveSection : uint8
+	{
+		LEGACY_SECTION_STATS	= 1 << 0,
+		LEGACY_SECTION_WELFARE	= 1 << 1,
+		LEGACY_SECTION_EFFECTS	= 1 << 2
+	};
+
+	// Floats are written as a one byte count followed by the raw values
+	void SerializeFloats(FArchive& Ar, TArray<float>& Values)
+	{
+		uint8 NumValues = static_cast<uint8>(FMath::Min(Values.Num(), 255));
+		Ar << NumValues;
+		if (Ar.IsLoading())
+			Values.SetNumZeroed(NumValues);
+		Ar.Serialize(Values.GetData(), NumValues * sizeof(float));
+	}
+
+	// Only the newest full save request for a slot is written, since it supersedes
+	// every save and journal record queued before it
+	FCriticalSection SaveSequenceLock;
+	TMap<FString, uint64> LatestSaveSequence;
+
+	FString MakeSlotKey(const FString& SlotName, int32 UserIndex)
+	{
+		return FString::Printf(TEXT("%s#%d"), *SlotName, UserIndex);
+	}
+
+	// Work for one slot runs on a worker thread in the order it was queued, so a
+	// journal append can never land before the snapshot it belongs after
+	struct FSlotQueue
+	{
+		TArray<TUniqueFunction<void()>> Pending;
+		bool bDraining = false;
+	};
+	FCriticalSection SlotQueueLock;
+	TMap<FString, FSlotQueue> SlotQueues;
+
+	void EnqueueSlotWork(const FString& SlotKey, TUniqueFunction<void()>&& Work)
+	{
+		{
+			FScopeLock ScopeLock(&SlotQueueLock);
+			FSlotQueue& SlotQueue = SlotQueues.FindOrAdd(SlotKey);
+			SlotQueue.Pending.Add(MoveTemp(Work));
+			if (SlotQueue.bDraining)
+				return;
+			SlotQueue.bDraining = true;
+		}
+
+		AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [SlotKey]()
+		{
+			for (;;)
+			{
+				TArray<TUniqueFunction<void()>> Batch;
+				{
+					FScopeLock ScopeLock(&SlotQueueLock);
+					FSlotQueue& SlotQueue = SlotQueues.FindChecked(SlotKey);
+					if (SlotQueue.Pending.Num() == 0)
+					{
+						SlotQueues.Remove(SlotKey);
+						return;
+					}
+					Batch = MoveTemp(SlotQueue.Pending);
+				}
+				for (TUniqueFunction<void()>& SlotWork : Batch)
+					SlotWork();
+			}
+		});
+	}
+
+	/* Worker thread helpers. Only called from slot work. */
+
+	// Journal entries are [uint32 size][uint32 crc][record bytes]
+	bool AppendJournal(const FString& JournalPath, const TArray<uint8>& RecordBytes)
+	{
+		TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*JournalPath, FILEWRITE_Append));
+		if (!Writer.IsValid())
+			return false;
+
+		uint32 RecordSize = RecordBytes.Num();
+		uint32 RecordCrc  = FCrc::MemCrc32(RecordBytes.GetData(), RecordBytes.Num());
+		*Writer << RecordSize;
+		*Writer << RecordCrc;
+		Writer->Serialize(const_cast<uint8*>(RecordBytes.GetData()), RecordBytes.Num());
+		return Writer->Close();
+	}
+
+	// Replays every intact journal entry onto the record. Stops at the first torn or
+	// corrupt entry, which is what a crash in the middle of an append leaves behind.
+	int32 ReplayJournal(const FString& JournalPath, FVitalitySaveRecord& Record)
+	{
+		TArray<uint8> JournalBytes;
+		if (!IFileManager::Get().FileExists(*JournalPath) || !FFileHelper::LoadFileToArray(JournalBytes, *JournalPath))
+			return 0;
+
+		int32 NumReplayed = 0;
+		FMemoryReader Reader(JournalBytes);
+		while (Reader.Tell() + 8 <= Reader.TotalSize())
+		{
+			uint32 RecordSize = 0;
+			uint32 RecordCrc  = 0;
+			Reader << RecordSize;
+			Reader << RecordCrc;
+			if (Reader.Tell() + RecordSize > Reader.TotalSize())
+				break;
+
+			const uint8* RecordData = JournalBytes.GetData() + Reader.Tell();
+			if (FCrc::MemCrc32(RecordData, RecordSize) != RecordCrc)
+				break;
+
+			FVitalitySaveRecord JournalRecord;
+			if (!UVitalitySaveSystem::ReadRecord(TArray<uint8>(RecordData, RecordSize), JournalRecord))
+				break;
+			Record.Merge(JournalRecord);
+			Reader.Seek(Reader.Tell() + RecordSize);
+			NumReplayed++;
+		}
+		return NumReplayed;
+	}
+
+	// Reads the snapshot and replays the journal over it
+	bool ReadSlot(const FString& SlotName, int32 UserIndex, FVitalitySaveRecord& OutRecord)
+	{
+		if (ISaveGameSystem* SaveSystem = IPlatformFeaturesModule::Get().GetSaveGameSystem())
+		{
+			TArray<uint8> Bytes;
+			if (SaveSystem->LoadGame(false, *SlotName, UserIndex, Bytes))
+				UVitalitySaveSystem::ReadRecord(Bytes, OutRecord);
+		}
+		ReplayJournal(UVitalitySaveSystem::GetJournalPath(SlotName, UserIndex), OutRecord);
+		return OutRecord.Sections != EVitalitySaveSections::NONE;
+	}
+
+	// Writes the record as the new snapshot, then drops the journal it replaces
+	bool WriteSnapshot(const FString& SlotName, int32 UserIndex, FVitalitySaveRecord& Record)
+	{
+		ISaveGameSystem* SaveSystem = IPlatformFeaturesModule::Get().GetSaveGameSystem();
+		if (SaveSystem == nullptr)
+			return false;
+
+		TArray<uint8> Bytes;
+		UVitalitySaveSystem::WriteRecord(Record, Bytes);
+		if (!SaveSystem->SaveGame(false, *SlotName, UserIndex, Bytes))
+			return false;
+
+		IFileManager::Get().Delete(*UVitalitySaveSystem::GetJournalPath(SlotName, UserIndex), false, false, true);
+		return true;
+	}
+
+	void CompactSlot(const FString& SlotName, int32 UserIndex)
+	{
+		FVitalitySaveRecord Record;
+		if (ReadSlot(SlotName, UserIndex, Record))
+			WriteSnapshot(SlotName, UserIndex, Record);
+	}
+}
+
+bool FVitalitySaveRecord::Serialize(FArchive& Ar)
+{
+	uint32 FileMagic = Magic;
+	uint16 Version = VERSION_LATEST;
+	Ar << FileMagic;
+	Ar << Version;
+	if (FileMagic != Magic || Version < VERSION_INITIAL || Version > VERSION_LATEST)
+	{
+		Ar.SetError();
+		return false;
+	}
+
+	uint8 SectionBits = static_cast<uint8>(Sections);
+	Ar << SectionBits;
+	if (Ar.IsLoading())
+	{
+		Sections = static_cast<EVitalitySaveSections>(SectionBits) & EVitalitySaveSections::ALL;
+		if (Version < VERSION_LAYER_SECTIONS)
+		{
+			Sections = EVitalitySaveSections::NONE;
+			if (SectionBits & LEGACY_SECTION_STATS)		Sections |= EVitalitySaveSections::STATS;
+			if (SectionBits & LEGACY_SECTION_WELFARE)	Sections |= EVitalitySaveSections::WELFARE;
+			if (SectionBits & LEGACY_SECTION_EFFECTS)	Sections |= EVitalitySaveSections::EFFECTS;
+		}
+	}
+
+	for (int32 Layer = 0; Layer < NumLayers; Layer++)
+	{
+		if (HasSection(GetLayerSection(static_cast<EVitalityStatLayer>(Layer))))
+		{
+			SerializeFloats(Ar, CoreStats[Layer]);
+			SerializeFloats(Ar, DamageBonuses[Layer]);
+			SerializeFloats(Ar, DamageResists[Layer]);
+		}
+	}
+
+	if (HasSection(EVitalitySaveSections::WELFARE))
+	{
+		Ar.Serialize(PoolCurrent, sizeof(PoolCurrent));
+		Ar.Serialize(PoolMax, sizeof(PoolMax));
+		// FArchive writes bools as four bytes
+		uint8 IsDead = bIsDead ? 1 : 0;
+		Ar << IsDead;
+		Ar << CombatState;
+		bIsDead = IsDead != 0;
+	}
+
+	if (HasSection(EVitalitySaveSections::EFFECTS))
+	{
+		uint16 NumEffects = static_cast<uint16>(FMath::Min(Effects.Num(), 0xFFFF));
+		Ar << NumEffects;
+		if (Ar.IsLoading())
+			Effects.SetNum(NumEffects);
+		for (int i = 0; i < NumEffects; i++)
+		{
+			FEffect& Effect = Effects[i];
+			// Names are stored as strings so the record does not depend on the name table
+			FString EffectName = Effect.EffectName.ToString();
+			Ar << EffectName;
+			Ar << Effect.BenefitEffect;
+			Ar << Effect.DetrimentEffect;
+			Ar << Effect.RemainingTicks;
+			Ar << Effect.UniqueId;
+			uint8 IsPersistent = Effect.bIsPersistent ? 1 : 0;
+			Ar << IsPersistent;
+			if (Ar.IsLoading())
+			{
+				Effect.EffectName		= FName(*EffectName);
+				Effect.bIsPersistent	= IsPersistent != 0;
+			}
+		}
+	}
+	return !Ar.IsError();
+}
+
+void FVitalitySaveRecord::Merge(const FVitalitySaveRecord& Newer)
+{
+	for (int32 Layer = 0; Layer < NumLayers; Layer++)
+	{
+		if (Newer.HasSection(GetLayerSection(static_cast<EVitalityStatLayer>(Layer))))
+		{
+			CoreStats[Layer]		= Newer.CoreStats[Layer];
+			DamageBonuses[Layer]	= Newer.DamageBonuses[Layer];
+			DamageResists[Layer]	= Newer.DamageResists[Layer];
+		}
+	}
+	if (Newer.HasSection(EVitalitySaveSections::WELFARE))
+	{
+		FMemory::Memcpy(PoolCurrent, Newer.PoolCurrent, sizeof(PoolCurrent));
+		FMemory::Memcpy(PoolMax, Newer.PoolMax, sizeof(PoolMax));
+		bIsDead		= Newer.bIsDead;
+		CombatState	= Newer.CombatState;
+	}
+	if (Newer.HasSection(EVitalitySaveSections::EFFECTS))
+	{
+		Effects = Newer.Effects;
+	}
+	Sections |= Newer.Sections;
+}
+
+
+bool USaveVitalityStat::CaptureActor(const AActor* Actor)
+{
+	FVitalitySaveRecord Record;
+	if (!UVitalitySaveSystem::CaptureActor(Actor, Record))
+		return false;
+	VitalityRecord.Reset();
+	UVitalitySaveSystem::WriteRecord(Record, VitalityRecord);
+	return true;
+}
+
+bool USaveVitalityStat::ApplyToActor(AActor* Actor) const
+{
+	FVitalitySaveRecord Record;
+	if (!UVitalitySaveSystem::ReadRecord(VitalityRecord, Record))
+		return false;
+	return UVitalitySaveSystem::ApplyToActor(Actor, Record);
+}
+
+
+bool UVitalitySaveSystem::CaptureActor(const AActor* Actor, FVitalitySaveRecord& OutRecord,
+	EVitalitySaveSections Sections)
+{
+	check(IsInGameThread());
+	if (!IsValid(Actor))
+		return false;
+
+	if (const UVitalityStatComponent* StatComponent = Actor->FindComponentByClass<UVitalityStatComponent>())
+		StatComponent->CaptureSaveData(OutRecord, Sections);
+	if (const UVitalityWelfareComponent* WelfareComponent = Actor->FindComponentByClass<UVitalityWelfareComponent>())
+		WelfareComponent->CaptureSaveData(OutRecord, Sections);
+	if (const UVitalityEffectsComponent* EffectsComponent = Actor->FindComponentByClass<UVitalityEffectsComponent>())
+		EffectsComponent->CaptureSaveData(OutRecord, Sections);
+
+	return OutRecord.Sections != EVitalitySaveSections::NONE;
+}
+
+bool UVitalitySaveSystem::ApplyToActor(AActor* Actor, const FVitalitySaveRecord& Record)
+{
+	check(IsInGameThread());
+	if (!IsValid(Actor) || !Actor->HasAuthority())
+		return false;
+
+	// Stats first, so derived maximums are in place before the pools are clamped to them
+	if (UVitalityStatComponent* StatComponent = Actor->FindComponentByClass<UVitalityStatComponent>())
+		StatComponent->ApplySaveData(Record);
+	if (UVitalityWelfareComponent* WelfareComponent = Actor->FindComponentByClass<UVitalityWelfareComponent>())
+		WelfareComponent->ApplySaveData(Record);
+	if (UVitalityEffectsComponent* EffectsComponent = Actor->FindComponentByClass<UVitalityEffectsComponent>())
+		EffectsComponent->ApplySaveData(Record);
+	return true;
+}
+
+EVitalitySaveSections UVitalitySaveSystem::GetActorDirtySections(const AActor* Actor)
+{
+	EVitalitySaveSections DirtySections = EVitalitySaveSections::NONE;
+	if (!IsValid(Actor))
+		return DirtySections;
+
+	if (const UVitalityStatComponent* StatComponent = Actor->FindComponentByClass<UVitalityStatComponent>())
+		DirtySections |= StatComponent->GetDirtySaveSections();
+	if (const UVitalityWelfareComponent* WelfareComponent = Actor->FindComponentByClass<UVitalityWelfareComponent>())
+		DirtySections |= WelfareComponent->GetDirtySaveSections();
+	if (const UVitalityEffectsComponent* EffectsComponent = Actor->FindComponentByClass<UVitalityEffectsComponent>())
+		DirtySections |= EffectsComponent->GetDirtySaveSections();
+	return DirtySections;
+}
+
+void UVitalitySaveSystem::SetActorDirtySections(AActor* Actor, EVitalitySaveSections Sections, bool bIsDirty)
+{
+	if (!IsValid(Actor))
+		return;
+
+	if (UVitalityStatComponent* StatComponent = Actor->FindComponentByClass<UVitalityStatComponent>())
+		StatComponent->SetSaveSectionsDirty(Sections, bIsDirty);
+	if (UVitalityWelfareComponent* WelfareComponent = Actor->FindComponentByClass<UVitalityWelfareComponent>())
+		WelfareComponent->SetSaveSectionsDirty(Sections, bIsDirty);
+	if (UVitalityEffectsComponent* EffectsComponent = Actor->FindComponentByClass<UVitalityEffectsComponent>())
+		EffectsComponent->SetSaveSectionsDirty(Sections, bIsDirty);
+}
+
+void UVitalitySaveSystem::WriteRecord(FVitalitySaveRecord& Record, TArray<uint8>& OutBytes)
+{
+	FMemoryWriter Writer(OutBytes);
+	Record.Serialize(Writer);
+}
+
+bool UVitalitySaveSystem::ReadRecord(const TArray<uint8>& Bytes, FVitalitySaveRecord& OutRecord)
+{
+	if (Bytes.Num() == 0)
+		return false;
+	FMemoryReader Reader(Bytes);
+	return OutRecord.Serialize(Reader);
+}
+
+/**
+ * @brief Captures the actor's vitality on the game thread, then encodes and writes it on a
+ *        worker as the slot's new snapshot, replacing the slot's journal
+ * @param Actor The actor owning the vitality components
+ * @param SlotName The save slot to write
+ * @param UserIndex The platform user index of the slot
+ * @param OnComplete Called on the game thread once the slot was written (or failed to be)
+ * @return False if there was nothing to save. True if the request was sent.
+ */
+bool UVitalitySaveSystem::SaveActorAsync(AActor* Actor, const FString& SlotName, int32 UserIndex,
+	FOnVitalitySaveComplete OnComplete)
+{
+	TSharedRef<FVitalitySaveRecord, ESPMode::ThreadSafe> Record = MakeShared<FVitalitySaveRecord, ESPMode::ThreadSafe>();
+	if (SlotName.IsEmpty() || !CaptureActor(Actor, *Record))
+		return false;
+	SetActorDirtySections(Actor, EVitalitySaveSections::ALL, false);
+
+	const FString SlotKey = MakeSlotKey(SlotName, UserIndex);
+	uint64 Sequence;
+	{
+		FScopeLock ScopeLock(&SaveSequenceLock);
+		Sequence = ++LatestSaveSequence.FindOrAdd(SlotKey);
+	}
+
+	TWeakObjectPtr<AActor> WeakActor(Actor);
+	EnqueueSlotWork(SlotKey, [Record, WeakActor, SlotName, SlotKey, UserIndex, Sequence, OnComplete]()
+	{
+		bool bSuccess = false;
+		{
+			FScopeLock ScopeLock(&SaveSequenceLock);
+			// A newer save for this slot was requested. It will be written instead.
+			if (LatestSaveSequence.FindRef(SlotKey) != Sequence)
+				bSuccess = true;
+		}
+		if (!bSuccess)
+			bSuccess = WriteSnapshot(SlotName, UserIndex, *Record);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakActor, OnComplete, bSuccess]()
+		{
+			// Nothing was written, so everything has to be written next time
+			if (!bSuccess)
+				SetActorDirtySections(WeakActor.Get(), EVitalitySaveSections::ALL, true);
+			OnComplete.ExecuteIfBound(bSuccess);
+		});
+	});
+	return true;
+}
+
+/**
+ * @brief Captures only the sections that changed since the last save or journal record,
+ *        then appends them to the slot's journal on a worker thread
+ * @param Actor The actor owning the vitality components
+ * @param SlotName The save slot whose journal is appended to
+ * @param UserIndex The platform user index of the slot
+ * @param OnComplete Called on the game thread once the record was appended (or failed to be)
+ * @return False if nothing changed, in which case no I/O happens. True if the request was sent.
+ */
+bool UVitalitySaveSystem::JournalActorAsync(AActor* Actor, const FString& SlotName, int32 UserIndex,
+	FOnVitalitySaveComplete OnComplete)
+{
+	const EVitalitySaveSections DirtySections = GetActorDirtySections(Actor);
+	if (SlotName.IsEmpty() || DirtySections == EVitalitySaveSections::NONE)
+		return false;
+
+	TSharedRef<FVitalitySaveRecord, ESPMode::ThreadSafe> Record = MakeShared<FVitalitySaveRecord, ESPMode::ThreadSafe>();
+	if (!CaptureActor(Actor, *Record, DirtySections))
+		return false;
+	SetActorDirtySections(Actor, DirtySections, false);
+
+	TWeakObjectPtr<AActor> WeakActor(Actor);
+	EnqueueSlotWork(MakeSlotKey(SlotName, UserIndex),
+		[Record, WeakActor, DirtySections, SlotName, UserIndex, OnComplete]()
+	{
+		TArray<uint8> RecordBytes;
+		WriteRecord(*Record, RecordBytes);
+
+		const FString JournalPath = GetJournalPath(SlotName, UserIndex);
+		const bool bSuccess = AppendJournal(JournalPath, RecordBytes);
+		if (bSuccess && IFileManager::Get().FileSize(*JournalPath) > JournalCompactionBytes)
+			CompactSlot(SlotName, UserIndex);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakActor, DirtySections, OnComplete, bSuccess]()
+		{
+			if (!bSuccess)
+				SetActorDirtySections(WeakActor.Get(), DirtySections, true);
+			OnComplete.ExecuteIfBound(bSuccess);
+		});
+	});
+	return true;
+}
+
+void UVitalitySaveSystem::CompactSlotAsync(const FString& SlotName, int32 UserIndex)
+{
+	if (SlotName.IsEmpty())
+		return;
+	EnqueueSlotWork(MakeSlotKey(SlotName, UserIndex), [SlotName, UserIndex]()
+	{
+		CompactSlot(SlotName, UserIndex);
+	});
+}
+
+/**
+ * @brief Reads the snapshot and replays the journal on a worker thread, then applies
+ *        all three components on the game thread in a single step
+ * @param Actor The actor owning the vitality components. Must be authority.
+ * @param SlotName The save slot to read
+ * @param UserIndex The platform user index of the slot
+ * @param OnComplete Called on the game thread once the record was applied (or failed to be)
+ * @return True if the request was sent.
+ */
+bool UVitalitySaveSystem::LoadActorAsync(AActor* Actor, const FString& SlotName, int32 UserIndex,
+	FOnVitalityLoadComplete OnComplete)
+{
+	if (SlotName.IsEmpty() || !IsValid(Actor) || !Actor->HasAuthority())
+		return false;
+
+	TWeakObjectPtr<AActor> WeakActor(Actor);
+	EnqueueSlotWork(MakeSlotKey(SlotName, UserIndex), [WeakActor, SlotName, UserIndex, OnComplete]()
+	{
+		TSharedRef<FVitalitySaveRecord, ESPMode::ThreadSafe> Record = MakeShared<FVitalitySaveRecord, ESPMode::ThreadSafe>();
+		const bool bDecoded = ReadSlot(SlotName, UserIndex, *Record);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakActor, Record, bDecoded, OnComplete]()
+		{
+			const bool bSuccess = bDecoded && ApplyToActor(WeakActor.Get(), *Record);
+			OnComplete.ExecuteIfBound(bSuccess);
+		});
+	});
+	return true;
+}
+
+bool UVitalitySaveSystem::SaveActor(AActor* Actor, const FString& SlotName, int32 UserIndex)
+{
+	FVitalitySaveRecord Record;
+	if (SlotName.IsEmpty() || !CaptureActor(Actor, Record))
+		return false;
+
+	if (!WriteSnapshot(SlotName, UserIndex, Record))
+		return false;
+	SetActorDirtySections(Actor, EVitalitySaveSections::ALL, false);
+	return true;
+}
+
+bool UVitalitySaveSystem::LoadActor(AActor* Actor, const FString& SlotName, int32 UserIndex)
+{
+	FVitalitySaveRecord Record;
+	if (SlotName.IsEmpty() || !ReadSlot(SlotName, UserIndex, Record))
+		return false;
+	return ApplyToActor(Actor, Record);
+}
+
+bool UVitalitySaveSystem::K2_SaveVitalityAsync(AActor* Actor, const FString& SlotName, int32 UserIndex)
+{
+	return SaveActorAsync(Actor, SlotName, UserIndex);
+}
+
+bool UVitalitySaveSystem::K2_JournalVitalityAsync(AActor* Actor, const FString& SlotName, int32 UserIndex)
+{
+	return JournalActorAsync(Actor, SlotName, UserIndex);
+}
+
+bool UVitalitySaveSystem::K2_LoadVitalityAsync(AActor* Actor, const FString& SlotName, int32 UserIndex)
+{
+	return LoadActorAsync(Actor, SlotName, UserIndex);
+}
+
+bool UVitalitySaveSystem::DoesVitalitySaveExist(const FString& SlotName, int32 UserIndex)
+{
+	ISaveGameSystem* SaveSystem = IPlatformFeaturesModule::Get().GetSaveGameSystem();
+	if (SaveSystem != nullptr && SaveSystem->DoesSaveGameExist(*SlotName, UserIndex))
+		return true;
+	return IFileManager::Get().FileExists(*GetJournalPath(SlotName, UserIndex));
+}
+
+FString UVitalitySaveSystem::GetJournalPath(const FString& SlotName, int32 UserIndex)
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Vitality"),
+		FString::Printf(TEXT("%s_%d.vjournal"), *SlotName, UserIndex));
+}
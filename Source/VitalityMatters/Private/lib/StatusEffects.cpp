@@ -3,6 +3,8 @@
 
 #include "lib/StatusEffects.h"
 
+#include "lib/VitalityDataBlob.h"
+
 
 UDataTable* UVitalityEffect::GetVitalityEffectsTable()
 {
@@ -14,6 +16,16 @@ UDataTable* UVitalityEffect::GetVitalityEffectsTable()
 
 FStVitalityEffects UVitalityEffect::GetVitalityEffect(FName EffectName)
 {
+	// Dedicated servers read the cooked blob, and never load the table or its icons
+	const FVitalityDataBlob& dataBlob = FVitalityDataBlob::Get();
+	if (dataBlob.IsOpen())
+	{
+		FStVitalityEffects vitalityEffect;
+		if (const FVitalityBlobEffect* blobEffect = dataBlob.FindEffect(EffectName))
+			dataBlob.ToEffectRow(*blobEffect, vitalityEffect);
+		return vitalityEffect;
+	}
+	
 	UDataTable* vitalityData = GetVitalityEffectsTable();
 	if (IsValid(vitalityData))
 	{
@@ -21,7 +33,10 @@ FStVitalityEffects UVitalityEffect::GetVitalityEffect(FName EffectName)
 		FStVitalityEffects* vitalityPointer = vitalityData->FindRow<FStVitalityEffects>(EffectName, errorCaught);
 		if (vitalityPointer != nullptr)
 		{
-			return *vitalityPointer;
+			// The row name is not part of the row, so it is filled in as the blob does
+			FStVitalityEffects vitalityEffect = *vitalityPointer;
+			vitalityEffect.EffectName = EffectName;
+			return vitalityEffect;
 		}
 	}
 	return FStVitalityEffects();
@@ -31,6 +46,14 @@ FStVitalityEffects UVitalityEffect::GetVitalityEffectByBenefit(EEffectsBeneficia
 {
 	if (EffectEnum != EEffectsBeneficial::MAX)
 	{
+		const FVitalityDataBlob& dataBlob = FVitalityDataBlob::Get();
+		if (dataBlob.IsOpen())
+		{
+			FStVitalityEffects vitalityEffect;
+			if (const FVitalityBlobEffect* blobEffect = dataBlob.FindEffectByBenefit(EffectEnum))
+				dataBlob.ToEffectRow(*blobEffect, vitalityEffect);
+			return vitalityEffect;
+		}
 		const FString effectString = UEnum::GetValueAsString(EffectEnum);
 		return GetVitalityEffect(*effectString);
 	}
@@ -41,6 +64,14 @@ FStVitalityEffects UVitalityEffect::GetVitalityEffectByDetriment(EEffectsDetrime
 {
 	if (EffectEnum != EEffectsDetrimental::MAX)
 	{
+		const FVitalityDataBlob& dataBlob = FVitalityDataBlob::Get();
+		if (dataBlob.IsOpen())
+		{
+			FStVitalityEffects vitalityEffect;
+			if (const FVitalityBlobEffect* blobEffect = dataBlob.FindEffectByDetriment(EffectEnum))
+				dataBlob.ToEffectRow(*blobEffect, vitalityEffect);
+			return vitalityEffect;
+		}
 		const FString effectString = UEnum::GetValueAsString(EffectEnum);
 		return GetVitalityEffect(*effectString);
 	}
@@ -0,0 +1,377 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "lib/VitalityBenchmark.h"
+
+#include <atomic>
+
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "HAL/PlatformMemory.h"
+#include "VitalityEffectsComponent.h"
+#include "VitalityStatComponent.h"
+#include "VitalityWelfareComponent.h"
+#include "lib/VitalityBenchmarkUtils.h"
+
+
+namespace
+{
+	// Seconds between each actor's workload calls. Actors are staggered across the interval.
+	constexpr double DamageInterval	= 2.0;
+	constexpr double EffectInterval	= 5.0;
+	constexpr double StatInterval	= 3.0;
+	// Actors are spawned on a grid this far apart, so their capsules never overlap
+	constexpr float GridSpacing		= 200.f;
+
+	// Counts every allocation made through GMalloc while installed, forwarding everything else.
+	// Installing it mid-run is safe because every block still comes from the same allocator.
+	class FVitalityCountingMalloc final : public FMalloc
+	{
+	public:
+
+		explicit FVitalityCountingMalloc(FMalloc* InInner) : Inner(InInner) {}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			Allocations.fetch_add(1, std::memory_order_relaxed);
+			AllocatedBytes.fetch_add(Count, std::memory_order_relaxed);
+			return Inner->Malloc(Count, Alignment);
+		}
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			Allocations.fetch_add(1, std::memory_order_relaxed);
+			AllocatedBytes.fetch_add(Count, std::memory_order_relaxed);
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual void UpdateStats() override { Inner->UpdateStats(); }
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+		FMalloc* Inner;
+		std::atomic<uint64> Allocations		{0};
+		std::atomic<uint64> AllocatedBytes	{0};
+	};
+
+	// Keeps the last sampled value of every replicated property of each component, and
+	// estimates the bytes a replication pass would send from the properties that changed.
+	class FReplicationEstimator
+	{
+	public:
+
+		~FReplicationEstimator()
+		{
+			for (const FShadow& Shadow : Shadows_)
+			{
+				for (const FProperty* Property : *Shadow.Properties)
+					Property->DestroyValue_InContainer(Shadow.Values);
+				FMemory::Free(Shadow.Values);
+			}
+		}
+
+		void Add(UActorComponent* Component)
+		{
+			const UClass* Class = Component->GetClass();
+			TUniquePtr<TArray<const FProperty*>>& Properties = ClassProperties_.FindOrAdd(Class);
+			if (!Properties.IsValid())
+			{
+				Properties = MakeUnique<TArray<const FProperty*>>();
+				for (TFieldIterator<FProperty> It(Class); It; ++It)
+				{
+					if (It->HasAnyPropertyFlags(CPF_Net))
+						Properties->Add(*It);
+				}
+			}
+
+			FShadow& Shadow		= Shadows_.AddDefaulted_GetRef();
+			Shadow.Component	= Component;
+			Shadow.Properties	= Properties.Get();
+			Shadow.Values		= FMemory::MallocZeroed(Class->GetPropertiesSize(), Class->GetMinAlignment());
+			for (const FProperty* Property : *Shadow.Properties)
+			{
+				Property->InitializeValue_InContainer(Shadow.Values);
+				Property->CopyCompleteValue_InContainer(Shadow.Values, Component);
+			}
+		}
+
+		// Returns the estimated bytes of every property that changed since the last sample
+		int64 Sample()
+		{
+			int64 Bytes = 0;
+			for (const FShadow& Shadow : Shadows_)
+			{
+				for (const FProperty* Property : *Shadow.Properties)
+				{
+					bool bChanged = false;
+					for (int32 i = 0; i < Property->ArrayDim && !bChanged; i++)
+						bChanged = !Property->Identical_InContainer(Shadow.Values, Shadow.Component, i);
+					if (!bChanged)
+						continue;
+					Bytes += EstimateSize(Property, Property->ContainerPtrToValuePtr<void>(Shadow.Component));
+					Property->CopyCompleteValue_InContainer(Shadow.Values, Shadow.Component);
+				}
+			}
+			return Bytes;
+		}
+
+	private:
+
+		static int64 EstimateSize(const FProperty* Property, const void* Value)
+		{
+			if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Property))
+			{
+				const FScriptArrayHelper ArrayHelper(ArrayProperty, Value);
+				return sizeof(int32) + static_cast<int64>(ArrayHelper.Num()) * ArrayProperty->Inner->GetSize();
+			}
+			return Property->GetSize();
+		}
+
+		struct FShadow
+		{
+			const UActorComponent* Component = nullptr;
+			const TArray<const FProperty*>* Properties = nullptr;
+			void* Values = nullptr;
+		};
+
+		TMap<const UClass*, TUniquePtr<TArray<const FProperty*>>> ClassProperties_;
+		TArray<FShadow> Shadows_;
+	};
+
+	uint64 GetUsedPhysical()
+	{
+		return FPlatformMemory::GetStats().UsedPhysical;
+	}
+}
+
+
+UVitalityBenchmarkCommandlet::UVitalityBenchmarkCommandlet()
+{
+	IsClient	= false;
+	IsServer	= true;
+	IsEditor	= false;
+	LogToConsole = true;
+}
+
+int32 UVitalityBenchmarkCommandlet::Main(const FString& Params)
+{
+	const TArray<int32> ActorCounts = FVitalityBenchmarkUtils::ParseCounts(Params, TEXT("Counts="), {100, 1000, 10000});
+
+	double Seconds	= 30.0;
+	double TickRate	= 30.0;
+	FParse::Value(*Params, TEXT("Seconds="), Seconds);
+	FParse::Value(*Params, TEXT("TickRate="), TickRate);
+	Seconds		= FMath::Max(Seconds, 1.0);
+	TickRate	= FMath::Clamp(TickRate, 1.0, 240.0);
+	const bool bTrackAllocations = !FParse::Param(*Params, TEXT("NoAllocTracking"));
+	const bool bParallelUpdate	= FParse::Param(*Params, TEXT("Parallel"));
+
+	const FString OutputPath = FVitalityBenchmarkUtils::ParseOutputPath(Params, TEXT("VitalityBenchmark"));
+
+	TArray<FVitalityBenchmarkResult> Results;
+	for (const int32 ActorCount : ActorCounts)
+	{
+		const FVitalityBenchmarkResult& Result = Results.Add_GetRef(RunPass(ActorCount, Seconds, TickRate, bTrackAllocations, bParallelUpdate));
+		UE_LOG(LogTemp, Display, TEXT("VitalityBenchmark: %6d actors, %.3f ms mean, %.3f ms p95, %.0f allocs/frame, %.0f bytes/actor, %.0f replicated bytes/frame"),
+			Result.NumActors, Result.FrameMsMean, Result.FrameMsP95, Result.AllocationsPerFrame,
+			Result.BytesPerActor, Result.ReplicatedBytesPerFrame);
+	}
+
+	const bool bWrote = FVitalityBenchmarkUtils::WriteResults(OutputPath, TEXT("VitalityBenchmark"), Results,
+		TEXT("NumActors,ParallelUpdate,NumFrames,SimulatedSeconds,SpawnSeconds,FrameMsMean,FrameMsMedian,FrameMsP95,FrameMsMax,")
+		TEXT("AllocationsPerFrame,AllocatedBytesPerFrame,BytesPerActor,ReplicatedBytesPerFrame,DamageCalls,EffectCalls,StatCalls"),
+		[](const FVitalityBenchmarkResult& Result)
+		{
+			return FString::Printf(TEXT("%d,%d,%d,%.3f,%.3f,%.4f,%.4f,%.4f,%.4f,%.1f,%.1f,%.1f,%.1f,%d,%d,%d"),
+				Result.NumActors, Result.bParallelUpdate ? 1 : 0, Result.NumFrames, Result.SimulatedSeconds, Result.SpawnSeconds,
+				Result.FrameMsMean, Result.FrameMsMedian, Result.FrameMsP95, Result.FrameMsMax,
+				Result.AllocationsPerFrame, Result.AllocatedBytesPerFrame, Result.BytesPerActor,
+				Result.ReplicatedBytesPerFrame, Result.DamageCalls, Result.EffectCalls, Result.StatCalls);
+		},
+		[](TJsonWriter<>& Writer, const FVitalityBenchmarkResult& Result)
+		{
+			Writer.WriteValue(TEXT("NumActors"), Result.NumActors);
+			Writer.WriteValue(TEXT("ParallelUpdate"), Result.bParallelUpdate);
+			Writer.WriteValue(TEXT("NumFrames"), Result.NumFrames);
+			Writer.WriteValue(TEXT("SimulatedSeconds"), Result.SimulatedSeconds);
+			Writer.WriteValue(TEXT("SpawnSeconds"), Result.SpawnSeconds);
+			Writer.WriteValue(TEXT("FrameMsMean"), Result.FrameMsMean);
+			Writer.WriteValue(TEXT("FrameMsMedian"), Result.FrameMsMedian);
+			Writer.WriteValue(TEXT("FrameMsP95"), Result.FrameMsP95);
+			Writer.WriteValue(TEXT("FrameMsMax"), Result.FrameMsMax);
+			Writer.WriteValue(TEXT("AllocationsPerFrame"), Result.AllocationsPerFrame);
+			Writer.WriteValue(TEXT("AllocatedBytesPerFrame"), Result.AllocatedBytesPerFrame);
+			Writer.WriteValue(TEXT("BytesPerActor"), Result.BytesPerActor);
+			Writer.WriteValue(TEXT("ReplicatedBytesPerFrame"), Result.ReplicatedBytesPerFrame);
+			Writer.WriteValue(TEXT("DamageCalls"), Result.DamageCalls);
+			Writer.WriteValue(TEXT("EffectCalls"), Result.EffectCalls);
+			Writer.WriteValue(TEXT("StatCalls"), Result.StatCalls);
+			Writer.WriteArrayStart(TEXT("FrameMs"));
+			for (const double FrameMs : Result.FrameMs)
+				Writer.WriteValue(FrameMs);
+			Writer.WriteArrayEnd();
+		});
+	return bWrote ? 0 : 1;
+}
+
+/**
+ * @brief Runs the workload over a fresh world with the given number of actors.
+ * @param NumActors The number of actors to spawn
+ * @param Seconds The simulated duration
+ * @param TickRate The fixed number of world ticks per simulated second
+ * @param bTrackAllocations Counts allocations during each frame if true
+ * @param bParallelUpdate Steps the pools and effects through the subsystem's parallel update if true
+ * @return The measurements of the pass
+ */
+FVitalityBenchmarkResult UVitalityBenchmarkCommandlet::RunPass(int32 NumActors, double Seconds,
+	double TickRate, bool bTrackAllocations, bool bParallelUpdate) const
+{
+	FVitalityBenchmarkResult Result;
+	Result.NumActors		= NumActors;
+	Result.bParallelUpdate	= bParallelUpdate;
+	Result.NumFrames		= FMath::CeilToInt(Seconds * TickRate);
+	Result.SimulatedSeconds	= Result.NumFrames / TickRate;
+
+	UWorld* World = FVitalityBenchmarkUtils::CreateWorld(TEXT("VitalityBenchmark"), bParallelUpdate);
+
+	// Characters, since hit and death effects play their montages on one.
+	// Only the vitality components are left ticking.
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	const int32 GridWidth = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(NumActors)));
+	TArray<ACharacter*> Characters;
+	Characters.Reserve(NumActors);
+	for (int32 i = 0; i < NumActors; i++)
+	{
+		const FVector Location((i % GridWidth) * GridSpacing, (i / GridWidth) * GridSpacing, 0.f);
+		ACharacter* Character = World->SpawnActor<ACharacter>(ACharacter::StaticClass(), Location, FRotator::ZeroRotator, SpawnParameters);
+		Character->SetActorTickEnabled(false);
+		Character->GetCharacterMovement()->SetComponentTickEnabled(false);
+		Character->GetMesh()->SetComponentTickEnabled(false);
+		Characters.Add(Character);
+	}
+
+	TArray<UVitalityWelfareComponent*> Welfares;
+	TArray<UVitalityEffectsComponent*> Effects;
+	TArray<UVitalityStatComponent*> Stats;
+	Welfares.Reserve(NumActors);
+	Effects.Reserve(NumActors);
+	Stats.Reserve(NumActors);
+
+	const uint64 MemoryBefore = GetUsedPhysical();
+	const double SpawnStart = FPlatformTime::Seconds();
+	for (ACharacter* Character : Characters)
+	{
+		UVitalityWelfareComponent* Welfare = FVitalityBenchmarkUtils::AddComponent<UVitalityWelfareComponent>(Character);
+		// Start below the maximum, so the regen timers run
+		Welfare->InitializeSubsystem(EVitalityCategory::HEALTH, true, 500.f, 1000.f, 2.f);
+		Welfare->InitializeSubsystem(EVitalityCategory::STAMINA, true, 50.f, 100.f, 2.f);
+		Welfare->InitializeSubsystem(EVitalityCategory::MAGIC, true, 50.f, 100.f, 2.f);
+		Welfare->SetVitalityRegenRate(EVitalityCategory::HEALTH, 2.f);
+		Welfare->SetVitalityRegenRate(EVitalityCategory::STAMINA, 2.f);
+		Welfares.Add(Welfare);
+		Effects.Add(FVitalityBenchmarkUtils::AddComponent<UVitalityEffectsComponent>(Character));
+		Stats.Add(FVitalityBenchmarkUtils::AddComponent<UVitalityStatComponent>(Character));
+	}
+	Result.SpawnSeconds		= FPlatformTime::Seconds() - SpawnStart;
+	const uint64 MemoryAfter = GetUsedPhysical();
+	Result.BytesPerActor	= MemoryAfter > MemoryBefore
+		? static_cast<double>(MemoryAfter - MemoryBefore) / NumActors : 0.0;
+
+	TUniquePtr<FReplicationEstimator> ReplicationEstimator = MakeUnique<FReplicationEstimator>();
+	for (int32 i = 0; i < NumActors; i++)
+	{
+		ReplicationEstimator->Add(Welfares[i]);
+		ReplicationEstimator->Add(Effects[i]);
+		ReplicationEstimator->Add(Stats[i]);
+	}
+
+	// Allocated once and kept installed only while frames are timed
+	static FVitalityCountingMalloc* CountingMalloc = nullptr;
+	FMalloc* PreviousMalloc = GMalloc;
+	if (bTrackAllocations)
+	{
+		if (CountingMalloc == nullptr)
+			CountingMalloc = new FVitalityCountingMalloc(GMalloc);
+		CountingMalloc->Inner = PreviousMalloc;
+		GMalloc = CountingMalloc;
+	}
+
+	const int32 DamageFrames	= FMath::Max(FMath::RoundToInt(DamageInterval * TickRate), 1);
+	const int32 EffectFrames	= FMath::Max(FMath::RoundToInt(EffectInterval * TickRate), 1);
+	const int32 StatFrames		= FMath::Max(FMath::RoundToInt(StatInterval * TickRate), 1);
+	const int32 NumBenefits		= static_cast<int32>(EEffectsBeneficial::MAX);
+	const int32 NumCoreStats	= static_cast<int32>(EVitalityStat::MAX);
+	const float DeltaSeconds	= 1.f / TickRate;
+
+	uint64 TotalAllocations		= 0;
+	uint64 TotalAllocatedBytes	= 0;
+	int64 TotalReplicatedBytes	= 0;
+	Result.FrameMs.Reserve(Result.NumFrames);
+
+	for (int32 Frame = 0; Frame < Result.NumFrames; Frame++)
+	{
+		const uint64 AllocationsBefore	= bTrackAllocations ? CountingMalloc->Allocations.load() : 0;
+		const uint64 BytesBefore		= bTrackAllocations ? CountingMalloc->AllocatedBytes.load() : 0;
+		const double FrameStart			= FPlatformTime::Seconds();
+
+		for (int32 i = 0; i < NumActors; i++)
+		{
+			if ((Frame + i) % DamageFrames == 0)
+			{
+				Welfares[i]->DamageHealth(nullptr, 5.f);
+				Welfares[i]->DamageStamina(nullptr, 5.f);
+				Result.DamageCalls++;
+			}
+			if ((Frame + i) % EffectFrames == 0)
+			{
+				// Swaps one beneficial effect for the next
+				const int32 Step = (Frame + i) / EffectFrames;
+				Effects[i]->RemoveEffectBeneficial(static_cast<EEffectsBeneficial>((Step + NumBenefits - 1) % NumBenefits));
+				Effects[i]->ApplyEffectBeneficial(static_cast<EEffectsBeneficial>(Step % NumBenefits));
+				Result.EffectCalls++;
+			}
+			if ((Frame + i) % StatFrames == 0)
+			{
+				const int32 Step = (Frame + i) / StatFrames;
+				Stats[i]->SetNaturalCoreStat(static_cast<EVitalityStat>(Step % NumCoreStats), static_cast<float>(Step % 20));
+				Result.StatCalls++;
+			}
+		}
+		World->Tick(LEVELTICK_All, DeltaSeconds);
+		// The timer manager only ticks once per engine frame
+		GFrameCounter++;
+
+		Result.FrameMs.Add((FPlatformTime::Seconds() - FrameStart) * 1000.0);
+		if (bTrackAllocations)
+		{
+			TotalAllocations	+= CountingMalloc->Allocations.load() - AllocationsBefore;
+			TotalAllocatedBytes	+= CountingMalloc->AllocatedBytes.load() - BytesBefore;
+		}
+		TotalReplicatedBytes += ReplicationEstimator->Sample();
+	}
+
+	if (bTrackAllocations)
+		GMalloc = PreviousMalloc;
+
+	const double NumFrames			= FMath::Max(Result.NumFrames, 1);
+	Result.AllocationsPerFrame		= TotalAllocations / NumFrames;
+	Result.AllocatedBytesPerFrame	= TotalAllocatedBytes / NumFrames;
+	Result.ReplicatedBytesPerFrame	= TotalReplicatedBytes / NumFrames;
+
+	const FVitalitySampleSummary FrameSummary = FVitalityBenchmarkUtils::Summarize(Result.FrameMs);
+	Result.FrameMsMean		= FrameSummary.Mean;
+	Result.FrameMsMedian	= FrameSummary.Median;
+	Result.FrameMsP95		= FrameSummary.P95;
+	Result.FrameMsMax		= FrameSummary.Max;
+
+	// The shadows must be released while the components still exist
+	ReplicationEstimator.Reset();
+	FVitalityBenchmarkUtils::DestroyWorld(World);
+	return Result;
+}
@@ -0,0 +1,117 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "lib/VitalityBenchmarkUtils.h"
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+#include "HAL/PlatformProperties.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectGlobals.h"
+#include "VitalitySubsystem.h"
+
+
+UWorld* FVitalityBenchmarkUtils::CreateWorld(FName WorldName, bool bParallelUpdate)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, WorldName);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	if (UVitalitySubsystem* VitalitySubsystem = World->GetSubsystem<UVitalitySubsystem>())
+		VitalitySubsystem->bParallelUpdate = bParallelUpdate;
+	if (AWorldSettings* WorldSettings = World->GetWorldSettings())
+		WorldSettings->NotifyBeginPlay();
+	return World;
+}
+
+void FVitalityBenchmarkUtils::DestroyWorld(UWorld* World)
+{
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+TArray<int32> FVitalityBenchmarkUtils::ParseCounts(const FString& Params, const TCHAR* Key, const TArray<int32>& Defaults)
+{
+	FString CountsString;
+	if (!FParse::Value(*Params, Key, CountsString, false))
+		return Defaults;
+
+	TArray<int32> Counts;
+	TArray<FString> CountStrings;
+	CountsString.ParseIntoArray(CountStrings, TEXT(","));
+	for (const FString& CountString : CountStrings)
+	{
+		const int32 Count = FCString::Atoi(*CountString);
+		if (Count > 0)
+			Counts.Add(Count);
+	}
+	return Counts;
+}
+
+FString FVitalityBenchmarkUtils::ParseOutputPath(const FString& Params, const TCHAR* BenchmarkName)
+{
+	FString OutputPath;
+	if (!FParse::Value(*Params, TEXT("Output="), OutputPath))
+	{
+		OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks")
+			/ FString::Printf(TEXT("%s-%s"), BenchmarkName, *FDateTime::Now().ToString());
+	}
+	return OutputPath;
+}
+
+FVitalitySampleSummary FVitalityBenchmarkUtils::Summarize(TConstArrayView<double> Samples)
+{
+	FVitalitySampleSummary Summary;
+	if (Samples.Num() == 0)
+		return Summary;
+
+	TArray<double> Sorted(Samples);
+	Sorted.Sort();
+
+	double Total = 0.0;
+	for (const double Sample : Sorted)
+		Total += Sample;
+	Summary.Mean = Total / Sorted.Num();
+
+	double Variance = 0.0;
+	for (const double Sample : Sorted)
+		Variance += FMath::Square(Sample - Summary.Mean);
+	Summary.StdDev	= Sorted.Num() > 1 ? FMath::Sqrt(Variance / (Sorted.Num() - 1)) : 0.0;
+
+	Summary.Median	= Sorted[Sorted.Num() / 2];
+	Summary.Min		= Sorted[0];
+	Summary.P95		= Sorted[FMath::Min(FMath::FloorToInt(Sorted.Num() * 0.95), Sorted.Num() - 1)];
+	Summary.Max		= Sorted.Last();
+	return Summary;
+}
+
+void FVitalityBenchmarkUtils::BeginJson(TJsonWriter<>& Writer)
+{
+	Writer.WriteObjectStart();
+	Writer.WriteValue(TEXT("Platform"), FString(FPlatformProperties::IniPlatformName()));
+	Writer.WriteValue(TEXT("Timestamp"), FDateTime::UtcNow().ToIso8601());
+	Writer.WriteArrayStart(TEXT("Results"));
+}
+
+void FVitalityBenchmarkUtils::EndJson(TJsonWriter<>& Writer)
+{
+	Writer.WriteArrayEnd();
+	Writer.WriteObjectEnd();
+	Writer.Close();
+}
+
+bool FVitalityBenchmarkUtils::SaveResults(const FString& OutputPath, const TCHAR* BenchmarkName,
+	const FString& Csv, const FString& Json)
+{
+	const bool bWroteCsv	= FFileHelper::SaveStringToFile(Csv, *(OutputPath + TEXT(".csv")));
+	const bool bWroteJson	= FFileHelper::SaveStringToFile(Json, *(OutputPath + TEXT(".json")));
+	if (!bWroteCsv || !bWroteJson)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s: Failed to write the results to '%s'"), BenchmarkName, *OutputPath);
+		return false;
+	}
+	UE_LOG(LogTemp, Display, TEXT("%s: Wrote '%s.csv' and '%s.json'"), BenchmarkName, *OutputPath, *OutputPath);
+	return true;
+}
@@ -0,0 +1,209 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "lib/VitalityCheckpoint.h"
+
+#include "Algo/BinarySearch.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "lib/SaveStats.h"
+
+static_assert(TIsTriviallyCopyable<FVitalityCheckpointEntry>::Value,
+	"Checkpoint entries are written and mapped as raw bytes");
+static_assert(sizeof(FVitalityCheckpointHeader) % alignof(FVitalityCheckpointEntry) == 0,
+	"Mapped entries must stay aligned after the header");
+
+
+void FVitalityCheckpointEntry::SetFromSnapshots(const FVitalityWelfareSnapshot* Welfare,
+	const FVitalityStatSnapshot* Stats, const FVitalityEffectsSnapshot* Effects)
+{
+	EVitalitySaveSections EntrySections = EVitalitySaveSections::NONE;
+	if (Welfare != nullptr)
+	{
+		EntrySections |= EVitalitySaveSections::WELFARE;
+		PoolCurrent[static_cast<int32>(EVitalityCategory::HEALTH)]	= Welfare->HealthCurrent;
+		PoolCurrent[static_cast<int32>(EVitalityCategory::STAMINA)]	= Welfare->StaminaCurrent;
+		PoolCurrent[static_cast<int32>(EVitalityCategory::MAGIC)]	= Welfare->MagicCurrent;
+		PoolCurrent[static_cast<int32>(EVitalityCategory::HUNGER)]	= Welfare->CaloriesCurrent;
+		PoolCurrent[static_cast<int32>(EVitalityCategory::THIRST)]	= Welfare->HydrationCurrent;
+		PoolMax[static_cast<int32>(EVitalityCategory::HEALTH)]		= Welfare->HealthMax;
+		PoolMax[static_cast<int32>(EVitalityCategory::STAMINA)]		= Welfare->StaminaMax;
+		PoolMax[static_cast<int32>(EVitalityCategory::MAGIC)]		= Welfare->MagicMax;
+		PoolMax[static_cast<int32>(EVitalityCategory::HUNGER)]		= Welfare->CaloriesMax;
+		PoolMax[static_cast<int32>(EVitalityCategory::THIRST)]		= Welfare->HydrationMax;
+		bIsDead		= Welfare->bIsDead ? 1 : 0;
+		CombatState	= Welfare->CombatState;
+	}
+	if (Stats != nullptr)
+	{
+		EntrySections |= EVitalitySaveSections::STATS;
+		// The snapshot's TOTAL layer is last, so the first NumLayers rows copy straight across
+		FMemory::Memcpy(CoreStats, Stats->CoreStats, sizeof(CoreStats));
+		FMemory::Memcpy(DamageBonuses, Stats->DamageBonuses, sizeof(DamageBonuses));
+		FMemory::Memcpy(DamageResists, Stats->DamageResists, sizeof(DamageResists));
+	}
+	if (Effects != nullptr)
+	{
+		EntrySections |= EVitalitySaveSections::EFFECTS;
+		NumEffects = static_cast<uint8>(FMath::Min(Effects->NumEffects, MaxEffects));
+		for (int i = 0; i < NumEffects; i++)
+		{
+			const FVitalityEffectsSnapshot::FEffect& SourceEffect = Effects->Effects[i];
+			FEffect& TargetEffect		= this->Effects[i];
+			TargetEffect.UniqueId		= SourceEffect.UniqueId;
+			TargetEffect.RemainingTicks	= SourceEffect.EffectTicks;
+			TargetEffect.BenefitEffect	= SourceEffect.BenefitEffect;
+			TargetEffect.DetrimentEffect= SourceEffect.DetrimentEffect;
+			TargetEffect.bIsPersistent	= SourceEffect.bIsPersistent ? 1 : 0;
+		}
+	}
+	Sections = static_cast<uint8>(EntrySections);
+}
+
+void FVitalityCheckpointEntry::ToSaveRecord(FVitalitySaveRecord& OutRecord) const
+{
+	OutRecord.Sections = static_cast<EVitalitySaveSections>(Sections);
+	for (int32 Layer = 0; Layer < NumLayers; Layer++)
+	{
+		OutRecord.CoreStats[Layer]		= TArray<float>(CoreStats[Layer], NumCoreStats);
+		OutRecord.DamageBonuses[Layer]	= TArray<float>(DamageBonuses[Layer], NumDamageTypes);
+		OutRecord.DamageResists[Layer]	= TArray<float>(DamageResists[Layer], NumDamageTypes);
+	}
+
+	FMemory::Memcpy(OutRecord.PoolCurrent, PoolCurrent, sizeof(PoolCurrent));
+	FMemory::Memcpy(OutRecord.PoolMax, PoolMax, sizeof(PoolMax));
+	OutRecord.bIsDead		= bIsDead != 0;
+	OutRecord.CombatState	= CombatState;
+
+	// Effect names are not kept; they are looked up again by their effect enum
+	OutRecord.Effects.SetNum(NumEffects);
+	for (int i = 0; i < NumEffects; i++)
+	{
+		FVitalitySaveRecord::FEffect& SavedEffect = OutRecord.Effects[i];
+		SavedEffect.BenefitEffect	= Effects[i].BenefitEffect;
+		SavedEffect.DetrimentEffect	= Effects[i].DetrimentEffect;
+		SavedEffect.RemainingTicks	= Effects[i].RemainingTicks;
+		SavedEffect.UniqueId		= Effects[i].UniqueId;
+		SavedEffect.bIsPersistent	= Effects[i].bIsPersistent != 0;
+	}
+}
+
+
+FVitalityCheckpointFile::FVitalityCheckpointFile() = default;
+
+FVitalityCheckpointFile::~FVitalityCheckpointFile()
+{
+	Close();
+}
+
+/**
+ * @brief Maps the checkpoint file and validates its header. No entry is read or copied.
+ * @param FilePath The checkpoint to map
+ * @return True if the checkpoint is mapped and can be searched
+ */
+bool FVitalityCheckpointFile::Open(const FString& FilePath)
+{
+	Close();
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	MappedFile_.Reset(PlatformFile.OpenMapped(*FilePath));
+	if (!MappedFile_.IsValid())
+		return false;
+
+	const int64 FileSize = MappedFile_->GetFileSize();
+	if (FileSize < static_cast<int64>(sizeof(FVitalityCheckpointHeader)))
+	{
+		Close();
+		return false;
+	}
+
+	MappedRegion_.Reset(MappedFile_->MapRegion(0, FileSize));
+	if (!MappedRegion_.IsValid())
+	{
+		Close();
+		return false;
+	}
+
+	const uint8* MappedData = MappedRegion_->GetMappedPtr();
+	const FVitalityCheckpointHeader* Header = reinterpret_cast<const FVitalityCheckpointHeader*>(MappedData);
+	const int64 ExpectedSize = sizeof(FVitalityCheckpointHeader)
+		+ static_cast<int64>(Header->NumEntries) * sizeof(FVitalityCheckpointEntry);
+
+	if (Header->Magic != FVitalityCheckpointHeader::CheckpointMagic
+		|| Header->Version != FVitalityCheckpointHeader::CheckpointVersion
+		|| Header->EntrySize != sizeof(FVitalityCheckpointEntry)
+		|| FileSize < ExpectedSize)
+	{
+		Close();
+		return false;
+	}
+
+	Entries_	= reinterpret_cast<const FVitalityCheckpointEntry*>(MappedData + sizeof(FVitalityCheckpointHeader));
+	NumEntries_	= Header->NumEntries;
+	Timestamp_	= Header->Timestamp;
+	return true;
+}
+
+void FVitalityCheckpointFile::Close()
+{
+	Entries_	= nullptr;
+	NumEntries_	= 0;
+	Timestamp_	= 0;
+	MappedRegion_.Reset();
+	MappedFile_.Reset();
+}
+
+const FVitalityCheckpointEntry* FVitalityCheckpointFile::Find(uint64 StableId) const
+{
+	if (Entries_ == nullptr || StableId == 0)
+		return nullptr;
+
+	const int32 EntryIndex = Algo::LowerBoundBy(TConstArrayView<FVitalityCheckpointEntry>(Entries_, NumEntries_),
+		StableId, &FVitalityCheckpointEntry::StableId);
+	if (EntryIndex < NumEntries_ && Entries_[EntryIndex].StableId == StableId)
+		return &Entries_[EntryIndex];
+	return nullptr;
+}
+
+/**
+ * @brief Writes a new checkpoint. The entries are written to a temporary file first,
+ *        so a crash while writing never leaves a torn checkpoint behind.
+ * @param FilePath The checkpoint to replace
+ * @param Entries The entries to write. Sorted in place.
+ * @param Timestamp UTC ticks of when the entries were gathered
+ * @return True if the checkpoint was replaced
+ */
+bool FVitalityCheckpointFile::Write(const FString& FilePath,
+	TArray<FVitalityCheckpointEntry>& Entries, int64 Timestamp)
+{
+	Entries.Sort([](const FVitalityCheckpointEntry& A, const FVitalityCheckpointEntry& B)
+	{
+		return A.StableId < B.StableId;
+	});
+
+	// Two actors sharing an ID cannot both be restored, so only the first one is kept
+	for (int i = Entries.Num() - 1; i > 0; i--)
+	{
+		if (Entries[i].StableId == Entries[i - 1].StableId)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Vitality checkpoint: duplicate stable ID %llu"), Entries[i].StableId);
+			Entries.RemoveAt(i, 1, false);
+		}
+	}
+
+	FVitalityCheckpointHeader Header;
+	Header.NumEntries	= Entries.Num();
+	Header.Timestamp	= Timestamp;
+
+	const FString TempPath = FilePath + TEXT(".tmp");
+	{
+		TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempPath));
+		if (!Writer.IsValid())
+			return false;
+		Writer->Serialize(&Header, sizeof(Header));
+		Writer->Serialize(Entries.GetData(), Entries.Num() * sizeof(FVitalityCheckpointEntry));
+		if (!Writer->Close())
+			return false;
+	}
+	return IFileManager::Get().Move(*FilePath, *TempPath, true, true);
+}
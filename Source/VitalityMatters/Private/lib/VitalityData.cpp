@@ -2,6 +2,18 @@
 
 #include "lib/VitalityData.h"
 
+#include "VitalityStatMath.h"
+
+/**
+ * @brief Returns the heap memory held by the stat arrays and their delegates.
+ */
+SIZE_T FStVitalityStats::GetAllocatedSize() const
+{
+	return CoreStats.GetAllocatedSize() + DamageBonuses.GetAllocatedSize() + DamageResists.GetAllocatedSize()
+		+ OnCoreStatUpdated.GetAllocatedSize() + OnDamageBonusUpdated.GetAllocatedSize()
+		+ OnDamageResistanceUpdated.GetAllocatedSize();
+}
+
 /**
  * @brief Sets the value of the core stat, running the appropriate
  *        logic and triggering delegates.
@@ -49,10 +61,7 @@ void FStVitalityStats::SetDamageResistance(const EDamageType DamageEnum, const i
  */
 float FStVitalityStats::GetCoreStatValue(const EVitalityStat StatEnum) const
 {
-	const int enumAsIndex = static_cast<int>(StatEnum);
-	if (!CoreStats.IsValidIndex(enumAsIndex))
-		return 0.f;
-	return CoreStats[enumAsIndex];
+	return FVitalityStatMath::GetLayerValue(CoreStats, static_cast<int32>(StatEnum));
 }
 
 /**
@@ -62,10 +71,7 @@ float FStVitalityStats::GetCoreStatValue(const EVitalityStat StatEnum) const
  */
 float FStVitalityStats::GetDamageBonusValue(const EDamageType DamageEnum) const
 {
-	const int enumAsIndex = static_cast<int>(DamageEnum);
-	if (!DamageBonuses.IsValidIndex(enumAsIndex))
-		return 0.f;
-	return DamageBonuses[enumAsIndex];
+	return FVitalityStatMath::GetLayerValue(DamageBonuses, static_cast<int32>(DamageEnum));
 }
 
 /**
@@ -75,9 +81,6 @@ float FStVitalityStats::GetDamageBonusValue(const EDamageType DamageEnum) const
  */
 float FStVitalityStats::GetDamageResistValue(const EDamageType DamageEnum) const
 {
-	const int enumAsIndex = static_cast<int>(DamageEnum);
-	if (!DamageResists.IsValidIndex(enumAsIndex))
-		return 0.f;
-	return DamageResists[enumAsIndex];
+	return FVitalityStatMath::GetLayerValue(DamageResists, static_cast<int32>(DamageEnum));
 }
 
@@ -0,0 +1,373 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "lib/VitalityDataBlob.h"
+
+#include "Algo/AllOf.h"
+#include "Algo/BinarySearch.h"
+#include "Async/MappedFileHandle.h"
+#include "Engine/DataTable.h"
+#include "Hash/CityHash.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "lib/NutritionalData.h"
+#include "lib/StatusEffects.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+static_assert(TIsTriviallyCopyable<FVitalityBlobEffect>::Value
+	&& TIsTriviallyCopyable<FVitalityBlobNutrition>::Value, "Blob rows are written and mapped as raw bytes");
+static_assert(sizeof(FVitalityBlobHeader) % alignof(uint64) == 0
+	&& sizeof(FVitalityBlobEffect) % alignof(uint64) == 0, "Mapped rows must stay aligned after the header");
+
+
+namespace
+{
+	// Gathers the strings of the blob, storing each distinct string once
+	struct FStringInterner
+	{
+		TArray<UTF8CHAR> Bytes;
+		TMap<FString, uint32> Offsets;
+
+		FStringInterner()
+		{
+			// Offset zero is the empty string, so zero can mean "none"
+			Bytes.Add(UTF8CHAR(0));
+			Offsets.Add(FString(), 0);
+		}
+
+		uint32 Intern(const FString& String)
+		{
+			if (const uint32* Offset = Offsets.Find(String))
+				return *Offset;
+			const uint32 Offset = Bytes.Num();
+			const FTCHARToUTF8 Utf8String(*String);
+			Bytes.Append(reinterpret_cast<const UTF8CHAR*>(Utf8String.Get()), Utf8String.Length());
+			Bytes.Add(UTF8CHAR(0));
+			Offsets.Add(String, Offset);
+			return Offset;
+		}
+	};
+
+	template <typename RowType>
+	const RowType* FindRowByHash(const RowType* Rows, uint32 NumRows, uint64 NameHash)
+	{
+		if (Rows == nullptr)
+			return nullptr;
+		const int32 RowIndex = Algo::LowerBoundBy(TConstArrayView<RowType>(Rows, NumRows), NameHash, &RowType::NameHash);
+		if (RowIndex < static_cast<int32>(NumRows) && Rows[RowIndex].NameHash == NameHash)
+			return &Rows[RowIndex];
+		return nullptr;
+	}
+}
+
+
+FVitalityDataBlob::FVitalityDataBlob() = default;
+
+FVitalityDataBlob::~FVitalityDataBlob()
+{
+	Close();
+}
+
+FVitalityDataBlob& FVitalityDataBlob::Get()
+{
+	static FVitalityDataBlob DataBlob;
+	return DataBlob;
+}
+
+FString FVitalityDataBlob::GetDefaultPath()
+{
+	return FPaths::Combine(FPaths::ProjectContentDir(), TEXT("Vitality"), TEXT("VitalityData.vmdata"));
+}
+
+/**
+ * @brief Maps the blob and points the row views into it. Nothing is parsed or copied.
+ * @param FilePath The blob written by Cook()
+ * @return True if the blob is open and can be searched
+ */
+bool FVitalityDataBlob::Open(const FString& FilePath)
+{
+	Close();
+
+	const uint8* BlobData = nullptr;
+	int64 BlobSize = 0;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	MappedFile_.Reset(PlatformFile.OpenMapped(*FilePath));
+	if (MappedFile_.IsValid())
+	{
+		BlobSize = MappedFile_->GetFileSize();
+		MappedRegion_.Reset(MappedFile_->MapRegion(0, BlobSize));
+		if (MappedRegion_.IsValid())
+			BlobData = MappedRegion_->GetMappedPtr();
+	}
+	if (BlobData == nullptr)
+	{
+		MappedRegion_.Reset();
+		MappedFile_.Reset();
+		if (!FFileHelper::LoadFileToArray(FileBytes_, *FilePath, FILEREAD_Silent))
+			return false;
+		BlobData = FileBytes_.GetData();
+		BlobSize = FileBytes_.Num();
+	}
+
+	if (BlobSize < static_cast<int64>(sizeof(FVitalityBlobHeader)))
+	{
+		Close();
+		return false;
+	}
+
+	const FVitalityBlobHeader* Header = reinterpret_cast<const FVitalityBlobHeader*>(BlobData);
+	const int64 EffectsBytes	= static_cast<int64>(Header->NumEffects) * sizeof(FVitalityBlobEffect);
+	const int64 NutritionBytes	= static_cast<int64>(Header->NumNutrition) * sizeof(FVitalityBlobNutrition);
+	const int64 ExpectedSize	= sizeof(FVitalityBlobHeader) + EffectsBytes + NutritionBytes + Header->StringBytes;
+
+	if (Header->Magic != FVitalityBlobHeader::BlobMagic
+		|| Header->Version != FVitalityBlobHeader::BlobVersion
+		|| Header->NumBenefitTypes != FVitalityBlobHeader::NumBenefits
+		|| Header->NumDetrimentTypes != FVitalityBlobHeader::NumDetriments
+		|| Header->StringBytes < 1
+		|| BlobSize < ExpectedSize)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FVitalityDataBlob: '%s' is not a compatible data blob"), *FilePath);
+		Close();
+		return false;
+	}
+
+	// The enum lookups index the effect rows directly, so a damaged file must not point past them
+	const auto IsValidEffectIndex = [Header](int32 EffectIndex)
+	{
+		return EffectIndex == INDEX_NONE || (EffectIndex >= 0 && static_cast<uint32>(EffectIndex) < Header->NumEffects);
+	};
+	if (!Algo::AllOf(Header->BenefitIndex, IsValidEffectIndex) || !Algo::AllOf(Header->DetrimentIndex, IsValidEffectIndex))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("FVitalityDataBlob: '%s' has effect indices out of range"), *FilePath);
+		Close();
+		return false;
+	}
+
+	const uint8* RowData = BlobData + sizeof(FVitalityBlobHeader);
+	Header_		= Header;
+	Effects_	= reinterpret_cast<const FVitalityBlobEffect*>(RowData);
+	Nutrition_	= reinterpret_cast<const FVitalityBlobNutrition*>(RowData + EffectsBytes);
+	Strings_	= reinterpret_cast<const UTF8CHAR*>(RowData + EffectsBytes + NutritionBytes);
+	return true;
+}
+
+void FVitalityDataBlob::Close()
+{
+	Header_		= nullptr;
+	Effects_	= nullptr;
+	Nutrition_	= nullptr;
+	Strings_	= nullptr;
+	MappedRegion_.Reset();
+	MappedFile_.Reset();
+	FileBytes_.Empty();
+}
+
+TConstArrayView<FVitalityBlobEffect> FVitalityDataBlob::GetEffects() const
+{
+	return IsOpen() ? TConstArrayView<FVitalityBlobEffect>(Effects_, Header_->NumEffects)
+		: TConstArrayView<FVitalityBlobEffect>();
+}
+
+TConstArrayView<FVitalityBlobNutrition> FVitalityDataBlob::GetNutrition() const
+{
+	return IsOpen() ? TConstArrayView<FVitalityBlobNutrition>(Nutrition_, Header_->NumNutrition)
+		: TConstArrayView<FVitalityBlobNutrition>();
+}
+
+const UTF8CHAR* FVitalityDataBlob::GetString(uint32 Offset) const
+{
+	if (!IsOpen() || Offset >= Header_->StringBytes)
+		return reinterpret_cast<const UTF8CHAR*>("");
+	return Strings_ + Offset;
+}
+
+const FVitalityBlobEffect* FVitalityDataBlob::FindEffect(FName EffectName) const
+{
+	return IsOpen() ? FindRowByHash(Effects_, Header_->NumEffects, HashName(EffectName)) : nullptr;
+}
+
+const FVitalityBlobEffect* FVitalityDataBlob::FindEffectByBenefit(EEffectsBeneficial EffectEnum) const
+{
+	if (!IsOpen() || EffectEnum == EEffectsBeneficial::MAX)
+		return nullptr;
+	const int32 EffectIndex = Header_->BenefitIndex[static_cast<int32>(EffectEnum)];
+	return EffectIndex != INDEX_NONE ? &Effects_[EffectIndex] : nullptr;
+}
+
+const FVitalityBlobEffect* FVitalityDataBlob::FindEffectByDetriment(EEffectsDetrimental EffectEnum) const
+{
+	if (!IsOpen() || EffectEnum == EEffectsDetrimental::MAX)
+		return nullptr;
+	const int32 EffectIndex = Header_->DetrimentIndex[static_cast<int32>(EffectEnum)];
+	return EffectIndex != INDEX_NONE ? &Effects_[EffectIndex] : nullptr;
+}
+
+const FVitalityBlobNutrition* FVitalityDataBlob::FindNutrition(FName RowName) const
+{
+	return IsOpen() ? FindRowByHash(Nutrition_, Header_->NumNutrition, HashName(RowName)) : nullptr;
+}
+
+void FVitalityDataBlob::ToEffectRow(const FVitalityBlobEffect& BlobEffect, FStVitalityEffects& OutEffect) const
+{
+	OutEffect = FStVitalityEffects(FName(UTF8_TO_TCHAR(GetString(BlobEffect.NameOffset))));
+	OutEffect.benefitEffect		= BlobEffect.BenefitEffect;
+	OutEffect.detrimentEffect	= BlobEffect.DetrimentEffect;
+	OutEffect.effectTitle		= OutEffect.EffectName.ToString();
+	OutEffect.bIsPersistent		= BlobEffect.bIsPersistent != 0;
+	OutEffect.bEffectStacks		= BlobEffect.bEffectStacks != 0;
+	OutEffect.effectTicks		= BlobEffect.EffectTicks;
+	OutEffect.attachOnSpawn		= BlobEffect.bAttachOnSpawn != 0;
+	OutEffect.disableSprinting	= BlobEffect.bDisableSprinting != 0;
+	if (BlobEffect.ClassOffset != 0)
+	{
+		const FSoftClassPath ClassPath(UTF8_TO_TCHAR(GetString(BlobEffect.ClassOffset)));
+		OutEffect.optionalClass = ClassPath.TryLoadClass<AActor>();
+	}
+}
+
+uint64 FVitalityDataBlob::HashName(FName Name)
+{
+	TStringBuilder<128> NameString;
+	Name.AppendString(NameString);
+	for (TCHAR& Character : MakeArrayView(NameString.GetData(), NameString.Len()))
+		Character = FChar::ToLower(Character);
+
+	// Hashed as UTF-8, so the cooking editor and the server agree whatever their TCHAR is
+	const FTCHARToUTF8 Utf8Name(NameString.ToString(), NameString.Len());
+	return CityHash64(reinterpret_cast<const char*>(Utf8Name.Get()), Utf8Name.Length());
+}
+
+/**
+ * @brief Bakes the effect and nutrition tables into a blob of plain rows. Strings and
+ *        class paths are interned into one table, and icons are dropped.
+ * @param EffectsTable DT_VitalityData, or a table with the same row structure
+ * @param NutritionTable DT_NutritionTable, or a table with the same row structure
+ * @param FilePath The blob to write
+ * @return True if the blob was written
+ */
+bool FVitalityDataBlob::Cook(const UDataTable* EffectsTable, const UDataTable* NutritionTable, const FString& FilePath)
+{
+	if (!IsValid(EffectsTable) || !IsValid(NutritionTable))
+		return false;
+
+	FStringInterner Interner;
+
+	TArray<FVitalityBlobEffect> Effects;
+	for (const TPair<FName, uint8*>& Row : EffectsTable->GetRowMap())
+	{
+		const FStVitalityEffects* EffectRow = reinterpret_cast<const FStVitalityEffects*>(Row.Value);
+		FVitalityBlobEffect& BlobEffect = Effects.AddDefaulted_GetRef();
+		BlobEffect.NameHash				= HashName(Row.Key);
+		BlobEffect.NameOffset			= Interner.Intern(Row.Key.ToString());
+		BlobEffect.ClassOffset			= EffectRow->optionalClass != nullptr
+			? Interner.Intern(FSoftClassPath(EffectRow->optionalClass.Get()).ToString()) : 0;
+		BlobEffect.EffectTicks			= EffectRow->effectTicks;
+		BlobEffect.BenefitEffect		= EffectRow->benefitEffect;
+		BlobEffect.DetrimentEffect		= EffectRow->detrimentEffect;
+		BlobEffect.bIsPersistent		= EffectRow->bIsPersistent ? 1 : 0;
+		BlobEffect.bEffectStacks		= EffectRow->bEffectStacks ? 1 : 0;
+		BlobEffect.bAttachOnSpawn		= EffectRow->attachOnSpawn ? 1 : 0;
+		BlobEffect.bDisableSprinting	= EffectRow->disableSprinting ? 1 : 0;
+	}
+
+	TArray<FVitalityBlobNutrition> Nutrition;
+	for (const TPair<FName, uint8*>& Row : NutritionTable->GetRowMap())
+	{
+		const FStNutritionData* NutritionRow = reinterpret_cast<const FStNutritionData*>(Row.Value);
+		FVitalityBlobNutrition& BlobNutrition = Nutrition.AddDefaulted_GetRef();
+		BlobNutrition.NameHash			= HashName(Row.Key);
+		BlobNutrition.NameOffset		= Interner.Intern(Row.Key.ToString());
+		BlobNutrition.ProperNameOffset	= Interner.Intern(NutritionRow->properName.ToString());
+		BlobNutrition.SpawnClassOffset	= NutritionRow->optionalSpawnActor != nullptr
+			? Interner.Intern(FSoftClassPath(NutritionRow->optionalSpawnActor.Get()).ToString()) : 0;
+		BlobNutrition.Calories			= NutritionRow->calories;
+		BlobNutrition.Hydration			= NutritionRow->hydration;
+		BlobNutrition.DigestSeconds		= NutritionRow->digestSeconds;
+		BlobNutrition.BenefitCount		= NutritionRow->benefitCount;
+		BlobNutrition.DetrimentCount	= NutritionRow->detrimentCount;
+		BlobNutrition.AddBenefit		= NutritionRow->addBenefit;
+		BlobNutrition.AddDetriment		= NutritionRow->addDetriment;
+	}
+
+	Effects.Sort([](const FVitalityBlobEffect& A, const FVitalityBlobEffect& B) { return A.NameHash < B.NameHash; });
+	Nutrition.Sort([](const FVitalityBlobNutrition& A, const FVitalityBlobNutrition& B) { return A.NameHash < B.NameHash; });
+	for (int i = 1; i < Effects.Num(); i++)
+	{
+		if (Effects[i].NameHash == Effects[i - 1].NameHash)
+		{
+			UE_LOG(LogTemp, Error, TEXT("FVitalityDataBlob: effect rows '%s' and '%s' hash the same"),
+				UTF8_TO_TCHAR(&Interner.Bytes[Effects[i].NameOffset]), UTF8_TO_TCHAR(&Interner.Bytes[Effects[i - 1].NameOffset]));
+			return false;
+		}
+	}
+	for (int i = 1; i < Nutrition.Num(); i++)
+	{
+		if (Nutrition[i].NameHash == Nutrition[i - 1].NameHash)
+		{
+			UE_LOG(LogTemp, Error, TEXT("FVitalityDataBlob: nutrition rows '%s' and '%s' hash the same"),
+				UTF8_TO_TCHAR(&Interner.Bytes[Nutrition[i].NameOffset]), UTF8_TO_TCHAR(&Interner.Bytes[Nutrition[i - 1].NameOffset]));
+			return false;
+		}
+	}
+
+	FVitalityBlobHeader Header;
+	Header.NumEffects	= Effects.Num();
+	Header.NumNutrition	= Nutrition.Num();
+	Header.StringBytes	= Interner.Bytes.Num();
+
+	// Effects are looked up by enum through their row name, the same way the table is
+	for (int i = 0; i < FVitalityBlobHeader::NumBenefits; i++)
+	{
+		const uint64 NameHash = HashName(*UEnum::GetValueAsString(static_cast<EEffectsBeneficial>(i)));
+		const FVitalityBlobEffect* BlobEffect = FindRowByHash(Effects.GetData(), Effects.Num(), NameHash);
+		Header.BenefitIndex[i] = BlobEffect != nullptr ? static_cast<int32>(BlobEffect - Effects.GetData()) : INDEX_NONE;
+	}
+	for (int i = 0; i < FVitalityBlobHeader::NumDetriments; i++)
+	{
+		const uint64 NameHash = HashName(*UEnum::GetValueAsString(static_cast<EEffectsDetrimental>(i)));
+		const FVitalityBlobEffect* BlobEffect = FindRowByHash(Effects.GetData(), Effects.Num(), NameHash);
+		Header.DetrimentIndex[i] = BlobEffect != nullptr ? static_cast<int32>(BlobEffect - Effects.GetData()) : INDEX_NONE;
+	}
+
+	const FString TempPath = FilePath + TEXT(".tmp");
+	{
+		TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempPath));
+		if (!Writer.IsValid())
+			return false;
+		Writer->Serialize(&Header, sizeof(Header));
+		Writer->Serialize(Effects.GetData(), Effects.Num() * sizeof(FVitalityBlobEffect));
+		Writer->Serialize(Nutrition.GetData(), Nutrition.Num() * sizeof(FVitalityBlobNutrition));
+		Writer->Serialize(Interner.Bytes.GetData(), Interner.Bytes.Num());
+		if (!Writer->Close())
+			return false;
+	}
+	return IFileManager::Get().Move(*FilePath, *TempPath, true, true);
+}
+
+
+UVitalityCookDataCommandlet::UVitalityCookDataCommandlet()
+{
+	IsClient	= false;
+	IsServer	= false;
+	IsEditor	= true;
+	LogToConsole = true;
+}
+
+int32 UVitalityCookDataCommandlet::Main(const FString& Params)
+{
+	FString OutputPath;
+	if (!FParse::Value(*Params, TEXT("Output="), OutputPath))
+		OutputPath = FVitalityDataBlob::GetDefaultPath();
+
+	const UDataTable* EffectsTable		= UVitalityEffect::GetVitalityEffectsTable();
+	const UDataTable* NutritionTable	= UNutritionSystem::GetNutritionDataTable();
+	if (!FVitalityDataBlob::Cook(EffectsTable, NutritionTable, OutputPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("VitalityCookData: Failed to cook '%s'"), *OutputPath);
+		return 1;
+	}
+	UE_LOG(LogTemp, Display, TEXT("VitalityCookData: Cooked '%s'"), *OutputPath);
+	return 0;
+}
@@ -0,0 +1,248 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "lib/VitalityMicroBenchmark.h"
+
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "VitalityEffectsComponent.h"
+#include "VitalityStatComponent.h"
+#include "VitalityWelfareComponent.h"
+#include "lib/StatusEffects.h"
+#include "lib/VitalityBenchmarkUtils.h"
+#include "lib/VitalityData.h"
+
+
+namespace
+{
+	// Results are written here, so the compiler cannot drop the work that produced them
+	volatile float BenchmarkSink = 0.f;
+
+	// One timed operation. Setup runs before every sample and is not timed.
+	struct FMicroBenchmarkCase
+	{
+		FString Name;
+		int32 Param = 0;
+		TFunction<void()> Setup;
+		TFunction<void(int32 Iterations)> Run;
+	};
+
+	// Makes the given number of active effects, cycling through the beneficial effects.
+	// Ids start at the offset, so two sets can be made to partly overlap.
+	TArray<FStVitalityEffects> MakeEffects(int32 NumEffects, int32 IdOffset)
+	{
+		const int32 NumBenefits = static_cast<int32>(EEffectsBeneficial::MAX);
+		TArray<FStVitalityEffects> NewEffects;
+		NewEffects.Reserve(NumEffects);
+		for (int32 i = 0; i < NumEffects; i++)
+		{
+			const EEffectsBeneficial Benefit = static_cast<EEffectsBeneficial>(i % NumBenefits);
+			FStVitalityEffects& NewEffect = NewEffects.Add_GetRef(FStVitalityEffects(*UEnum::GetValueAsString(Benefit)));
+			NewEffect.benefitEffect	= Benefit;
+			NewEffect.effectTicks	= 10;
+			NewEffect.uniqueId		= IdOffset + i + 1;
+		}
+		return NewEffects;
+	}
+
+	FVitalityMicroBenchmarkResult RunCase(const FMicroBenchmarkCase& Case, int32 Iterations, int32 Samples, int32 Warmup)
+	{
+		FVitalityMicroBenchmarkResult Result;
+		Result.Name			= Case.Name;
+		Result.Param		= Case.Param;
+		Result.Iterations	= Iterations;
+		Result.SampleNs.Reserve(Samples);
+
+		for (int32 Sample = -Warmup; Sample < Samples; Sample++)
+		{
+			if (Case.Setup)
+				Case.Setup();
+			const double SampleStart = FPlatformTime::Seconds();
+			Case.Run(Iterations);
+			const double SampleNs = (FPlatformTime::Seconds() - SampleStart) * 1.0e9 / Iterations;
+			if (Sample >= 0)
+				Result.SampleNs.Add(SampleNs);
+		}
+
+		const FVitalitySampleSummary Summary = FVitalityBenchmarkUtils::Summarize(Result.SampleNs);
+		Result.NsMean	= Summary.Mean;
+		Result.NsMedian	= Summary.Median;
+		Result.NsStdDev	= Summary.StdDev;
+		Result.NsMin	= Summary.Min;
+		Result.NsP95	= Summary.P95;
+		Result.NsMax	= Summary.Max;
+		return Result;
+	}
+}
+
+
+UVitalityMicroBenchmarkCommandlet::UVitalityMicroBenchmarkCommandlet()
+{
+	IsClient	= false;
+	IsServer	= true;
+	IsEditor	= false;
+	LogToConsole = true;
+}
+
+int32 UVitalityMicroBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 Iterations	= 1000;
+	int32 Samples		= 30;
+	int32 Warmup		= 3;
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("Samples="), Samples);
+	FParse::Value(*Params, TEXT("Warmup="), Warmup);
+	Iterations	= FMath::Max(Iterations, 1);
+	Samples		= FMath::Max(Samples, 1);
+	Warmup		= FMath::Max(Warmup, 0);
+
+	const TArray<int32> EffectCounts = FVitalityBenchmarkUtils::ParseCounts(Params, TEXT("EffectCounts="), {16, 256, 4096});
+
+	FString Filter;
+	FParse::Value(*Params, TEXT("Filter="), Filter);
+
+	const FString OutputPath = FVitalityBenchmarkUtils::ParseOutputPath(Params, TEXT("VitalityMicroBenchmark"));
+
+	// The components need an authoritative owner in a world, the same as in game
+	UWorld* World = FVitalityBenchmarkUtils::CreateWorld(TEXT("VitalityMicroBenchmark"));
+
+	// A character, since the damage multicast plays its hit montage on one
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	ACharacter* Character = World->SpawnActor<ACharacter>(ACharacter::StaticClass(), FTransform::Identity, SpawnParameters);
+	UVitalityWelfareComponent* Welfare	= FVitalityBenchmarkUtils::AddComponent<UVitalityWelfareComponent>(Character);
+	UVitalityEffectsComponent* Effects	= FVitalityBenchmarkUtils::AddComponent<UVitalityEffectsComponent>(Character);
+	UVitalityStatComponent* Stats		= FVitalityBenchmarkUtils::AddComponent<UVitalityStatComponent>(Character);
+
+	const int32 NumBenefits		= static_cast<int32>(EEffectsBeneficial::MAX);
+	const int32 NumDamageTypes	= static_cast<int32>(EDamageType::MAX);
+	for (int32 i = 0; i < NumDamageTypes; i++)
+		Stats->SetNaturalResistanceValue(static_cast<EDamageType>(i), i);
+
+	TArray<FMicroBenchmarkCase> Cases;
+	Cases.Add({TEXT("DamageHealth"), 0,
+		[Welfare]()
+		{
+			// Enough health that no iteration can kill the character
+			Welfare->InitializeSubsystem(EVitalityCategory::HEALTH, true, 1.0e9f, 1.0e9f, 0.f);
+		},
+		[Welfare](int32 Num)
+		{
+			for (int32 i = 0; i < Num; i++)
+				BenchmarkSink = Welfare->DamageHealth(nullptr, 1.f);
+		}});
+
+	Cases.Add({TEXT("StatsConstruct"), 0, nullptr,
+		[](int32 Num)
+		{
+			for (int32 i = 0; i < Num; i++)
+			{
+				const FStVitalityStats NewStats;
+				BenchmarkSink = NewStats.CoreStats.Num();
+			}
+		}});
+
+	const FStVitalityStats SourceStats;
+	Cases.Add({TEXT("StatsCopy"), 0, nullptr,
+		[&SourceStats](int32 Num)
+		{
+			for (int32 i = 0; i < Num; i++)
+			{
+				const FStVitalityStats CopiedStats = SourceStats;
+				BenchmarkSink = CopiedStats.DamageResists.Num();
+			}
+		}});
+
+	Cases.Add({TEXT("GetTotalResistance"), 0, nullptr,
+		[Stats, NumDamageTypes](int32 Num)
+		{
+			for (int32 i = 0; i < Num; i++)
+				BenchmarkSink = Stats->GetTotalResistance(static_cast<EDamageType>(i % NumDamageTypes));
+		}});
+
+	// The row lookup ApplyEffect makes through UVitalityEffect
+	TArray<FName> EffectNames;
+	for (int32 i = 0; i < NumBenefits; i++)
+		EffectNames.Add(*UEnum::GetValueAsString(static_cast<EEffectsBeneficial>(i)));
+	Cases.Add({TEXT("GetVitalityEffect"), 0, nullptr,
+		[&EffectNames](int32 Num)
+		{
+			for (int32 i = 0; i < Num; i++)
+				BenchmarkSink = UVitalityEffect::GetVitalityEffect(EffectNames[i % EffectNames.Num()]).effectTicks;
+		}});
+
+	Cases.Add({TEXT("GetVitalityEffectByBenefit"), 0, nullptr,
+		[NumBenefits](int32 Num)
+		{
+			for (int32 i = 0; i < Num; i++)
+				BenchmarkSink = UVitalityEffect::GetVitalityEffectByBenefit(static_cast<EEffectsBeneficial>(i % NumBenefits)).effectTicks;
+		}});
+
+#if !UE_BUILD_SHIPPING
+	for (const int32 EffectCount : EffectCounts)
+	{
+		// Half of the old effects expired and were replaced by as many new ones
+		TSharedRef<TArray<FStVitalityEffects>> OldEffects = MakeShared<TArray<FStVitalityEffects>>(MakeEffects(EffectCount, 0));
+		TSharedRef<TArray<FStVitalityEffects>> NewEffects = MakeShared<TArray<FStVitalityEffects>>(MakeEffects(EffectCount, EffectCount / 2));
+		Cases.Add({TEXT("OnRepEffectsDiff"), EffectCount,
+			[Effects, NewEffects]()
+			{
+				Effects->SetActiveEffectsForTesting(*NewEffects);
+			},
+			[Effects, OldEffects](int32 Num)
+			{
+				for (int32 i = 0; i < Num; i++)
+					Effects->DiffEffectsForTesting(*OldEffects);
+			}});
+
+		Cases.Add({TEXT("GenerateUniqueId"), EffectCount,
+			[Effects, NewEffects]()
+			{
+				Effects->SetActiveEffectsForTesting(*NewEffects);
+			},
+			[Effects](int32 Num)
+			{
+				for (int32 i = 0; i < Num; i++)
+					BenchmarkSink = Effects->GenerateUniqueIdForTesting();
+			}});
+	}
+#endif
+
+	TArray<FVitalityMicroBenchmarkResult> Results;
+	for (const FMicroBenchmarkCase& Case : Cases)
+	{
+		if (!Filter.IsEmpty() && !Case.Name.Contains(Filter))
+			continue;
+		const FVitalityMicroBenchmarkResult& Result = Results.Add_GetRef(RunCase(Case, Iterations, Samples, Warmup));
+		UE_LOG(LogTemp, Display, TEXT("VitalityMicroBenchmark: %-28s %6d  %10.1f ns/op mean, %10.1f median, %8.1f stddev, %10.1f p95"),
+			*Result.Name, Result.Param, Result.NsMean, Result.NsMedian, Result.NsStdDev, Result.NsP95);
+	}
+
+	FVitalityBenchmarkUtils::DestroyWorld(World);
+
+	const bool bWrote = FVitalityBenchmarkUtils::WriteResults(OutputPath, TEXT("VitalityMicroBenchmark"), Results,
+		TEXT("Name,Param,Iterations,Samples,NsMean,NsMedian,NsStdDev,NsMin,NsP95,NsMax"),
+		[](const FVitalityMicroBenchmarkResult& Result)
+		{
+			return FString::Printf(TEXT("%s,%d,%d,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f"),
+				*Result.Name, Result.Param, Result.Iterations, Result.SampleNs.Num(),
+				Result.NsMean, Result.NsMedian, Result.NsStdDev, Result.NsMin, Result.NsP95, Result.NsMax);
+		},
+		[](TJsonWriter<>& Writer, const FVitalityMicroBenchmarkResult& Result)
+		{
+			Writer.WriteValue(TEXT("Name"), Result.Name);
+			Writer.WriteValue(TEXT("Param"), Result.Param);
+			Writer.WriteValue(TEXT("Iterations"), Result.Iterations);
+			Writer.WriteValue(TEXT("Samples"), Result.SampleNs.Num());
+			Writer.WriteValue(TEXT("NsMean"), Result.NsMean);
+			Writer.WriteValue(TEXT("NsMedian"), Result.NsMedian);
+			Writer.WriteValue(TEXT("NsStdDev"), Result.NsStdDev);
+			Writer.WriteValue(TEXT("NsMin"), Result.NsMin);
+			Writer.WriteValue(TEXT("NsP95"), Result.NsP95);
+			Writer.WriteValue(TEXT("NsMax"), Result.NsMax);
+			Writer.WriteArrayStart(TEXT("SampleNs"));
+			for (const double SampleNs : Result.SampleNs)
+				Writer.WriteValue(SampleNs);
+			Writer.WriteArrayEnd();
+		});
+	return bWrote ? 0 : 1;
+}
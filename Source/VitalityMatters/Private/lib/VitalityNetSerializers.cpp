@@ -0,0 +1,646 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "lib/VitalityNetSerializers.h"
+
+#if UE_WITH_IRIS
+
+#include "Iris/ReplicationState/PropertyNetSerializerInfoRegistry.h"
+#include "Iris/Serialization/NetBitStreamReader.h"
+#include "Iris/Serialization/NetBitStreamWriter.h"
+#include "Iris/Serialization/NetSerializerDelegates.h"
+#include "Engine/DataTable.h"
+#include "lib/StatusEffects.h"
+#include "lib/VitalityData.h"
+#include "lib/VitalityDataBlob.h"
+#include "lib/VitalitySnapshot.h"
+
+namespace UE::Net
+{
+
+namespace VitalityNetSerializer
+{
+	// Values are sent in hundredths
+	constexpr float QuantizeScale	= 100.f;
+	// Half the int32 range, so the difference of any two quantized values still fits
+	constexpr float QuantizeLimit	= static_cast<float>(MAX_int32 / 2);
+
+	int32 QuantizeValue(float Value)
+	{
+		return FMath::RoundToInt32(FMath::Clamp(Value * QuantizeScale, -QuantizeLimit, QuantizeLimit));
+	}
+
+	float DequantizeValue(int32 Value)
+	{
+		return static_cast<float>(Value) / QuantizeScale;
+	}
+
+	// Zigzag encoded, so small negative values stay small, then sent in 8, 16 or 32 bits
+	void WritePackedInt(FNetBitStreamWriter* Writer, int32 Value)
+	{
+		const uint32 Encoded = (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31);
+		if (Encoded < (1U << 8))
+		{
+			Writer->WriteBool(false);
+			Writer->WriteBits(Encoded, 8);
+			return;
+		}
+		Writer->WriteBool(true);
+		if (Encoded < (1U << 16))
+		{
+			Writer->WriteBool(false);
+			Writer->WriteBits(Encoded, 16);
+			return;
+		}
+		Writer->WriteBool(true);
+		Writer->WriteBits(Encoded, 32);
+	}
+
+	int32 ReadPackedInt(FNetBitStreamReader* Reader)
+	{
+		uint32 Encoded = 0;
+		if (!Reader->ReadBool())
+			Encoded = Reader->ReadBits(8);
+		else if (!Reader->ReadBool())
+			Encoded = Reader->ReadBits(16);
+		else
+			Encoded = Reader->ReadBits(32);
+		return static_cast<int32>(Encoded >> 1) ^ -static_cast<int32>(Encoded & 1);
+	}
+
+	// Sends each value behind a changed bit, as the difference from the previous value
+	void WriteDeltaValues(FNetBitStreamWriter* Writer, const int32* Values, const int32* PrevValues, int32 NumValues)
+	{
+		for (int32 i = 0; i < NumValues; i++)
+		{
+			const bool bChanged = Values[i] != PrevValues[i];
+			Writer->WriteBool(bChanged);
+			if (bChanged)
+				WritePackedInt(Writer, Values[i] - PrevValues[i]);
+		}
+	}
+
+	void ReadDeltaValues(FNetBitStreamReader* Reader, int32* Values, const int32* PrevValues, int32 NumValues)
+	{
+		for (int32 i = 0; i < NumValues; i++)
+			Values[i] = Reader->ReadBool() ? PrevValues[i] + ReadPackedInt(Reader) : PrevValues[i];
+	}
+}
+
+
+/****************************************
+ * POOL BLOCK
+****************************************/
+
+struct FVitalityPoolBlockNetSerializer
+{
+	static const uint32 Version = 0;
+
+	typedef FVitalityPoolBlock SourceType;
+	struct FQuantizedType
+	{
+		int32 Current[FVitalityPoolBlock::NumPools];
+		int32 Maximum[FVitalityPoolBlock::NumPools];
+	};
+	typedef FQuantizedType QuantizedType;
+	typedef FVitalityPoolBlockNetSerializerConfig ConfigType;
+	static const ConfigType DefaultConfig;
+
+	static void Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args);
+	static void Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args);
+	static void SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args);
+	static void DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args);
+	static void Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args);
+	static void Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args);
+	static bool IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args);
+	static bool Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args);
+};
+UE_NET_IMPLEMENT_SERIALIZER(FVitalityPoolBlockNetSerializer);
+const FVitalityPoolBlockNetSerializer::ConfigType FVitalityPoolBlockNetSerializer::DefaultConfig;
+
+void FVitalityPoolBlockNetSerializer::Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args)
+{
+	const QuantizedType& Value = *reinterpret_cast<const QuantizedType*>(Args.Source);
+	FNetBitStreamWriter* Writer = Context.GetBitStreamWriter();
+	for (int32 i = 0; i < FVitalityPoolBlock::NumPools; i++)
+	{
+		VitalityNetSerializer::WritePackedInt(Writer, Value.Current[i]);
+		VitalityNetSerializer::WritePackedInt(Writer, Value.Maximum[i]);
+	}
+}
+
+void FVitalityPoolBlockNetSerializer::Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args)
+{
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+	FNetBitStreamReader* Reader = Context.GetBitStreamReader();
+	for (int32 i = 0; i < FVitalityPoolBlock::NumPools; i++)
+	{
+		Target.Current[i] = VitalityNetSerializer::ReadPackedInt(Reader);
+		Target.Maximum[i] = VitalityNetSerializer::ReadPackedInt(Reader);
+	}
+}
+
+void FVitalityPoolBlockNetSerializer::SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args)
+{
+	const QuantizedType& Value	= *reinterpret_cast<const QuantizedType*>(Args.Source);
+	const QuantizedType& Prev	= *reinterpret_cast<const QuantizedType*>(Args.Prev);
+	FNetBitStreamWriter* Writer = Context.GetBitStreamWriter();
+	VitalityNetSerializer::WriteDeltaValues(Writer, Value.Current, Prev.Current, FVitalityPoolBlock::NumPools);
+	VitalityNetSerializer::WriteDeltaValues(Writer, Value.Maximum, Prev.Maximum, FVitalityPoolBlock::NumPools);
+}
+
+void FVitalityPoolBlockNetSerializer::DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args)
+{
+	QuantizedType& Target		= *reinterpret_cast<QuantizedType*>(Args.Target);
+	const QuantizedType& Prev	= *reinterpret_cast<const QuantizedType*>(Args.Prev);
+	FNetBitStreamReader* Reader = Context.GetBitStreamReader();
+	VitalityNetSerializer::ReadDeltaValues(Reader, Target.Current, Prev.Current, FVitalityPoolBlock::NumPools);
+	VitalityNetSerializer::ReadDeltaValues(Reader, Target.Maximum, Prev.Maximum, FVitalityPoolBlock::NumPools);
+}
+
+void FVitalityPoolBlockNetSerializer::Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+	for (int32 i = 0; i < FVitalityPoolBlock::NumPools; i++)
+	{
+		Target.Current[i] = VitalityNetSerializer::QuantizeValue(Source.Current[i]);
+		Target.Maximum[i] = VitalityNetSerializer::QuantizeValue(Source.Maximum[i]);
+	}
+}
+
+void FVitalityPoolBlockNetSerializer::Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args)
+{
+	const QuantizedType& Source = *reinterpret_cast<const QuantizedType*>(Args.Source);
+	SourceType& Target = *reinterpret_cast<SourceType*>(Args.Target);
+	for (int32 i = 0; i < FVitalityPoolBlock::NumPools; i++)
+	{
+		Target.Current[i] = VitalityNetSerializer::DequantizeValue(Source.Current[i]);
+		Target.Maximum[i] = VitalityNetSerializer::DequantizeValue(Source.Maximum[i]);
+	}
+}
+
+bool FVitalityPoolBlockNetSerializer::IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args)
+{
+	if (Args.bStateIsQuantized)
+		return FMemory::Memcmp(reinterpret_cast<const void*>(Args.Source0), reinterpret_cast<const void*>(Args.Source1), sizeof(QuantizedType)) == 0;
+	return *reinterpret_cast<const SourceType*>(Args.Source0) == *reinterpret_cast<const SourceType*>(Args.Source1);
+}
+
+bool FVitalityPoolBlockNetSerializer::Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	for (int32 i = 0; i < FVitalityPoolBlock::NumPools; i++)
+	{
+		if (!FMath::IsFinite(Source.Current[i]) || !FMath::IsFinite(Source.Maximum[i]))
+			return false;
+	}
+	return true;
+}
+
+
+/****************************************
+ * STAT LAYERS
+****************************************/
+
+struct FVitalityStatsNetSerializer
+{
+	static const uint32 Version = 0;
+
+	static constexpr int32 MaxCoreStats		= FVitalityStatSnapshot::NumCoreStats;
+	static constexpr int32 MaxDamageTypes	= FVitalityStatSnapshot::NumDamageTypes;
+	static_assert(MaxCoreStats < 256 && MaxDamageTypes < 256, "Layer sizes are sent in 8 bits");
+
+	typedef FStVitalityStats SourceType;
+	struct FQuantizedType
+	{
+		// Values past the sizes are always zero, so deltas can run over the whole arrays
+		int32 CoreStats[MaxCoreStats];
+		int32 DamageBonuses[MaxDamageTypes];
+		int32 DamageResists[MaxDamageTypes];
+		uint8 NumCoreStats;
+		uint8 NumDamageBonuses;
+		uint8 NumDamageResists;
+	};
+	typedef FQuantizedType QuantizedType;
+	typedef FVitalityStatsNetSerializerConfig ConfigType;
+	static const ConfigType DefaultConfig;
+
+	static void Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args);
+	static void Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args);
+	static void SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args);
+	static void DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args);
+	static void Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args);
+	static void Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args);
+	static bool IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args);
+	static bool Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args);
+
+private:
+
+	static void WriteSizes(FNetBitStreamWriter* Writer, const QuantizedType& Value);
+	// Clamps the sizes read to the maximums, and zeroes every value
+	static void ReadSizes(FNetBitStreamReader* Reader, QuantizedType& Target);
+};
+UE_NET_IMPLEMENT_SERIALIZER(FVitalityStatsNetSerializer);
+const FVitalityStatsNetSerializer::ConfigType FVitalityStatsNetSerializer::DefaultConfig;
+
+void FVitalityStatsNetSerializer::WriteSizes(FNetBitStreamWriter* Writer, const QuantizedType& Value)
+{
+	Writer->WriteBits(Value.NumCoreStats, 8);
+	Writer->WriteBits(Value.NumDamageBonuses, 8);
+	Writer->WriteBits(Value.NumDamageResists, 8);
+}
+
+void FVitalityStatsNetSerializer::ReadSizes(FNetBitStreamReader* Reader, QuantizedType& Target)
+{
+	FMemory::Memzero(Target);
+	Target.NumCoreStats		= static_cast<uint8>(FMath::Min<uint32>(Reader->ReadBits(8), MaxCoreStats));
+	Target.NumDamageBonuses	= static_cast<uint8>(FMath::Min<uint32>(Reader->ReadBits(8), MaxDamageTypes));
+	Target.NumDamageResists	= static_cast<uint8>(FMath::Min<uint32>(Reader->ReadBits(8), MaxDamageTypes));
+}
+
+void FVitalityStatsNetSerializer::Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args)
+{
+	const QuantizedType& Value = *reinterpret_cast<const QuantizedType*>(Args.Source);
+	FNetBitStreamWriter* Writer = Context.GetBitStreamWriter();
+	WriteSizes(Writer, Value);
+	for (int32 i = 0; i < Value.NumCoreStats; i++)
+		VitalityNetSerializer::WritePackedInt(Writer, Value.CoreStats[i]);
+	for (int32 i = 0; i < Value.NumDamageBonuses; i++)
+		VitalityNetSerializer::WritePackedInt(Writer, Value.DamageBonuses[i]);
+	for (int32 i = 0; i < Value.NumDamageResists; i++)
+		VitalityNetSerializer::WritePackedInt(Writer, Value.DamageResists[i]);
+}
+
+void FVitalityStatsNetSerializer::Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args)
+{
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+	FNetBitStreamReader* Reader = Context.GetBitStreamReader();
+	ReadSizes(Reader, Target);
+	for (int32 i = 0; i < Target.NumCoreStats; i++)
+		Target.CoreStats[i] = VitalityNetSerializer::ReadPackedInt(Reader);
+	for (int32 i = 0; i < Target.NumDamageBonuses; i++)
+		Target.DamageBonuses[i] = VitalityNetSerializer::ReadPackedInt(Reader);
+	for (int32 i = 0; i < Target.NumDamageResists; i++)
+		Target.DamageResists[i] = VitalityNetSerializer::ReadPackedInt(Reader);
+}
+
+void FVitalityStatsNetSerializer::SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args)
+{
+	const QuantizedType& Value	= *reinterpret_cast<const QuantizedType*>(Args.Source);
+	const QuantizedType& Prev	= *reinterpret_cast<const QuantizedType*>(Args.Prev);
+	FNetBitStreamWriter* Writer = Context.GetBitStreamWriter();
+
+	// The sizes only change when the stat or damage type enums do
+	const bool bSameSizes = Value.NumCoreStats == Prev.NumCoreStats
+		&& Value.NumDamageBonuses == Prev.NumDamageBonuses && Value.NumDamageResists == Prev.NumDamageResists;
+	Writer->WriteBool(bSameSizes);
+	if (!bSameSizes)
+		WriteSizes(Writer, Value);
+
+	VitalityNetSerializer::WriteDeltaValues(Writer, Value.CoreStats, Prev.CoreStats, Value.NumCoreStats);
+	VitalityNetSerializer::WriteDeltaValues(Writer, Value.DamageBonuses, Prev.DamageBonuses, Value.NumDamageBonuses);
+	VitalityNetSerializer::WriteDeltaValues(Writer, Value.DamageResists, Prev.DamageResists, Value.NumDamageResists);
+}
+
+void FVitalityStatsNetSerializer::DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args)
+{
+	QuantizedType& Target		= *reinterpret_cast<QuantizedType*>(Args.Target);
+	const QuantizedType& Prev	= *reinterpret_cast<const QuantizedType*>(Args.Prev);
+	FNetBitStreamReader* Reader = Context.GetBitStreamReader();
+
+	if (Reader->ReadBool())
+	{
+		FMemory::Memzero(Target);
+		Target.NumCoreStats		= Prev.NumCoreStats;
+		Target.NumDamageBonuses	= Prev.NumDamageBonuses;
+		Target.NumDamageResists	= Prev.NumDamageResists;
+	}
+	else
+	{
+		ReadSizes(Reader, Target);
+	}
+
+	VitalityNetSerializer::ReadDeltaValues(Reader, Target.CoreStats, Prev.CoreStats, Target.NumCoreStats);
+	VitalityNetSerializer::ReadDeltaValues(Reader, Target.DamageBonuses, Prev.DamageBonuses, Target.NumDamageBonuses);
+	VitalityNetSerializer::ReadDeltaValues(Reader, Target.DamageResists, Prev.DamageResists, Target.NumDamageResists);
+}
+
+void FVitalityStatsNetSerializer::Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+	FMemory::Memzero(Target);
+
+	Target.NumCoreStats		= static_cast<uint8>(FMath::Min(Source.CoreStats.Num(), MaxCoreStats));
+	Target.NumDamageBonuses	= static_cast<uint8>(FMath::Min(Source.DamageBonuses.Num(), MaxDamageTypes));
+	Target.NumDamageResists	= static_cast<uint8>(FMath::Min(Source.DamageResists.Num(), MaxDamageTypes));
+	for (int32 i = 0; i < Target.NumCoreStats; i++)
+		Target.CoreStats[i] = VitalityNetSerializer::QuantizeValue(Source.CoreStats[i]);
+	for (int32 i = 0; i < Target.NumDamageBonuses; i++)
+		Target.DamageBonuses[i] = VitalityNetSerializer::QuantizeValue(Source.DamageBonuses[i]);
+	for (int32 i = 0; i < Target.NumDamageResists; i++)
+		Target.DamageResists[i] = VitalityNetSerializer::QuantizeValue(Source.DamageResists[i]);
+}
+
+void FVitalityStatsNetSerializer::Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args)
+{
+	const QuantizedType& Source = *reinterpret_cast<const QuantizedType*>(Args.Source);
+	SourceType& Target = *reinterpret_cast<SourceType*>(Args.Target);
+
+	// Only the layers are written. The delegates bound on the target are left alone.
+	Target.CoreStats.SetNum(Source.NumCoreStats);
+	for (int32 i = 0; i < Source.NumCoreStats; i++)
+		Target.CoreStats[i] = VitalityNetSerializer::DequantizeValue(Source.CoreStats[i]);
+	Target.DamageBonuses.SetNum(Source.NumDamageBonuses);
+	for (int32 i = 0; i < Source.NumDamageBonuses; i++)
+		Target.DamageBonuses[i] = VitalityNetSerializer::DequantizeValue(Source.DamageBonuses[i]);
+	Target.DamageResists.SetNum(Source.NumDamageResists);
+	for (int32 i = 0; i < Source.NumDamageResists; i++)
+		Target.DamageResists[i] = VitalityNetSerializer::DequantizeValue(Source.DamageResists[i]);
+}
+
+bool FVitalityStatsNetSerializer::IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args)
+{
+	if (Args.bStateIsQuantized)
+		return FMemory::Memcmp(reinterpret_cast<const void*>(Args.Source0), reinterpret_cast<const void*>(Args.Source1), sizeof(QuantizedType)) == 0;
+
+	const SourceType& Source0 = *reinterpret_cast<const SourceType*>(Args.Source0);
+	const SourceType& Source1 = *reinterpret_cast<const SourceType*>(Args.Source1);
+	return Source0.CoreStats == Source1.CoreStats
+		&& Source0.DamageBonuses == Source1.DamageBonuses
+		&& Source0.DamageResists == Source1.DamageResists;
+}
+
+bool FVitalityStatsNetSerializer::Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	return Source.CoreStats.Num() <= MaxCoreStats
+		&& Source.DamageBonuses.Num() <= MaxDamageTypes
+		&& Source.DamageResists.Num() <= MaxDamageTypes;
+}
+
+
+/****************************************
+ * EFFECTS
+****************************************/
+
+struct FVitalityEffectNetSerializer
+{
+	static const uint32 Version = 1;
+
+	enum EFlags : uint8
+	{
+		FLAG_PERSISTENT			= 1 << 0,
+		FLAG_STACKS				= 1 << 1,
+		FLAG_ATTACH_ON_SPAWN	= 1 << 2,
+		FLAG_DISABLE_SPRINTING	= 1 << 3,
+		NUM_FLAG_BITS			= 4
+	};
+
+	typedef FStVitalityEffects SourceType;
+	struct FQuantizedType
+	{
+		// FVitalityDataBlob::HashName() of the row name, for effects with neither enum set. Zero for none.
+		uint64 NameHash;
+		int32 EffectTicks;
+		int32 UniqueId;
+		uint8 BenefitEffect;
+		uint8 DetrimentEffect;
+		uint8 Flags;
+	};
+	typedef FQuantizedType QuantizedType;
+	typedef FVitalityEffectNetSerializerConfig ConfigType;
+	static const ConfigType DefaultConfig;
+
+	static void Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args);
+	static void Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args);
+	static void SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args);
+	static void DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args);
+	static void Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args);
+	static void Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args);
+	static bool IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args);
+	static bool Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args);
+
+private:
+
+	static bool IsTableEffect(const QuantizedType& Value)
+	{
+		return Value.BenefitEffect == static_cast<uint8>(EEffectsBeneficial::MAX)
+			&& Value.DetrimentEffect == static_cast<uint8>(EEffectsDetrimental::MAX);
+	}
+	static void WriteStatic(FNetBitStreamWriter* Writer, const QuantizedType& Value);
+	static void ReadStatic(FNetBitStreamReader* Reader, QuantizedType& Target);
+	// Returns the effects table row whose name hashes to NameHash, or none
+	static FName FindRowName(uint64 NameHash);
+};
+UE_NET_IMPLEMENT_SERIALIZER(FVitalityEffectNetSerializer);
+const FVitalityEffectNetSerializer::ConfigType FVitalityEffectNetSerializer::DefaultConfig;
+
+// Everything but the ticks, which count down while the rest of the effect stays the same
+void FVitalityEffectNetSerializer::WriteStatic(FNetBitStreamWriter* Writer, const QuantizedType& Value)
+{
+	Writer->WriteBits(Value.BenefitEffect, 8);
+	Writer->WriteBits(Value.DetrimentEffect, 8);
+	Writer->WriteBits(Value.Flags, NUM_FLAG_BITS);
+	Writer->WriteBits(static_cast<uint32>(Value.UniqueId), 32);
+	// Only effects with neither enum set need their row name to be told apart
+	if (IsTableEffect(Value))
+	{
+		Writer->WriteBits(static_cast<uint32>(Value.NameHash), 32);
+		Writer->WriteBits(static_cast<uint32>(Value.NameHash >> 32), 32);
+	}
+}
+
+void FVitalityEffectNetSerializer::ReadStatic(FNetBitStreamReader* Reader, QuantizedType& Target)
+{
+	Target.BenefitEffect	= static_cast<uint8>(FMath::Min<uint32>(Reader->ReadBits(8), static_cast<uint32>(EEffectsBeneficial::MAX)));
+	Target.DetrimentEffect	= static_cast<uint8>(FMath::Min<uint32>(Reader->ReadBits(8), static_cast<uint32>(EEffectsDetrimental::MAX)));
+	Target.Flags			= static_cast<uint8>(Reader->ReadBits(NUM_FLAG_BITS));
+	Target.UniqueId			= static_cast<int32>(Reader->ReadBits(32));
+	Target.NameHash			= 0;
+	if (IsTableEffect(Target))
+	{
+		const uint64 LowBits	= Reader->ReadBits(32);
+		const uint64 HighBits	= Reader->ReadBits(32);
+		Target.NameHash			= LowBits | (HighBits << 32);
+	}
+}
+
+FName FVitalityEffectNetSerializer::FindRowName(uint64 NameHash)
+{
+	// The table is small, and this only runs when a client receives a different effect
+	const UDataTable* EffectsTable = UVitalityEffect::GetVitalityEffectsTable();
+	if (NameHash == 0 || !IsValid(EffectsTable))
+		return NAME_None;
+	for (const TPair<FName, uint8*>& Row : EffectsTable->GetRowMap())
+	{
+		if (FVitalityDataBlob::HashName(Row.Key) == NameHash)
+			return Row.Key;
+	}
+	return NAME_None;
+}
+
+void FVitalityEffectNetSerializer::Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args)
+{
+	const QuantizedType& Value = *reinterpret_cast<const QuantizedType*>(Args.Source);
+	FNetBitStreamWriter* Writer = Context.GetBitStreamWriter();
+	WriteStatic(Writer, Value);
+	VitalityNetSerializer::WritePackedInt(Writer, Value.EffectTicks);
+}
+
+void FVitalityEffectNetSerializer::Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args)
+{
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+	FNetBitStreamReader* Reader = Context.GetBitStreamReader();
+	ReadStatic(Reader, Target);
+	Target.EffectTicks = VitalityNetSerializer::ReadPackedInt(Reader);
+}
+
+void FVitalityEffectNetSerializer::SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args)
+{
+	const QuantizedType& Value	= *reinterpret_cast<const QuantizedType*>(Args.Source);
+	const QuantizedType& Prev	= *reinterpret_cast<const QuantizedType*>(Args.Prev);
+	FNetBitStreamWriter* Writer = Context.GetBitStreamWriter();
+
+	const bool bSameEffect = Value.UniqueId == Prev.UniqueId && Value.BenefitEffect == Prev.BenefitEffect
+		&& Value.DetrimentEffect == Prev.DetrimentEffect && Value.Flags == Prev.Flags && Value.NameHash == Prev.NameHash;
+	Writer->WriteBool(bSameEffect);
+	if (!bSameEffect)
+		WriteStatic(Writer, Value);
+	VitalityNetSerializer::WritePackedInt(Writer, Value.EffectTicks - Prev.EffectTicks);
+}
+
+void FVitalityEffectNetSerializer::DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args)
+{
+	QuantizedType& Target		= *reinterpret_cast<QuantizedType*>(Args.Target);
+	const QuantizedType& Prev	= *reinterpret_cast<const QuantizedType*>(Args.Prev);
+	FNetBitStreamReader* Reader = Context.GetBitStreamReader();
+
+	if (Reader->ReadBool())
+		Target = Prev;
+	else
+		ReadStatic(Reader, Target);
+	Target.EffectTicks = Prev.EffectTicks + VitalityNetSerializer::ReadPackedInt(Reader);
+}
+
+void FVitalityEffectNetSerializer::Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+	FMemory::Memzero(Target);
+
+	Target.EffectTicks		= Source.effectTicks;
+	Target.UniqueId			= Source.uniqueId;
+	Target.BenefitEffect	= static_cast<uint8>(Source.benefitEffect);
+	Target.DetrimentEffect	= static_cast<uint8>(Source.detrimentEffect);
+	if (IsTableEffect(Target) && !Source.EffectName.IsNone())
+		Target.NameHash		= FVitalityDataBlob::HashName(Source.EffectName);
+	Target.Flags			= (Source.bIsPersistent ? FLAG_PERSISTENT : 0)
+							| (Source.bEffectStacks ? FLAG_STACKS : 0)
+							| (Source.attachOnSpawn ? FLAG_ATTACH_ON_SPAWN : 0)
+							| (Source.disableSprinting ? FLAG_DISABLE_SPRINTING : 0);
+}
+
+void FVitalityEffectNetSerializer::Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args)
+{
+	const QuantizedType& Source = *reinterpret_cast<const QuantizedType*>(Args.Source);
+	SourceType& Target = *reinterpret_cast<SourceType*>(Args.Target);
+
+	// The title, icon and class were not sent. Look them up only when the effect itself changed.
+	const EEffectsBeneficial BenefitEffect		= static_cast<EEffectsBeneficial>(Source.BenefitEffect);
+	const EEffectsDetrimental DetrimentEffect	= static_cast<EEffectsDetrimental>(Source.DetrimentEffect);
+	const bool bSameTableRow = !IsTableEffect(Source) || (Source.NameHash == 0 ? Target.EffectName.IsNone()
+		: !Target.EffectName.IsNone() && FVitalityDataBlob::HashName(Target.EffectName) == Source.NameHash);
+	if (Target.benefitEffect != BenefitEffect || Target.detrimentEffect != DetrimentEffect || !bSameTableRow)
+	{
+		if (BenefitEffect != EEffectsBeneficial::MAX)
+			Target = UVitalityEffect::GetVitalityEffectByBenefit(BenefitEffect);
+		else if (DetrimentEffect != EEffectsDetrimental::MAX)
+			Target = UVitalityEffect::GetVitalityEffectByDetriment(DetrimentEffect);
+		else
+		{
+			const FName RowName = FindRowName(Source.NameHash);
+			Target = RowName.IsNone() ? FStVitalityEffects() : UVitalityEffect::GetVitalityEffect(RowName);
+		}
+	}
+
+	Target.benefitEffect	= BenefitEffect;
+	Target.detrimentEffect	= DetrimentEffect;
+	Target.effectTicks		= Source.EffectTicks;
+	Target.uniqueId			= Source.UniqueId;
+	Target.bIsPersistent	= (Source.Flags & FLAG_PERSISTENT) != 0;
+	Target.bEffectStacks	= (Source.Flags & FLAG_STACKS) != 0;
+	Target.attachOnSpawn	= (Source.Flags & FLAG_ATTACH_ON_SPAWN) != 0;
+	Target.disableSprinting	= (Source.Flags & FLAG_DISABLE_SPRINTING) != 0;
+}
+
+bool FVitalityEffectNetSerializer::IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args)
+{
+	if (Args.bStateIsQuantized)
+		return FMemory::Memcmp(reinterpret_cast<const void*>(Args.Source0), reinterpret_cast<const void*>(Args.Source1), sizeof(QuantizedType)) == 0;
+
+	const SourceType& Source0 = *reinterpret_cast<const SourceType*>(Args.Source0);
+	const SourceType& Source1 = *reinterpret_cast<const SourceType*>(Args.Source1);
+	return Source0.uniqueId == Source1.uniqueId
+		&& Source0.EffectName == Source1.EffectName
+		&& Source0.effectTicks == Source1.effectTicks
+		&& Source0.benefitEffect == Source1.benefitEffect
+		&& Source0.detrimentEffect == Source1.detrimentEffect
+		&& Source0.bIsPersistent == Source1.bIsPersistent
+		&& Source0.bEffectStacks == Source1.bEffectStacks
+		&& Source0.attachOnSpawn == Source1.attachOnSpawn
+		&& Source0.disableSprinting == Source1.disableSprinting;
+}
+
+bool FVitalityEffectNetSerializer::Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	// MAX is the "none" value of both enums, so it is allowed, but nothing past it is
+	const uint32 BenefitValue	= static_cast<uint32>(Source.benefitEffect);
+	const uint32 DetrimentValue	= static_cast<uint32>(Source.detrimentEffect);
+	if (BenefitValue > static_cast<uint32>(EEffectsBeneficial::MAX)
+		|| DetrimentValue > static_cast<uint32>(EEffectsDetrimental::MAX))
+		return false;
+	// Effects with neither enum set are only told apart by their row name
+	return Source.uniqueId == 0 || Source.benefitEffect != EEffectsBeneficial::MAX
+		|| Source.detrimentEffect != EEffectsDetrimental::MAX || !Source.EffectName.IsNone();
+}
+
+
+/****************************************
+ * REGISTRATION
+****************************************/
+
+static const FName PropertyNetSerializerRegistry_NAME_VitalityPoolBlock(TEXT("VitalityPoolBlock"));
+static const FName PropertyNetSerializerRegistry_NAME_StVitalityStats(TEXT("StVitalityStats"));
+static const FName PropertyNetSerializerRegistry_NAME_StVitalityEffects(TEXT("StVitalityEffects"));
+UE_NET_IMPLEMENT_NAMED_STRUCT_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_VitalityPoolBlock, FVitalityPoolBlockNetSerializer);
+UE_NET_IMPLEMENT_NAMED_STRUCT_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_StVitalityStats, FVitalityStatsNetSerializer);
+UE_NET_IMPLEMENT_NAMED_STRUCT_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_StVitalityEffects, FVitalityEffectNetSerializer);
+
+// Binds the serializers to their structs before Iris freezes its serializer registry
+class FVitalityNetSerializerRegistryDelegates final : private FNetSerializerRegistryDelegates
+{
+public:
+
+	virtual ~FVitalityNetSerializerRegistryDelegates() override
+	{
+		UE_NET_UNREGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_VitalityPoolBlock);
+		UE_NET_UNREGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_StVitalityStats);
+		UE_NET_UNREGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_StVitalityEffects);
+	}
+
+private:
+
+	virtual void OnPreFreezeNetSerializerRegistry() override
+	{
+		UE_NET_REGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_VitalityPoolBlock);
+		UE_NET_REGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_StVitalityStats);
+		UE_NET_REGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_StVitalityEffects);
+	}
+};
+static FVitalityNetSerializerRegistryDelegates VitalityNetSerializerRegistryDelegates;
+
+}
+
+#endif // UE_WITH_IRIS
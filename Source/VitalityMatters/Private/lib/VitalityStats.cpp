@@ -0,0 +1,203 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "lib/VitalityStats.h"
+
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+#include "VitalityEffectsComponent.h"
+#include "VitalityStatComponent.h"
+#include "VitalityWelfareComponent.h"
+
+DEFINE_STAT(STAT_VitalityDamageHealth);
+DEFINE_STAT(STAT_VitalityTickEffects);
+DEFINE_STAT(STAT_VitalityTickWelfare);
+DEFINE_STAT(STAT_VitalityOnRepWelfare);
+DEFINE_STAT(STAT_VitalityOnRepEffects);
+DEFINE_STAT(STAT_VitalityStatsEventTrigger);
+DEFINE_STAT(STAT_VitalityTickDigestion);
+DEFINE_STAT(STAT_VitalityPublishSnapshot);
+DEFINE_STAT(STAT_VitalityParallelUpdate);
+DEFINE_STAT(STAT_VitalityParallelApply);
+DEFINE_STAT(STAT_VitalityMassDamage);
+DEFINE_STAT(STAT_VitalityMassPools);
+DEFINE_STAT(STAT_VitalityMassEffects);
+DEFINE_STAT(STAT_VitalityMassBridge);
+
+DEFINE_STAT(STAT_VitalityDamageEvents);
+DEFINE_STAT(STAT_VitalityEffectsApplied);
+DEFINE_STAT(STAT_VitalityEffectsExpired);
+DEFINE_STAT(STAT_VitalityTimersFired);
+DEFINE_STAT(STAT_VitalityDelegatesBroadcast);
+DEFINE_STAT(STAT_VitalityPoolsReplicated);
+DEFINE_STAT(STAT_VitalityPoolsHeldBack);
+
+UE_TRACE_CHANNEL_DEFINE(VitalityChannel);
+
+UE_TRACE_EVENT_BEGIN(Vitality, DamageApplied)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ActorId)
+	UE_TRACE_EVENT_FIELD(uint32, InstigatorId)
+	UE_TRACE_EVENT_FIELD(float, DamageTaken)
+	UE_TRACE_EVENT_FIELD(float, HealthAfter)
+	UE_TRACE_EVENT_FIELD(bool, bKilled)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Vitality, EffectApplied)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ActorId)
+	UE_TRACE_EVENT_FIELD(int32, UniqueId)
+	UE_TRACE_EVENT_FIELD(int32, StackCount)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, EffectName)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Vitality, EffectExpired)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ActorId)
+	UE_TRACE_EVENT_FIELD(int32, UniqueId)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, EffectName)
+UE_TRACE_EVENT_END()
+
+
+namespace
+{
+	uint32 GetTraceId(const AActor* Actor)
+	{
+		return Actor != nullptr ? Actor->GetUniqueID() : 0;
+	}
+
+	// Memory held by a set of vitality components
+	struct FMemoryReportRow
+	{
+		FString Name;
+		int32 NumComponents	= 0;
+		// The components themselves
+		SIZE_T ObjectBytes	= 0;
+		FVitalityMemoryUsage Usage;
+
+		SIZE_T GetTotal() const { return ObjectBytes + Usage.GetTotal(); }
+
+		void Add(const UActorComponent* Component, const FVitalityMemoryUsage& ComponentUsage)
+		{
+			NumComponents++;
+			ObjectBytes += Component->GetClass()->GetStructureSize();
+			Usage		+= ComponentUsage;
+		}
+	};
+
+	template<typename ComponentType>
+	void GatherMemoryUsage(const UWorld* World, FMemoryReportRow& ClassRow, TMap<const AActor*, FMemoryReportRow>& ActorRows)
+	{
+		ClassRow.Name = ComponentType::StaticClass()->GetName();
+		for (TObjectIterator<ComponentType> It; It; ++It)
+		{
+			const ComponentType* Component = *It;
+			if (Component->IsTemplate() || Component->GetWorld() != World)
+				continue;
+			FVitalityMemoryUsage ComponentUsage;
+			Component->GetMemoryUsage(ComponentUsage);
+			ClassRow.Add(Component, ComponentUsage);
+
+			const AActor* Owner = Component->GetOwner();
+			FMemoryReportRow& ActorRow = ActorRows.FindOrAdd(Owner);
+			if (ActorRow.NumComponents == 0)
+				ActorRow.Name = GetNameSafe(Owner);
+			ActorRow.Add(Component, ComponentUsage);
+		}
+	}
+
+	void LogMemoryReportRow(FOutputDevice& Ar, const FMemoryReportRow& Row)
+	{
+		Ar.Logf(TEXT("%-40s %6d %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f"), *Row.Name, Row.NumComponents,
+			Row.ObjectBytes / 1024.0, Row.Usage.History / 1024.0, Row.Usage.Effects / 1024.0,
+			Row.Usage.Stats / 1024.0, Row.Usage.Queues / 1024.0, Row.Usage.Other / 1024.0, Row.GetTotal() / 1024.0);
+	}
+
+	/**
+	 * @brief Lists the memory held by every vitality component in the world, by class and by
+	 *        container, followed by the actors holding the most. Sizes are in KiB.
+	 * @param Args Optionally, the number of actors to list. Defaults to 20.
+	 */
+	void DumpMemoryReport(const TArray<FString>& Args, UWorld* World, FOutputDevice& Ar)
+	{
+		if (World == nullptr)
+			return;
+		const int32 NumTopActors = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 0) : 20;
+
+		FMemoryReportRow ClassRows[3];
+		TMap<const AActor*, FMemoryReportRow> ActorRows;
+		GatherMemoryUsage<UVitalityWelfareComponent>(World, ClassRows[0], ActorRows);
+		GatherMemoryUsage<UVitalityEffectsComponent>(World, ClassRows[1], ActorRows);
+		GatherMemoryUsage<UVitalityStatComponent>(World, ClassRows[2], ActorRows);
+
+		FMemoryReportRow WorldRow;
+		WorldRow.Name = TEXT("Total");
+		for (const FMemoryReportRow& ClassRow : ClassRows)
+		{
+			WorldRow.NumComponents	+= ClassRow.NumComponents;
+			WorldRow.ObjectBytes	+= ClassRow.ObjectBytes;
+			WorldRow.Usage			+= ClassRow.Usage;
+		}
+
+		const TCHAR* HeaderFormat = TEXT("%-40s %6s %10s %10s %10s %10s %10s %10s %10s");
+		Ar.Logf(TEXT("Vitality memory in %s (KiB)"), *World->GetName());
+		Ar.Logf(HeaderFormat, TEXT("Class"), TEXT("Count"), TEXT("Object"), TEXT("History"),
+			TEXT("Effects"), TEXT("Stats"), TEXT("Queues"), TEXT("Other"), TEXT("Total"));
+		for (const FMemoryReportRow& ClassRow : ClassRows)
+			LogMemoryReportRow(Ar, ClassRow);
+		LogMemoryReportRow(Ar, WorldRow);
+
+		if (NumTopActors < 1 || ActorRows.Num() < 1)
+			return;
+		TArray<FMemoryReportRow> SortedActors;
+		ActorRows.GenerateValueArray(SortedActors);
+		SortedActors.Sort([](const FMemoryReportRow& A, const FMemoryReportRow& B) { return A.GetTotal() > B.GetTotal(); });
+
+		Ar.Logf(TEXT(""));
+		Ar.Logf(TEXT("Top %d of %d actors"), FMath::Min(NumTopActors, SortedActors.Num()), SortedActors.Num());
+		Ar.Logf(HeaderFormat, TEXT("Actor"), TEXT("Count"), TEXT("Object"), TEXT("History"),
+			TEXT("Effects"), TEXT("Stats"), TEXT("Queues"), TEXT("Other"), TEXT("Total"));
+		for (int32 i = 0; i < FMath::Min(NumTopActors, SortedActors.Num()); i++)
+			LogMemoryReportRow(Ar, SortedActors[i]);
+	}
+
+	FAutoConsoleCommandWithWorldArgsAndOutputDevice MemReportCommand(
+		TEXT("vitality.memreport"),
+		TEXT("Lists the memory held by vitality components in this world by class and container, ")
+		TEXT("then the actors holding the most. Usage: vitality.memreport [NumActors=20]"),
+		FConsoleCommandWithWorldArgsAndOutputDeviceDelegate::CreateStatic(&DumpMemoryReport));
+}
+
+void VitalityTrace::DamageApplied(const AActor* DamagedActor, const AActor* DamageInstigator,
+	float DamageTaken, float HealthAfter, bool bKilled)
+{
+	UE_TRACE_LOG(Vitality, DamageApplied, VitalityChannel)
+		<< DamageApplied.Cycle(FPlatformTime::Cycles64())
+		<< DamageApplied.ActorId(GetTraceId(DamagedActor))
+		<< DamageApplied.InstigatorId(GetTraceId(DamageInstigator))
+		<< DamageApplied.DamageTaken(DamageTaken)
+		<< DamageApplied.HealthAfter(HealthAfter)
+		<< DamageApplied.bKilled(bKilled);
+}
+
+void VitalityTrace::EffectApplied(const AActor* EffectActor, int UniqueId, FName EffectName, int StackCount)
+{
+	const FString NameString = EffectName.ToString();
+	UE_TRACE_LOG(Vitality, EffectApplied, VitalityChannel)
+		<< EffectApplied.Cycle(FPlatformTime::Cycles64())
+		<< EffectApplied.ActorId(GetTraceId(EffectActor))
+		<< EffectApplied.UniqueId(UniqueId)
+		<< EffectApplied.StackCount(StackCount)
+		<< EffectApplied.EffectName(*NameString, NameString.Len());
+}
+
+void VitalityTrace::EffectExpired(const AActor* EffectActor, int UniqueId, FName EffectName)
+{
+	const FString NameString = EffectName.ToString();
+	UE_TRACE_LOG(Vitality, EffectExpired, VitalityChannel)
+		<< EffectExpired.Cycle(FPlatformTime::Cycles64())
+		<< EffectExpired.ActorId(GetTraceId(EffectActor))
+		<< EffectExpired.UniqueId(UniqueId)
+		<< EffectExpired.EffectName(*NameString, NameString.Len());
+}
@@ -10,6 +10,8 @@
 /* Spawns an actor that manages damage dealt, such as floating text widgets
  * and more. Very useful for debugging. Used by the floating damage numbers
  * component.
+ * For damage numbers in busy fights, prefer UVitalityDamageNumbers, which
+ * draws every number from one pool without spawning actors or widgets.
  */
 
 UCLASS(BlueprintType, Blueprintable)
@@ -0,0 +1,101 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+
+#include "VitalityDamageNumbers.generated.h"
+
+class SVitalityDamageNumbers;
+
+
+/**
+ * Client-side floating damage numbers. Every number on screen comes from one fixed pool
+ * of entries and is drawn by a single Slate layer over the viewport, so a busy fight
+ * spawns no actors or widgets. Hits landing on the same target in quick succession are
+ * merged into one rising number. Not created on dedicated servers.
+ *
+ * Configure under [/Script/VitalityMatters.VitalityDamageNumbers] in DefaultGame.ini.
+ */
+UCLASS(Config = Game)
+class VITALITYMATTERS_API UVitalityDamageNumbers : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	friend class SVitalityDamageNumbers;
+
+public:
+
+	static UVitalityDamageNumbers* Get(const UObject* WorldContextObject);
+
+	// Shows the damage above the target, merging it into the target's number if it was hit recently.
+	// Negative values are shown as healing.
+	UFUNCTION(BlueprintCallable) void AddDamageNumber(AActor* Target, float DamageValue);
+	UFUNCTION(BlueprintCallable) void ClearDamageNumbers();
+	UFUNCTION(BlueprintPure) int32 GetNumVisible() const { return NumActive_; }
+
+	/* UTickableWorldSubsystem */
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// The most numbers on screen at once. When full, the number that has waited longest is reused.
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Damage Numbers")
+	int32 MaxVisible = 32;
+	// Hits on a target within this many seconds of its last hit are added to its number
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Damage Numbers")
+	float MergeWindow = 0.3f;
+	// Seconds a number stays up after the last hit merged into it
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Damage Numbers")
+	float Lifetime = 1.f;
+	// How far a number rises over its lifetime, in world units
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Damage Numbers")
+	float RiseHeight = 30.f;
+	// Where a number starts, relative to the target's location
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Damage Numbers")
+	FVector WorldOffset = FVector(0.f, 0.f, 60.f);
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Damage Numbers")
+	int32 FontSize = 18;
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Damage Numbers")
+	FLinearColor DamageColor = FLinearColor(1.f, 0.9f, 0.2f);
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Damage Numbers")
+	FLinearColor HealColor = FLinearColor(0.2f, 1.f, 0.3f);
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	struct FEntry
+	{
+		TWeakObjectPtr<AActor> Target;
+		// The target's location when last seen, so the number finishes even if the target is gone
+		FVector Anchor		= FVector::ZeroVector;
+		float Value			= 0.f;
+		float Age			= 0.f;
+		float SinceLastHit	= 0.f;
+		// Refreshed only when the value changes
+		FString Text;
+		FVector2D TextSize	= FVector2D::ZeroVector;
+		// Pixels, relative to the viewport. Updated every tick.
+		FVector2D ScreenPosition = FVector2D::ZeroVector;
+		float Opacity		= 1.f;
+		bool bOnScreen		= false;
+	};
+
+	void SetEntryValue(FEntry& Entry, float NewValue) const;
+	// Adds the drawing layer to the game viewport, if it is not there yet
+	void EnsureWidget();
+	// Draws every visible entry. Called by the Slate layer.
+	void PaintDamageNumbers(const FGeometry& AllottedGeometry, FSlateWindowElementList& OutDrawElements, int32 LayerId) const;
+
+	// Allocated once. Entries [0, NumActive_) are showing.
+	TArray<FEntry> Entries_;
+	int32 NumActive_ = 0;
+
+	TSharedPtr<SVitalityDamageNumbers> Widget_;
+};
@@ -6,9 +6,14 @@
 #include "Components/ActorComponent.h"
 #include "Delegates/Delegate.h"
 #include "lib/StatusEffects.h"
+#include "VitalitySubsystem.h"
+#include "lib/VitalitySnapshot.h"
 
 #include "VitalityEffectsComponent.generated.h"
 
+struct FVitalityMemoryUsage;
+struct FVitalitySaveRecord;
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(
 	FOnEffectDetrimentalApplied,	int, UniqueId, FName, EffectName);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(
@@ -17,6 +22,7 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(
 	FOnEffectDetrimentalExpired,	int, UniqueId, FName, EffectName);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(
 	FOnEffectBeneficialExpired,		int, UniqueId, FName, EffectName);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnVisibleEffectsChanged);
 
 
 /**
@@ -34,6 +40,16 @@ public:
 	void InitializeEffects(const TArray<FStVitalityEffects>& SavedEffects);
 	UFUNCTION(Server, Reliable) void Server_InitializeEffects(const TArray<FStVitalityEffects>& SavedEffects);
 	
+	// Copies the active effects and their remaining ticks into the record, if requested
+	void CaptureSaveData(FVitalitySaveRecord& OutRecord,
+		EVitalitySaveSections Sections = EVitalitySaveSections::ALL) const;
+	// Replaces the active effects with the record's, keeping their remaining ticks. Authority only.
+	void ApplySaveData(const FVitalitySaveRecord& Record);
+
+	// The effects section, if the effects changed since they were last saved or journaled
+	EVitalitySaveSections GetDirtySaveSections() const { return DirtySaveSections_; }
+	void SetSaveSectionsDirty(EVitalitySaveSections Sections, bool bIsDirty);
+	
 	UFUNCTION(BlueprintCallable) bool ApplyEffect(FName EffectName, int StackCount = 1);
 	UFUNCTION(BlueprintCallable) bool ApplyEffectBeneficial(EEffectsBeneficial EffectBeneficial, int StackCount = 1);
 	UFUNCTION(BlueprintCallable) bool ApplyEffectDetrimental(EEffectsDetrimental EffectDetrimental, int StackCount = 1);
@@ -59,13 +75,57 @@ public:
 	UFUNCTION(BlueprintPure) bool IsEffectBeneficialActive(EEffectsBeneficial EffectEnum) const;
 	UFUNCTION(BlueprintPure) bool IsEffectDetrimentalActive(EEffectsDetrimental EffectEnum) const;
 
+	// Sets bit n if EEffectsBeneficial(n) or EEffectsDetrimental(n) is active
+	void GetActiveEffectBits(uint32& OutBenefitBits, uint32& OutDetrimentBits) const;
+
+	// The visible effects are replicated to everyone, unlike the active effects. Use these
+	// for other players' VFX and nameplates.
+	UFUNCTION(BlueprintPure) bool IsEffectBeneficialVisible(EEffectsBeneficial EffectEnum) const { return VisibleEffects_.HasBenefit(EffectEnum); }
+	UFUNCTION(BlueprintPure) bool IsEffectDetrimentalVisible(EEffectsDetrimental EffectEnum) const { return VisibleEffects_.HasDetriment(EffectEnum); }
+	// Only effects listed in VisibleTableEffects are visible by name
+	UFUNCTION(BlueprintPure) bool IsTableEffectVisible(FName EffectName) const;
+	const FVitalityVisibleEffects& GetVisibleEffects() const { return VisibleEffects_; }
+
+	// Publishes the active effects for lock-free reads from any thread. Game thread only.
+	void PublishSnapshot();
+	// Copies the latest published effects. Safe to call from any thread.
+	uint64 ReadSnapshot(FVitalityEffectsSnapshot& OutSnapshot) const { return Snapshot_.Read(OutSnapshot); }
+	uint64 GetSnapshotVersion() const { return Snapshot_.GetVersion(); }
+	// The latest published snapshot, without copying. Game thread only.
+	const FVitalityEffectsSnapshot& GetPublishedSnapshot() const { return Snapshot_.GetFront(); }
+
+	// Counts the effects down in parallel update mode, gathering the ones that ran out without
+	// removing them. Touches nothing outside this component, so the subsystem runs it on worker threads.
+	void CountDownEffects(float DeltaSeconds);
+	// Removes the effects the last CountDownEffects() gathered and flushes the add and remove
+	// queues, broadcasting as TickEffects() does. Game thread only.
+	void ApplyExpiredEffects();
+	// True if there are effects that are not persistent to count down, or queued changes to flush. Game thread only.
+	bool HasEffectsToTick() const;
+
+	// Adds the heap memory held by this component to OutUsage, by container
+	void GetMemoryUsage(FVitalityMemoryUsage& OutUsage) const;
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+#if !UE_BUILD_SHIPPING
+	// For the microbenchmark only: replaces the active effects without broadcasting
+	void SetActiveEffectsForTesting(const TArray<FStVitalityEffects>& Effects);
+	// For the microbenchmark only: diffs the active effects against OldEffects, as the owning client does
+	void DiffEffectsForTesting(const TArray<FStVitalityEffects>& OldEffects) { OnRep_CurrentEffectsChanged_Implementation(OldEffects); }
+	// For the microbenchmark only
+	int GenerateUniqueIdForTesting() { return GenerateUniqueId(); }
+#endif
+
 protected:
 	
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	
-	// Handles effects wearing off
+	// Handles effects wearing off. Scheduled on the authority at EffectsTickRate, unless the
+	// vitality subsystem is in parallel update mode and counts the effects down itself.
 	virtual void TickEffects();
 
 private:
@@ -74,11 +134,20 @@ private:
 			FTimerDelegate TimerDelegate, float TickRate = 0.5) const;
 
 	void CancelTimer(FTimerHandle& TimerHandle) const;
+
+	// Moves the add and remove queues into the active effects
+	void FlushEffectQueues();
 	
 	int GenerateUniqueId();
 
+	// Flags the effects as changed for the vitality subsystem snapshot and the save journal
+	void MarkEffectsDirty();
+
 	UFUNCTION(Client, Reliable)
 	void OnRep_CurrentEffectsChanged(const TArray<FStVitalityEffects>& OldEffects);
+
+	UFUNCTION()
+	void OnRep_VisibleEffectsChanged();
 	
 public:
 	
@@ -93,22 +162,48 @@ public:
 	
 	UPROPERTY(BlueprintAssignable, Category = "Vitality Events")
 	FOnEffectBeneficialExpired OnEffectBeneficialExpired;
+
+	// Called on every machine when an effect becomes visible or stops being visible
+	UPROPERTY(BlueprintAssignable, Category = "Vitality Events")
+	FOnVisibleEffectsChanged OnVisibleEffectsChanged;
+
+	// Effects with neither enum set that other players can see, by row name. Up to 16; the rest are ignored.
+	// The server and the clients must list them in the same order.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Effects Settings")
+	TArray<FName> VisibleTableEffects;
 	
 private:
 
 	bool bHasInitialized = false;
 
+	FVitalityHandle VitalityHandle_;
+	EVitalitySaveSections DirtySaveSections_ = EVitalitySaveSections::EFFECTS;
+	TVitalityDoubleBuffer<FVitalityEffectsSnapshot> Snapshot_;
+
 	// Write Lock: Stops all writing AND reading
 	// Read Lock:  Stops all writing, allows any number of reads
-	FRWLock EffectsLock_;
+	mutable FRWLock EffectsLock_;
 	//FRWLock _AddQueueLock;
 	//FRWLock _RemoveQueueLock;
 	
 	UPROPERTY() FTimerHandle EffectsTimer_;
 
+	// The interval TickEffects() counts effects down at
+	static constexpr float EffectsTickRate = 0.5f;
+	// Seconds since the effects were last counted down in parallel update mode
+	float EffectsElapsed_ = 0.f;
+	// Unique IDs that ran out on a worker thread, removed once back on the game thread
+	TArray<int> ExpiredEffects_;
+	// Set when CountDownEffects() changed any remaining ticks, so the game thread marks the effects dirty
+	bool bTicksCounted_ = false;
+
 	UPROPERTY(Replicated, ReplicatedUsing=OnRep_CurrentEffectsChanged)
 	TArray<FStVitalityEffects> CurrentEffects_;
 
+	// Refreshed on the server whenever the effects snapshot is published. Sent to everyone.
+	UPROPERTY(Replicated, ReplicatedUsing=OnRep_VisibleEffectsChanged)
+	FVitalityVisibleEffects VisibleEffects_;
+
 	
 	TArray<FStVitalityEffects> AddQueue_;	// Thread safe add queue
 	TArray<int> RemoveQueue_;				// Thread safe remove queue
@@ -0,0 +1,103 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+
+#include "VitalityHealthBars.generated.h"
+
+class SVitalityHealthBars;
+
+
+/**
+ * Client-side world-space health bars. Once per frame the published welfare snapshots of
+ * every actor that wants a bar are gathered, culled by distance and recent rendering, and
+ * drawn by a single Slate layer over the viewport. Close actors show health, stamina and
+ * magic; distant ones only health, shrinking with distance. Not created on dedicated servers.
+ *
+ * Configure under [/Script/VitalityMatters.VitalityHealthBars] in DefaultGame.ini.
+ */
+UCLASS(Config = Game)
+class VITALITYMATTERS_API UVitalityHealthBars : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+	friend class SVitalityHealthBars;
+
+public:
+
+	static UVitalityHealthBars* Get(const UObject* WorldContextObject);
+
+	UFUNCTION(BlueprintCallable) void SetHealthBarsEnabled(bool bEnabled);
+	UFUNCTION(BlueprintPure) bool GetHealthBarsEnabled() const { return bEnabled_; }
+	// The number of bars drawn last frame
+	UFUNCTION(BlueprintPure) int32 GetNumVisible() const { return Bars_.Num(); }
+
+	/* UTickableWorldSubsystem */
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Actors further from the camera than this have no bar
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Health Bars")
+	float MaxDistance = 3000.f;
+	// Actors closer than this also show stamina and magic
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Health Bars")
+	float DetailDistance = 1000.f;
+	// The most bars drawn at once. The closest actors win.
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Health Bars")
+	int32 MaxBars = 200;
+	// Actors not rendered within this many seconds are skipped, which hides occluded actors cheaply
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Health Bars")
+	float RecentlyRenderedTime = 0.2f;
+	// Hides bars of actors at full health
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Health Bars")
+	bool bHideWhenFull = false;
+	// Where the bar sits, relative to the actor's location
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Health Bars")
+	FVector WorldOffset = FVector(0.f, 0.f, 100.f);
+	// The size of the health bar of an actor at the camera, in DPI scaled units
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Health Bars")
+	FVector2D BarSize = FVector2D(80.f, 8.f);
+	// The scale of the bar at MaxDistance
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Health Bars")
+	float MinScale = 0.4f;
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Health Bars")
+	FLinearColor BackgroundColor = FLinearColor(0.f, 0.f, 0.f, 0.6f);
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Health Bars")
+	FLinearColor HealthColor = FLinearColor(0.8f, 0.1f, 0.1f);
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Health Bars")
+	FLinearColor StaminaColor = FLinearColor(0.1f, 0.7f, 0.1f);
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Health Bars")
+	FLinearColor MagicColor = FLinearColor(0.1f, 0.3f, 0.9f);
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	struct FBar
+	{
+		// Pixels, relative to the viewport
+		FVector2D ScreenPosition = FVector2D::ZeroVector;
+		float DistanceSquared	= 0.f;
+		float Scale				= 1.f;
+		float HealthPercent		= 0.f;
+		float StaminaPercent	= 0.f;
+		float MagicPercent		= 0.f;
+		bool bShowDetail		= false;
+	};
+
+	// Adds the drawing layer to the game viewport, if it is not there yet
+	void EnsureWidget();
+	// Draws every gathered bar, each on its own pair of layers. Returns the highest layer used.
+	int32 PaintHealthBars(const FGeometry& AllottedGeometry, FSlateWindowElementList& OutDrawElements, int32 LayerId) const;
+
+	bool bEnabled_ = true;
+	// Rebuilt every tick, keeping its allocation
+	TArray<FBar> Bars_;
+	TSharedPtr<SVitalityHealthBars> Widget_;
+};
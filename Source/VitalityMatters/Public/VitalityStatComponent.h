@@ -6,11 +6,17 @@
 #include "Components/ActorComponent.h"
 #include "Delegates/Delegate.h"
 #include "lib/VitalityData.h"
+#include "lib/DerivedStats.h"
+#include "VitalitySubsystem.h"
+#include "lib/VitalitySnapshot.h"
 
 #include "lib/VitalityEnums.h"
 
 #include "VitalityStatComponent.generated.h"
 
+struct FVitalityMemoryUsage;
+struct FVitalitySaveRecord;
+
 
 /**
  * Manages all of the Stat-specific members of an actor
@@ -25,8 +31,22 @@ public:
 	UVitalityStatComponent();
 	
 	TMulticastDelegate<void(bool)> OnInventorySaved;
+	TMulticastDelegate<void(bool)> OnStatsLoaded;
 
+	// Saves the stat, welfare and effects components of the owner to the slot
+	bool SaveStatsToSlot(FString& ResponseString, FString SaveSlotName, bool isAsync);
+	// Loads the stat, welfare and effects components of the owner from the slot
 	bool LoadStatsFromSave(FString& ResponseString, FString SaveSlotName, bool isAsync);
+
+	// Copies the requested stat layers into the record
+	void CaptureSaveData(FVitalitySaveRecord& OutRecord,
+		EVitalitySaveSections Sections = EVitalitySaveSections::ALL) const;
+	// Replaces the stat layers the record holds. Authority only.
+	void ApplySaveData(const FVitalitySaveRecord& Record);
+
+	// The stat layers changed since they were last saved or journaled
+	EVitalitySaveSections GetDirtySaveSections() const { return DirtySaveSections_; }
+	void SetSaveSectionsDirty(EVitalitySaveSections Sections, bool bIsDirty);
 	
 	UFUNCTION(BlueprintCallable) void Reinitialize();
 	
@@ -82,19 +102,37 @@ public:
 	UFUNCTION(BlueprintPure) FStVitalityStats GetAllGearStats() const		{ return GearStats_; }
 	UFUNCTION(BlueprintPure) FStVitalityStats GetAllModifiedStats() const	{ return ModifiedStats_; }
 	UFUNCTION(BlueprintPure) FStVitalityStats GetAllOtherStats() const		{ return OtherStats_; }
+
+	// Publishes the current layers for lock-free reads from any thread. Game thread only.
+	void PublishSnapshot();
+	// Copies the latest published layers and totals. Safe to call from any thread.
+	uint64 ReadSnapshot(FVitalityStatSnapshot& OutSnapshot) const { return Snapshot_.Read(OutSnapshot); }
+	uint64 GetSnapshotVersion() const { return Snapshot_.GetVersion(); }
+	// The latest published snapshot, without copying. Game thread only.
+	const FVitalityStatSnapshot& GetPublishedSnapshot() const { return Snapshot_.GetFront(); }
+
+	UFUNCTION(BlueprintCallable) bool CompileDerivedStats();
+	// Callable rather than pure, since it evaluates the graph and pushes the results into the welfare component
+	UFUNCTION(BlueprintCallable) float GetDerivedStatValue(FName StatName);
+
+	// Adds the heap memory held by this component to OutUsage, by container
+	void GetMemoryUsage(FVitalityMemoryUsage& OutUsage) const;
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
 	
 protected:
 
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void OnComponentCreated() override;
 
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
 private:
 
-	UFUNCTION()
-	void LoadDataDelegate(const FString& SaveSlotName, int32 UserIndex, USaveGame* SaveData);
+	void SaveDataDelegate(bool bSuccess);
+	void LoadDataDelegate(bool bSuccess);
 	
 	// Helper function for updating damage resistance or adding if it doesn't exist
 	bool SetNewDamageResistanceValue(FStVitalityStats& StatsMap,
@@ -137,6 +175,15 @@ private:
 	UFUNCTION() void OtherDamageResistUpdated(const EDamageType DamageEnum);
 	
 	void BindListenerEvents();
+
+	// Called by every layer listener when a value changes
+	void StatInputChanged(EDerivedStatSource Source, EVitalityStatLayer Layer, int32 Index);
+
+	// Marks derived stats reading the given input dirty and schedules a lazy recompute
+	void MarkDerivedInputDirty(EDerivedStatSource Source, EVitalityStatLayer Layer, int32 Index);
+	void EvaluateDerivedStats();
+	float ReadDerivedInput(EDerivedStatSource Source, EVitalityStatLayer Layer, int32 Index) const;
+	const FStVitalityStats* GetStatsLayer(EVitalityStatLayer Layer) const;
 	
 public:
 	
@@ -146,6 +193,15 @@ public:
 
 	UPROPERTY(BlueprintReadWrite, EditAnywhere) FStVitalityStats StartingStats;
 
+	// Stats derived from the core stats and layers, such as max health from fortitude.
+	// Recomputed only when one of their inputs changes, then pushed into the welfare component.
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Derived Stats")
+	TArray<FStDerivedStatFormula> DerivedStatFormulas;
+
+	// Optional table of FStDerivedStatFormula rows, compiled together with DerivedStatFormulas
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Derived Stats")
+	UDataTable* DerivedStatsTable = nullptr;
+
 private:
 
 	bool bStatsSystemReady = false;
@@ -168,6 +224,13 @@ private:
 	FString StatsSaveName_ = "";
 	int32 StatsSaveUserIndex_ = 0;
 
+	FVitalityHandle VitalityHandle_;
+	EVitalitySaveSections DirtySaveSections_ = EVitalitySaveSections::STATS;
+	TVitalityDoubleBuffer<FVitalityStatSnapshot> Snapshot_;
+
+	FVitalityDerivedStatGraph DerivedStats_;
+	bool bDerivedStatsScheduled_ = false;
+
 	void StatsEventTrigger(	const FStVitalityStats* OldStats,
 							const FStVitalityStats* NewStats);
 
@@ -0,0 +1,252 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+
+#include "lib/VitalityCheckpoint.h"
+#include "lib/VitalityEnums.h"
+
+#include "VitalitySubsystem.generated.h"
+
+class UVitalityWelfareComponent;
+class UVitalityStatComponent;
+class UVitalityEffectsComponent;
+
+
+// Identifies an actor registered with the vitality subsystem. Cheap to copy and compare.
+USTRUCT(BlueprintType)
+struct VITALITYMATTERS_API FVitalityHandle
+{
+	GENERATED_BODY()
+	FVitalityHandle() {}
+	FVitalityHandle(int32 SlotIndex, int32 SlotSerial) : Index(SlotIndex), Serial(SlotSerial) {}
+
+	bool IsValid() const { return Index != INDEX_NONE; }
+	bool operator==(const FVitalityHandle& Other) const { return Index == Other.Index && Serial == Other.Serial; }
+
+	UPROPERTY() int32 Index  = INDEX_NONE;
+	UPROPERTY() int32 Serial = 0;
+};
+
+/** Structure-of-arrays result of a batch query. Row i belongs to the i-th requested actor.
+ * Arrays not requested by the field mask are left empty. Stat arrays are row-major,
+ * with GetNumberOfDamageTypes() or GetNumberOfCoreStats() entries per row.
+ */
+USTRUCT(BlueprintType)
+struct VITALITYMATTERS_API FStVitalityBatchResult
+{
+	GENERATED_BODY()
+
+	// The frame the snapshot was taken on
+	UPROPERTY(BlueprintReadOnly) int64 FrameNumber = 0;
+	UPROPERTY(BlueprintReadOnly) int32 NumRows = 0;
+	// False if the actor was not registered in the snapshot
+	UPROPERTY(BlueprintReadOnly) TArray<bool> IsValid;
+
+	UPROPERTY(BlueprintReadOnly) TArray<float> HealthPercent;
+	UPROPERTY(BlueprintReadOnly) TArray<float> StaminaPercent;
+	UPROPERTY(BlueprintReadOnly) TArray<float> MagicPercent;
+	UPROPERTY(BlueprintReadOnly) TArray<float> HydrationPercent;
+	UPROPERTY(BlueprintReadOnly) TArray<float> CaloriesPercent;
+
+	UPROPERTY(BlueprintReadOnly) TArray<bool> IsDead;
+	UPROPERTY(BlueprintReadOnly) TArray<ECombatState> CombatState;
+
+	UPROPERTY(BlueprintReadOnly) TArray<float> CoreStats;
+	UPROPERTY(BlueprintReadOnly) TArray<float> DamageBonuses;
+	UPROPERTY(BlueprintReadOnly) TArray<float> Resistances;
+
+	// Bit n is set if EEffectsBeneficial(n) / EEffectsDetrimental(n) is active
+	UPROPERTY(BlueprintReadOnly) TArray<int32> BenefitBits;
+	UPROPERTY(BlueprintReadOnly) TArray<int32> DetrimentBits;
+};
+
+/**
+ * Immutable, frame-consistent copy of every registered actor's vitality values.
+ * Rows are indexed by FVitalityHandle::Index. Blocks that did not change since the
+ * previous frame are shared with it instead of copied. Safe to read from any thread.
+ */
+struct VITALITYMATTERS_API FVitalityFrameSnapshot
+{
+	struct FPoolBlock
+	{
+		TArray<float> HealthPercent;
+		TArray<float> StaminaPercent;
+		TArray<float> MagicPercent;
+		TArray<float> HydrationPercent;
+		TArray<float> CaloriesPercent;
+		TArray<bool> IsDead;
+		TArray<ECombatState> CombatState;
+	};
+	struct FStatBlock
+	{
+		TArray<float> CoreStats;
+		TArray<float> DamageBonuses;
+		TArray<float> Resistances;
+	};
+	struct FEffectBlock
+	{
+		TArray<uint32> BenefitBits;
+		TArray<uint32> DetrimentBits;
+	};
+
+	uint64 FrameNumber = 0;
+	int32 NumSlots = 0;
+	TArray<int32> Serials;
+
+	TSharedPtr<const FPoolBlock, ESPMode::ThreadSafe>	Pools;
+	TSharedPtr<const FStatBlock, ESPMode::ThreadSafe>	Stats;
+	TSharedPtr<const FEffectBlock, ESPMode::ThreadSafe>	Effects;
+
+	// Only used to look up handles. The actors are never dereferenced.
+	TSharedPtr<const TMap<const AActor*, FVitalityHandle>, ESPMode::ThreadSafe> Handles;
+
+	bool IsValidHandle(const FVitalityHandle& Handle) const
+	{
+		return Serials.IsValidIndex(Handle.Index) && Serials[Handle.Index] == Handle.Serial;
+	}
+	FVitalityHandle FindHandle(const AActor* Actor) const;
+
+	// Fills the result with one row per handle. Safe to call from any thread.
+	void Query(TConstArrayView<FVitalityHandle> QueryHandles,
+		EVitalityQueryFields Fields, FStVitalityBatchResult& OutResult) const;
+};
+
+typedef TSharedPtr<const FVitalityFrameSnapshot, ESPMode::ThreadSafe> FVitalityFrameSnapshotPtr;
+
+
+/**
+ * Keeps a registry of every actor with vitality components in the world, and publishes
+ * a frame-consistent snapshot of their values at the end of every frame for batch queries.
+ *
+ * In parallel update mode, the welfare pools and effect expiry of every registered actor are
+ * stepped here in batches on worker threads, instead of by each component's timers. Their
+ * side effects are then applied serially on the game thread.
+ * Configure under [/Script/VitalityMatters.VitalitySubsystem] in DefaultGame.ini.
+ */
+UCLASS(Config = Game)
+class VITALITYMATTERS_API UVitalitySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	static UVitalitySubsystem* Get(const UObject* WorldContextObject);
+
+	// Registers the component with the actor's slot, creating the slot if needed
+	FVitalityHandle RegisterComponent(UActorComponent* VitalityComponent);
+	// Removes the component from the actor's slot, freeing the slot once it is empty
+	void UnregisterComponent(UActorComponent* VitalityComponent);
+
+	// Flags the actor's stats and effects to be copied into the next snapshot
+	void MarkDirty(const FVitalityHandle& Handle);
+	// Adds the actor's welfare component to the digestion pass. It leaves once its queue is empty.
+	void SetDigesting(const FVitalityHandle& Handle, bool bIsDigesting);
+
+	UFUNCTION(BlueprintPure) FVitalityHandle GetHandle(const AActor* Actor) const;
+	UFUNCTION(BlueprintPure) int32 GetNumRegistered() const { return SlotByActor_.Num(); }
+	UFUNCTION(BlueprintPure) bool IsParallelUpdate() const { return bParallelUpdate; }
+
+	// Calls the function for every registered welfare component. Game thread only.
+	void ForEachWelfare(TFunctionRef<void(const FVitalityHandle&, UVitalityWelfareComponent&)> Function) const;
+
+	// Returns the latest published snapshot. Safe to call from any thread.
+	FVitalityFrameSnapshotPtr GetFrameSnapshot() const;
+
+	// Queries the latest snapshot for the given actors. Safe to call from any thread.
+	void QueryActors(TConstArrayView<const AActor*> Actors,
+		EVitalityQueryFields Fields, FStVitalityBatchResult& OutResult) const;
+	// Queries the latest snapshot for the given handles. Safe to call from any thread.
+	void QueryHandles(TConstArrayView<FVitalityHandle> Handles,
+		EVitalityQueryFields Fields, FStVitalityBatchResult& OutResult) const;
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Query Vitality Batch"))
+	FStVitalityBatchResult K2_QueryActors(const TArray<AActor*>& Actors,
+		UPARAM(meta = (Bitmask, BitmaskEnum = "/Script/VitalityMatters.EVitalityQueryFields")) int32 Fields);
+
+	/* World Checkpoints */
+
+	// Returns the ID that finds the actor in world checkpoints across restarts, or zero for none
+	uint64 GetStableActorId(const AActor* Actor) const;
+
+	// Overrides how stable IDs are made, such as from a player's account ID. By default the
+	// actor's path is hashed, which is only stable for actors placed in the level.
+	TDelegate<uint64(const AActor*)> StableIdResolver;
+
+	// Gathers every registered actor now, then writes the checkpoint on a worker thread.
+	// Returns false if the previous checkpoint is still being written.
+	UFUNCTION(BlueprintCallable) bool WriteCheckpointAsync(const FString& FilePath = "");
+	// Writes a checkpoint every IntervalSeconds. Zero or less stops writing them.
+	UFUNCTION(BlueprintCallable) void SetCheckpointInterval(float IntervalSeconds, const FString& FilePath = "");
+
+	// Maps the checkpoint and restores every registered actor found in it. Actors that
+	// register while it is mapped are restored on the next tick. Returns the number restored.
+	UFUNCTION(BlueprintCallable) int32 RestoreFromCheckpoint(const FString& FilePath = "");
+	// Unmaps the checkpoint once the world has finished loading
+	UFUNCTION(BlueprintCallable) void ReleaseCheckpoint();
+
+	FString GetDefaultCheckpointPath() const;
+
+	/* UTickableWorldSubsystem */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual void Deinitialize() override;
+
+	// Steps pools and effects on worker threads instead of timers. Components check it when a pool
+	// starts, so it should be set in the config rather than changed while actors are playing.
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Parallel Update")
+	bool bParallelUpdate = false;
+	// The number of components each worker task steps
+	UPROPERTY(Config, EditAnywhere, BlueprintReadOnly, Category = "Parallel Update")
+	int32 ParallelBatchSize = 64;
+
+protected:
+
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	struct FSlot
+	{
+		TWeakObjectPtr<AActor> Actor;
+		TWeakObjectPtr<UVitalityWelfareComponent> Welfare;
+		TWeakObjectPtr<UVitalityStatComponent> Stats;
+		TWeakObjectPtr<UVitalityEffectsComponent> Effects;
+		int32 Serial = 0;
+		bool bInUse = false;
+	};
+
+	// Builds and publishes the snapshot for this frame
+	void PublishFrameSnapshot();
+	// Releases the digestion queue of every digesting actor
+	void TickDigestion();
+	// Steps the parallel pools and effects of every actor on worker threads, then applies them
+	void TickParallel(float DeltaTime);
+
+	// Applies the mapped checkpoint entry of the slot's actor, if it has one
+	bool RestoreSlotFromCheckpoint(int32 SlotIndex);
+	void RestorePendingSlots();
+
+	TArray<FSlot> Slots_;
+	TArray<int32> FreeSlots_;
+	TMap<const AActor*, int32> SlotByActor_;
+	TBitArray<> DirtySlots_;
+	TBitArray<> DigestingSlots_;
+	bool bRegistryChanged_ = true;
+	// The components stepped by this frame's parallel update. Only valid during TickParallel().
+	TArray<UVitalityWelfareComponent*> ParallelWelfare_;
+	TArray<UVitalityEffectsComponent*> ParallelEffects_;
+
+	FVitalityCheckpointFile CheckpointFile_;
+	// Slots registered while the checkpoint is mapped, restored on the next tick
+	TArray<FVitalityHandle> PendingRestore_;
+	TFuture<bool> CheckpointWrite_;
+	FTimerHandle CheckpointTimer_;
+	FString CheckpointPath_;
+
+	// Protects the snapshot pointer only. The snapshot itself is immutable.
+	mutable FRWLock SnapshotLock_;
+	FVitalityFrameSnapshotPtr FrameSnapshot_;
+};
@@ -8,11 +8,15 @@
 
 #include "lib/VitalityData.h"
 #include "lib/VitalityEnums.h"
+#include "VitalitySubsystem.h"
+#include "lib/VitalitySnapshot.h"
 
 #include "VitalityWelfareComponent.generated.h"
 
 class UVitalityEffectsComponent;
 class UVitalityStatComponent;
+struct FVitalityMemoryUsage;
+struct FVitalitySaveRecord;
 
 
 // Called when the combat state has changed
@@ -53,6 +57,22 @@ FOnCaloriesUpdated,			float, CurrentValue, float, NewValue, float, ValueAsPercen
 // Called whenever the current calorie value has changed, no matter the cause
 
 
+// Nutrition waiting in the digestion queue, released into its pool a little every frame
+struct FVitalityDigestion
+{
+	// HUNGER or THIRST
+	EVitalityCategory Pool = EVitalityCategory::HUNGER;
+	// The amount not released yet, as of the last time the queue was rebuilt
+	float AmountRemaining = 0.f;
+	// The amount released per second. Has the same sign as AmountRemaining.
+	float ReleaseRate = 0.f;
+	// World time the unreleased amount is discarded at
+	double ExpiryTime = 0.0;
+	// World time the entry is fully released or expires, whichever comes first
+	double FinishTime = 0.0;
+};
+
+
 /**
  * Manages all of the Stat-specific members of an actor
  */
@@ -76,6 +96,29 @@ public:
 	UFUNCTION(BlueprintCallable) float DamageHealth(AActor* DamageInstigator = nullptr, float DamageTaken = 0.f);
 	UFUNCTION(BlueprintCallable) float DamageStamina(AActor* DamageInstigator = nullptr, float DamageTaken = 0.f);
 	UFUNCTION(BlueprintCallable) float DamageMagic(AActor* DamageInstigator = nullptr, float DamageTaken = 0.f);
+	UFUNCTION(BlueprintCallable) float AddCalories(float CaloriesAdded = 0.f);
+	UFUNCTION(BlueprintCallable) float AddHydration(float HydrationAdded = 0.f);
+
+	// Consumes the nutrition table rows as one batch. Authority only, so the game's inventory decides what is eaten.
+	UFUNCTION(BlueprintCallable) int ConsumeItems(const TArray<FName>& ItemNames);
+
+	// Queues nutrition to be released into the hunger or thirst pool over time. Authority only.
+	UFUNCTION(BlueprintCallable) bool DigestNutrition(EVitalityCategory VitalityCategory,
+		float Amount = 0.f, float ReleaseRate = 1.f, float ExpirySeconds = 0.f);
+	// The net amount per second the digestion queue is releasing into the pool
+	UFUNCTION(BlueprintPure) float GetDigestionRate(EVitalityCategory VitalityCategory) const;
+	UFUNCTION(BlueprintPure) int GetNumberOfDigesting() const { return DigestionQueue_.Num(); }
+	// Releases the digestion queue up to the given world time. Returns false once the queue is empty.
+	// Called by the vitality subsystem for every digesting actor.
+	bool TickDigestion(double WorldTime);
+
+	// Steps the pools the subsystem ticks in parallel update mode, in place of their timers.
+	// Touches nothing outside this component, so the subsystem runs it on worker threads.
+	void IntegratePools(float DeltaSeconds);
+	// Applies what the last IntegratePools() gathered for the game thread
+	void ApplyIntegratedPools();
+	// True if any pool is ticked by the vitality subsystem rather than by a timer
+	bool HasParallelPools() const { return (ParallelPools_ & ~PausedParallelPools_) != 0; }
 
 	UFUNCTION(BlueprintCallable) bool StartTimerForCategory(EVitalityCategory VitalityCategory);
 	UFUNCTION(BlueprintCallable) bool CancelTimerForCategory(EVitalityCategory VitalityCategory);
@@ -85,7 +128,11 @@ public:
 
 	UFUNCTION(BlueprintPure) bool GetIsDead() const { return IsDead_; }
 	UFUNCTION(BlueprintPure) ECombatState GetCombatState() const { return CombatState_; };
+	// Dead, down (incapacitated), injured (health below maximum) or alive. Valid on every machine.
+	UFUNCTION(BlueprintPure) EVitalityStatus GetVitalityStatus() const;
 	UFUNCTION(BlueprintPure) TArray<FStDamageData> GetDamageHistory() const { return DamageHistory_; }
+	// True if the actor has damaged this one. Does not copy the history like GetDamageHistory().
+	UFUNCTION(BlueprintPure) bool IsInDamageHistory(const AActor* DamagingActor) const;
 
 	UFUNCTION(BlueprintPure) float GetVitalityStatData(EVitalityCategory VitalityCategory, float& CurrentValue, float& MaxValue) const;
 	
@@ -109,6 +156,29 @@ public:
 	UFUNCTION(BlueprintPure) float GetHungerValue() const { return CaloriesCurrent_; }
 	UFUNCTION(BlueprintPure) float GetCurrentHunger(float& CurrentValue, float& MaxValue) const;
 
+	// On the owning client, eased and extrapolated pools only move when this runs, when the pools
+	// replicate, or when the component is published. UI that shows them smoothly calls this every
+	// frame before reading them. Does nothing while no pool is being smoothed.
+	UFUNCTION(BlueprintCallable) void UpdateDisplayedPools();
+
+	// Publishes the pools for lock-free reads from any thread, if they changed. Game thread only.
+	void PublishSnapshot();
+	// Copies the latest published pools. Safe to call from any thread.
+	uint64 ReadSnapshot(FVitalityWelfareSnapshot& OutSnapshot) const { return Snapshot_.Read(OutSnapshot); }
+	uint64 GetSnapshotVersion() const { return Snapshot_.GetVersion(); }
+	// The latest published snapshot, without copying. Game thread only.
+	const FVitalityWelfareSnapshot& GetPublishedSnapshot() const { return Snapshot_.GetFront(); }
+
+	// Copies the pools, dead flag and combat state into the record, if requested
+	void CaptureSaveData(FVitalitySaveRecord& OutRecord,
+		EVitalitySaveSections Sections = EVitalitySaveSections::ALL) const;
+	// Restores the pools, dead flag and combat state from the record. Authority only.
+	void ApplySaveData(const FVitalitySaveRecord& Record);
+
+	// The welfare section, if the pools changed since they were last saved or journaled
+	EVitalitySaveSections GetDirtySaveSections() const { return DirtySaveSections_; }
+	void SetSaveSectionsDirty(EVitalitySaveSections Sections, bool bIsDirty);
+
 	UFUNCTION(BlueprintCallable) void HitByWeapon();
 	
 	UFUNCTION(NetMulticast, Unreliable)
@@ -133,17 +203,27 @@ public:
 
 	void InitializeSubsystem(EVitalityCategory VitalityCategory,
 		bool UseSubsystem = false, float NowValue = 0.f, float MaxValue = 0.f, float RegenRate = 0.f);
+
+	// Changes a maximum value without re-running the subsystem initializer (ie. derived stats)
+	UFUNCTION(BlueprintCallable) bool SetVitalityMaximum(EVitalityCategory VitalityCategory, float NewMaximum);
+	// Changes a regen (or drain) rate without re-running the subsystem initializer
+	UFUNCTION(BlueprintCallable) bool SetVitalityRegenRate(EVitalityCategory VitalityCategory, float NewRate);
 	UFUNCTION(Server, Reliable)	void Server_InitializeHealthSubsystem(bool UseSubsystem = false, float NowValue = 0.f, float MaxValue = 0.f, float RegenRate = 0.f);
 	UFUNCTION(Server, Reliable)	void Server_InitializeStaminaSubsystem(bool UseSubsystem = false, float NowValue = 0.f, float MaxValue = 0.f, float RegenRate = 0.f);
 	UFUNCTION(Server, Reliable)	void Server_InitializeMagicSubsystem(bool UseSubsystem = false, float NowValue = 0.f, float MaxValue = 0.f, float RegenRate = 0.f);
 	UFUNCTION(Server, Reliable)	void Server_InitializeSurvivalSubsystem(bool UseSubsystem = false,
 		float NowHydrationValue = 0.f, float MaxHydrationValue = 0.f, float HydrationRegenRate = 0.f,
 		float NowCaloriesValue = 0.f, float MaxCaloriesValue = 0.f, float CaloriesRegenRate = 0.f);
-	
+
+	// Adds the heap memory held by this component to OutUsage, by container
+	void GetMemoryUsage(FVitalityMemoryUsage& OutUsage) const;
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
 	
 protected:
 	
 	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
@@ -171,18 +251,30 @@ private:
 	
 	/* Replication Callbacks */
 	
-	UFUNCTION(NetMulticast, Reliable)	void OnRep_IsDeadChanged(bool WasDeadBefore);
-	UFUNCTION(NetMulticast, Reliable)	void OnRep_CombatStateChanged(ECombatState OldCombatState);
-	UFUNCTION(NetMulticast, Reliable)	void OnRep_HealthValueChanged(float OldValue);
-	UFUNCTION(NetMulticast, Reliable)	void OnRep_HealthMaxChanged(float OldValue);
-	UFUNCTION(NetMulticast, Reliable)	void OnRep_MagicValueChanged(float OldValue);
-	UFUNCTION(NetMulticast, Reliable)	void OnRep_MagicMaxChanged(float OldValue);
-	UFUNCTION(NetMulticast, Reliable)	void OnRep_StaminaValueChanged(float OldValue);
-	UFUNCTION(NetMulticast, Reliable)	void OnRep_StaminaMaxChanged(float OldValue);
-	UFUNCTION(Client, Reliable)			void OnRep_CaloriesValueChanged(float OldValue);
-	UFUNCTION(Client, Reliable)			void OnRep_CaloriesMaxChanged(float OldValue);
-	UFUNCTION(Client, Reliable)			void OnRep_HydrationValueChanged(float OldValue);
-	UFUNCTION(Client, Reliable)			void OnRep_HydrationMaxChanged(float OldValue);
+	UFUNCTION()	void OnRep_IsDeadChanged(bool WasDeadBefore);
+	UFUNCTION()	void OnRep_CombatStateChanged(ECombatState OldCombatState);
+	// Copies the replicated block into the pools, and fires the updated delegate of each pool that changed
+	UFUNCTION()	void OnRep_PoolsChanged(const FVitalityPoolBlock& OldPools);
+	// Starts or stops extrapolating each pool on the owning client
+	UFUNCTION()	void OnRep_PoolTrendChanged(const FVitalityPoolTrend& OldTrend);
+
+	// Applies the summary on simulated proxies, firing the same delegates the owner's replication does
+	UFUNCTION()	void OnRep_SummaryChanged(const FVitalityProxySummary& OldSummary);
+
+	// Copies the pools into a replicated block, or back out of one
+	void WritePoolBlock(FVitalityPoolBlock& OutPools) const;
+	void ReadPoolBlock(const FVitalityPoolBlock& Pools);
+	// Copies each pool its replication policy allows into ReplicatedPools_, with its rate. Authority only.
+	// Returns true if a pool is still held back, waiting for its minimum interval.
+	bool UpdateReplicatedPools();
+	// Eases the owner's pools toward the last replicated block, and extrapolates the moving ones
+	void AdvanceDisplayedPools(double WorldTime);
+	const FVitalityReplicationPolicy& GetReplicationPolicy(EVitalityCategory VitalityCategory) const;
+	// The units per second the pool is moving at on its own, from its timer and the digestion queue
+	float GetPoolRate(EVitalityCategory VitalityCategory) const;
+	// The server's world time, as far as this machine knows it
+	double GetServerWorldTime() const;
+	void WriteSummary(FVitalityProxySummary& OutSummary) const;
 	
 	/** Sent to all clients from server when the DamageHealth() function runs
 	 * successfully, but the character survives the damage. Used to trigger clientside events.
@@ -196,6 +288,27 @@ private:
 	
 	UFUNCTION(BlueprintCallable)
 	void SetCombatState(ECombatState CombatState);
+
+	// Fires the updated delegate for the given category with the current values
+	void BroadcastCategoryUpdated(EVitalityCategory VitalityCategory);
+
+	// Brings the digestion queue up to the given world time, so entries can be added at it
+	void BeginDigestionChange(double WorldTime);
+	// Appends to the digestion queue. RebuildDigestion() must be called afterwards.
+	bool QueueDigestion(EVitalityCategory VitalityCategory, float Amount, float ReleaseRate,
+		float ExpirySeconds, double WorldTime);
+	// Drops finished entries, and re-sums the net rate of each pool and the next finish time
+	void RebuildDigestion(double WorldTime);
+	// Releases the net rates of the digestion queue into the pools
+	void ReleaseDigestion(float DeltaSeconds);
+
+	// Runs one regen or drain step of the pool. Returns true once the pool has nothing left to do.
+	bool StepPool(EVitalityCategory VitalityCategory);
+	// Seconds between the pool's steps
+	float GetPoolTickRate(EVitalityCategory VitalityCategory) const;
+	// Hands the pool to the subsystem if it is in parallel update mode. Returns false if it is not.
+	bool StartParallelPool(EVitalityCategory VitalityCategory);
+	bool IsParallelPoolActive(EVitalityCategory VitalityCategory) const;
 	
 public:
 
@@ -254,6 +367,14 @@ public:
 	// An array of sounds played when actor gets hit, chosen at random
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TArray<USoundBase*> HitSounds;
+
+	// If TRUE, clients show the damage this actor takes as pooled floating numbers
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool ShowDamageNumbers = false;
+
+	// If TRUE, clients draw a health bar over this actor through the batched health bar layer
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool ShowHealthBar = false;
 	
 	// If FALSE, the welfare component will NOT have health-related functionality
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Health Settings")
@@ -329,9 +450,39 @@ public:
 	// The rate of the magic tick timer when LoadSettings() is called
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Survival Settings")
 	float CaloriesTimerTickRate = 0.5;
+
+	// How each pool replicates to the owning client. Health sends every change; the pools
+	// that tick constantly only send once they have moved noticeably, or hit empty or full.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replication Settings")
+	FVitalityReplicationPolicy HealthReplication;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replication Settings")
+	FVitalityReplicationPolicy StaminaReplication	= FVitalityReplicationPolicy(0.02f, 1.f);
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replication Settings")
+	FVitalityReplicationPolicy MagicReplication		= FVitalityReplicationPolicy(0.02f, 1.f);
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replication Settings")
+	FVitalityReplicationPolicy HungerReplication	= FVitalityReplicationPolicy(0.01f, 5.f);
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Replication Settings")
+	FVitalityReplicationPolicy ThirstReplication	= FVitalityReplicationPolicy(0.01f, 5.f);
 	
 private:
 
+	FVitalityHandle VitalityHandle_;
+	EVitalitySaveSections DirtySaveSections_ = EVitalitySaveSections::WELFARE;
+	TVitalityDoubleBuffer<FVitalityWelfareSnapshot> Snapshot_;
+
+	/* Digestion */
+
+	TArray<FVitalityDigestion> DigestionQueue_;
+	// The digestion queue summed per pool, so releasing costs the same for one entry or many
+	float CaloriesDigestionRate_	= 0.f;
+	float HydrationDigestionRate_	= 0.f;
+	// World time the queue was released up to
+	double DigestionTime_			= 0.0;
+	// World time the entries' remaining amounts were last brought up to date
+	double DigestionRebuildTime_	= 0.0;
+	// Earliest finish time in the queue. The rates only change when it passes.
+	double NextDigestionEvent_		= 0.0;
+
 	/* Timers */
 	
 	// Timers that manage regeneration & resetting values
@@ -341,9 +492,19 @@ private:
 	UPROPERTY() FTimerHandle CaloriesTimer_;
 	UPROPERTY() FTimerHandle HydrationTimer_;
 	UPROPERTY() FTimerHandle CombatTimer_;
+
+	// Pools ticked by the vitality subsystem in parallel update mode. Bit n is EVitalityCategory n.
+	uint8 ParallelPools_		= 0;
+	uint8 PausedParallelPools_	= 0;
+	// Seconds since each parallel pool last stepped
+	float ParallelElapsed_[static_cast<int32>(EVitalityCategory::MAX)] = {};
+	// Steps taken on a worker thread, counted once back on the game thread
+	int32 ParallelSteps_		= 0;
 		
 	/* Replicated Members */
 
+	// The owning connection receives the full state: the history, the flags and every pool.
+	// Everyone else receives ReplicatedSummary_ only.
 	UPROPERTY(Replicated) TArray<FStDamageData> DamageHistory_;
 	
 	UPROPERTY(Replicated, ReplicatedUsing=OnRep_IsDeadChanged)
@@ -352,28 +513,45 @@ private:
 	UPROPERTY(Replicated, ReplicatedUsing=OnRep_CombatStateChanged)
 	ECombatState CombatState_ = ECombatState::RELAXED;
 	
-	UPROPERTY(Replicated, ReplicatedUsing=OnRep_HealthValueChanged)
+	// The pools below, refreshed on the server whenever a changed snapshot is published
+	UPROPERTY(Replicated, ReplicatedUsing=OnRep_PoolsChanged)
+	FVitalityPoolBlock ReplicatedPools_;
+
+	// The rate and sample time of each pool in ReplicatedPools_
+	UPROPERTY(Replicated, ReplicatedUsing=OnRep_PoolTrendChanged)
+	FVitalityPoolTrend ReplicatedTrend_;
+
+	/* Pool Replication */
+
+	// World time each pool was last copied into ReplicatedPools_
+	double PoolSentTime_[FVitalityPoolBlock::NumPools] = {};
+	// True while a pool has a change waiting to go out, or a rate may have changed
+	bool bPoolsPending_ = false;
+	// Owner only. The value each easing pool started from, and when. Bit n of InterpolatingPools_ is pool n.
+	float InterpFrom_[FVitalityPoolBlock::NumPools] = {};
+	double InterpStart_[FVitalityPoolBlock::NumPools] = {};
+	uint8 InterpolatingPools_ = 0;
+	// Owner only. Pools moving at a replicated rate, extrapolated every frame. Bit n is pool n.
+	uint8 ExtrapolatingPools_ = 0;
+
+	// Health percent, status and combat state for simulated proxies, refreshed with ReplicatedPools_
+	UPROPERTY(Replicated, ReplicatedUsing=OnRep_SummaryChanged)
+	FVitalityProxySummary ReplicatedSummary_;
+
+	/* Non-Replicated Members */
+
+	// The pools themselves. Owning clients receive them through ReplicatedPools_. On simulated
+	// proxies only the health is kept, scaled from the summary's percent.
 	float HealthCurrent_	= 1.f;
-	UPROPERTY(Replicated, ReplicatedUsing=OnRep_HealthMaxChanged)
 	float HealthMax_		= 1.f;
-	UPROPERTY(Replicated, ReplicatedUsing=OnRep_MagicValueChanged)
 	float MagicCurrent_		= 1.f;
-	UPROPERTY(Replicated, ReplicatedUsing=OnRep_MagicMaxChanged)
 	float MagicMax_			= 1.f;
-	UPROPERTY(Replicated, ReplicatedUsing=OnRep_StaminaValueChanged)
 	float StaminaCurrent_	= 1.f;
-	UPROPERTY(Replicated, ReplicatedUsing=OnRep_StaminaMaxChanged)
 	float StaminaMax_		= 1.f;
-	UPROPERTY(Replicated, ReplicatedUsing=OnRep_HydrationValueChanged)
 	float HydrationCurrent_ = 1.f;
-	UPROPERTY(Replicated, ReplicatedUsing=OnRep_HydrationMaxChanged)
 	float HydrationMax_		= 500.f;
-	UPROPERTY(Replicated, ReplicatedUsing=OnRep_CaloriesValueChanged)
-	float CaloriesCurrent_  = 1.f;	
-	UPROPERTY(Replicated, ReplicatedUsing=OnRep_CaloriesMaxChanged)
+	float CaloriesCurrent_  = 1.f;
 	float CaloriesMax_		= 500.f;
-
-	/* Non-Replicated Members */
 	
 	float HealthRegenAtRest_	= 1.f;
 	float MagicRegenAtRest_		= 1.f;
@@ -0,0 +1,123 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VitalityEnums.h"
+#include "Engine/DataTable.h"
+
+#include "DerivedStats.generated.h"
+
+
+// A single input of a derived stat formula, multiplied by its coefficient
+USTRUCT(BlueprintType)
+struct VITALITYMATTERS_API FStDerivedStatTerm
+{
+	GENERATED_BODY()
+	// The kind of value this term reads
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) EDerivedStatSource Source = EDerivedStatSource::CORE_STAT;
+	// The core stat to read. Only used when Source is CORE_STAT
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) EVitalityStat CoreStat = EVitalityStat::FORTITUDE;
+	// The damage type to read. Only used when Source is DAMAGE_BONUS or DAMAGE_RESIST
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) EDamageType DamageType = EDamageType::ADMIN;
+	// The name of another derived stat to read. Only used when Source is DERIVED
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) FName DerivedStat = FName();
+	// The stat layer to read from. Ignored when Source is DERIVED
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) EVitalityStatLayer Layer = EVitalityStatLayer::TOTAL;
+	// The value the input is multiplied by before being added to the formula
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) float Coefficient = 1.f;
+};
+
+/** A declarative formula: Value = Clamp(BaseValue + Sum(Term * Coefficient), MinValue, MaxValue)
+ * Can be used directly on the stat component, or as a data table row.
+ */
+USTRUCT(BlueprintType)
+struct VITALITYMATTERS_API FStDerivedStatFormula : public FTableRowBase
+{
+	GENERATED_BODY()
+	// The unique name of the derived stat. If empty, the data table row name is used
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) FName StatName = FName();
+	// The value of the derived stat before any terms are added
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) float BaseValue = 0.f;
+	// The inputs that make up the derived stat
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) TArray<FStDerivedStatTerm> Terms;
+	// The lowest value the derived stat can have
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) float MinValue = 0.f;
+	// The highest value the derived stat can have. Zero or less means unbounded
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) float MaxValue = 0.f;
+	// The welfare value to push the result into whenever it changes
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) EDerivedStatTarget Target = EDerivedStatTarget::NONE;
+};
+
+
+/**
+ * Compiles derived stat formulas into a dependency DAG and recomputes them lazily.
+ * Only formulas whose inputs were marked dirty (directly, or through another
+ * derived stat they read) are evaluated. Not thread safe; game thread only.
+ */
+class VITALITYMATTERS_API FVitalityDerivedStatGraph
+{
+public:
+
+	// Reads the current value of a non-derived input (Index is the stat or damage enum as int)
+	typedef TFunctionRef<float(EDerivedStatSource Source, EVitalityStatLayer Layer, int32 Index)> FInputReader;
+
+	// A derived stat whose value changed during Evaluate()
+	struct FChangedStat
+	{
+		FName StatName;
+		EDerivedStatTarget Target;
+		float NewValue;
+	};
+
+	// Builds the graph. Returns false (and leaves the graph empty) on a cycle or duplicate name
+	bool Compile(const TArray<FStDerivedStatFormula>& Formulas);
+	void Reset();
+
+	// Marks every formula reading the given input as dirty. TOTAL readers are also marked.
+	void MarkInputDirty(EDerivedStatSource Source, EVitalityStatLayer Layer, int32 Index);
+	void MarkAllDirty();
+
+	bool IsDirty() const { return NumDirty_ > 0; }
+	bool IsCompiled() const { return Nodes_.Num() > 0; }
+	int32 GetNumFormulas() const { return Nodes_.Num(); }
+
+	// Recomputes all dirty formulas in dependency order, appending the ones that changed
+	void Evaluate(FInputReader ReadInput, TArray<FChangedStat>& OutChanged);
+
+	// Returns the last evaluated value of the derived stat, or zero if it does not exist
+	float GetValue(FName StatName) const;
+	bool HasStat(FName StatName) const { return NodeByName_.Contains(StatName); }
+
+	// Heap memory held by the compiled graph
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	static int32 MakeInputKey(EDerivedStatSource Source, EVitalityStatLayer Layer, int32 Index)
+	{
+		return (static_cast<int32>(Source) << 16) | (static_cast<int32>(Layer) << 8) | (Index & 0xFF);
+	}
+
+	void MarkNodeDirty(int32 NodeIndex);
+
+	struct FNode
+	{
+		FStDerivedStatFormula Formula;
+		// Indices into Nodes_ for terms reading other derived stats, INDEX_NONE otherwise
+		TArray<int32> TermNodes;
+		// Nodes that read this node. Always later in Nodes_ (topological order)
+		TArray<int32> Dependents;
+		float Value = 0.f;
+		bool bDirty = true;
+		// False until first evaluated, so the first value is always reported, even if it is zero
+		bool bEvaluated = false;
+	};
+
+	// Stored in topological order, so a single forward pass evaluates the graph
+	TArray<FNode> Nodes_;
+	TMap<FName, int32> NodeByName_;
+	// Input key -> nodes reading that input directly
+	TMap<int32, TArray<int32>> InputDependents_;
+	int32 NumDirty_ = 0;
+};
@@ -0,0 +1,67 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NutritionalData.h"
+#include "UObject/StrongObjectPtr.h"
+
+class FVitalityDataBlob;
+struct FStreamableHandle;
+class UDataTable;
+
+
+/**
+ * Hashed index of every row in DT_NutritionTable. The table is streamed in
+ * asynchronously at module startup; after that, lookups are a single hash probe
+ * with no asset-system calls. Rebuilt when the table is edited or reimported in
+ * the editor. On dedicated servers with a cooked data blob, the index is built from the
+ * blob instead and the table is never loaded. Game thread only.
+ */
+class VITALITYMATTERS_API FNutritionRegistry
+{
+public:
+
+	static FNutritionRegistry& Get();
+
+	// Starts streaming the table once the engine is initialized
+	void StartPreload();
+	// Drops the index and releases the table
+	void Shutdown();
+
+	/**
+	 * @brief Finds the nutrition row with the given row name
+	 * @param RowName The data table row name of the consumable
+	 * @return The row, or nullptr if it does not exist. Valid until the table is reloaded.
+	 */
+	const FStNutritionData* Find(FName RowName);
+
+	bool IsReady() const { return bIsReady_; }
+	int32 GetNumRows() const { return Rows_.Num(); }
+
+private:
+
+	FNutritionRegistry() = default;
+
+	void RequestTableLoad();
+	void OnTableLoaded();
+	// Blocks on the table if it is still streaming. Only happens if a lookup beats the preload.
+	void FlushPreload();
+	void BuildIndex(const UDataTable* NutritionTable);
+	// Loads only the spawn classes the rows reference
+	void BuildIndexFromBlob(const FVitalityDataBlob& DataBlob);
+
+	TArray<FStNutritionData> Rows_;
+	TMap<FName, int32> RowIndex_;
+	bool bIsReady_ = false;
+	// True once the table failed to load, so lookups stop retrying and logging
+	bool bLoadFailed_ = false;
+
+	// Keeps the table, and the classes its rows reference, loaded
+	TSharedPtr<FStreamableHandle> LoadHandle_;
+	TWeakObjectPtr<UDataTable> NutritionTable_;
+	// Keeps the spawn classes of rows built from the data blob loaded
+	TArray<TStrongObjectPtr<UClass>> SpawnClasses_;
+	FDelegateHandle PostEngineInitHandle_;
+	FDelegateHandle TableChangedHandle_;
+};
@@ -15,6 +15,12 @@ struct VITALITYMATTERS_API FStNutritionData : public FTableRowBase
 	GENERATED_BODY()
 	// The proper name of the item, when consumed, gives the following data
 	UPROPERTY(EditAnywhere, BlueprintReadWrite) FName properName = FName();
+	// The calories restored when the item is consumed. Negative values drain hunger.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) float calories = 0.f;
+	// The hydration restored when the item is consumed. Negative values drain thirst.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) float hydration = 0.f;
+	// The seconds the calories and hydration are digested over. Zero restores them instantly.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite) float digestSeconds = 0.f;
 	// The benefit to apply when the item is consumed
 	UPROPERTY(EditAnywhere, BlueprintReadWrite) EEffectsBeneficial addBenefit = EEffectsBeneficial::MAX;
 	// The number of seconds to apply the benefit
@@ -34,4 +40,6 @@ class VITALITYMATTERS_API UNutritionSystem : public UBlueprintFunctionLibrary
 public:
 	UFUNCTION(BlueprintPure) static UDataTable* GetNutritionDataTable();
 	UFUNCTION(BlueprintPure) static FStNutritionData GetNutritionData(FName rowName);
+	// Same as GetNutritionData, but reports a miss instead of returning an empty row
+	UFUNCTION(BlueprintPure) static bool FindNutritionData(FName rowName, FStNutritionData& nutritionData);
 };
\ No newline at end of file
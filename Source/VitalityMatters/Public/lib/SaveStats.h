@@ -2,14 +2,152 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/SaveGame.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
+#include "VitalityEnums.h"
 
 #include "SaveStats.generated.h"
 
+// Called on the game thread when an async save or load finishes
+DECLARE_DELEGATE_OneParam(FOnVitalitySaveComplete, bool /* bSuccess */);
+DECLARE_DELEGATE_OneParam(FOnVitalityLoadComplete, bool /* bSuccess */);
 
+
+/**
+ * Plain copy of everything the vitality components persist for one actor.
+ * Captured on the game thread, then serialized and written on a background thread.
+ */
+struct VITALITYMATTERS_API FVitalitySaveRecord
+{
+	// Bump when the binary layout changes, and keep reading older versions in Serialize()
+	enum EVersion : uint16
+	{
+		VERSION_INITIAL = 1,
+		// Each stat layer is its own section, so journal records can carry a single layer
+		VERSION_LAYER_SECTIONS,
+		VERSION_LATEST_PLUS_ONE,
+		VERSION_LATEST = VERSION_LATEST_PLUS_ONE - 1
+	};
+	static constexpr uint32 Magic = 0x56534D56; // "VMSV"
+	static constexpr int32 NumLayers = static_cast<int32>(EVitalityStatLayer::TOTAL);
+	static constexpr int32 NumPools  = static_cast<int32>(EVitalityCategory::MAX);
+
+	struct FEffect
+	{
+		FName EffectName;
+		EEffectsBeneficial	BenefitEffect	= EEffectsBeneficial::MAX;
+		EEffectsDetrimental	DetrimentEffect	= EEffectsDetrimental::MAX;
+		// The ticks the effect had left when it was saved
+		int32 RemainingTicks	= 0;
+		int32 UniqueId			= 0;
+		bool bIsPersistent		= false;
+	};
+
+	static EVitalitySaveSections GetLayerSection(EVitalityStatLayer Layer)
+	{
+		return static_cast<EVitalitySaveSections>(
+			static_cast<uint8>(EVitalitySaveSections::STATS_NATURAL) << static_cast<uint8>(Layer));
+	}
+
+	// The sections this record holds. Sections not listed are left untouched when applied.
+	EVitalitySaveSections Sections = EVitalitySaveSections::NONE;
+	bool HasSection(EVitalitySaveSections Section) const { return EnumHasAnyFlags(Sections, Section); }
+
+	// Indexed by EVitalityStatLayer, excluding TOTAL
+	TArray<float> CoreStats[NumLayers];
+	TArray<float> DamageBonuses[NumLayers];
+	TArray<float> DamageResists[NumLayers];
+
+	// Indexed by EVitalityCategory
+	float PoolCurrent[NumPools] = {};
+	float PoolMax[NumPools]		= {};
+	bool bIsDead = false;
+	ECombatState CombatState = ECombatState::RELAXED;
+
+	TArray<FEffect> Effects;
+
+	// Reads or writes the compact binary form. Returns false on a bad header or unknown version.
+	bool Serialize(FArchive& Ar);
+
+	// Overwrites every section the newer record holds. Used to replay journal records.
+	void Merge(const FVitalitySaveRecord& Newer);
+};
+
+
+/**
+ * Optional USaveGame wrapper, for games that keep vitality inside their own save files.
+ * Holds the same compact binary record written by UVitalitySaveSystem. Capture the actor
+ * before saving the game object, and apply it once the game object is loaded.
+ */
 UCLASS(Blueprintable, BlueprintType)
 class VITALITYMATTERS_API USaveVitalityStat : public USaveGame
 {
 	GENERATED_BODY()
 public:
-	
-};
\ No newline at end of file
+
+	// Encodes the actor's vitality components into VitalityRecord. Game thread only.
+	UFUNCTION(BlueprintCallable) bool CaptureActor(const AActor* Actor);
+	// Decodes VitalityRecord and applies it to the actor's vitality components. Authority only.
+	UFUNCTION(BlueprintCallable) bool ApplyToActor(AActor* Actor) const;
+
+	UPROPERTY() TArray<uint8> VitalityRecord;
+
+};
+
+
+/**
+ * Saves and loads the stat, welfare and effects components of an actor together.
+ * Capturing and applying happen on the game thread; encoding, decoding and disk
+ * access happen on a worker thread so autosaving many actors does not hitch.
+ *
+ * A slot is a full snapshot plus an append-only journal of the sections that changed
+ * since. Journaling only writes dirty sections, so its cost follows activity rather
+ * than player count. Loading replays the journal over the snapshot, and compaction
+ * folds the journal back into the snapshot. Work for one slot always runs in order.
+ */
+UCLASS(Blueprintable)
+class VITALITYMATTERS_API UVitalitySaveSystem : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
+public:
+
+	// Copies the requested sections of the actor's vitality components into the record. Game thread only.
+	static bool CaptureActor(const AActor* Actor, FVitalitySaveRecord& OutRecord,
+		EVitalitySaveSections Sections = EVitalitySaveSections::ALL);
+	// Applies the record to the actor's vitality components in one step. Game thread only.
+	static bool ApplyToActor(AActor* Actor, const FVitalitySaveRecord& Record);
+
+	// The sections of the actor that changed since they were last saved or journaled
+	static EVitalitySaveSections GetActorDirtySections(const AActor* Actor);
+	static void SetActorDirtySections(AActor* Actor, EVitalitySaveSections Sections, bool bIsDirty);
+
+	static void WriteRecord(FVitalitySaveRecord& Record, TArray<uint8>& OutBytes);
+	static bool ReadRecord(const TArray<uint8>& Bytes, FVitalitySaveRecord& OutRecord);
+
+	// Captures now, then encodes and writes the slot on a worker thread
+	static bool SaveActorAsync(AActor* Actor, const FString& SlotName, int32 UserIndex,
+		FOnVitalitySaveComplete OnComplete = FOnVitalitySaveComplete());
+	// Captures only the dirty sections now, then appends them to the slot's journal on a worker thread.
+	// Returns false without any I/O if nothing changed.
+	static bool JournalActorAsync(AActor* Actor, const FString& SlotName, int32 UserIndex,
+		FOnVitalitySaveComplete OnComplete = FOnVitalitySaveComplete());
+	// Folds the slot's journal into its snapshot on a worker thread
+	static void CompactSlotAsync(const FString& SlotName, int32 UserIndex);
+	// Reads the snapshot and replays the journal on a worker thread, then applies it on the game thread
+	static bool LoadActorAsync(AActor* Actor, const FString& SlotName, int32 UserIndex,
+		FOnVitalityLoadComplete OnComplete = FOnVitalityLoadComplete());
+
+	static bool SaveActor(AActor* Actor, const FString& SlotName, int32 UserIndex);
+	static bool LoadActor(AActor* Actor, const FString& SlotName, int32 UserIndex);
+
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Save Vitality (Async)"))
+	static bool K2_SaveVitalityAsync(AActor* Actor, const FString& SlotName, int32 UserIndex = 0);
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Journal Vitality (Async)"))
+	static bool K2_JournalVitalityAsync(AActor* Actor, const FString& SlotName, int32 UserIndex = 0);
+	UFUNCTION(BlueprintCallable, meta = (DisplayName = "Load Vitality (Async)"))
+	static bool K2_LoadVitalityAsync(AActor* Actor, const FString& SlotName, int32 UserIndex = 0);
+	UFUNCTION(BlueprintPure) static bool DoesVitalitySaveExist(const FString& SlotName, int32 UserIndex = 0);
+
+	// The journal is folded into the snapshot once it grows past this size
+	static constexpr int64 JournalCompactionBytes = 256 * 1024;
+	static FString GetJournalPath(const FString& SlotName, int32 UserIndex);
+};
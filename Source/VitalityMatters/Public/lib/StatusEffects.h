@@ -44,6 +44,44 @@ struct FStVitalityEffects : public FTableRowBase
 	
 };
 
+/**
+ * Which effects an actor visibly has, one bit per effect, for everyone to see. Effects
+ * that have neither enum set use TableBits, by their place in the effects component's
+ * VisibleTableEffects list.
+ */
+USTRUCT()
+struct FVitalityVisibleEffects
+{
+	GENERATED_BODY()
+
+	static_assert(static_cast<int32>(EEffectsBeneficial::MAX) <= 8, "One bit per beneficial effect");
+	static_assert(static_cast<int32>(EEffectsDetrimental::MAX) <= 16, "One bit per detrimental effect");
+	static constexpr int32 MaxTableEffects = 16;
+
+	UPROPERTY() uint8 BenefitBits		= 0;
+	UPROPERTY() uint16 DetrimentBits	= 0;
+	UPROPERTY() uint16 TableBits		= 0;
+
+	bool HasBenefit(EEffectsBeneficial EffectEnum) const
+	{
+		return EffectEnum != EEffectsBeneficial::MAX && (BenefitBits & (1u << static_cast<uint32>(EffectEnum))) != 0;
+	}
+	bool HasDetriment(EEffectsDetrimental EffectEnum) const
+	{
+		return EffectEnum != EEffectsDetrimental::MAX && (DetrimentBits & (1u << static_cast<uint32>(EffectEnum))) != 0;
+	}
+	bool HasTableEffect(int32 Index) const
+	{
+		return Index >= 0 && Index < MaxTableEffects && (TableBits & (1u << Index)) != 0;
+	}
+
+	bool operator==(const FVitalityVisibleEffects& Other) const
+	{
+		return BenefitBits == Other.BenefitBits && DetrimentBits == Other.DetrimentBits && TableBits == Other.TableBits;
+	}
+	bool operator!=(const FVitalityVisibleEffects& Other) const { return !(*this == Other); }
+};
+
 UCLASS(Blueprintable, BlueprintType)
 class UVitalityEffect : public UBlueprintFunctionLibrary
 {
@@ -0,0 +1,72 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "VitalityBenchmark.generated.h"
+
+
+// The measurements of one benchmark pass
+struct FVitalityBenchmarkResult
+{
+	int32 NumActors				= 0;
+	int32 NumFrames				= 0;
+	// True if the pools and effects were stepped by the subsystem's parallel update
+	bool bParallelUpdate		= false;
+	double SimulatedSeconds		= 0.0;
+	double SpawnSeconds			= 0.0;
+	// Wall time of each world tick, in milliseconds
+	TArray<double> FrameMs;
+	double FrameMsMean			= 0.0;
+	double FrameMsMedian		= 0.0;
+	double FrameMsP95			= 0.0;
+	double FrameMsMax			= 0.0;
+	// Only measured while allocation tracking is on
+	double AllocationsPerFrame	= 0.0;
+	double AllocatedBytesPerFrame = 0.0;
+	// The resident memory the vitality components added, divided by the actor count
+	double BytesPerActor		= 0.0;
+	// Estimated from the replicated properties that changed each frame. See the commandlet.
+	double ReplicatedBytesPerFrame = 0.0;
+	// Workload calls made over the pass
+	int32 DamageCalls			= 0;
+	int32 EffectCalls			= 0;
+	int32 StatCalls				= 0;
+};
+
+
+/**
+ * Headless scale benchmark. For each actor count, a map-less game world is created, that many
+ * characters are spawned with a welfare, effects and stat component, and a scripted workload
+ * (regeneration, periodic damage, effect churn and stat changes) is run for a fixed simulated
+ * time at a fixed tick rate. Frame times, allocations, memory per actor and an estimate of the
+ * replicated bytes are written as CSV and JSON.
+ *
+ * Run with: UnrealEditor-Cmd <Project> -run=VitalityBenchmark -nullrhi
+ *     [-Counts=100,1000,10000] [-Seconds=30] [-TickRate=30] [-Output=<Path without extension>]
+ *     [-NoAllocTracking] [-Parallel]
+ *
+ * -Parallel runs the pools and effects through the vitality subsystem's parallel update
+ * instead of per-component timers.
+ *
+ * Replicated bytes are not measured by a net driver. Each frame, every replicated property
+ * that differs from its last sampled value is counted at its in-memory size, as if it were
+ * sent to one connection without quantization. RPCs are not included.
+ */
+UCLASS()
+class VITALITYMATTERS_API UVitalityBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+
+	UVitalityBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+
+	FVitalityBenchmarkResult RunPass(int32 NumActors, double Seconds, double TickRate,
+		bool bTrackAllocations, bool bParallelUpdate) const;
+};
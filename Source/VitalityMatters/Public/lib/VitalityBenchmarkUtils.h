@@ -0,0 +1,92 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonWriter.h"
+
+
+// The summary statistics of a set of timed samples
+struct FVitalitySampleSummary
+{
+	double Mean		= 0.0;
+	double Median	= 0.0;
+	double StdDev	= 0.0;
+	double Min		= 0.0;
+	double P95		= 0.0;
+	double Max		= 0.0;
+};
+
+
+// What the vitality benchmark commandlets share: world setup, argument parsing, statistics and output
+struct VITALITYMATTERS_API FVitalityBenchmarkUtils
+{
+	/**
+	 * @brief Creates a map-less game world and begins play in it, since there is no game mode to.
+	 * @param WorldName The name of the world
+	 * @param bParallelUpdate Set on the vitality subsystem before play begins, since components check it then
+	 * @return The new world. Release it with DestroyWorld().
+	 */
+	static UWorld* CreateWorld(FName WorldName, bool bParallelUpdate = false);
+
+	// Destroys a world made by CreateWorld() and collects its garbage
+	static void DestroyWorld(UWorld* World);
+
+	// Adds a component to an actor that has already begun play, so the component begins play right away
+	template<typename ComponentType>
+	static ComponentType* AddComponent(AActor* Actor)
+	{
+		ComponentType* Component = NewObject<ComponentType>(Actor);
+		Actor->AddInstanceComponent(Component);
+		Component->RegisterComponent();
+		return Component;
+	}
+
+	// Parses a comma-separated list of positive counts, such as -Counts=100,1000, or returns the defaults
+	static TArray<int32> ParseCounts(const FString& Params, const TCHAR* Key, const TArray<int32>& Defaults);
+
+	// Returns the -Output= path, or a timestamped path under Saved/Benchmarks. Has no extension.
+	static FString ParseOutputPath(const FString& Params, const TCHAR* BenchmarkName);
+
+	// Returns the summary statistics of the samples. The standard deviation is the sample one.
+	static FVitalitySampleSummary Summarize(TConstArrayView<double> Samples);
+
+	/**
+	 * @brief Writes <OutputPath>.csv and <OutputPath>.json, and logs where they went.
+	 * @param Header The CSV header line, without a line break
+	 * @param FormatRow Returns the CSV line of a result, without a line break
+	 * @param WriteFields Writes the fields of a result into the JSON object that holds it
+	 * @return True if both files were written
+	 */
+	template<typename ResultType, typename RowFormatter, typename FieldWriter>
+	static bool WriteResults(const FString& OutputPath, const TCHAR* BenchmarkName, const TArray<ResultType>& Results,
+		const TCHAR* Header, RowFormatter&& FormatRow, FieldWriter&& WriteFields)
+	{
+		FString Csv = FString(Header) + TEXT("\n");
+		for (const ResultType& Result : Results)
+			Csv += FormatRow(Result) + TEXT("\n");
+
+		FString Json;
+		const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+		BeginJson(*Writer);
+		for (const ResultType& Result : Results)
+		{
+			Writer->WriteObjectStart();
+			WriteFields(*Writer, Result);
+			Writer->WriteObjectEnd();
+		}
+		EndJson(*Writer);
+
+		return SaveResults(OutputPath, BenchmarkName, Csv, Json);
+	}
+
+private:
+
+	// Opens the JSON document with the platform and time, and starts its results array
+	static void BeginJson(TJsonWriter<>& Writer);
+	// Closes the results array and the document
+	static void EndJson(TJsonWriter<>& Writer);
+	static bool SaveResults(const FString& OutputPath, const TCHAR* BenchmarkName, const FString& Csv, const FString& Json);
+};
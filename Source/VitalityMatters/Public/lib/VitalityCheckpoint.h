@@ -0,0 +1,109 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VitalityEnums.h"
+#include "VitalitySnapshot.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+struct FVitalitySaveRecord;
+
+
+/**
+ * One actor's vitality inside a world checkpoint. Fixed size plain-old-data,
+ * so a checkpoint file can be memory mapped and read in place without parsing.
+ */
+struct VITALITYMATTERS_API FVitalityCheckpointEntry
+{
+	static constexpr int32 NumLayers		= FVitalityStatSnapshot::NumLayers;
+	static constexpr int32 NumCoreStats		= FVitalityStatSnapshot::NumCoreStats;
+	static constexpr int32 NumDamageTypes	= FVitalityStatSnapshot::NumDamageTypes;
+	static constexpr int32 NumPools			= static_cast<int32>(EVitalityCategory::MAX);
+	static constexpr int32 MaxEffects		= FVitalityEffectsSnapshot::MaxListedEffects;
+
+	struct FEffect
+	{
+		int32 UniqueId			= 0;
+		int32 RemainingTicks	= 0;
+		EEffectsBeneficial	BenefitEffect	= EEffectsBeneficial::MAX;
+		EEffectsDetrimental	DetrimentEffect	= EEffectsDetrimental::MAX;
+		uint8 bIsPersistent		= 0;
+		uint8 Padding			= 0;
+	};
+
+	uint64 StableId			= 0;
+	// The EVitalitySaveSections this entry holds
+	uint8 Sections			= 0;
+	uint8 bIsDead			= 0;
+	ECombatState CombatState = ECombatState::RELAXED;
+	uint8 NumEffects		= 0;
+	// Indexed by EVitalityCategory
+	float PoolCurrent[NumPools]	= {};
+	float PoolMax[NumPools]		= {};
+	// Indexed by EVitalityStatLayer, excluding TOTAL
+	float CoreStats[NumLayers][NumCoreStats]		= {};
+	float DamageBonuses[NumLayers][NumDamageTypes]	= {};
+	float DamageResists[NumLayers][NumDamageTypes]	= {};
+	FEffect Effects[MaxEffects];
+
+	// Fills the entry from the components' published snapshots. Any of them may be null.
+	void SetFromSnapshots(const FVitalityWelfareSnapshot* Welfare,
+		const FVitalityStatSnapshot* Stats, const FVitalityEffectsSnapshot* Effects);
+
+	// Expands the entry into a save record, so it can be applied like any other save
+	void ToSaveRecord(FVitalitySaveRecord& OutRecord) const;
+};
+
+// The first bytes of a checkpoint file, followed by NumEntries entries sorted by StableId
+struct FVitalityCheckpointHeader
+{
+	static constexpr uint32 CheckpointMagic		= 0x4B434D56; // "VMCK"
+	// Bump whenever FVitalityCheckpointEntry changes
+	static constexpr uint16 CheckpointVersion	= 1;
+
+	uint32 Magic		= CheckpointMagic;
+	uint16 Version		= CheckpointVersion;
+	uint16 EntrySize	= sizeof(FVitalityCheckpointEntry);
+	uint32 NumEntries	= 0;
+	uint32 Padding		= 0;
+	// UTC ticks of when the checkpoint was gathered
+	int64 Timestamp		= 0;
+};
+
+
+/**
+ * A memory mapped world checkpoint. Opening only maps and validates the header;
+ * entries are looked up in place with a binary search over their stable IDs.
+ */
+class VITALITYMATTERS_API FVitalityCheckpointFile
+{
+public:
+
+	FVitalityCheckpointFile();
+	~FVitalityCheckpointFile();
+
+	// Maps the checkpoint. Returns false if it is missing or was written by an incompatible build.
+	bool Open(const FString& FilePath);
+	void Close();
+
+	bool IsOpen() const { return Entries_ != nullptr; }
+	int32 GetNumEntries() const { return NumEntries_; }
+	int64 GetTimestamp() const { return Timestamp_; }
+
+	// Returns the entry of the given stable ID, or nullptr if it is not in the checkpoint
+	const FVitalityCheckpointEntry* Find(uint64 StableId) const;
+
+	// Sorts the entries by stable ID, writes them next to the checkpoint, then replaces it.
+	// Safe to call from any thread.
+	static bool Write(const FString& FilePath, TArray<FVitalityCheckpointEntry>& Entries, int64 Timestamp);
+
+private:
+
+	TUniquePtr<IMappedFileHandle> MappedFile_;
+	TUniquePtr<IMappedFileRegion> MappedRegion_;
+	const FVitalityCheckpointEntry* Entries_ = nullptr;
+	int32 NumEntries_ = 0;
+	int64 Timestamp_ = 0;
+};
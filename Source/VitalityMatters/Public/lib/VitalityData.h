@@ -36,6 +36,111 @@ struct VITALITYMATTERS_API FStDamageData
 	UPROPERTY(EditAnywhere, BlueprintReadWrite) float TotalDamageDealt = 0.f;
 };
 
+/**
+ * The welfare pools as one replicated block, indexed by EVitalityCategory. The welfare
+ * component refreshes it from its pools when it publishes a changed snapshot, so every
+ * pool change in a frame goes out together. Under Iris it uses FVitalityPoolBlockNetSerializer.
+ */
+USTRUCT()
+struct VITALITYMATTERS_API FVitalityPoolBlock
+{
+	GENERATED_BODY()
+
+	static constexpr int32 NumPools = 5;
+	static_assert(NumPools == static_cast<int32>(EVitalityCategory::MAX), "One entry per vitality category");
+
+	UPROPERTY() float Current[NumPools] = {};
+	UPROPERTY() float Maximum[NumPools] = {};
+
+	bool operator==(const FVitalityPoolBlock& Other) const
+	{
+		return FMemory::Memcmp(Current, Other.Current, sizeof(Current)) == 0
+			&& FMemory::Memcmp(Maximum, Other.Maximum, sizeof(Maximum)) == 0;
+	}
+	bool operator!=(const FVitalityPoolBlock& Other) const { return !(*this == Other); }
+};
+
+/**
+ * The rate each pool was moving at when its value in the pool block was sampled, and the
+ * server time of the sample. The owning client extrapolates the pools from these between
+ * updates, so a pool that regenerates or drains steadily needs no further replication.
+ */
+USTRUCT()
+struct VITALITYMATTERS_API FVitalityPoolTrend
+{
+	GENERATED_BODY()
+
+	// Units per second, including digestion. Zero for pools that are not moving on their own.
+	UPROPERTY() float Rate[FVitalityPoolBlock::NumPools] = {};
+	// Server world time each pool was sampled at. A double, since a float loses sub-frame precision on long-running servers.
+	UPROPERTY() double Timestamp[FVitalityPoolBlock::NumPools] = {};
+
+	// The pool's value at the given server time, extrapolated from the sample and kept within the pool
+	float Extrapolate(const FVitalityPoolBlock& Pools, int32 Pool, double ServerTime) const
+	{
+		const float Elapsed = FMath::Max(static_cast<float>(ServerTime - Timestamp[Pool]), 0.f);
+		return FMath::Clamp(Pools.Current[Pool] + Rate[Pool] * Elapsed, 0.f, Pools.Maximum[Pool]);
+	}
+};
+
+/**
+ * How eagerly one pool replicates to its owner. A change goes out once it moves the pool
+ * by more than the deadband, and the minimum interval has passed since the pool was last
+ * sent. Reaching empty or full, and any change to the maximum, go out immediately.
+ */
+USTRUCT(BlueprintType)
+struct VITALITYMATTERS_API FVitalityReplicationPolicy
+{
+	GENERATED_BODY()
+
+	FVitalityReplicationPolicy() {}
+	FVitalityReplicationPolicy(float InDeadband, float InMinInterval)
+		: Deadband(InDeadband), MinInterval(InMinInterval) {}
+
+	// Fraction of the maximum the pool must move by before it is sent. Zero sends every change.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float Deadband = 0.f;
+	// Seconds between two sends of the pool. Zero sends as soon as the deadband is exceeded.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0"))
+	float MinInterval = 0.f;
+	// If TRUE, the owning client eases the pool toward each update over MinInterval instead of jumping
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bInterpolate = true;
+};
+
+/**
+ * What other players see of an actor's welfare. Simulated proxies receive this in place
+ * of the pool block and the damage history, which go to the owning connection only.
+ */
+USTRUCT()
+struct VITALITYMATTERS_API FVitalityProxySummary
+{
+	GENERATED_BODY()
+
+	// Health, stamina and magic as percents, quantized to 0-255
+	UPROPERTY() uint8 HealthPercent = 255;
+	UPROPERTY() uint8 StaminaPercent = 255;
+	UPROPERTY() uint8 MagicPercent = 255;
+	UPROPERTY() EVitalityStatus Status = EVitalityStatus::ALIVE;
+	UPROPERTY() ECombatState CombatState = ECombatState::RELAXED;
+
+	float GetHealthPercent() const	{ return HealthPercent / 255.f; }
+	float GetStaminaPercent() const	{ return StaminaPercent / 255.f; }
+	float GetMagicPercent() const	{ return MagicPercent / 255.f; }
+	void SetHealthPercent(float Percent)	{ HealthPercent = QuantizePercent(Percent); }
+	void SetStaminaPercent(float Percent)	{ StaminaPercent = QuantizePercent(Percent); }
+	void SetMagicPercent(float Percent)		{ MagicPercent = QuantizePercent(Percent); }
+
+	static uint8 QuantizePercent(float Percent) { return FMath::RoundToInt(FMath::Clamp(Percent, 0.f, 1.f) * 255.f); }
+
+	bool operator==(const FVitalityProxySummary& Other) const
+	{
+		return HealthPercent == Other.HealthPercent && StaminaPercent == Other.StaminaPercent
+			&& MagicPercent == Other.MagicPercent && Status == Other.Status && CombatState == Other.CombatState;
+	}
+	bool operator!=(const FVitalityProxySummary& Other) const { return !(*this == Other); }
+};
+
 USTRUCT(BlueprintType)
 struct VITALITYMATTERS_API FStVitalityStats
 {
@@ -71,6 +176,9 @@ struct VITALITYMATTERS_API FStVitalityStats
 	float GetDamageBonusValue(const EDamageType DamageEnum) const;
 	// Allows safe access to DamageResists by using the Enum
 	float GetDamageResistValue(const EDamageType DamageEnum) const;
+
+	// Heap memory held by the stat arrays and bound delegates
+	SIZE_T GetAllocatedSize() const;
 	
 	UPROPERTY(BlueprintAssignable) FOnCoreStatUpdated		OnCoreStatUpdated;
 	UPROPERTY(BlueprintAssignable) FOnDamageBonusUpdated	OnDamageBonusUpdated;
@@ -0,0 +1,147 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VitalityEnums.h"
+
+#include "VitalityDataBlob.generated.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+class UDataTable;
+struct FStNutritionData;
+struct FStVitalityEffects;
+
+
+// A DT_VitalityData row, without its title or icon. The class is kept as an interned path.
+struct FVitalityBlobEffect
+{
+	// FVitalityDataBlob::HashName() of the row name. Rows are sorted by it.
+	uint64 NameHash			= 0;
+	// Offset of the row name in the string table
+	uint32 NameOffset		= 0;
+	// Offset of the optionalClass class path, or zero for none
+	uint32 ClassOffset		= 0;
+	int32 EffectTicks		= 0;
+	EEffectsBeneficial	BenefitEffect	= EEffectsBeneficial::MAX;
+	EEffectsDetrimental	DetrimentEffect	= EEffectsDetrimental::MAX;
+	uint8 bIsPersistent		= 0;
+	uint8 bEffectStacks		= 0;
+	uint8 bAttachOnSpawn	= 0;
+	uint8 bDisableSprinting	= 0;
+	uint8 Padding[6]		= {};
+};
+
+// A DT_NutritionTable row. The spawn class is kept as an interned path, and only loaded if used.
+struct FVitalityBlobNutrition
+{
+	uint64 NameHash			= 0;
+	uint32 NameOffset		= 0;
+	uint32 ProperNameOffset	= 0;
+	// Offset of the optionalSpawnActor class path, or zero for none
+	uint32 SpawnClassOffset	= 0;
+	float Calories			= 0.f;
+	float Hydration			= 0.f;
+	float DigestSeconds		= 0.f;
+	int32 BenefitCount		= 0;
+	int32 DetrimentCount	= 0;
+	EEffectsBeneficial	AddBenefit		= EEffectsBeneficial::MAX;
+	EEffectsDetrimental	AddDetriment	= EEffectsDetrimental::MAX;
+	uint8 Padding[2]		= {};
+};
+
+// The first bytes of a data blob. Followed by the effects, the nutrition rows, then the string table.
+struct FVitalityBlobHeader
+{
+	static constexpr uint32 BlobMagic	= 0x42444D56; // "VMDB"
+	// Bump whenever a blob record changes
+	static constexpr uint16 BlobVersion	= 2;
+	static constexpr int32 NumBenefits		= static_cast<int32>(EEffectsBeneficial::MAX);
+	static constexpr int32 NumDetriments	= static_cast<int32>(EEffectsDetrimental::MAX);
+
+	uint32 Magic			= BlobMagic;
+	uint16 Version			= BlobVersion;
+	uint8 NumBenefitTypes	= NumBenefits;
+	uint8 NumDetrimentTypes	= NumDetriments;
+	uint32 NumEffects		= 0;
+	uint32 NumNutrition		= 0;
+	uint32 StringBytes		= 0;
+	uint32 Padding			= 0;
+	// The effect index of each EEffectsBeneficial / EEffectsDetrimental, or INDEX_NONE
+	int32 BenefitIndex[NumBenefits];
+	int32 DetrimentIndex[NumDetriments];
+};
+
+
+/**
+ * The vitality data tables baked into one server-only file of plain rows. Icons, titles
+ * and classes are stripped or interned, so a dedicated server reads its effects and
+ * nutrition with a single map of the file instead of loading the tables' assets.
+ */
+class VITALITYMATTERS_API FVitalityDataBlob
+{
+public:
+
+	FVitalityDataBlob();
+	~FVitalityDataBlob();
+
+	// The blob opened at startup. Only opened on dedicated servers.
+	static FVitalityDataBlob& Get();
+	static FString GetDefaultPath();
+
+	// Maps the blob, or reads it in one go if the platform cannot map files.
+	// Returns false if it is missing or was cooked by an incompatible build.
+	bool Open(const FString& FilePath);
+	void Close();
+	bool IsOpen() const { return Header_ != nullptr; }
+
+	TConstArrayView<FVitalityBlobEffect> GetEffects() const;
+	TConstArrayView<FVitalityBlobNutrition> GetNutrition() const;
+	// Returns the interned string at the offset. Offset zero is always the empty string.
+	const UTF8CHAR* GetString(uint32 Offset) const;
+
+	const FVitalityBlobEffect* FindEffect(FName EffectName) const;
+	const FVitalityBlobEffect* FindEffectByBenefit(EEffectsBeneficial EffectEnum) const;
+	const FVitalityBlobEffect* FindEffectByDetriment(EEffectsDetrimental EffectEnum) const;
+	const FVitalityBlobNutrition* FindNutrition(FName RowName) const;
+
+	// Expands a blob effect into a table row. The title is the row name, there is no icon, and the class is loaded.
+	void ToEffectRow(const FVitalityBlobEffect& BlobEffect, FStVitalityEffects& OutEffect) const;
+
+	// Case insensitive, like FName
+	static uint64 HashName(FName Name);
+
+	// Bakes both tables into a blob, written next to the path first and then moved over it
+	static bool Cook(const UDataTable* EffectsTable, const UDataTable* NutritionTable, const FString& FilePath);
+
+private:
+
+	TUniquePtr<IMappedFileHandle> MappedFile_;
+	TUniquePtr<IMappedFileRegion> MappedRegion_;
+	// Used instead of the mapping where files cannot be mapped
+	TArray64<uint8> FileBytes_;
+
+	const FVitalityBlobHeader* Header_ = nullptr;
+	const FVitalityBlobEffect* Effects_ = nullptr;
+	const FVitalityBlobNutrition* Nutrition_ = nullptr;
+	const UTF8CHAR* Strings_ = nullptr;
+};
+
+
+/**
+ * Bakes DT_VitalityData and DT_NutritionTable into the server data blob.
+ * Run with: UnrealEditor-Cmd <Project> -run=VitalityCookData [-Output=<Path>]
+ * The output folder must be staged as a non-asset directory for servers to find it.
+ */
+UCLASS()
+class VITALITYMATTERS_API UVitalityCookDataCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+
+	UVitalityCookDataCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
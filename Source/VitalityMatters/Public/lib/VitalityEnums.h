@@ -138,6 +138,76 @@ enum class EDamageType : uint8
 	MAX			UMETA(Hidden)
 };
 
+// A stat layer is one of the four stat groups managed by the stat component
+UENUM(BlueprintType)
+enum class EVitalityStatLayer : uint8
+{
+	NATURAL = 0	UMETA(DisplayName = "Natural"),
+	GEAR		UMETA(DisplayName = "Gear"),
+	MAGICAL		UMETA(DisplayName = "Magical"),
+	OTHER		UMETA(DisplayName = "Other"),
+	TOTAL		UMETA(DisplayName = "Total (All Layers)"),
+	MAX			UMETA(Hidden)
+};
+
+// The kind of value a derived stat formula term reads from
+UENUM(BlueprintType)
+enum class EDerivedStatSource : uint8
+{
+	CORE_STAT = 0	UMETA(DisplayName = "Core Stat"),
+	DAMAGE_BONUS	UMETA(DisplayName = "Damage Bonus"),
+	DAMAGE_RESIST	UMETA(DisplayName = "Damage Resistance"),
+	DERIVED			UMETA(DisplayName = "Derived Stat"),
+	MAX				UMETA(Hidden)
+};
+
+// The welfare value a derived stat is pushed into when it changes
+UENUM(BlueprintType)
+enum class EDerivedStatTarget : uint8
+{
+	NONE = 0		UMETA(DisplayName = "None (Query Only)"),
+	HEALTH_MAX		UMETA(DisplayName = "Max Health"),
+	STAMINA_MAX		UMETA(DisplayName = "Max Stamina"),
+	MAGIC_MAX		UMETA(DisplayName = "Max Magic"),
+	HYDRATION_MAX	UMETA(DisplayName = "Max Hydration"),
+	CALORIES_MAX	UMETA(DisplayName = "Max Calories"),
+	HEALTH_REGEN	UMETA(DisplayName = "Health Regen"),
+	STAMINA_REGEN	UMETA(DisplayName = "Stamina Regen"),
+	MAGIC_REGEN		UMETA(DisplayName = "Magic Regen"),
+	MAX				UMETA(Hidden)
+};
+
+// The groups of values returned by a vitality batch query
+UENUM(BlueprintType, meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class EVitalityQueryFields : uint8
+{
+	NONE			= 0			UMETA(Hidden),
+	POOLS			= 1 << 0	UMETA(DisplayName = "Pool Percentages"),
+	COMBAT			= 1 << 1	UMETA(DisplayName = "Dead & Combat State"),
+	CORE_STATS		= 1 << 2	UMETA(DisplayName = "Core Stat Totals"),
+	DAMAGE_BONUSES	= 1 << 3	UMETA(DisplayName = "Damage Bonus Totals"),
+	RESISTANCES		= 1 << 4	UMETA(DisplayName = "Resistance Totals"),
+	EFFECTS			= 1 << 5	UMETA(DisplayName = "Active Effect Bits"),
+	ALL				= 0x3F		UMETA(Hidden)
+};
+ENUM_CLASS_FLAGS(EVitalityQueryFields);
+
+// The independently saved parts of an actor's vitality. Used for dirty tracking and journaling.
+UENUM(BlueprintType, meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class EVitalitySaveSections : uint8
+{
+	NONE			= 0			UMETA(Hidden),
+	WELFARE			= 1 << 0	UMETA(DisplayName = "Welfare Pools"),
+	STATS_NATURAL	= 1 << 1	UMETA(DisplayName = "Natural Stats"),
+	STATS_GEAR		= 1 << 2	UMETA(DisplayName = "Gear Stats"),
+	STATS_MAGICAL	= 1 << 3	UMETA(DisplayName = "Magical Stats"),
+	STATS_OTHER		= 1 << 4	UMETA(DisplayName = "Other Stats"),
+	EFFECTS			= 1 << 5	UMETA(DisplayName = "Active Effects"),
+	STATS			= 0x1E		UMETA(Hidden),
+	ALL				= 0x3F		UMETA(Hidden)
+};
+ENUM_CLASS_FLAGS(EVitalitySaveSections);
+
 // A list of all values that wielding equipment can modify
 // Is this obsolete?
 UENUM(BlueprintType)
@@ -0,0 +1,51 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "VitalityMicroBenchmark.generated.h"
+
+
+// The timing of one microbenchmark case
+struct FVitalityMicroBenchmarkResult
+{
+	FString Name;
+	// The case's size parameter (such as the number of active effects), or zero if it has none
+	int32 Param					= 0;
+	int32 Iterations			= 0;
+	// Nanoseconds per operation of each timed sample
+	TArray<double> SampleNs;
+	double NsMean				= 0.0;
+	double NsMedian				= 0.0;
+	double NsStdDev				= 0.0;
+	double NsMin				= 0.0;
+	double NsP95				= 0.0;
+	double NsMax				= 0.0;
+};
+
+
+/**
+ * Headless microbenchmark of the individual vitality hot operations. Each case is set up
+ * outside of the timed region, warmed up, and then timed as a number of samples of a fixed
+ * number of iterations each. The per-operation statistics are written as CSV and JSON,
+ * so that a change can be compared against the same command run before it.
+ *
+ * Run with: UnrealEditor-Cmd <Project> -run=VitalityMicroBenchmark -nullrhi
+ *     [-Iterations=1000] [-Samples=30] [-Warmup=3] [-EffectCounts=16,256,4096]
+ *     [-Filter=<Case name substring>] [-Output=<Path without extension>]
+ *
+ * Effect lookups resolve through the cooked data blob when one is open, and through the
+ * effects table otherwise, the same as at runtime.
+ */
+UCLASS()
+class VITALITYMATTERS_API UVitalityMicroBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+
+	UVitalityMicroBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,49 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Iris/Serialization/NetSerializer.h"
+
+#include "VitalityNetSerializers.generated.h"
+
+/**
+ * Iris net serializers for the replicated vitality state. They are registered by struct
+ * name, so Iris picks them up for every property of these types without a fallback to
+ * the legacy property bridge. Without Iris (UE_WITH_IRIS=0) the serializers are compiled
+ * out, and the same properties replicate through the generic replication path.
+ *
+ * Values are quantized to hundredths. Deltas are taken against the last state the
+ * connection acknowledged, so a frame where one pool or stat moved sends that value only.
+ *
+ *  FVitalityPoolBlock:	a changed bit per value, then the packed value
+ *  FStVitalityStats:	the layer sizes, then a changed bit per value; the delegates are not sent
+ *  FStVitalityEffects:	the effect enums, ticks, ID and flags, plus a hash of the row name for
+ *						effects with neither enum set. The title, icon and class are filled in
+ *						on receipt from the effects table, by the effect's enum or row name.
+ */
+
+USTRUCT()
+struct FVitalityPoolBlockNetSerializerConfig : public FNetSerializerConfig
+{
+	GENERATED_BODY()
+};
+
+USTRUCT()
+struct FVitalityStatsNetSerializerConfig : public FNetSerializerConfig
+{
+	GENERATED_BODY()
+};
+
+USTRUCT()
+struct FVitalityEffectNetSerializerConfig : public FNetSerializerConfig
+{
+	GENERATED_BODY()
+};
+
+namespace UE::Net
+{
+	UE_NET_DECLARE_SERIALIZER(FVitalityPoolBlockNetSerializer, VITALITYMATTERS_API);
+	UE_NET_DECLARE_SERIALIZER(FVitalityStatsNetSerializer, VITALITYMATTERS_API);
+	UE_NET_DECLARE_SERIALIZER(FVitalityEffectNetSerializer, VITALITYMATTERS_API);
+}
@@ -0,0 +1,148 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "VitalityEnums.h"
+
+#include <atomic>
+
+/**
+ * Single-writer, many-reader double buffer for plain-old-data snapshots.
+ * The game thread writes into the back buffer and flips it to the front with one
+ * atomic version increment. Readers never lock: they copy the front buffer and retry
+ * if the version moved while copying. The version doubles as the snapshot version.
+ */
+template <typename SnapshotType>
+class TVitalityDoubleBuffer
+{
+	static_assert(TIsTriviallyDestructible<SnapshotType>::Value,
+		"Vitality snapshots must be plain-old-data so they can be copied while being replaced");
+
+public:
+
+	// Returns the back buffer. Game thread only, and only once per Publish().
+	SnapshotType& BeginWrite()
+	{
+		// Keeps the writes below from being observed before the previous flip
+		std::atomic_thread_fence(std::memory_order_release);
+		return Buffers_[(Version_.load(std::memory_order_relaxed) + 1) & 1];
+	}
+
+	// Flips the back buffer to the front. Game thread only.
+	void Publish()
+	{
+		Version_.fetch_add(1, std::memory_order_release);
+	}
+
+	/**
+	 * @brief Copies the front buffer. Safe to call from any thread.
+	 * @param OutSnapshot Receives a consistent copy of the latest published snapshot
+	 * @return The version that was copied, or zero if nothing was published yet
+	 */
+	uint64 Read(SnapshotType& OutSnapshot) const
+	{
+		for (;;)
+		{
+			const uint64 VersionBefore = Version_.load(std::memory_order_acquire);
+			FMemory::Memcpy(&OutSnapshot, &Buffers_[VersionBefore & 1], sizeof(SnapshotType));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (Version_.load(std::memory_order_relaxed) == VersionBefore)
+				return VersionBefore;
+			FPlatformProcess::Yield();
+		}
+	}
+
+	uint64 GetVersion() const { return Version_.load(std::memory_order_acquire); }
+
+	// The most recently published buffer. Game thread only.
+	const SnapshotType& GetFront() const { return Buffers_[Version_.load(std::memory_order_relaxed) & 1]; }
+
+private:
+
+	SnapshotType Buffers_[2] = {};
+	std::atomic<uint64> Version_{0};
+};
+
+
+// Immutable copy of a welfare component's pools, published once per frame
+struct FVitalityWelfareSnapshot
+{
+	float HealthCurrent		= 0.f;
+	float HealthMax			= 0.f;
+	float StaminaCurrent	= 0.f;
+	float StaminaMax		= 0.f;
+	float MagicCurrent		= 0.f;
+	float MagicMax			= 0.f;
+	float HydrationCurrent	= 0.f;
+	float HydrationMax		= 0.f;
+	float CaloriesCurrent	= 0.f;
+	float CaloriesMax		= 0.f;
+	bool  bIsDead			= false;
+	ECombatState CombatState = ECombatState::RELAXED;
+
+	static float GetPercent(float Current, float Max) { return Max > 0.f ? FMath::Clamp(Current/Max, 0.f, 1.f) : 0.f; }
+	float GetHealthPercent() const		{ return bIsDead ? 0.f : GetPercent(HealthCurrent, HealthMax); }
+	float GetStaminaPercent() const		{ return GetPercent(StaminaCurrent, StaminaMax); }
+	float GetMagicPercent() const		{ return GetPercent(MagicCurrent, MagicMax); }
+	float GetHydrationPercent() const	{ return GetPercent(HydrationCurrent, HydrationMax); }
+	float GetHungerPercent() const		{ return GetPercent(CaloriesCurrent, CaloriesMax); }
+};
+
+// Immutable copy of a stat component's four layers and their totals
+struct FVitalityStatSnapshot
+{
+	static constexpr int32 NumLayers		= static_cast<int32>(EVitalityStatLayer::TOTAL);
+	static constexpr int32 NumCoreStats		= static_cast<int32>(EVitalityStat::MAX);
+	static constexpr int32 NumDamageTypes	= static_cast<int32>(EDamageType::MAX);
+
+	// Indexed by EVitalityStatLayer, including TOTAL as the last entry
+	float CoreStats[NumLayers + 1][NumCoreStats]		= {};
+	float DamageBonuses[NumLayers + 1][NumDamageTypes]	= {};
+	float DamageResists[NumLayers + 1][NumDamageTypes]	= {};
+
+	float GetTotalCoreStat(EVitalityStat StatEnum) const
+	{
+		return StatEnum < EVitalityStat::MAX ? CoreStats[NumLayers][static_cast<int32>(StatEnum)] : 0.f;
+	}
+	float GetTotalDamageBonus(EDamageType DamageEnum) const
+	{
+		return DamageEnum < EDamageType::MAX ? DamageBonuses[NumLayers][static_cast<int32>(DamageEnum)] : 0.f;
+	}
+	float GetTotalResistance(EDamageType DamageEnum) const
+	{
+		return DamageEnum < EDamageType::MAX ? DamageResists[NumLayers][static_cast<int32>(DamageEnum)] : 0.f;
+	}
+};
+
+// Immutable copy of an effects component's active effects
+struct FVitalityEffectsSnapshot
+{
+	// The number of effects copied in full. The counts and bits always cover every effect.
+	static constexpr int32 MaxListedEffects = 32;
+
+	struct FEffect
+	{
+		int32 UniqueId		= 0;
+		int32 EffectTicks	= 0;
+		EEffectsBeneficial	BenefitEffect	= EEffectsBeneficial::MAX;
+		EEffectsDetrimental	DetrimentEffect	= EEffectsDetrimental::MAX;
+		bool bIsPersistent	= false;
+	};
+
+	uint32 BenefitBits		= 0;
+	uint32 DetrimentBits	= 0;
+	uint8  BenefitCounts[static_cast<int32>(EEffectsBeneficial::MAX)]		= {};
+	uint8  DetrimentCounts[static_cast<int32>(EEffectsDetrimental::MAX)]	= {};
+	int32  NumEffects		= 0;
+	FEffect Effects[MaxListedEffects];
+
+	bool IsBenefitActive(EEffectsBeneficial EffectEnum) const
+	{
+		return EffectEnum < EEffectsBeneficial::MAX && (BenefitBits & (1u << static_cast<uint32>(EffectEnum))) != 0;
+	}
+	bool IsDetrimentActive(EEffectsDetrimental EffectEnum) const
+	{
+		return EffectEnum < EEffectsDetrimental::MAX && (DetrimentBits & (1u << static_cast<uint32>(EffectEnum))) != 0;
+	}
+};
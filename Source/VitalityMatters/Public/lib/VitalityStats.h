@@ -0,0 +1,102 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+
+/**
+ * Profiling for the vitality components. "stat Vitality" shows the cycle counters of the
+ * hot paths and how many damage events, effects, timers and delegates ran this frame.
+ *
+ * Running with -trace=cpu,vitality records the same paths as CPU scopes in Unreal Insights,
+ * along with a DamageApplied, EffectApplied or EffectExpired event for each occurrence.
+ * Nothing is recorded, and the events cost a single branch, while the channel is off.
+ */
+
+DECLARE_STATS_GROUP(TEXT("Vitality"), STATGROUP_Vitality, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("DamageHealth"),		STAT_VitalityDamageHealth,		STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TickEffects"),		STAT_VitalityTickEffects,		STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TickWelfare"),		STAT_VitalityTickWelfare,		STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OnRep Welfare"),	STAT_VitalityOnRepWelfare,		STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OnRep Effects"),	STAT_VitalityOnRepEffects,		STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("StatsEventTrigger"), STAT_VitalityStatsEventTrigger, STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TickDigestion"),	STAT_VitalityTickDigestion,		STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PublishFrameSnapshot"), STAT_VitalityPublishSnapshot, STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ParallelUpdate"),	STAT_VitalityParallelUpdate,	STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ParallelUpdate Apply"), STAT_VitalityParallelApply, STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mass Damage"),		STAT_VitalityMassDamage,		STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mass Pools"),		STAT_VitalityMassPools,			STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mass Effects"),		STAT_VitalityMassEffects,		STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mass Actor Bridge"), STAT_VitalityMassBridge,		STATGROUP_Vitality, VITALITYMATTERS_API);
+
+// Counters are reset every frame
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Damage Events"),		STAT_VitalityDamageEvents,		STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Effects Applied"),		STAT_VitalityEffectsApplied,	STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Effects Expired"),		STAT_VitalityEffectsExpired,	STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Timers Fired"),			STAT_VitalityTimersFired,		STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Delegates Broadcast"),	STAT_VitalityDelegatesBroadcast, STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pools Replicated"),		STAT_VitalityPoolsReplicated,	STATGROUP_Vitality, VITALITYMATTERS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Pools Held Back"),		STAT_VitalityPoolsHeldBack,		STATGROUP_Vitality, VITALITYMATTERS_API);
+
+// Enabled with -trace=vitality
+UE_TRACE_CHANNEL_EXTERN(VitalityChannel, VITALITYMATTERS_API);
+
+// Counts the scope under the stat, and records it as a CPU scope on the vitality channel
+#define VITALITY_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Stat, VitalityChannel)
+
+
+// Heap memory held by a vitality component, by container. Reported by vitality.memreport.
+struct FVitalityMemoryUsage
+{
+	// DamageHistory_
+	SIZE_T History	= 0;
+	// The active effects
+	SIZE_T Effects	= 0;
+	// The stat layers
+	SIZE_T Stats	= 0;
+	// The effect add and remove queues, and the digestion queue
+	SIZE_T Queues	= 0;
+	// Configuration, like hit animations and derived stat formulas
+	SIZE_T Other	= 0;
+
+	SIZE_T GetTotal() const { return History + Effects + Stats + Queues + Other; }
+
+	FVitalityMemoryUsage& operator+=(const FVitalityMemoryUsage& Usage)
+	{
+		History	+= Usage.History;
+		Effects	+= Usage.Effects;
+		Stats	+= Usage.Stats;
+		Queues	+= Usage.Queues;
+		Other	+= Usage.Other;
+		return *this;
+	}
+};
+
+
+class AActor;
+
+namespace VitalityTrace
+{
+	// Actors are identified by their object unique ID, which is zero for none
+	VITALITYMATTERS_API void DamageApplied(const AActor* DamagedActor, const AActor* DamageInstigator,
+		float DamageTaken, float HealthAfter, bool bKilled);
+	VITALITYMATTERS_API void EffectApplied(const AActor* EffectActor, int UniqueId, FName EffectName, int StackCount);
+	VITALITYMATTERS_API void EffectExpired(const AActor* EffectActor, int UniqueId, FName EffectName);
+}
+
+#if UE_TRACE_ENABLED
+#define VITALITY_TRACE_EVENT(EventName, ...) \
+	do \
+	{ \
+		if (UE_TRACE_CHANNELEXPR_IS_ENABLED(VitalityChannel)) \
+			VitalityTrace::EventName(__VA_ARGS__); \
+	} while (0)
+#else
+#define VITALITY_TRACE_EVENT(EventName, ...) do {} while (0)
+#endif
@@ -38,11 +38,17 @@ public class VitalityMatters : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
-				"EnhancedInput"
+				"EnhancedInput",
+				"Json",
+				"TraceLog",
+				"VitalityCore"
 			}
 			);
 		
 		
+		// Adds IrisCore and defines UE_WITH_IRIS, for the vitality net serializers
+		SetupIrisSupport(Target);
+		
 		DynamicallyLoadedModuleNames.AddRange(
 			new string[]
 			{
@@ -0,0 +1,232 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#include "VitalityReplicationGraphNode.h"
+
+#include "VitalityEffectsComponent.h"
+#include "VitalityStatComponent.h"
+#include "VitalityWelfareComponent.h"
+#include "GameFramework/Pawn.h"
+
+
+namespace
+{
+	// Below this speed an actor counts as standing still
+	constexpr float IdleSpeedSquared = 1.f;
+
+	// True if the pool is full, or not in use
+	bool IsPoolFull(float Current, float Maximum)
+	{
+		return Maximum <= 0.f || Current >= Maximum;
+	}
+}
+
+
+UVitalityReplicationGraphNode::UVitalityReplicationGraphNode()
+{
+	bRequiresPrepareForReplicationCall = true;
+}
+
+void UVitalityReplicationGraphNode::NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	AActor* Actor = ActorInfo.Actor;
+	if (!IsValid(Actor))
+		return;
+
+	UVitalityWelfareComponent* Welfare	= Actor->FindComponentByClass<UVitalityWelfareComponent>();
+	UVitalityStatComponent* Stats		= Actor->FindComponentByClass<UVitalityStatComponent>();
+	UVitalityEffectsComponent* Effects	= Actor->FindComponentByClass<UVitalityEffectsComponent>();
+	if (!IsValid(Welfare))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s(%s): Routed an actor with no welfare component. It will not replicate.")
+			, *GetName(), *Actor->GetName());
+		return;
+	}
+
+	FTrackedActor Tracked;
+	Tracked.Actor			= Actor;
+	Tracked.Welfare			= Welfare;
+	Tracked.Stats			= Stats;
+	Tracked.Effects			= Effects;
+	Tracked.WelfareVersion	= Welfare->GetSnapshotVersion();
+	Tracked.StatsVersion	= IsValid(Stats) ? Stats->GetSnapshotVersion() : 0;
+	Tracked.EffectsVersion	= IsValid(Effects) ? Effects->GetSnapshotVersion() : 0;
+	Actors_.Add(Tracked);
+}
+
+bool UVitalityReplicationGraphNode::NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound)
+{
+	const int32 i = Actors_.IndexOfByPredicate(
+		[&ActorInfo](const FTrackedActor& Tracked) { return Tracked.Actor == ActorInfo.Actor; });
+	if (i == INDEX_NONE)
+	{
+		if (bWarnIfNotFound)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s: Removed an actor that was never added (%s)")
+				, *GetName(), *GetNameSafe(ActorInfo.Actor));
+		}
+		return false;
+	}
+	Actors_.RemoveAtSwap(i);
+	return true;
+}
+
+void UVitalityReplicationGraphNode::NotifyResetAllNetworkActors()
+{
+	Actors_.Reset();
+	ReplicationList_.Reset();
+}
+
+bool UVitalityReplicationGraphNode::IsSettled(const AActor* Actor, const UVitalityWelfareComponent* Welfare,
+	const UVitalityEffectsComponent* Effects) const
+{
+	if (Welfare->GetIsDead())
+		return bDormantWhenDead;
+
+	if (!bDormantWhenIdle || Welfare->GetCombatState() != ECombatState::RELAXED)
+		return false;
+	if (Effects != nullptr && Effects->GetNumberOfActiveEffects() > 0)
+		return false;
+	if (Actor->GetVelocity().SizeSquared() > IdleSpeedSquared)
+		return false;
+
+	float Current, Maximum;
+	Welfare->GetCurrentHealth(Current, Maximum);
+	if (!IsPoolFull(Current, Maximum))
+		return false;
+	Welfare->GetCurrentStamina(Current, Maximum);
+	if (!IsPoolFull(Current, Maximum))
+		return false;
+	Welfare->GetCurrentMagic(Current, Maximum);
+	return IsPoolFull(Current, Maximum);
+}
+
+void UVitalityReplicationGraphNode::PrepareForReplication()
+{
+	for (FTrackedActor& Tracked : Actors_)
+	{
+		AActor* Actor = Tracked.Actor.Get();
+		const UVitalityWelfareComponent* Welfare = Tracked.Welfare.Get();
+		if (Actor == nullptr || Welfare == nullptr)
+			continue;
+		const UVitalityStatComponent* Stats			= Tracked.Stats.Get();
+		const UVitalityEffectsComponent* Effects	= Tracked.Effects.Get();
+
+		const uint64 WelfareVersion	= Welfare->GetSnapshotVersion();
+		const uint64 StatsVersion	= Stats != nullptr ? Stats->GetSnapshotVersion() : 0;
+		const uint64 EffectsVersion	= Effects != nullptr ? Effects->GetSnapshotVersion() : 0;
+		const bool bChanged = WelfareVersion != Tracked.WelfareVersion
+			|| StatsVersion != Tracked.StatsVersion || EffectsVersion != Tracked.EffectsVersion;
+		Tracked.WelfareVersion	= WelfareVersion;
+		Tracked.StatsVersion	= StatsVersion;
+		Tracked.EffectsVersion	= EffectsVersion;
+
+		if (bChanged || !IsSettled(Actor, Welfare, Effects))
+		{
+			Tracked.SettledFrames = 0;
+			if (Tracked.bMadeDormant)
+			{
+				Tracked.bMadeDormant = false;
+				Actor->SetNetDormancy(DORM_Awake);
+			}
+			continue;
+		}
+
+		if (Tracked.bMadeDormant || ++Tracked.SettledFrames < FramesBeforeDormant)
+			continue;
+		// Never override dormancy the game has set up itself
+		if (Actor->NetDormancy == DORM_Awake)
+		{
+			Tracked.bMadeDormant = true;
+			Actor->SetNetDormancy(DORM_DormantAll);
+		}
+	}
+}
+
+EVitalityReplicationTier UVitalityReplicationGraphNode::GetReplicationTier(const AActor* Actor,
+	const UVitalityWelfareComponent* Welfare, const FConnectionGatherActorListParameters& Params,
+	TConstArrayView<const UVitalityWelfareComponent*> ViewerWelfares) const
+{
+	if (Actor->GetNetConnection() == Params.ConnectionManager.NetConnection)
+		return EVitalityReplicationTier::FULL;
+
+	float ClosestDistanceSquared = TNumericLimits<float>::Max();
+	for (int32 i = 0; i < Params.Viewers.Num(); ++i)
+	{
+		const FNetViewer& Viewer = Params.Viewers[i];
+		if (Actor == Viewer.ViewTarget || Actor == Viewer.InViewer)
+			return EVitalityReplicationTier::FULL;
+		if (IsPartyMember(Actor, Viewer))
+			return EVitalityReplicationTier::FULL;
+
+		// Combat targets: either side has damaged the other
+		if (IsValid(Viewer.ViewTarget) && Welfare->IsInDamageHistory(Viewer.ViewTarget))
+			return EVitalityReplicationTier::FULL;
+		const UVitalityWelfareComponent* ViewerWelfare = ViewerWelfares.IsValidIndex(i) ? ViewerWelfares[i] : nullptr;
+		if (ViewerWelfare != nullptr && ViewerWelfare->IsInDamageHistory(Actor))
+			return EVitalityReplicationTier::FULL;
+
+		ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared,
+			FVector::DistSquared(Actor->GetActorLocation(), Viewer.ViewLocation));
+	}
+
+	if (ClosestDistanceSquared <= FMath::Square(FullFidelityDistance))
+		return EVitalityReplicationTier::NEAR;
+	if (ClosestDistanceSquared <= FMath::Square(CullDistance))
+		return EVitalityReplicationTier::DISTANT;
+	return EVitalityReplicationTier::CULLED;
+}
+
+void UVitalityReplicationGraphNode::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	ReplicationList_.Reset(Actors_.Num());
+	const int32 Period = FMath::Max(DistantReplicationPeriod, 1);
+
+	ViewerWelfares_.Reset(Params.Viewers.Num());
+	for (const FNetViewer& Viewer : Params.Viewers)
+	{
+		const UVitalityWelfareComponent* ViewerWelfare = IsValid(Viewer.ViewTarget)
+			? Viewer.ViewTarget->FindComponentByClass<UVitalityWelfareComponent>() : nullptr;
+		ViewerWelfares_.Add(IsValid(ViewerWelfare) ? ViewerWelfare : nullptr);
+	}
+
+	for (int32 i = 0; i < Actors_.Num(); ++i)
+	{
+		const FTrackedActor& Tracked = Actors_[i];
+		AActor* Actor = Tracked.Actor.Get();
+		const UVitalityWelfareComponent* Welfare = Tracked.Welfare.Get();
+		if (Actor == nullptr || Welfare == nullptr)
+			continue;
+
+		switch (GetReplicationTier(Actor, Welfare, Params, ViewerWelfares_))
+		{
+		case EVitalityReplicationTier::FULL:
+		case EVitalityReplicationTier::NEAR:
+			ReplicationList_.Add(Actor);
+			break;
+		case EVitalityReplicationTier::DISTANT:
+			// Offset by index, so the distant actors are spread across the period instead of all at once
+			if ((Params.ReplicationFrameNum + i) % Period == 0)
+				ReplicationList_.Add(Actor);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (ReplicationList_.Num() > 0)
+		Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationList_);
+}
+
+void UVitalityReplicationGraphNode::LogNode(FReplicationGraphDebugInfo& DebugInfo, const FString& NodeName) const
+{
+	DebugInfo.Log(NodeName);
+	DebugInfo.PushIndent();
+	int32 NumDormant = 0;
+	for (const FTrackedActor& Tracked : Actors_)
+	{
+		if (Tracked.bMadeDormant)
+			++NumDormant;
+	}
+	DebugInfo.Log(FString::Printf(TEXT("Vitality actors: %d (%d made dormant)"), Actors_.Num(), NumDormant));
+	DebugInfo.PopIndent();
+}
@@ -0,0 +1,122 @@
+﻿// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+
+#include "VitalityReplicationGraphNode.generated.h"
+
+class UVitalityEffectsComponent;
+class UVitalityStatComponent;
+class UVitalityWelfareComponent;
+
+
+// How often an actor's vitality goes to a connection
+enum class EVitalityReplicationTier : uint8
+{
+	// Every frame: the owner, party members and combat targets
+	FULL,
+	// Every frame, within FullFidelityDistance
+	NEAR,
+	// Every DistantReplicationPeriod frames, up to CullDistance
+	DISTANT,
+	// Not at all
+	CULLED
+};
+
+
+/**
+ * Replication graph node for actors with a welfare component. It decides per connection how
+ * often each actor replicates, so a hundred players do not each receive every other player's
+ * vitality every frame, and puts actors whose vitality has settled to sleep.
+ *
+ * Route vitality-bearing actors to this node from your graph's RouteAddNetworkActorToNodes()
+ * and RouteRemoveNetworkActorToNodes(), in place of the spatial grid. Subclass it and override
+ * IsPartyMember() to give party members full fidelity.
+ *
+ * Configure under [/Script/VitalityReplication.VitalityReplicationGraphNode] in DefaultGame.ini.
+ */
+UCLASS(Config = Game)
+class VITALITYREPLICATION_API UVitalityReplicationGraphNode : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+public:
+
+	UVitalityReplicationGraphNode();
+
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override;
+	virtual void NotifyResetAllNetworkActors() override;
+	virtual void PrepareForReplication() override;
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+	virtual void LogNode(FReplicationGraphDebugInfo& DebugInfo, const FString& NodeName) const override;
+
+	/**
+	 * @brief Decides how often the actor replicates to the connection's viewers.
+	 * @param Actor The vitality-bearing actor
+	 * @param Welfare The actor's welfare component
+	 * @param Params The connection being gathered for
+	 * @param ViewerWelfares The welfare component of each viewer's view target, or null, in the order of Params.Viewers
+	 * @return The tier to replicate the actor at
+	 */
+	virtual EVitalityReplicationTier GetReplicationTier(const AActor* Actor,
+		const UVitalityWelfareComponent* Welfare, const FConnectionGatherActorListParameters& Params,
+		TConstArrayView<const UVitalityWelfareComponent*> ViewerWelfares) const;
+
+	// Override to give the viewer's party members full fidelity. No actor is a party member by default.
+	virtual bool IsPartyMember(const AActor* Actor, const FNetViewer& Viewer) const { return false; }
+
+	// Non-combat actors closer than this replicate every frame
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Vitality Replication")
+	float FullFidelityDistance = 3000.f;
+
+	// Non-combat actors farther than this are not replicated at all
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Vitality Replication")
+	float CullDistance = 15000.f;
+
+	// Frames between replications of an actor in the distant tier
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Vitality Replication")
+	int32 DistantReplicationPeriod = 8;
+
+	// If TRUE, dead actors go dormant until their vitality changes again
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Vitality Replication")
+	bool bDormantWhenDead = true;
+
+	// If TRUE, relaxed actors at full health with no effects that stand still go dormant
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Vitality Replication")
+	bool bDormantWhenIdle = true;
+
+	// Frames an actor must stay dead or idle, with no vitality change, before it goes dormant
+	UPROPERTY(Config, EditAnywhere, BlueprintReadWrite, Category = "Vitality Replication")
+	int32 FramesBeforeDormant = 30;
+
+private:
+
+	// Weak, since this struct is not reflected, and a component can be destroyed apart from its actor
+	struct FTrackedActor
+	{
+		TWeakObjectPtr<AActor> Actor;
+		TWeakObjectPtr<UVitalityWelfareComponent> Welfare;
+		TWeakObjectPtr<UVitalityStatComponent> Stats;
+		TWeakObjectPtr<UVitalityEffectsComponent> Effects;
+		// Snapshot versions when last checked. Any change wakes the actor.
+		uint64 WelfareVersion	= 0;
+		uint64 StatsVersion		= 0;
+		uint64 EffectsVersion	= 0;
+		// Frames the actor has been settled for
+		int32 SettledFrames		= 0;
+		// True if this node put the actor to sleep, so it never wakes an actor the game put to sleep
+		bool bMadeDormant		= false;
+	};
+
+	// True if the actor is dead, or idle, as far as the dormancy settings go. Effects may be null.
+	bool IsSettled(const AActor* Actor, const UVitalityWelfareComponent* Welfare,
+		const UVitalityEffectsComponent* Effects) const;
+
+	TArray<FTrackedActor> Actors_;
+	// Gathering and replicating run one connection at a time, so a single list is reused
+	FActorRepListRefView ReplicationList_;
+	// The connection's viewer welfare components, looked up once per gather instead of once per actor
+	TArray<const UVitalityWelfareComponent*> ViewerWelfares_;
+};
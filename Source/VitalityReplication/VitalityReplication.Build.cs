@@ -0,0 +1,31 @@
+// Copyright Take Five Games, LLC 2023 - All Rights Reserved
+
+using UnrealBuildTool;
+
+// Replication Graph support for actors with vitality components. Only games that
+// run a replication graph need this module. Not loaded by default: those games enable
+// ReplicationGraph and add this module to their own module's dependencies.
+public class VitalityReplication : ModuleRules
+{
+	public VitalityReplication(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Core",
+				"CoreUObject",
+				"Engine",
+				"ReplicationGraph"
+			}
+			);
+
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"VitalityMatters"
+			}
+			);
+	}
+}